@@ -0,0 +1,756 @@
+/*
+ *                                Copyright (C) 2015 by Rafael Santiago
+ *
+ * This is a free software. You can redistribute it and/or modify under
+ * the terms of the GNU General Public License version 2.
+ *
+ */
+#include "alerts.h"
+#include "pacer.h"
+#include "memory.h"
+#include "cpus.h"
+#ifdef __linux
+#include "linux/tail.h"
+#endif
+#include <stdio.h>
+#include <string.h>
+#include <ctype.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+//  INFO(Santiago): the alert correlation reads the ground truth stream of the manifest and follows an
+//                  alert file written by an IDS, both from the same thread. Each packet sent takes an
+//                  entry in the bucket of its 5-tuple (the newest packet of a 5-tuple wins), an alert
+//                  looks its 5-tuple up there in both directions and, when found inside the window,
+//                  marks that packet as detected. The latency is the time between the packet leaving
+//                  and the alert being read from the file. A full bucket first reuses the entries out
+//                  of the window, then the oldest one, an undetected packet still inside the window
+//                  lost this way is counted as evicted.
+//
+//                  Two formats are understood, told apart line by line: Suricata's eve.json (one JSON
+//                  object per line, only the "alert" events count) and Snort's alert_fast. The JSON
+//                  is scanned in a single pass without building anything, only the scalars of the
+//                  outer object are looked at. ICMP is matched by the addresses alone, alert_fast does
+//                  not tell the type and the code.
+
+#define PIG_ALERTS_ROTATION_CHECK 1000000000ULL
+
+static size_t hash_tuple(const unsigned int src_addr, const unsigned int dst_addr, const unsigned int ports, const unsigned char proto);
+
+static pig_alert_entry_ctx *get_entry(pig_alerts_ctx *alerts, const unsigned int src_addr, const unsigned int dst_addr, const unsigned short src_port, const unsigned short dst_port, const unsigned char proto);
+
+static size_t parse_ipv4(const char *data, const size_t data_size, unsigned int *addr);
+
+static size_t parse_number(const char *data, const size_t data_size, unsigned int *number);
+
+static unsigned char get_proto(const char *name, const size_t name_size);
+
+static int get_digits(const char *data, const size_t data_size, size_t *p, const size_t digits_nr, unsigned int *value);
+
+static unsigned long long get_fraction_ns(const char *data, const size_t data_size, size_t *p);
+
+static unsigned long long get_epoch_days(const unsigned int year, const unsigned int month, const unsigned int day);
+
+static unsigned long long parse_eve_timestamp(const char *data, const size_t data_size);
+
+static unsigned long long parse_fast_timestamp(const char *data, const size_t data_size);
+
+static pig_alert_entry_ctx *find_alerted_entry(pig_alerts_ctx *alerts, const pig_alert_ctx *alert);
+
+static size_t scan_string(const char *line, const size_t line_size, size_t p, char *out, const size_t out_size, size_t *out_len);
+
+static int scan_eve(const char *line, const size_t line_size, pig_alert_ctx *alert);
+
+static int scan_fast(const char *line, const size_t line_size, pig_alert_ctx *alert);
+
+static void process_line(pig_alerts_ctx *alerts, const char *line, const size_t line_size, const unsigned long long now);
+
+static int open_alerts(pig_alerts_ctx *alerts, const int at_end);
+
+static void close_alerts(pig_alerts_ctx *alerts);
+
+static void check_rotation(pig_alerts_ctx *alerts);
+
+static size_t read_alerts(pig_alerts_ctx *alerts);
+
+static int wait_alerts(pig_alerts_ctx *alerts);
+
+static void report_alerts(pig_alerts_ctx *alerts);
+
+static void on_record(const pig_manifest_record_ctx *record, void *arg);
+
+static void *follow_alerts(void *arg);
+
+static size_t hash_tuple(const unsigned int src_addr, const unsigned int dst_addr, const unsigned int ports, const unsigned char proto) {
+    unsigned int h = src_addr * 0x9e3779b1;
+    h ^= dst_addr * 0x85ebca6b;
+    h ^= ports * 0xc2b2ae35;
+    h ^= proto;
+    h ^= h >> 15;
+    h *= 0x2c1b3c6d;
+    h ^= h >> 13;
+    return (h & (PIG_ALERTS_TABLE_SIZE / PIG_ALERTS_BUCKET_SIZE - 1)) * PIG_ALERTS_BUCKET_SIZE;
+}
+
+static pig_alert_entry_ctx *get_entry(pig_alerts_ctx *alerts, const unsigned int src_addr, const unsigned int dst_addr, const unsigned short src_port, const unsigned short dst_port, const unsigned char proto) {
+    pig_alert_entry_ctx *bucket = NULL;
+    unsigned int ports = (proto == 1 ? 0 : ((unsigned int)src_port << 16) | dst_port);
+    size_t e = 0;
+    bucket = &alerts->table[hash_tuple(src_addr, dst_addr, ports, proto)];
+    for (e = 0; e < PIG_ALERTS_BUCKET_SIZE; e++) {
+        if (bucket[e].signature > 0 && bucket[e].src_addr == src_addr && bucket[e].dst_addr == dst_addr &&
+            bucket[e].ports == ports && bucket[e].proto == proto) {
+            return &bucket[e];
+        }
+    }
+    return NULL;
+}
+
+static size_t parse_ipv4(const char *data, const size_t data_size, unsigned int *addr) {
+    size_t p = 0, o = 0, n = 0;
+    unsigned int octet = 0;
+    *addr = 0;
+    for (o = 0; o < 4; o++) {
+        if (o > 0) {
+            if (p >= data_size || data[p] != '.') {
+                return 0;
+            }
+            p++;
+        }
+        n = parse_number(&data[p], data_size - p, &octet);
+        if (n == 0 || n > 3 || octet > 255) {
+            return 0;
+        }
+        *addr = (*addr << 8) | octet;
+        p += n;
+    }
+    return p;
+}
+
+static size_t parse_number(const char *data, const size_t data_size, unsigned int *number) {
+    size_t p = 0;
+    *number = 0;
+    for (p = 0; p < data_size && data[p] >= '0' && data[p] <= '9' && p < 10; p++) {
+        *number = *number * 10 + (data[p] - '0');
+    }
+    return p;
+}
+
+static unsigned char get_proto(const char *name, const size_t name_size) {
+    unsigned int number = 0;
+    size_t skip = 0;
+    if (name_size == 3 && strncmp(name, "TCP", 3) == 0) {
+        return 6;
+    }
+    if (name_size == 3 && strncmp(name, "UDP", 3) == 0) {
+        return 17;
+    }
+    if (name_size == 4 && strncmp(name, "ICMP", 4) == 0) {
+        return 1;
+    }
+    //  INFO(Santiago): anything else is written as a number, Snort prefixes it with "PROTO:".
+    skip = (name_size > 6 && strncmp(name, "PROTO:", 6) == 0 ? 6 : 0);
+    if (parse_number(&name[skip], name_size - skip, &number) == 0 || number > 255) {
+        return 0;
+    }
+    return number;
+}
+
+static int get_digits(const char *data, const size_t data_size, size_t *p, const size_t digits_nr, unsigned int *value) {
+    size_t d = 0;
+    *value = 0;
+    for (d = 0; d < digits_nr; d++, (*p)++) {
+        if (*p >= data_size || !isdigit((unsigned char)data[*p])) {
+            return 0;
+        }
+        *value = *value * 10 + (data[*p] - '0');
+    }
+    return 1;
+}
+
+static unsigned long long get_fraction_ns(const char *data, const size_t data_size, size_t *p) {
+    unsigned long long ns = 0, scale = 100000000ULL;
+    if (*p >= data_size || data[*p] != '.') {
+        return 0;
+    }
+    for ((*p)++; *p < data_size && isdigit((unsigned char)data[*p]); (*p)++) {
+        ns += (data[*p] - '0') * scale;
+        scale /= 10;
+    }
+    return ns;
+}
+
+static unsigned long long get_epoch_days(const unsigned int year, const unsigned int month, const unsigned int day) {
+    //  INFO(Santiago): days since 1970-01-01 of a date of the proleptic Gregorian calendar (years from 1970 on).
+    unsigned long long y = year - (month <= 2), era = y / 400, yoe = y - era * 400, doy = 0, doe = 0;
+    doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+    doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + doe - 719468;
+}
+
+static unsigned long long parse_eve_timestamp(const char *data, const size_t data_size) {
+    //  INFO(Santiago): "2015-10-17T10:00:00.000000+0000", the offset may also come as "+00:00" or "Z".
+    unsigned int year = 0, month = 0, day = 0, hour = 0, min = 0, sec = 0, tz_hour = 0, tz_min = 0;
+    unsigned long long ns = 0, secs = 0, offset = 0;
+    size_t p = 0;
+    int sign = 0;
+    if (!get_digits(data, data_size, &p, 4, &year) || year < 1970 || p >= data_size || data[p++] != '-' ||
+        !get_digits(data, data_size, &p, 2, &month) || month < 1 || month > 12 || p >= data_size || data[p++] != '-' ||
+        !get_digits(data, data_size, &p, 2, &day) || day < 1 || day > 31 || p >= data_size || data[p++] != 'T' ||
+        !get_digits(data, data_size, &p, 2, &hour) || p >= data_size || data[p++] != ':' ||
+        !get_digits(data, data_size, &p, 2, &min) || p >= data_size || data[p++] != ':' ||
+        !get_digits(data, data_size, &p, 2, &sec)) {
+        return 0;
+    }
+    ns = get_fraction_ns(data, data_size, &p);
+    if (p < data_size && (data[p] == '+' || data[p] == '-')) {
+        sign = (data[p++] == '-') ? -1 : 1;
+        if (!get_digits(data, data_size, &p, 2, &tz_hour)) {
+            return 0;
+        }
+        p += (p < data_size && data[p] == ':');
+        if (!get_digits(data, data_size, &p, 2, &tz_min)) {
+            return 0;
+        }
+        offset = tz_hour * 3600ULL + tz_min * 60ULL;
+    }
+    secs = get_epoch_days(year, month, day) * 86400ULL + hour * 3600ULL + min * 60ULL + sec;
+    //  INFO(Santiago): a local time ahead of UTC (+hhmm) is later than the same UTC time would be.
+    secs = (sign > 0) ? secs - offset : secs + offset;
+    return secs * 1000000000ULL + ns;
+}
+
+static unsigned long long parse_fast_timestamp(const char *data, const size_t data_size) {
+    //  INFO(Santiago): "10/17/2015-10:00:00.000000" (Suricata) or "10/17-10:00:00.000000" (Snort), in local time.
+    //                  Without a year the current one is taken.
+    unsigned int year = 0, month = 0, day = 0, hour = 0, min = 0, sec = 0;
+    unsigned long long ns = 0;
+    struct tm tm;
+    time_t t = 0;
+    size_t p = 0;
+    if (!get_digits(data, data_size, &p, 2, &month) || month < 1 || month > 12 || p >= data_size || data[p++] != '/' ||
+        !get_digits(data, data_size, &p, 2, &day) || day < 1 || day > 31 || p >= data_size) {
+        return 0;
+    }
+    if (data[p] == '/') {
+        p++;
+        if (!get_digits(data, data_size, &p, 4, &year) || year < 1970 || p >= data_size) {
+            return 0;
+        }
+    }
+    if (data[p++] != '-' || !get_digits(data, data_size, &p, 2, &hour) || p >= data_size || data[p++] != ':' ||
+        !get_digits(data, data_size, &p, 2, &min) || p >= data_size || data[p++] != ':' ||
+        !get_digits(data, data_size, &p, 2, &sec)) {
+        return 0;
+    }
+    ns = get_fraction_ns(data, data_size, &p);
+    t = time(NULL);
+    localtime_r(&t, &tm);
+    if (year > 0) {
+        tm.tm_year = year - 1900;
+    }
+    tm.tm_mon = month - 1;
+    tm.tm_mday = day;
+    tm.tm_hour = hour;
+    tm.tm_min = min;
+    tm.tm_sec = sec;
+    tm.tm_isdst = -1;
+    t = mktime(&tm);
+    if (t == (time_t)-1 || t < 0) {
+        return 0;
+    }
+    return (unsigned long long)t * 1000000000ULL + ns;
+}
+
+static size_t scan_string(const char *line, const size_t line_size, size_t p, char *out, const size_t out_size, size_t *out_len) {
+    //  INFO(Santiago): p is at the opening quote, the returned position is right after the closing one.
+    //                  The escapes are kept as they are, the values that matter never have any.
+    *out_len = 0;
+    for (p++; p < line_size && line[p] != '"'; p++) {
+        if (line[p] == '\\' && p + 1 < line_size) {
+            p++;
+        }
+        if (*out_len + 1 < out_size) {
+            out[(*out_len)++] = line[p];
+        }
+    }
+    out[*out_len] = 0;
+    return p + 1;
+}
+
+static int scan_eve(const char *line, const size_t line_size, pig_alert_ctx *alert) {
+    char key[32], value[64];
+    size_t p = 0, key_len = 0, value_len = 0;
+    unsigned int number = 0;
+    int depth = 0, is_alert = 0, has_src = 0, has_dst = 0;
+    while (p < line_size) {
+        switch (line[p]) {
+            case '{':
+            case '[':
+                depth++;
+                p++;
+                break;
+
+            case '}':
+            case ']':
+                depth--;
+                p++;
+                break;
+
+            case '"':
+                p = scan_string(line, line_size, p, key, sizeof(key), &key_len);
+                if (depth != 1) {
+                    break;
+                }
+                for (; p < line_size && (line[p] == ' ' || line[p] == '\t'); p++)
+                    ;
+                if (p >= line_size || line[p] != ':') {
+                    break;
+                }
+                for (p++; p < line_size && (line[p] == ' ' || line[p] == '\t'); p++)
+                    ;
+                if (p < line_size && line[p] == '"') {
+                    p = scan_string(line, line_size, p, value, sizeof(value), &value_len);
+                } else {
+                    for (value_len = 0; p < line_size && line[p] != ',' && line[p] != '}' && line[p] != '{' &&
+                                        line[p] != '[' && line[p] != ' '; p++) {
+                        if (value_len + 1 < sizeof(value)) {
+                            value[value_len++] = line[p];
+                        }
+                    }
+                    value[value_len] = 0;
+                }
+                if (strcmp(key, "event_type") == 0) {
+                    is_alert = (strcmp(value, "alert") == 0);
+                } else if (strcmp(key, "src_ip") == 0) {
+                    has_src = (parse_ipv4(value, value_len, &alert->src_addr) == value_len);
+                } else if (strcmp(key, "dest_ip") == 0) {
+                    has_dst = (parse_ipv4(value, value_len, &alert->dst_addr) == value_len);
+                } else if (strcmp(key, "src_port") == 0 && parse_number(value, value_len, &number) > 0) {
+                    alert->src_port = number;
+                } else if (strcmp(key, "dest_port") == 0 && parse_number(value, value_len, &number) > 0) {
+                    alert->dst_port = number;
+                } else if (strcmp(key, "proto") == 0) {
+                    alert->proto = get_proto(value, value_len);
+                } else if (strcmp(key, "timestamp") == 0) {
+                    alert->timestamp = parse_eve_timestamp(value, value_len);
+                }
+                break;
+
+            default:
+                p++;
+                break;
+        }
+    }
+    if (!is_alert) {
+        return 0;
+    }
+    return ((has_src && has_dst && alert->proto != 0) ? 1 : -1);
+}
+
+static int scan_fast(const char *line, const size_t line_size, pig_alert_ctx *alert) {
+    size_t p = line_size, n = 0, proto = 0;
+    unsigned int number = 0;
+    //  INFO(Santiago): "... [**] {TCP} 10.0.0.1:1000 -> 10.0.0.2:80", the message may hold braces too,
+    //                  so the protocol is the last one.
+    alert->timestamp = parse_fast_timestamp(line, line_size);
+    while (p > 0 && line[p - 1] != '{') {
+        p--;
+    }
+    if (p == 0) {
+        return -1;
+    }
+    for (proto = p; p < line_size && line[p] != '}'; p++)
+        ;
+    if (p >= line_size || (alert->proto = get_proto(&line[proto], p - proto)) == 0) {
+        return -1;
+    }
+    for (p++; p < line_size && line[p] == ' '; p++)
+        ;
+    if ((n = parse_ipv4(&line[p], line_size - p, &alert->src_addr)) == 0) {
+        return -1;
+    }
+    p += n;
+    if (p < line_size && line[p] == ':') {
+        p++;
+        p += parse_number(&line[p], line_size - p, &number);
+        alert->src_port = number;
+    }
+    if (p + 4 > line_size || strncmp(&line[p], " -> ", 4) != 0) {
+        return -1;
+    }
+    p += 4;
+    if ((n = parse_ipv4(&line[p], line_size - p, &alert->dst_addr)) == 0) {
+        return -1;
+    }
+    p += n;
+    if (p < line_size && line[p] == ':') {
+        p++;
+        parse_number(&line[p], line_size - p, &number);
+        alert->dst_port = number;
+    }
+    return 1;
+}
+
+int pig_alerts_parse(const char *line, const size_t line_size, pig_alert_ctx *alert) {
+    size_t p = 0;
+    memset(alert, 0, sizeof(pig_alert_ctx));
+    for (p = 0; p < line_size && (line[p] == ' ' || line[p] == '\t' || line[p] == '\r'); p++)
+        ;
+    if (p == line_size) {
+        return 0;
+    }
+    if (line[p] == '{') {
+        return scan_eve(&line[p], line_size - p, alert);
+    }
+    return scan_fast(&line[p], line_size - p, alert);
+}
+
+pig_alerts_ctx *mk_pig_alerts(const char *filepath, pigsty_entry_ctx **signatures, const size_t signatures_count, const unsigned long long window) {
+    pig_alerts_ctx *alerts = NULL;
+    if (signatures == NULL || signatures_count == 0) {
+        return NULL;
+    }
+    alerts = (pig_alerts_ctx *) pig_newseg(sizeof(pig_alerts_ctx));
+    memset(alerts, 0, sizeof(pig_alerts_ctx));
+    if (filepath != NULL) {
+        alerts->filepath = (char *) pig_newseg(strlen(filepath) + 1);
+        strcpy(alerts->filepath, filepath);
+    }
+    alerts->fd = -1;
+    alerts->watch_fd = -1;
+    alerts->signatures = signatures;
+    alerts->signatures_count = signatures_count;
+    alerts->window = window;
+    alerts->table = (pig_alert_entry_ctx *) pig_newseg(sizeof(pig_alert_entry_ctx) * PIG_ALERTS_TABLE_SIZE);
+    memset(alerts->table, 0, sizeof(pig_alert_entry_ctx) * PIG_ALERTS_TABLE_SIZE);
+    alerts->stats = (pig_alert_stats_ctx *) pig_newseg(sizeof(pig_alert_stats_ctx) * signatures_count);
+    memset(alerts->stats, 0, sizeof(pig_alert_stats_ctx) * signatures_count);
+    return alerts;
+}
+
+void del_pig_alerts(pig_alerts_ctx *alerts) {
+    if (alerts == NULL) {
+        return;
+    }
+    pig_alerts_stop(alerts, 0);
+    close_alerts(alerts);
+    free(alerts->filepath);
+    free(alerts->table);
+    free(alerts->stats);
+    free(alerts);
+}
+
+void pig_alerts_index(pig_alerts_ctx *alerts, const pig_manifest_record_ctx *record) {
+    pig_alert_entry_ctx *bucket = NULL, *entry = NULL;
+    unsigned int ports = 0;
+    size_t e = 0;
+    if (record->signature >= alerts->signatures_count) {
+        return;
+    }
+    ports = (record->proto == 1 ? 0 : ((unsigned int)record->src_port << 16) | record->dst_port);
+    bucket = &alerts->table[hash_tuple(record->src_addr, record->dst_addr, ports, record->proto)];
+    entry = get_entry(alerts, record->src_addr, record->dst_addr, record->src_port, record->dst_port, record->proto);
+    for (e = 0; entry == NULL && e < PIG_ALERTS_BUCKET_SIZE; e++) {
+        if (bucket[e].signature == 0 || record->timestamp > bucket[e].sent_at + alerts->window) {
+            entry = &bucket[e];
+        }
+    }
+    if (entry == NULL) {
+        entry = &bucket[0];
+        for (e = 1; e < PIG_ALERTS_BUCKET_SIZE; e++) {
+            if (bucket[e].sent_at < entry->sent_at) {
+                entry = &bucket[e];
+            }
+        }
+        if (!entry->is_detected) {
+            alerts->evicted++;
+        }
+    }
+    entry->src_addr = record->src_addr;
+    entry->dst_addr = record->dst_addr;
+    entry->ports = ports;
+    entry->proto = record->proto;
+    entry->is_detected = 0;
+    entry->signature = record->signature + 1;
+    entry->sent_at = record->timestamp;
+    alerts->stats[record->signature].sent++;
+}
+
+static pig_alert_entry_ctx *find_alerted_entry(pig_alerts_ctx *alerts, const pig_alert_ctx *alert) {
+    pig_alert_entry_ctx *entry = get_entry(alerts, alert->src_addr, alert->dst_addr, alert->src_port, alert->dst_port, alert->proto);
+    if (entry == NULL) {
+        //  INFO(Santiago): a rule may also fire on the answer, which goes the other way around.
+        entry = get_entry(alerts, alert->dst_addr, alert->src_addr, alert->dst_port, alert->src_port, alert->proto);
+    }
+    return entry;
+}
+
+int pig_alerts_match(pig_alerts_ctx *alerts, const pig_alert_ctx *alert, const unsigned long long now) {
+    pig_alert_entry_ctx *entry = NULL;
+    pig_alert_stats_ctx *stats = NULL;
+    unsigned long long latency = 0, alerted_at = 0;
+    alerts->alerts++;
+    entry = find_alerted_entry(alerts, alert);
+    if (entry == NULL && alerts->manifest != NULL && pig_manifest_drain(alerts->manifest) > 0) {
+        //  WARN(Santiago): the packet may have been sent after the last drain, this runs in the thread that
+        //                  reads the manifest, so it can be drained again here.
+        entry = find_alerted_entry(alerts, alert);
+    }
+    if (entry == NULL) {
+        alerts->unmatched++;
+        return 0;
+    }
+    //  INFO(Santiago): the IDS's own time of the alert, the time it was read here only when the line has none.
+    alerted_at = (alert->timestamp > 0 ? alert->timestamp : now);
+    latency = (alerted_at > entry->sent_at ? alerted_at - entry->sent_at : 0);
+    if (latency > alerts->window) {
+        alerts->late++;
+        return 0;
+    }
+    stats = &alerts->stats[entry->signature - 1];
+    stats->alerts++;
+    if (!entry->is_detected) {
+        entry->is_detected = 1;
+        stats->detected++;
+        pig_rtt_hist_add(&stats->latency, latency);
+        pig_rtt_hist_add(&alerts->latency, latency);
+    }
+    return 1;
+}
+
+static void process_line(pig_alerts_ctx *alerts, const char *line, const size_t line_size, const unsigned long long now) {
+    pig_alert_ctx alert;
+    alerts->lines++;
+    switch (pig_alerts_parse(line, line_size, &alert)) {
+        case 1:
+            pig_alerts_match(alerts, &alert, now);
+            break;
+
+        case -1:
+            alerts->unparsable++;
+            break;
+    }
+}
+
+void pig_alerts_feed(pig_alerts_ctx *alerts, const char *data, const size_t data_size, const unsigned long long now) {
+    size_t p = 0, e = 0;
+    while (p < data_size) {
+        for (e = p; e < data_size && data[e] != '\n'; e++)
+            ;
+        if (e == data_size) {
+            //  INFO(Santiago): the rest of the line is still to be written, a line too long to be kept
+            //                  is skipped up to its end.
+            if (!alerts->is_skipping && alerts->buf_size + (e - p) <= sizeof(alerts->buf)) {
+                memcpy(&alerts->buf[alerts->buf_size], &data[p], e - p);
+                alerts->buf_size += e - p;
+            } else {
+                alerts->is_skipping = 1;
+                alerts->buf_size = 0;
+            }
+            return;
+        }
+        if (alerts->is_skipping) {
+            alerts->is_skipping = 0;
+            alerts->lines++;
+            alerts->unparsable++;
+        } else if (alerts->buf_size > 0) {
+            if (alerts->buf_size + (e - p) <= sizeof(alerts->buf)) {
+                memcpy(&alerts->buf[alerts->buf_size], &data[p], e - p);
+                process_line(alerts, alerts->buf, alerts->buf_size + (e - p), now);
+            } else {
+                alerts->lines++;
+                alerts->unparsable++;
+            }
+            alerts->buf_size = 0;
+        } else {
+            process_line(alerts, &data[p], e - p, now);
+        }
+        p = e + 1;
+    }
+}
+
+static int open_alerts(pig_alerts_ctx *alerts, const int at_end) {
+    struct stat st;
+    alerts->fd = open(alerts->filepath, O_RDONLY);
+    if (alerts->fd == -1) {
+        return 0;
+    }
+    fstat(alerts->fd, &st);
+    alerts->inode = st.st_ino;
+    alerts->offset = 0;
+    //  INFO(Santiago): what was there before pig started has nothing to do with this run.
+    if (at_end) {
+        alerts->offset = lseek(alerts->fd, 0, SEEK_END);
+    }
+    alerts->buf_size = 0;
+    alerts->is_skipping = 0;
+#ifdef __linux
+    alerts->watch_fd = lin_tail_watch(alerts->filepath);
+#endif
+    return 1;
+}
+
+static void close_alerts(pig_alerts_ctx *alerts) {
+    if (alerts->fd != -1) {
+        close(alerts->fd);
+        alerts->fd = -1;
+    }
+#ifdef __linux
+    lin_tail_close(alerts->watch_fd);
+#endif
+    alerts->watch_fd = -1;
+}
+
+static void check_rotation(pig_alerts_ctx *alerts) {
+    struct stat st;
+    if (alerts->fd == -1) {
+        open_alerts(alerts, 0);
+        return;
+    }
+    if (stat(alerts->filepath, &st) != 0) {
+        return;
+    }
+    //  INFO(Santiago): a new file took the path or this one was truncated, both start over.
+    if ((unsigned long long)st.st_ino != alerts->inode || (unsigned long long)st.st_size < alerts->offset) {
+        read_alerts(alerts);
+        close_alerts(alerts);
+        open_alerts(alerts, 0);
+    }
+}
+
+static size_t read_alerts(pig_alerts_ctx *alerts) {
+    char chunk[PIG_ALERTS_BUFFER_SIZE];
+    ssize_t size = 0;
+    size_t total = 0;
+    if (alerts->fd == -1) {
+        return 0;
+    }
+    while ((size = read(alerts->fd, chunk, sizeof(chunk))) > 0) {
+        pig_alerts_feed(alerts, chunk, size, pig_wall_clock_ns());
+        alerts->offset += size;
+        total += size;
+    }
+    return total;
+}
+
+static int wait_alerts(pig_alerts_ctx *alerts) {
+    //  INFO(Santiago): the wait is short anyway, the manifest rings must be drained regularly.
+#ifdef __linux
+    if (alerts->watch_fd != -1) {
+        return ((lin_tail_wait(alerts->watch_fd, PIG_ALERTS_IDLE) & LIN_TAIL_MOVED) != 0);
+    }
+#endif
+    pig_sleep_ns(PIG_ALERTS_IDLE * 1000000ULL);
+    return 0;
+}
+
+static void report_alerts(pig_alerts_ctx *alerts) {
+    unsigned long long sent = 0, detected = 0;
+    char summary[256];
+    size_t s = 0;
+    for (s = 0; s < alerts->signatures_count; s++) {
+        sent += alerts->stats[s].sent;
+        detected += alerts->stats[s].detected;
+    }
+    printf("pig INFO: %llu alert(s) so far, %llu of %llu packet(s) detected (%.2f%%)", alerts->alerts, detected, sent,
+           (sent > 0 ? (double)detected * 100.0 / (double)sent : 0.0));
+    if (alerts->latency.count > 0) {
+        pig_rtt_hist_summary(&alerts->latency, summary, sizeof(summary));
+        printf(", latency: %s", summary);
+    }
+    printf(".\n");
+}
+
+static void on_record(const pig_manifest_record_ctx *record, void *arg) {
+    pig_alerts_index((pig_alerts_ctx *)arg, record);
+}
+
+static void *follow_alerts(void *arg) {
+    pig_alerts_ctx *alerts = (pig_alerts_ctx *)arg;
+    unsigned long long now = 0, checked_at = 0;
+    int is_moved = 0;
+    alerts->reported_at = checked_at = pig_wall_clock_ns();
+    while (!__atomic_load_n(&alerts->should_stop, __ATOMIC_ACQUIRE)) {
+        pig_manifest_drain(alerts->manifest);
+        is_moved = (read_alerts(alerts) == 0 && wait_alerts(alerts));
+        now = pig_wall_clock_ns();
+        if (is_moved || now - checked_at >= PIG_ALERTS_ROTATION_CHECK) {
+            check_rotation(alerts);
+            checked_at = now;
+        }
+        if (alerts->is_reporting && now - alerts->reported_at >= PIG_ALERTS_REPORT_INTERVAL) {
+            report_alerts(alerts);
+            alerts->reported_at = now;
+        }
+    }
+    pig_manifest_drain(alerts->manifest);
+    read_alerts(alerts);
+    return NULL;
+}
+
+int pig_alerts_start(pig_alerts_ctx *alerts, pig_manifest_ctx *manifest, const int is_reporting) {
+    if (alerts == NULL || manifest == NULL || alerts->filepath == NULL) {
+        return 0;
+    }
+    if (!open_alerts(alerts, 1)) {
+        printf("pig INFO: \"%s\" does not exist yet, it will be read once it shows up.\n", alerts->filepath);
+    }
+    alerts->manifest = manifest;
+    alerts->is_reporting = is_reporting;
+    pig_manifest_set_reader(manifest, on_record, alerts);
+    alerts->should_stop = 0;
+    if (!pig_mk_helper_thread(&alerts->thread, follow_alerts, alerts)) {
+        printf("pig PANIC: unable to start following the alerts.\n");
+        pig_manifest_set_reader(manifest, NULL, NULL);
+        close_alerts(alerts);
+        return 0;
+    }
+    alerts->has_thread = 1;
+    return 1;
+}
+
+void pig_alerts_stop(pig_alerts_ctx *alerts, const unsigned long long wait) {
+    if (alerts == NULL || !alerts->has_thread) {
+        return;
+    }
+    //  INFO(Santiago): the IDS is given some time to tell about the last packets.
+    if (wait > 0) {
+        pig_sleep_ns(wait);
+    }
+    __atomic_store_n(&alerts->should_stop, 1, __ATOMIC_RELEASE);
+    pthread_join(alerts->thread, NULL);
+    alerts->has_thread = 0;
+    pig_manifest_set_reader(alerts->manifest, NULL, NULL);
+    close_alerts(alerts);
+}
+
+void pig_alerts_stats(const pig_alerts_ctx *alerts) {
+    const pig_alert_stats_ctx *stats = NULL;
+    char summary[256];
+    size_t s = 0;
+    if (alerts == NULL) {
+        return;
+    }
+    printf("pig INFO: %llu line(s) read from \"%s\": %llu alert(s), %llu not matching any packet sent, %llu too late, %llu not understood.\n",
+           alerts->lines, alerts->filepath, alerts->alerts, alerts->unmatched, alerts->late, alerts->unparsable);
+    if (alerts->evicted > 0) {
+        printf("pig WARNING: %llu packet(s) were dropped from the alert table before their window ended, their alerts may be "
+               "counted as not matching.\n", alerts->evicted);
+    }
+    for (s = 0; s < alerts->signatures_count; s++) {
+        stats = &alerts->stats[s];
+        if (stats->sent == 0) {
+            continue;
+        }
+        printf("pig INFO: signature \"%s\": %llu sent, %llu detected (%.2f%%), %llu missed, %llu alert(s).\n",
+               alerts->signatures[s]->signature_name, stats->sent, stats->detected, (double)stats->detected * 100.0 / (double)stats->sent,
+               stats->sent - stats->detected, stats->alerts);
+        if (stats->latency.count > 0) {
+            pig_rtt_hist_summary(&stats->latency, summary, sizeof(summary));
+            printf("pig INFO: signature \"%s\" detection latency: %s.\n", alerts->signatures[s]->signature_name, summary);
+        }
+    }
+}
@@ -0,0 +1,103 @@
+/*
+ *                                Copyright (C) 2015 by Rafael Santiago
+ *
+ * This is a free software. You can redistribute it and/or modify under
+ * the terms of the GNU General Public License version 2.
+ *
+ */
+#ifndef PIG_ALERTS_H
+#define PIG_ALERTS_H 1
+
+#include "types.h"
+#include "manifest.h"
+#include "rtt.h"
+#include <pthread.h>
+
+#define PIG_ALERTS_TABLE_SIZE (1 << 18)
+
+#define PIG_ALERTS_BUCKET_SIZE 4
+
+#define PIG_ALERTS_BUFFER_SIZE 65536
+
+#define PIG_ALERTS_IDLE 5
+
+#define PIG_ALERTS_DEFAULT_WAIT 2000000000ULL
+
+#define PIG_ALERTS_DEFAULT_WINDOW 5000000000ULL
+
+#define PIG_ALERTS_REPORT_INTERVAL 1000000000ULL
+
+typedef struct _pig_alert {
+    unsigned int src_addr;
+    unsigned int dst_addr;
+    unsigned short src_port;
+    unsigned short dst_port;
+    unsigned char proto;
+    unsigned long long timestamp;
+}pig_alert_ctx;
+
+typedef struct _pig_alert_entry {
+    unsigned int src_addr;
+    unsigned int dst_addr;
+    unsigned int ports;
+    unsigned char proto;
+    unsigned char is_detected;
+    unsigned int signature;
+    unsigned long long sent_at;
+}pig_alert_entry_ctx;
+
+typedef struct _pig_alert_stats {
+    unsigned long long sent;
+    unsigned long long detected;
+    unsigned long long alerts;
+    pig_rtt_hist_ctx latency;
+}pig_alert_stats_ctx;
+
+typedef struct _pig_alerts {
+    char *filepath;
+    int fd;
+    int watch_fd;
+    unsigned long long inode;
+    unsigned long long offset;
+    char buf[PIG_ALERTS_BUFFER_SIZE];
+    size_t buf_size;
+    int is_skipping;
+    pigsty_entry_ctx **signatures;
+    size_t signatures_count;
+    pig_manifest_ctx *manifest;
+    pig_alert_entry_ctx *table;
+    pig_alert_stats_ctx *stats;
+    pig_rtt_hist_ctx latency;
+    unsigned long long window;
+    unsigned long long lines;
+    unsigned long long alerts;
+    unsigned long long unmatched;
+    unsigned long long late;
+    unsigned long long unparsable;
+    unsigned long long evicted;
+    unsigned long long reported_at;
+    int is_reporting;
+    pthread_t thread;
+    int has_thread;
+    int should_stop;
+}pig_alerts_ctx;
+
+pig_alerts_ctx *mk_pig_alerts(const char *filepath, pigsty_entry_ctx **signatures, const size_t signatures_count, const unsigned long long window);
+
+void del_pig_alerts(pig_alerts_ctx *alerts);
+
+int pig_alerts_parse(const char *line, const size_t line_size, pig_alert_ctx *alert);
+
+void pig_alerts_index(pig_alerts_ctx *alerts, const pig_manifest_record_ctx *record);
+
+int pig_alerts_match(pig_alerts_ctx *alerts, const pig_alert_ctx *alert, const unsigned long long now);
+
+void pig_alerts_feed(pig_alerts_ctx *alerts, const char *data, const size_t data_size, const unsigned long long now);
+
+int pig_alerts_start(pig_alerts_ctx *alerts, pig_manifest_ctx *manifest, const int is_reporting);
+
+void pig_alerts_stop(pig_alerts_ctx *alerts, const unsigned long long wait);
+
+void pig_alerts_stats(const pig_alerts_ctx *alerts);
+
+#endif
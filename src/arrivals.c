@@ -0,0 +1,357 @@
+/*
+ *                                Copyright (C) 2015 by Rafael Santiago
+ *
+ * This is a free software. You can redistribute it and/or modify under
+ * the terms of the GNU General Public License version 2.
+ *
+ */
+#include "arrivals.h"
+#include "pacer.h"
+#include "mkrnd.h"
+#include "memory.h"
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+//  INFO(Santiago): the gaps are drawn by inverse transform sampling. Instead of calling log()/pow()
+//                  for every packet, the inverse CDF of the unit distribution is tabulated once and the
+//                  random number picks a bucket (the high bits) and a point inside it (the low bits).
+//                  The last bucket holds an unbounded tail. Both tails are self-similar, so it is
+//                  sampled again from the table: shifted for the exponential (memoryless) and scaled
+//                  for the Pareto (scale invariant).
+
+#define PIG_ARRIVALS_FRAC_BITS (32 - PIG_ARRIVALS_TABLE_BITS)
+
+static double *mk_unit_table(const pig_arrival_dist_type_t type, const double alpha);
+
+static double sample_unit(const double *table, const int is_scaled_tail);
+
+static int parse_dist_params(const char *data, double *params, const size_t params_nr, const int first_is_number);
+
+static void add_stream(pig_arrivals_ctx *arrivals, const pig_arrival_dist_ctx *dist, const long signature_index);
+
+static void swap_rnd_state(pig_arrivals_ctx *arrivals);
+
+static int parse_arrivals_spec(pig_arrivals_ctx *arrivals, const char *spec, pigsty_entry_ctx **signatures, const size_t signatures_count, long *owner, long *global);
+
+static double *mk_unit_table(const pig_arrival_dist_type_t type, const double alpha) {
+    double *table = (double *) pig_newseg(sizeof(double) * PIG_ARRIVALS_TABLE_SIZE);
+    double u = 0;
+    size_t i = 0;
+    for (i = 0; i < PIG_ARRIVALS_TABLE_SIZE; i++) {
+        u = (double)i / (double)PIG_ARRIVALS_TABLE_SIZE;
+        table[i] = (type == kArrivalPareto ? pow(1.0 - u, -1.0 / alpha) : -log(1.0 - u));
+    }
+    return table;
+}
+
+static double sample_unit(const double *table, const int is_scaled_tail) {
+    double acc = (is_scaled_tail ? 1.0 : 0.0), value = 0;
+    unsigned int r = 0, i = 0, depth = 0;
+    for (depth = 0; depth < PIG_ARRIVALS_MAX_TAIL; depth++) {
+        r = mk_rnd_u32();
+        i = r >> PIG_ARRIVALS_FRAC_BITS;
+        if (i + 1 < PIG_ARRIVALS_TABLE_SIZE) {
+            value = table[i] + (table[i + 1] - table[i]) *
+                    ((double)(r & ((1u << PIG_ARRIVALS_FRAC_BITS) - 1)) / (double)(1u << PIG_ARRIVALS_FRAC_BITS));
+            return (is_scaled_tail ? acc * value : acc + value);
+        }
+        acc = (is_scaled_tail ? acc * table[PIG_ARRIVALS_TABLE_SIZE - 1] : acc + table[PIG_ARRIVALS_TABLE_SIZE - 1]);
+    }
+    return acc;
+}
+
+static int parse_dist_params(const char *data, double *params, const size_t params_nr, const int first_is_number) {
+    char token[255];
+    const char *dp = data, *colon = NULL;
+    unsigned long long t = 0;
+    size_t p = 0, len = 0;
+    char *end = NULL;
+    for (p = 0; p < params_nr; p++) {
+        if (dp == NULL || *dp == 0) {
+            return 0;
+        }
+        colon = strchr(dp, ':');
+        len = (colon != NULL ? (size_t)(colon - dp) : strlen(dp));
+        if (len == 0 || len >= sizeof(token)) {
+            return 0;
+        }
+        memcpy(token, dp, len);
+        token[len] = 0;
+        if (p == 0 && first_is_number) {
+            params[p] = strtod(token, &end);
+            if (*end != 0) {
+                return 0;
+            }
+        } else {
+            if (!parse_pig_time(token, &t)) {
+                return 0;
+            }
+            params[p] = (double)t;
+        }
+        dp = (colon != NULL ? colon + 1 : NULL);
+    }
+    return (dp == NULL);
+}
+
+int parse_pig_arrival_dist(const char *spec, pig_arrival_dist_ctx *dist) {
+    double params[3];
+    if (spec == NULL || dist == NULL) {
+        return 0;
+    }
+    memset(dist, 0, sizeof(pig_arrival_dist_ctx));
+    if (strncmp(spec, "constant:", 9) == 0) {
+        dist->type = kArrivalConstant;
+        if (!parse_dist_params(spec + 9, params, 1, 0)) {
+            return 0;
+        }
+        dist->mean = params[0];
+    } else if (strncmp(spec, "poisson:", 8) == 0) {
+        dist->type = kArrivalPoisson;
+        if (!parse_dist_params(spec + 8, params, 1, 0) || params[0] <= 0) {
+            return 0;
+        }
+        dist->mean = params[0];
+    } else if (strncmp(spec, "pareto:", 7) == 0) {
+        //  INFO(Santiago): with alpha <= 1 the mean is infinite, so the user could not express the rate.
+        dist->type = kArrivalPareto;
+        if (!parse_dist_params(spec + 7, params, 2, 1) || params[0] <= 1.0 || params[1] <= 0) {
+            return 0;
+        }
+        dist->alpha = params[0];
+        dist->mean = params[1];
+        dist->scale = dist->mean * (dist->alpha - 1.0) / dist->alpha;
+    } else if (strncmp(spec, "onoff:", 6) == 0) {
+        dist->type = kArrivalOnOff;
+        if (!parse_dist_params(spec + 6, params, 3, 0) || params[0] <= 0 || params[1] <= 0 || params[2] <= 0) {
+            return 0;
+        }
+        dist->mean = params[0];
+        dist->on_mean = params[1];
+        dist->off_mean = params[2];
+    } else {
+        return 0;
+    }
+    if (dist->type != kArrivalConstant) {
+        dist->table = mk_unit_table(dist->type, dist->alpha);
+    }
+    return 1;
+}
+
+void del_pig_arrival_dist(pig_arrival_dist_ctx *dist) {
+    if (dist == NULL) {
+        return;
+    }
+    free(dist->table);
+    dist->table = NULL;
+}
+
+double sample_pig_arrival_gap(const pig_arrival_dist_ctx *dist) {
+    switch (dist->type) {
+        case kArrivalPoisson:
+        case kArrivalOnOff:
+            return dist->mean * sample_unit(dist->table, 0);
+
+        case kArrivalPareto:
+            return dist->scale * sample_unit(dist->table, 1);
+
+        default:
+            break;
+    }
+    return dist->mean;
+}
+
+void pig_arrival_stream_init(pig_arrival_stream_ctx *stream, const pig_arrival_dist_ctx *dist, const long signature_index, const unsigned long long now) {
+    stream->dist = dist;
+    stream->signature_index = signature_index;
+    stream->next = now;
+    stream->on_left = (dist->type == kArrivalOnOff ? dist->on_mean * sample_unit(dist->table, 0) : 0);
+}
+
+unsigned long long pig_arrival_stream_advance(pig_arrival_stream_ctx *stream) {
+    const pig_arrival_dist_ctx *dist = stream->dist;
+    unsigned long long due = stream->next;
+    double gap = sample_pig_arrival_gap(dist), total = 0;
+    if (dist->type == kArrivalOnOff) {
+        //  INFO(Santiago): a two-state modulated Poisson process. The packets only flow while "on",
+        //                  the exponential gap is memoryless, so the part of it that does not fit in
+        //                  the current "on" period simply continues in the next one.
+        while (gap > stream->on_left) {
+            gap -= stream->on_left;
+            total += stream->on_left + dist->off_mean * sample_unit(dist->table, 0);
+            stream->on_left = dist->on_mean * sample_unit(dist->table, 0);
+        }
+        stream->on_left -= gap;
+    }
+    stream->next += (unsigned long long)(total + gap);
+    return due;
+}
+
+static void add_stream(pig_arrivals_ctx *arrivals, const pig_arrival_dist_ctx *dist, const long signature_index) {
+    pig_arrival_stream_init(&arrivals->streams[arrivals->streams_nr++], dist, signature_index, 0);
+}
+
+static void swap_rnd_state(pig_arrivals_ctx *arrivals) {
+    unsigned long long state[4];
+    //  INFO(Santiago): the arrivals draw from their own stream, so the packets built by the calling
+    //                  thread (and the event log checkpoints of its prng) do not depend on the timing.
+    mk_rnd_get_state(state);
+    mk_rnd_set_state(arrivals->rnd_state);
+    memcpy(arrivals->rnd_state, state, sizeof(state));
+}
+
+static int parse_arrivals_spec(pig_arrivals_ctx *arrivals, const char *spec, pigsty_entry_ctx **signatures, const size_t signatures_count, long *owner, long *global) {
+    char entry[1024], *eq = NULL;
+    const char *sp = spec, *comma = NULL, *dist_spec = NULL;
+    size_t len = 0, s = 0, d = 0;
+    while (*sp != 0) {
+        comma = strchr(sp, ',');
+        len = (comma != NULL ? (size_t)(comma - sp) : strlen(sp));
+        if (len == 0 || len >= sizeof(entry) || arrivals->dists_nr == signatures_count + 1) {
+            printf("pig PANIC: invalid arrivals specification \"%s\".\n", spec);
+            return 0;
+        }
+        memcpy(entry, sp, len);
+        entry[len] = 0;
+        dist_spec = entry;
+        owner[arrivals->dists_nr] = -1;
+        eq = strchr(entry, '=');
+        if (eq != NULL) {
+            *eq = 0;
+            dist_spec = eq + 1;
+            for (s = 0; s < signatures_count && strcmp(signatures[s]->signature_name, entry) != 0; s++)
+                ;
+            if (s == signatures_count) {
+                printf("pig PANIC: the arrivals refer to an unknown signature \"%s\".\n", entry);
+                return 0;
+            }
+            for (d = 0; d < arrivals->dists_nr; d++) {
+                if (owner[d] == (long)s) {
+                    printf("pig PANIC: the signature \"%s\" has more than one arrival distribution.\n", entry);
+                    return 0;
+                }
+            }
+            owner[arrivals->dists_nr] = (long)s;
+            arrivals->is_per_signature = 1;
+        } else if (*global != -1) {
+            printf("pig PANIC: more than one global arrival distribution was supplied.\n");
+            return 0;
+        } else {
+            *global = (long)arrivals->dists_nr;
+        }
+        if (!parse_pig_arrival_dist(dist_spec, &arrivals->dists[arrivals->dists_nr])) {
+            printf("pig PANIC: invalid arrival distribution \"%s\".\n", dist_spec);
+            return 0;
+        }
+        arrivals->dists_nr++;
+        sp += len;
+        if (*sp == ',' && *(++sp) == 0) {
+            printf("pig PANIC: invalid arrivals specification \"%s\".\n", spec);
+            return 0;
+        }
+    }
+    return 1;
+}
+
+pig_arrivals_ctx *mk_pig_arrivals(const char *spec, pigsty_entry_ctx **signatures, const size_t signatures_count, const unsigned long long default_gap,
+                                   const unsigned long long seed) {
+    pig_arrivals_ctx *arrivals = NULL;
+    long *owner = NULL, global = -1;
+    size_t s = 0, d = 0;
+    unsigned long long state[4];
+    if (spec == NULL || signatures == NULL || signatures_count == 0) {
+        return NULL;
+    }
+    arrivals = (pig_arrivals_ctx *) pig_newseg(sizeof(pig_arrivals_ctx));
+    memset(arrivals, 0, sizeof(pig_arrivals_ctx));
+    mk_rnd_get_state(state);
+    mk_rnd_init(seed, PIG_ARRIVALS_RND_STREAM);
+    mk_rnd_get_state(arrivals->rnd_state);
+    mk_rnd_set_state(state);
+    //  INFO(Santiago): one extra slot for the default (constant) distribution.
+    arrivals->dists = (pig_arrival_dist_ctx *) pig_newseg(sizeof(pig_arrival_dist_ctx) * (signatures_count + 2));
+    owner = (long *) pig_newseg(sizeof(long) * (signatures_count + 2));
+    if (!parse_arrivals_spec(arrivals, spec, signatures, signatures_count, owner, &global)) {
+        free(owner);
+        del_pig_arrivals(arrivals);
+        return NULL;
+    }
+    //  INFO(Santiago): one stream per signature distribution plus the shared one.
+    arrivals->streams = (pig_arrival_stream_ctx *) pig_newseg(sizeof(pig_arrival_stream_ctx) * (arrivals->dists_nr + 1));
+    swap_rnd_state(arrivals);
+    for (d = 0; d < arrivals->dists_nr; d++) {
+        if (owner[d] != -1) {
+            add_stream(arrivals, &arrivals->dists[d], owner[d]);
+        }
+    }
+    //  INFO(Santiago): the signatures without their own distribution share one stream, following the
+    //                  global distribution or, when it is missing, the fixed --timeout spacing.
+    arrivals->shared = (size_t *) pig_newseg(sizeof(size_t) * signatures_count);
+    for (s = 0; s < signatures_count; s++) {
+        for (d = 0; d < arrivals->dists_nr && owner[d] != (long)s; d++)
+            ;
+        if (d == arrivals->dists_nr) {
+            arrivals->shared[arrivals->shared_nr++] = s;
+        }
+    }
+    if (arrivals->shared_nr > 0) {
+        if (global == -1) {
+            global = (long)arrivals->dists_nr;
+            memset(&arrivals->dists[global], 0, sizeof(pig_arrival_dist_ctx));
+            arrivals->dists[global].type = kArrivalConstant;
+            arrivals->dists[global].mean = (double)default_gap;
+            arrivals->dists_nr++;
+        }
+        add_stream(arrivals, &arrivals->dists[global], -1);
+    }
+    swap_rnd_state(arrivals);
+    free(owner);
+    return arrivals;
+}
+
+void del_pig_arrivals(pig_arrivals_ctx *arrivals) {
+    size_t d = 0;
+    if (arrivals == NULL) {
+        return;
+    }
+    for (d = 0; d < arrivals->dists_nr; d++) {
+        del_pig_arrival_dist(&arrivals->dists[d]);
+    }
+    free(arrivals->dists);
+    free(arrivals->streams);
+    free(arrivals->shared);
+    free(arrivals);
+}
+
+unsigned long long next_pig_arrival(pig_arrivals_ctx *arrivals, long *signature_index) {
+    size_t s = 0, first = 0;
+    unsigned long long due = 0;
+    //  INFO(Santiago): the streams are merged by always taking the earliest one. There is one stream
+    //                  per signature at most, so a linear scan is cheaper than keeping a heap.
+    for (s = 1; s < arrivals->streams_nr; s++) {
+        if (arrivals->streams[s].next < arrivals->streams[first].next) {
+            first = s;
+        }
+    }
+    swap_rnd_state(arrivals);
+    *signature_index = arrivals->streams[first].signature_index;
+    if (*signature_index == -1 && arrivals->is_per_signature) {
+        //  INFO(Santiago): the shared stream only picks among the signatures without a distribution of their own.
+        *signature_index = (long)arrivals->shared[mk_rnd_u32() % arrivals->shared_nr];
+    }
+    due = pig_arrival_stream_advance(&arrivals->streams[first]);
+    swap_rnd_state(arrivals);
+    return due;
+}
+
+void pig_arrivals_rebase(pig_arrivals_ctx *arrivals, const unsigned long long now) {
+    size_t s = 0;
+    if (arrivals == NULL) {
+        return;
+    }
+    for (s = 0; s < arrivals->streams_nr; s++) {
+        if (arrivals->streams[s].next < now) {
+            arrivals->streams[s].next = now;
+        }
+    }
+}
@@ -0,0 +1,76 @@
+/*
+ *                                Copyright (C) 2015 by Rafael Santiago
+ *
+ * This is a free software. You can redistribute it and/or modify under
+ * the terms of the GNU General Public License version 2.
+ *
+ */
+#ifndef PIG_ARRIVALS_H
+#define PIG_ARRIVALS_H 1
+
+#include "types.h"
+
+#define PIG_ARRIVALS_TABLE_BITS 12
+
+#define PIG_ARRIVALS_TABLE_SIZE (1 << PIG_ARRIVALS_TABLE_BITS)
+
+#define PIG_ARRIVALS_MAX_TAIL 64
+
+//  INFO(Santiago): beyond the streams taken by the pipeline threads.
+#define PIG_ARRIVALS_RND_STREAM 256
+
+typedef enum _pig_arrival_dist_type {
+    kArrivalConstant,
+    kArrivalPoisson,
+    kArrivalPareto,
+    kArrivalOnOff
+}pig_arrival_dist_type_t;
+
+typedef struct _pig_arrival_dist {
+    pig_arrival_dist_type_t type;
+    double mean;
+    double alpha;
+    double scale;
+    double on_mean;
+    double off_mean;
+    double *table;
+}pig_arrival_dist_ctx;
+
+typedef struct _pig_arrival_stream {
+    const pig_arrival_dist_ctx *dist;
+    long signature_index;
+    unsigned long long next;
+    double on_left;
+}pig_arrival_stream_ctx;
+
+typedef struct _pig_arrivals {
+    pig_arrival_dist_ctx *dists;
+    size_t dists_nr;
+    pig_arrival_stream_ctx *streams;
+    size_t streams_nr;
+    size_t *shared;
+    size_t shared_nr;
+    int is_per_signature;
+    unsigned long long rnd_state[4];
+}pig_arrivals_ctx;
+
+int parse_pig_arrival_dist(const char *spec, pig_arrival_dist_ctx *dist);
+
+void del_pig_arrival_dist(pig_arrival_dist_ctx *dist);
+
+double sample_pig_arrival_gap(const pig_arrival_dist_ctx *dist);
+
+void pig_arrival_stream_init(pig_arrival_stream_ctx *stream, const pig_arrival_dist_ctx *dist, const long signature_index, const unsigned long long now);
+
+unsigned long long pig_arrival_stream_advance(pig_arrival_stream_ctx *stream);
+
+pig_arrivals_ctx *mk_pig_arrivals(const char *spec, pigsty_entry_ctx **signatures, const size_t signatures_count, const unsigned long long default_gap,
+                                   const unsigned long long seed);
+
+void del_pig_arrivals(pig_arrivals_ctx *arrivals);
+
+unsigned long long next_pig_arrival(pig_arrivals_ctx *arrivals, long *signature_index);
+
+void pig_arrivals_rebase(pig_arrivals_ctx *arrivals, const unsigned long long now);
+
+#endif
@@ -0,0 +1,141 @@
+/*
+ *                                Copyright (C) 2015 by Rafael Santiago
+ *
+ * This is a free software. You can redistribute it and/or modify under
+ * the terms of the GNU General Public License version 2.
+ *
+ */
+#include "budget.h"
+#include "pacer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <errno.h>
+
+//  INFO(Santiago): the budget is shared by all senders. Before injecting, a sender takes one packet
+//                  and the packet size from it with compare-and-swap loops, so the limits are never
+//                  exceeded no matter how many senders are running. When the injection fails the
+//                  packet and its bytes are given back. The bytes are counted at the IP level.
+
+static int take_counter(unsigned long long *counter, const unsigned long long amount, const unsigned long long limit);
+
+static int take_counter(unsigned long long *counter, const unsigned long long amount, const unsigned long long limit) {
+    unsigned long long old = 0;
+    do {
+        old = __atomic_load_n(counter, __ATOMIC_RELAXED);
+        if (limit > 0 && (old + amount) > limit) {
+            return 0;
+        }
+    } while (!__sync_bool_compare_and_swap(counter, old, old + amount));
+    return 1;
+}
+
+int parse_pig_bytes(const char *token, unsigned long long *bytes) {
+    char *end = NULL;
+    unsigned long long value = 0;
+    int shift = 0;
+    if (token == NULL || *token < '0' || *token > '9') {
+        return 0;
+    }
+    errno = 0;
+    value = strtoull(token, &end, 10);
+    if (errno == ERANGE) {
+        return 0;
+    }
+    if (*end == 'k' || *end == 'K') {
+        shift = 10;
+        end++;
+    } else if (*end == 'm' || *end == 'M') {
+        shift = 20;
+        end++;
+    } else if (*end == 'g' || *end == 'G') {
+        shift = 30;
+        end++;
+    }
+    //  WARN(Santiago): a value that does not fit after the shift would wrap to a much smaller budget.
+    if (*end != 0 || value > (ULLONG_MAX >> shift)) {
+        return 0;
+    }
+    *bytes = value << shift;
+    return 1;
+}
+
+void pig_budget_init(pig_budget_ctx *budget, const unsigned long long max_packets, const unsigned long long max_bytes, const unsigned long long max_duration) {
+    if (budget == NULL) {
+        return;
+    }
+    memset(budget, 0, sizeof(pig_budget_ctx));
+    budget->max_packets = max_packets;
+    budget->max_bytes = max_bytes;
+    budget->max_duration = max_duration;
+    budget->start = pig_clock_ns();
+}
+
+int pig_budget_take(pig_budget_ctx *budget, const unsigned long long size) {
+    if (budget == NULL) {
+        return 1;
+    }
+    if (is_pig_budget_exhausted(budget)) {
+        return 0;
+    }
+    if (!take_counter(&budget->packets, 1, budget->max_packets)) {
+        __atomic_store_n(&budget->exhausted, 1, __ATOMIC_RELAXED);
+        return 0;
+    }
+    if (!take_counter(&budget->bytes, size, budget->max_bytes)) {
+        __sync_fetch_and_sub(&budget->packets, 1);
+        __atomic_store_n(&budget->exhausted, 1, __ATOMIC_RELAXED);
+        return 0;
+    }
+    return 1;
+}
+
+void pig_budget_refund(pig_budget_ctx *budget, const unsigned long long size) {
+    if (budget == NULL) {
+        return;
+    }
+    __sync_fetch_and_sub(&budget->packets, 1);
+    __sync_fetch_and_sub(&budget->bytes, size);
+    __sync_fetch_and_add(&budget->failures, 1);
+}
+
+int is_pig_budget_exhausted(pig_budget_ctx *budget) {
+    if (budget == NULL) {
+        return 0;
+    }
+    if (__atomic_load_n(&budget->exhausted, __ATOMIC_RELAXED)) {
+        return 1;
+    }
+    if ((budget->max_duration > 0 && (pig_clock_ns() - budget->start) >= budget->max_duration) ||
+        (budget->max_packets > 0 && __atomic_load_n(&budget->packets, __ATOMIC_RELAXED) >= budget->max_packets)) {
+        __atomic_store_n(&budget->exhausted, 1, __ATOMIC_RELAXED);
+        return 1;
+    }
+    return 0;
+}
+
+unsigned long long get_pig_budget_time_left(const pig_budget_ctx *budget) {
+    unsigned long long elapsed = 0;
+    if (budget == NULL || budget->max_duration == 0) {
+        return ~0ULL;
+    }
+    elapsed = pig_clock_ns() - budget->start;
+    return (elapsed < budget->max_duration ? budget->max_duration - elapsed : 0);
+}
+
+void pig_budget_summary(const pig_budget_ctx *budget) {
+    double secs = 0;
+    if (budget == NULL) {
+        return;
+    }
+    secs = (double)(pig_clock_ns() - budget->start) / 1000000000.0;
+    printf("\npig INFO: %llu packet(s) and %llu byte(s) were sent in %.3f second(s)", budget->packets, budget->bytes, secs);
+    if (secs > 0) {
+        printf(" (%.2f packets/s, %.3f Mbit/s)", (double)budget->packets / secs, (double)budget->bytes * 8.0 / secs / 1000000.0);
+    }
+    printf(".\n");
+    if (budget->failures > 0) {
+        printf("pig INFO: %llu injection(s) failed.\n", budget->failures);
+    }
+}
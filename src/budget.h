@@ -0,0 +1,36 @@
+/*
+ *                                Copyright (C) 2015 by Rafael Santiago
+ *
+ * This is a free software. You can redistribute it and/or modify under
+ * the terms of the GNU General Public License version 2.
+ *
+ */
+#ifndef PIG_BUDGET_H
+#define PIG_BUDGET_H 1
+
+typedef struct _pig_budget {
+    unsigned long long max_packets;
+    unsigned long long max_bytes;
+    unsigned long long max_duration;
+    unsigned long long packets;
+    unsigned long long bytes;
+    unsigned long long failures;
+    unsigned long long start;
+    int exhausted;
+}pig_budget_ctx;
+
+int parse_pig_bytes(const char *token, unsigned long long *bytes);
+
+void pig_budget_init(pig_budget_ctx *budget, const unsigned long long max_packets, const unsigned long long max_bytes, const unsigned long long max_duration);
+
+int pig_budget_take(pig_budget_ctx *budget, const unsigned long long size);
+
+void pig_budget_refund(pig_budget_ctx *budget, const unsigned long long size);
+
+int is_pig_budget_exhausted(pig_budget_ctx *budget);
+
+unsigned long long get_pig_budget_time_left(const pig_budget_ctx *budget);
+
+void pig_budget_summary(const pig_budget_ctx *budget);
+
+#endif
@@ -0,0 +1,207 @@
+/*
+ *                                Copyright (C) 2015 by Rafael Santiago
+ *
+ * This is a free software. You can redistribute it and/or modify under
+ * the terms of the GNU General Public License version 2.
+ *
+ */
+#include "chsum.h"
+#include <string.h>
+
+#define swap_u16(w) ( (((w) & 0x00ff) << 8) | (((w) & 0xff00) >> 8) )
+
+#define get_u16(b) ( ((unsigned short)(b)[0] << 8) | (b)[1] )
+
+#define put_u16(b, w) ( (b)[0] = ((w) & 0xff00) >> 8, (b)[1] = (w) & 0x00ff )
+
+unsigned int chsum_partial(const unsigned char *buf, const size_t bsize, unsigned int sum) {
+    size_t b = 0;
+    if (buf == NULL) {
+        return sum;
+    }
+    for (b = 0; b + 1 < bsize; b += 2) {
+        sum += ((unsigned int)buf[b] << 8) | buf[b + 1];
+    }
+    if (b < bsize) {
+        sum += ((unsigned int)buf[b] << 8);
+    }
+    return sum;
+}
+
+unsigned short chsum_fold(unsigned int sum) {
+    while (sum >> 16) {
+        sum = (sum >> 16) + (sum & 0x0000ffff);
+    }
+    return (unsigned short)sum;
+}
+
+unsigned short chsum_adjust(const unsigned short chsum, const unsigned char *old_data, const unsigned char *new_data, const size_t dsize, const size_t offset) {
+    //  INFO(Santiago): RFC-1624, HC' = ~(~HC + ~m + m'). When the changed bytes start on an odd
+    //                  position of the checksummed area their partial sums are byte swapped.
+    unsigned short old_sum = chsum_fold(chsum_partial(old_data, dsize, 0));
+    unsigned short new_sum = chsum_fold(chsum_partial(new_data, dsize, 0));
+    if (offset & 1) {
+        old_sum = swap_u16(old_sum);
+        new_sum = swap_u16(new_sum);
+    }
+    return (unsigned short)(~chsum_fold((unsigned int)(~chsum & 0xffff) + (~old_sum & 0xffff) + new_sum));
+}
+
+size_t get_ip4_l4_offset(const unsigned char *dgram, const size_t dgram_size) {
+    size_t offset = 0;
+    if (dgram == NULL || dgram_size < 20) {
+        return dgram_size;
+    }
+    offset = 4 * (dgram[0] & 0x0f);
+    return (offset < dgram_size) ? offset : dgram_size;
+}
+
+size_t get_ip4_l7_offset(const unsigned char *dgram, const size_t dgram_size) {
+    size_t offset = get_ip4_l4_offset(dgram, dgram_size);
+    size_t hdr_size = 0;
+    if (offset == dgram_size) {
+        return dgram_size;
+    }
+    switch (dgram[9]) {
+        case 1:
+            hdr_size = 4;
+            break;
+
+        case 6:
+            hdr_size = (offset + 12 < dgram_size) ? 4 * ((dgram[offset + 12] & 0xf0) >> 4) : 20;
+            if (hdr_size < 20) {
+                hdr_size = 20;
+            }
+            break;
+
+        case 17:
+            hdr_size = 8;
+            break;
+
+        default:
+            hdr_size = 0;
+            break;
+    }
+    offset += hdr_size;
+    return (offset < dgram_size) ? offset : dgram_size;
+}
+
+size_t get_ip4_l4_chsum_offset(const unsigned char *dgram, const size_t dgram_size) {
+    size_t offset = get_ip4_l4_offset(dgram, dgram_size);
+    if (offset == dgram_size) {
+        return 0;
+    }
+    switch (dgram[9]) {
+        case 1:
+            offset += 2;
+            break;
+
+        case 6:
+            offset += 16;
+            break;
+
+        case 17:
+            offset += 6;
+            break;
+
+        default:
+            return 0;
+    }
+    return (offset + 2 <= dgram_size) ? offset : 0;
+}
+
+void adjust_ip4_l4_chsum(unsigned char *dgram, const size_t dgram_size, const size_t offset, const unsigned char *old_data, const size_t dsize) {
+    size_t chsum_offset = get_ip4_l4_chsum_offset(dgram, dgram_size);
+    size_t l4_offset = 0;
+    unsigned short chsum = 0;
+    if (chsum_offset == 0 || offset + dsize > dgram_size) {
+        return;
+    }
+    chsum = get_u16(&dgram[chsum_offset]);
+    if (dgram[9] == 17 && chsum == 0) {
+        return;  //  INFO(Santiago): UDP without checksum.
+    }
+    l4_offset = get_ip4_l4_offset(dgram, dgram_size);
+    chsum = chsum_adjust(chsum, old_data, &dgram[offset], dsize, offset - l4_offset);
+    if (dgram[9] == 17 && chsum == 0) {
+        chsum = 0xffff;
+    }
+    put_u16(&dgram[chsum_offset], chsum);
+}
+
+void chsum_ip4_dgram(unsigned char *dgram, const size_t dgram_size) {
+    chsum_ip4_hdr(dgram, dgram_size);
+    chsum_ip4_l4(dgram, dgram_size);
+}
+
+void chsum_ip4_hdr(unsigned char *dgram, const size_t dgram_size) {
+    unsigned short chsum = 0;
+    if (dgram == NULL || dgram_size < 20) {
+        return;
+    }
+    dgram[10] = 0;
+    dgram[11] = 0;
+    chsum = ~chsum_fold(chsum_partial(dgram, get_ip4_l4_offset(dgram, dgram_size), 0));
+    put_u16(&dgram[10], chsum);
+}
+
+void chsum_ip4_l4(unsigned char *dgram, const size_t dgram_size) {
+    size_t l4_offset = 0, chsum_offset = 0, l4_size = 0;
+    unsigned int sum = 0;
+    unsigned short chsum = 0;
+    if (dgram == NULL || dgram_size < 20) {
+        return;
+    }
+    chsum_offset = get_ip4_l4_chsum_offset(dgram, dgram_size);
+    if (chsum_offset == 0) {
+        return;
+    }
+    l4_offset = get_ip4_l4_offset(dgram, dgram_size);
+    l4_size = dgram_size - l4_offset;
+    dgram[chsum_offset] = 0;
+    dgram[chsum_offset + 1] = 0;
+    if (dgram[9] != 1) {
+        //  INFO(Santiago): the pseudo header (src, dst, protocol and the transport length).
+        sum = chsum_partial(&dgram[12], 8, 0);
+        sum += dgram[9];
+        sum += l4_size;
+    }
+    chsum = ~chsum_fold(chsum_partial(&dgram[l4_offset], l4_size, sum));
+    if (dgram[9] == 17 && chsum == 0) {
+        chsum = 0xffff;
+    }
+    put_u16(&dgram[chsum_offset], chsum);
+}
+
+void patch_ip4_dgram(unsigned char *dgram, const size_t dgram_size, const size_t offset, const unsigned char *data, const size_t dsize) {
+    unsigned char old[64];
+    size_t pos = offset, n = dsize, step = 0;
+    if (dgram == NULL || data == NULL || offset + dsize > dgram_size) {
+        return;
+    }
+    while (n > 0) {
+        step = (n < sizeof(old)) ? n : sizeof(old);
+        memcpy(old, &dgram[pos], step);
+        memcpy(&dgram[pos], data, step);
+        adjust_ip4_l4_chsum(dgram, dgram_size, pos, old, step);
+        pos += step;
+        data += step;
+        n -= step;
+    }
+}
+
+void patch_ip4_hdr(unsigned char *dgram, const size_t dgram_size, const size_t offset, const unsigned char *data, const size_t dsize) {
+    unsigned char old[8];
+    unsigned short chsum = 0;
+    if (dgram == NULL || data == NULL || dsize > sizeof(old) || offset + dsize > get_ip4_l4_offset(dgram, dgram_size)) {
+        return;
+    }
+    memcpy(old, &dgram[offset], dsize);
+    memcpy(&dgram[offset], data, dsize);
+    chsum = chsum_adjust(get_u16(&dgram[10]), old, data, dsize, offset);
+    put_u16(&dgram[10], chsum);
+    if (offset >= 12 && offset + dsize <= 20 && dgram[9] != 1) {
+        //  INFO(Santiago): the addresses also take part in the transport pseudo header.
+        adjust_ip4_l4_chsum(dgram, dgram_size, offset, old, dsize);
+    }
+}
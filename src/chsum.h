@@ -0,0 +1,37 @@
+/*
+ *                                Copyright (C) 2015 by Rafael Santiago
+ *
+ * This is a free software. You can redistribute it and/or modify under
+ * the terms of the GNU General Public License version 2.
+ *
+ */
+#ifndef PIG_CHSUM_H
+#define PIG_CHSUM_H 1
+
+#include <stdlib.h>
+
+unsigned int chsum_partial(const unsigned char *buf, const size_t bsize, unsigned int sum);
+
+unsigned short chsum_fold(unsigned int sum);
+
+unsigned short chsum_adjust(const unsigned short chsum, const unsigned char *old_data, const unsigned char *new_data, const size_t dsize, const size_t offset);
+
+void chsum_ip4_dgram(unsigned char *dgram, const size_t dgram_size);
+
+void chsum_ip4_hdr(unsigned char *dgram, const size_t dgram_size);
+
+void chsum_ip4_l4(unsigned char *dgram, const size_t dgram_size);
+
+size_t get_ip4_l4_offset(const unsigned char *dgram, const size_t dgram_size);
+
+size_t get_ip4_l7_offset(const unsigned char *dgram, const size_t dgram_size);
+
+size_t get_ip4_l4_chsum_offset(const unsigned char *dgram, const size_t dgram_size);
+
+void adjust_ip4_l4_chsum(unsigned char *dgram, const size_t dgram_size, const size_t offset, const unsigned char *old_data, const size_t dsize);
+
+void patch_ip4_dgram(unsigned char *dgram, const size_t dgram_size, const size_t offset, const unsigned char *data, const size_t dsize);
+
+void patch_ip4_hdr(unsigned char *dgram, const size_t dgram_size, const size_t offset, const unsigned char *data, const size_t dsize);
+
+#endif
@@ -0,0 +1,206 @@
+/*
+ *                                Copyright (C) 2015 by Rafael Santiago
+ *
+ * This is a free software. You can redistribute it and/or modify under
+ * the terms of the GNU General Public License version 2.
+ *
+ */
+#include "cpus.h"
+#ifdef __linux
+#include "linux/cpu.h"
+#endif
+#include <string.h>
+#include <sched.h>
+#include <signal.h>
+#include <sys/mman.h>
+
+//  INFO(Santiago): the CPU lists follow the kernel's cpulist syntax, e.g. "0-3,8,10-11", so the same
+//                  parser reads the user's --cpus and the NUMA node lists from sysfs.
+
+static int add_cpu(pig_cpu_set_ctx *set, const int cpu);
+
+static int add_cpu(pig_cpu_set_ctx *set, const int cpu) {
+    if (is_pig_cpu_in_set(set, cpu)) {
+        return 1;
+    }
+    if (set->cpus_nr == PIG_MAX_CPUS) {
+        return 0;
+    }
+    set->cpus[set->cpus_nr++] = cpu;
+    return 1;
+}
+
+int parse_pig_cpus(const char *list, pig_cpu_set_ctx *set) {
+    const char *lp = list;
+    char *end = NULL;
+    long first = 0, last = 0, c = 0;
+    if (list == NULL || set == NULL) {
+        return 0;
+    }
+    set->cpus_nr = 0;
+    while (*lp != 0) {
+        if (*lp < '0' || *lp > '9') {
+            return 0;
+        }
+        first = strtol(lp, &end, 10);
+        last = first;
+        if (*end == '-') {
+            lp = end + 1;
+            if (*lp < '0' || *lp > '9') {
+                return 0;
+            }
+            last = strtol(lp, &end, 10);
+        }
+        if (first >= PIG_MAX_CPUS || last >= PIG_MAX_CPUS || last < first) {
+            return 0;
+        }
+        for (c = first; c <= last; c++) {
+            if (!add_cpu(set, (int)c)) {
+                return 0;
+            }
+        }
+        if (*end == ',') {
+            end++;
+            if (*end == 0) {
+                return 0;
+            }
+        } else if (*end != 0) {
+            return 0;
+        }
+        lp = end;
+    }
+    return (set->cpus_nr > 0);
+}
+
+int is_pig_cpu_in_set(const pig_cpu_set_ctx *set, const int cpu) {
+    size_t c = 0;
+    if (set == NULL) {
+        return 0;
+    }
+    for (c = 0; c < set->cpus_nr; c++) {
+        if (set->cpus[c] == cpu) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+int get_pig_usable_cpus(pig_cpu_set_ctx *set) {
+    if (set == NULL) {
+        return 0;
+    }
+#ifdef __linux
+    set->cpus_nr = lin_cpu_getaffinity(set->cpus, PIG_MAX_CPUS);
+#else
+    set->cpus_nr = 0;
+#endif
+    return (set->cpus_nr > 0);
+}
+
+int get_pig_iface_numa_node(const char *iface) {
+#ifdef __linux
+    return lin_cpu_iface_node(iface);
+#else
+    return -1;
+#endif
+}
+
+int get_pig_numa_node_cpus(const int node, pig_cpu_set_ctx *set) {
+#ifdef __linux
+    char cpulist[4096];
+    if (set == NULL || !lin_cpu_node_cpulist(node, cpulist, sizeof(cpulist))) {
+        return 0;
+    }
+    return parse_pig_cpus(cpulist, set);
+#else
+    return 0;
+#endif
+}
+
+void pig_cpus_local_first(pig_cpu_set_ctx *set, const pig_cpu_set_ctx *local) {
+    int sorted[PIG_MAX_CPUS];
+    size_t c = 0, s = 0;
+    if (set == NULL || local == NULL || local->cpus_nr == 0) {
+        return;
+    }
+    for (c = 0; c < set->cpus_nr; c++) {
+        if (is_pig_cpu_in_set(local, set->cpus[c])) {
+            sorted[s++] = set->cpus[c];
+        }
+    }
+    for (c = 0; c < set->cpus_nr; c++) {
+        if (!is_pig_cpu_in_set(local, set->cpus[c])) {
+            sorted[s++] = set->cpus[c];
+        }
+    }
+    memcpy(set->cpus, sorted, sizeof(int) * set->cpus_nr);
+}
+
+void pig_cpus_subtract(pig_cpu_set_ctx *set, const pig_cpu_set_ctx *unwanted) {
+    size_t c = 0, s = 0;
+    if (set == NULL || unwanted == NULL) {
+        return;
+    }
+    for (c = 0; c < set->cpus_nr; c++) {
+        if (!is_pig_cpu_in_set(unwanted, set->cpus[c])) {
+            set->cpus[s++] = set->cpus[c];
+        }
+    }
+    set->cpus_nr = s;
+}
+
+int pig_pin_thread(pthread_t thread, const pig_cpu_set_ctx *set) {
+    if (set == NULL || set->cpus_nr == 0) {
+        return 0;
+    }
+#ifdef __linux
+    return lin_cpu_setaffinity(thread, set->cpus, set->cpus_nr);
+#else
+    return 0;
+#endif
+}
+
+int pig_pin_thread_to(pthread_t thread, const int cpu) {
+#ifdef __linux
+    return lin_cpu_setaffinity(thread, &cpu, 1);
+#else
+    return 0;
+#endif
+}
+
+int pig_set_realtime(pthread_t thread, const int priority) {
+    struct sched_param param;
+    memset(&param, 0, sizeof(param));
+    param.sched_priority = priority;
+    return (pthread_setschedparam(thread, SCHED_FIFO, &param) == 0);
+}
+
+int pig_lock_memory() {
+    //  INFO(Santiago): also the future pages, otherwise the first packet built in a new heap page
+    //                  would take a page fault right in the middle of the schedule.
+    return (mlockall(MCL_CURRENT | MCL_FUTURE) == 0);
+}
+
+int pig_mk_helper_thread(pthread_t *thread, void *(*routine)(void *), void *arg) {
+    pthread_attr_t attr;
+    struct sched_param param;
+    sigset_t signals, old_signals;
+    int created = 0;
+    //  INFO(Santiago): a helper thread (capture, logging, tailing) must not inherit SCHED_FIFO from a
+    //                  real-time creator, nor take SIGINT/SIGTERM: they have to wake up the main thread.
+    if (pthread_attr_init(&attr) != 0) {
+        return 0;
+    }
+    memset(&param, 0, sizeof(param));
+    pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+    pthread_attr_setschedpolicy(&attr, SCHED_OTHER);
+    pthread_attr_setschedparam(&attr, &param);
+    sigemptyset(&signals);
+    sigaddset(&signals, SIGINT);
+    sigaddset(&signals, SIGTERM);
+    pthread_sigmask(SIG_BLOCK, &signals, &old_signals);
+    created = (pthread_create(thread, &attr, routine, arg) == 0);
+    pthread_sigmask(SIG_SETMASK, &old_signals, NULL);
+    pthread_attr_destroy(&attr);
+    return created;
+}
@@ -0,0 +1,47 @@
+/*
+ *                                Copyright (C) 2015 by Rafael Santiago
+ *
+ * This is a free software. You can redistribute it and/or modify under
+ * the terms of the GNU General Public License version 2.
+ *
+ */
+#ifndef PIG_CPUS_H
+#define PIG_CPUS_H 1
+
+#include <stdlib.h>
+#include <pthread.h>
+
+#define PIG_MAX_CPUS 1024
+
+#define PIG_DEFAULT_RT_PRIORITY 50
+
+typedef struct _pig_cpu_set {
+    int cpus[PIG_MAX_CPUS];
+    size_t cpus_nr;
+}pig_cpu_set_ctx;
+
+int parse_pig_cpus(const char *list, pig_cpu_set_ctx *set);
+
+int is_pig_cpu_in_set(const pig_cpu_set_ctx *set, const int cpu);
+
+int get_pig_usable_cpus(pig_cpu_set_ctx *set);
+
+int get_pig_iface_numa_node(const char *iface);
+
+int get_pig_numa_node_cpus(const int node, pig_cpu_set_ctx *set);
+
+void pig_cpus_local_first(pig_cpu_set_ctx *set, const pig_cpu_set_ctx *local);
+
+void pig_cpus_subtract(pig_cpu_set_ctx *set, const pig_cpu_set_ctx *unwanted);
+
+int pig_pin_thread(pthread_t thread, const pig_cpu_set_ctx *set);
+
+int pig_pin_thread_to(pthread_t thread, const int cpu);
+
+int pig_set_realtime(pthread_t thread, const int priority);
+
+int pig_lock_memory();
+
+int pig_mk_helper_thread(pthread_t *thread, void *(*routine)(void *), void *arg);
+
+#endif
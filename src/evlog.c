@@ -0,0 +1,333 @@
+/*
+ *                                Copyright (C) 2015 by Rafael Santiago
+ *
+ * This is a free software. You can redistribute it and/or modify under
+ * the terms of the GNU General Public License version 2.
+ *
+ */
+#include "evlog.h"
+#include "memory.h"
+#include "mkrnd.h"
+#include "mkpkt.h"
+#include <string.h>
+
+//  INFO(Santiago): the event log layout is:
+//
+//      header:     "PIGEVLOG" | version (u32) | checkpoint interval (u32) | seed (u64) | signatures count (u32) | reserved (u32)
+//      records:    signature index (u32)
+//                  0xffffffff | packet number (u64) | packet sequence (u64) | prng state (4 x u64) |
+//                  slots count (u32) | slots count x (value (u64) | left (u32) | ready (u32)) |
+//                  counters count (u32) | counters count x counter (u64)
+//
+//                  All numbers are little-endian. A checkpoint always comes right before the record of
+//                  the packet that it refers to, so restoring its prng state and the packet sequence
+//                  (the {seq} template variable) regenerates that packet. The slots are the refresh and
+//                  increment field modifiers of all loaded signatures, in the loading order. The counters
+//                  are the {counter} template variables of the signatures with a template, in the same order.
+
+#define PIG_EVLOG_MAGIC "PIGEVLOG"
+
+#define PIG_EVLOG_VERSION 3
+
+#define PIG_EVLOG_CHECKPOINT_MARK 0xffffffff
+
+static int write_u32(FILE *fp, const unsigned int value);
+
+static int write_u64(FILE *fp, const unsigned long long value);
+
+static int read_u32(FILE *fp, unsigned int *value);
+
+static int read_u64(FILE *fp, unsigned long long *value);
+
+static int read_checkpoint(pig_evlog_ctx *evlog, unsigned long long *packet_nr, unsigned long long *seq, unsigned long long state[4]);
+
+static unsigned int get_slots_nr(pigsty_entry_ctx **signatures, const size_t signatures_count);
+
+static unsigned int get_counters_nr(pigsty_entry_ctx **signatures, const size_t signatures_count);
+
+static int write_slots(FILE *fp, pigsty_entry_ctx **signatures, const size_t signatures_count);
+
+static int skip_slots(FILE *fp);
+
+static int read_slots(FILE *fp, pigsty_entry_ctx **signatures, const size_t signatures_count);
+
+static int write_u32(FILE *fp, const unsigned int value) {
+    unsigned char buf[4];
+    buf[0] = value & 0xff;
+    buf[1] = (value >>  8) & 0xff;
+    buf[2] = (value >> 16) & 0xff;
+    buf[3] = (value >> 24) & 0xff;
+    return (fwrite(buf, 1, sizeof(buf), fp) == sizeof(buf));
+}
+
+static int write_u64(FILE *fp, const unsigned long long value) {
+    return (write_u32(fp, value & 0xffffffff) && write_u32(fp, value >> 32));
+}
+
+static int read_u32(FILE *fp, unsigned int *value) {
+    unsigned char buf[4];
+    if (fread(buf, 1, sizeof(buf), fp) != sizeof(buf)) {
+        return 0;
+    }
+    *value = ((unsigned int)buf[3] << 24) |
+             ((unsigned int)buf[2] << 16) |
+             ((unsigned int)buf[1] <<  8) | buf[0];
+    return 1;
+}
+
+static int read_u64(FILE *fp, unsigned long long *value) {
+    unsigned int lo = 0, hi = 0;
+    if (!read_u32(fp, &lo) || !read_u32(fp, &hi)) {
+        return 0;
+    }
+    *value = ((unsigned long long)hi << 32) | lo;
+    return 1;
+}
+
+pig_evlog_ctx *evlog_create(const char *filepath, const unsigned long long seed, const size_t signatures_count) {
+    pig_evlog_ctx *evlog = NULL;
+    FILE *fp = NULL;
+    if (filepath == NULL) {
+        return NULL;
+    }
+    fp = fopen(filepath, "wb");
+    if (fp == NULL) {
+        printf("pig i/o PANIC: unable to create the event log \"%s\".\n", filepath);
+        return NULL;
+    }
+    fwrite(PIG_EVLOG_MAGIC, 1, 8, fp);
+    write_u32(fp, PIG_EVLOG_VERSION);
+    write_u32(fp, PIG_EVLOG_CHECKPOINT_INTERVAL);
+    write_u64(fp, seed);
+    write_u32(fp, signatures_count);
+    write_u32(fp, 0);
+    evlog = (pig_evlog_ctx *) pig_newseg(sizeof(pig_evlog_ctx));
+    evlog->fp = fp;
+    evlog->is_replay = 0;
+    evlog->seed = seed;
+    evlog->signatures_count = signatures_count;
+    evlog->packet_nr = 0;
+    return evlog;
+}
+
+pig_evlog_ctx *evlog_open(const char *filepath) {
+    pig_evlog_ctx *evlog = NULL;
+    FILE *fp = NULL;
+    char magic[8];
+    unsigned int version = 0, interval = 0, signatures_count = 0, reserved = 0;
+    unsigned long long seed = 0;
+    if (filepath == NULL) {
+        return NULL;
+    }
+    fp = fopen(filepath, "rb");
+    if (fp == NULL) {
+        printf("pig i/o PANIC: unable to open the event log \"%s\".\n", filepath);
+        return NULL;
+    }
+    if (fread(magic, 1, sizeof(magic), fp) != sizeof(magic) || memcmp(magic, PIG_EVLOG_MAGIC, sizeof(magic)) != 0 ||
+        !read_u32(fp, &version) || version != PIG_EVLOG_VERSION ||
+        !read_u32(fp, &interval) || !read_u64(fp, &seed) ||
+        !read_u32(fp, &signatures_count) || !read_u32(fp, &reserved)) {
+        printf("pig PANIC: \"%s\" is not a valid event log.\n", filepath);
+        fclose(fp);
+        return NULL;
+    }
+    evlog = (pig_evlog_ctx *) pig_newseg(sizeof(pig_evlog_ctx));
+    evlog->fp = fp;
+    evlog->is_replay = 1;
+    evlog->seed = seed;
+    evlog->signatures_count = signatures_count;
+    evlog->packet_nr = 0;
+    return evlog;
+}
+
+void evlog_close(pig_evlog_ctx *evlog) {
+    if (evlog == NULL) {
+        return;
+    }
+    fclose(evlog->fp);
+    free(evlog);
+}
+
+static unsigned int get_slots_nr(pigsty_entry_ctx **signatures, const size_t signatures_count) {
+    unsigned int slots_nr = 0;
+    size_t s = 0;
+    if (signatures == NULL) {
+        return 0;
+    }
+    for (s = 0; s < signatures_count; s++) {
+        slots_nr += signatures[s]->slots_nr;
+    }
+    return slots_nr;
+}
+
+static unsigned int get_counters_nr(pigsty_entry_ctx **signatures, const size_t signatures_count) {
+    unsigned int counters_nr = 0;
+    size_t s = 0;
+    if (signatures == NULL) {
+        return 0;
+    }
+    for (s = 0; s < signatures_count; s++) {
+        counters_nr += (signatures[s]->tpl != NULL);
+    }
+    return counters_nr;
+}
+
+static int write_slots(FILE *fp, pigsty_entry_ctx **signatures, const size_t signatures_count) {
+    size_t s = 0, l = 0;
+    int written = write_u32(fp, get_slots_nr(signatures, signatures_count));
+    for (s = 0; written && signatures != NULL && s < signatures_count; s++) {
+        for (l = 0; written && l < signatures[s]->slots_nr; l++) {
+            written = (write_u64(fp, signatures[s]->slots[l].value) &&
+                       write_u32(fp, signatures[s]->slots[l].left) &&
+                       write_u32(fp, signatures[s]->slots[l].ready));
+        }
+    }
+    written = (written && write_u32(fp, get_counters_nr(signatures, signatures_count)));
+    for (s = 0; written && signatures != NULL && s < signatures_count; s++) {
+        if (signatures[s]->tpl != NULL) {
+            written = write_u64(fp, __atomic_load_n(&signatures[s]->tpl->counter, __ATOMIC_RELAXED));
+        }
+    }
+    return written;
+}
+
+static int skip_slots(FILE *fp) {
+    unsigned int slots_nr = 0, counters_nr = 0;
+    return (read_u32(fp, &slots_nr) && fseek(fp, (long)slots_nr * 16, SEEK_CUR) == 0 &&
+            read_u32(fp, &counters_nr) && fseek(fp, (long)counters_nr * 8, SEEK_CUR) == 0);
+}
+
+static int read_slots(FILE *fp, pigsty_entry_ctx **signatures, const size_t signatures_count) {
+    unsigned int slots_nr = 0, left = 0, ready = 0, counters_nr = 0;
+    unsigned long long value = 0;
+    size_t s = 0, l = 0;
+    if (!read_u32(fp, &slots_nr) || slots_nr != get_slots_nr(signatures, signatures_count)) {
+        return 0;
+    }
+    for (s = 0; signatures != NULL && s < signatures_count; s++) {
+        for (l = 0; l < signatures[s]->slots_nr; l++) {
+            if (!read_u64(fp, &value) || !read_u32(fp, &left) || !read_u32(fp, &ready)) {
+                return 0;
+            }
+            signatures[s]->slots[l].value = value;
+            signatures[s]->slots[l].left = left;
+            signatures[s]->slots[l].ready = ready;
+        }
+    }
+    if (!read_u32(fp, &counters_nr) || counters_nr != get_counters_nr(signatures, signatures_count)) {
+        return 0;
+    }
+    for (s = 0; signatures != NULL && s < signatures_count; s++) {
+        if (signatures[s]->tpl != NULL) {
+            if (!read_u64(fp, &value)) {
+                return 0;
+            }
+            signatures[s]->tpl->counter = value;
+        }
+    }
+    return 1;
+}
+
+int evlog_checkpoint(pig_evlog_ctx *evlog, pigsty_entry_ctx **signatures) {
+    unsigned long long state[4];
+    if (evlog == NULL || evlog->is_replay) {
+        return 1;
+    }
+    if ((evlog->packet_nr % PIG_EVLOG_CHECKPOINT_INTERVAL) != 0) {
+        return 1;
+    }
+    mk_rnd_get_state(state);
+    return (write_u32(evlog->fp, PIG_EVLOG_CHECKPOINT_MARK) &&
+            write_u64(evlog->fp, evlog->packet_nr) &&
+            write_u64(evlog->fp, get_pig_pkt_seq()) &&
+            write_u64(evlog->fp, state[0]) && write_u64(evlog->fp, state[1]) &&
+            write_u64(evlog->fp, state[2]) && write_u64(evlog->fp, state[3]) &&
+            write_slots(evlog->fp, signatures, evlog->signatures_count));
+}
+
+int evlog_record(pig_evlog_ctx *evlog, const size_t signature_index) {
+    if (evlog == NULL || evlog->is_replay) {
+        return 1;
+    }
+    evlog->packet_nr++;
+    return write_u32(evlog->fp, signature_index);
+}
+
+static int read_checkpoint(pig_evlog_ctx *evlog, unsigned long long *packet_nr, unsigned long long *seq, unsigned long long state[4]) {
+    return (read_u64(evlog->fp, packet_nr) && read_u64(evlog->fp, seq) &&
+            read_u64(evlog->fp, &state[0]) && read_u64(evlog->fp, &state[1]) &&
+            read_u64(evlog->fp, &state[2]) && read_u64(evlog->fp, &state[3]));
+}
+
+int evlog_seek(pig_evlog_ctx *evlog, const unsigned long long packet_nr, pigsty_entry_ctx **signatures) {
+    unsigned long long state[4], best_state[4];
+    unsigned long long cp_nr = 0, best_nr = 0, nr = 0, seq = 0, best_seq = 0;
+    long best_offset = -1, offset = 0;
+    unsigned int word = 0;
+    if (evlog == NULL || !evlog->is_replay) {
+        return 0;
+    }
+    fseek(evlog->fp, 32, SEEK_SET);
+    offset = ftell(evlog->fp);
+    while (nr <= packet_nr && read_u32(evlog->fp, &word)) {
+        if (word == PIG_EVLOG_CHECKPOINT_MARK) {
+            if (!read_checkpoint(evlog, &cp_nr, &seq, state) || !skip_slots(evlog->fp)) {
+                break;
+            }
+            if (cp_nr <= packet_nr) {
+                best_nr = cp_nr;
+                best_seq = seq;
+                memcpy(best_state, state, sizeof(best_state));
+                //  INFO(Santiago): rewinding to the checkpoint itself, evlog_replay_next() will consume it.
+                best_offset = offset;
+            }
+        } else {
+            nr++;
+        }
+        offset = ftell(evlog->fp);
+    }
+    if (best_offset == -1 || nr < packet_nr) {
+        printf("pig PANIC: the event log does not reach the packet #%llu.\n", packet_nr);
+        return 0;
+    }
+    //  INFO(Santiago): mark (u32), packet number, packet sequence and prng state (6 x u64) come before the slots.
+    fseek(evlog->fp, best_offset + 52, SEEK_SET);
+    if (!read_slots(evlog->fp, signatures, evlog->signatures_count)) {
+        printf("pig PANIC: the event log slots and counters do not match the loaded signatures.\n");
+        return 0;
+    }
+    fseek(evlog->fp, best_offset, SEEK_SET);
+    mk_rnd_set_state(best_state);
+    set_pig_pkt_seq(best_seq);
+    evlog->packet_nr = best_nr;
+    return 1;
+}
+
+int evlog_replay_next(pig_evlog_ctx *evlog, size_t *signature_index) {
+    unsigned long long state[4], curr_state[4];
+    unsigned long long cp_nr = 0, seq = 0;
+    unsigned int word = 0;
+    if (evlog == NULL || !evlog->is_replay || signature_index == NULL) {
+        return 0;
+    }
+    if (!read_u32(evlog->fp, &word)) {
+        return 0;
+    }
+    if (word == PIG_EVLOG_CHECKPOINT_MARK) {
+        if (!read_checkpoint(evlog, &cp_nr, &seq, state) || !skip_slots(evlog->fp)) {
+            return 0;
+        }
+        mk_rnd_get_state(curr_state);
+        if (cp_nr != evlog->packet_nr || seq != get_pig_pkt_seq() || memcmp(state, curr_state, sizeof(state)) != 0) {
+            //  WARN(Santiago): the regenerated traffic diverged from the logged one.
+            return -1;
+        }
+        if (!read_u32(evlog->fp, &word) || word == PIG_EVLOG_CHECKPOINT_MARK) {
+            return 0;
+        }
+    }
+    *signature_index = word;
+    evlog->packet_nr++;
+    return 1;
+}
@@ -0,0 +1,39 @@
+/*
+ *                                Copyright (C) 2015 by Rafael Santiago
+ *
+ * This is a free software. You can redistribute it and/or modify under
+ * the terms of the GNU General Public License version 2.
+ *
+ */
+#ifndef PIG_EVLOG_H
+#define PIG_EVLOG_H 1
+
+#include "types.h"
+#include <stdlib.h>
+#include <stdio.h>
+
+#define PIG_EVLOG_CHECKPOINT_INTERVAL 1024
+
+typedef struct _pig_evlog {
+    FILE *fp;
+    int is_replay;
+    unsigned long long seed;
+    size_t signatures_count;
+    unsigned long long packet_nr;
+}pig_evlog_ctx;
+
+pig_evlog_ctx *evlog_create(const char *filepath, const unsigned long long seed, const size_t signatures_count);
+
+pig_evlog_ctx *evlog_open(const char *filepath);
+
+void evlog_close(pig_evlog_ctx *evlog);
+
+int evlog_checkpoint(pig_evlog_ctx *evlog, pigsty_entry_ctx **signatures);
+
+int evlog_record(pig_evlog_ctx *evlog, const size_t signature_index);
+
+int evlog_seek(pig_evlog_ctx *evlog, const unsigned long long packet_nr, pigsty_entry_ctx **signatures);
+
+int evlog_replay_next(pig_evlog_ctx *evlog, size_t *signature_index);
+
+#endif
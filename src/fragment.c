@@ -0,0 +1,194 @@
+/*
+ *                                Copyright (C) 2015 by Rafael Santiago
+ *
+ * This is a free software. You can redistribute it and/or modify under
+ * the terms of the GNU General Public License version 2.
+ *
+ */
+#include "fragment.h"
+#include "chsum.h"
+#include "mkrnd.h"
+#include <string.h>
+
+//  INFO(Santiago): the datagram is built once and never copied, each fragment only brings its own IP
+//                  header (total length, MF and offset patched) and points to a slice of the original
+//                  payload. When overlapping, a fragment starts some bytes before the end of the previous
+//                  one. The duplicates are copies of fragments picked at random, sent along with the others.
+//                  These random choices come from a stream of their own, seeded by the run's seed and the
+//                  datagram's IP header, so the stream that builds the traffic is never touched (an event
+//                  log stays valid) and a replayed datagram is cut the same way.
+
+#define get_u16(b) ( ((unsigned short)(b)[0] << 8) | (b)[1] )
+
+#define put_u16(b, w) ( (b)[0] = ((w) & 0xff00) >> 8, (b)[1] = (w) & 0x00ff )
+
+static size_t get_step(const pig_fragmenter_ctx *fragmenter);
+
+static void shuffle_fragments(pig_fragment_ctx *fragments, const size_t fragments_nr);
+
+static size_t mk_next_fragment_hdr(const unsigned char *dgram, const size_t hdr_size, unsigned char *hdr);
+
+static unsigned long long splitmix64(unsigned long long *x);
+
+static void seed_rnd_state(const pig_fragmenter_ctx *fragmenter, const unsigned char *dgram, unsigned long long state[4]);
+
+static void swap_rnd_state(unsigned long long state[4]);
+
+static size_t get_step(const pig_fragmenter_ctx *fragmenter) {
+    //  WARN(Santiago): offsets are counted in 8 byte units, so are the sizes of all but the last fragment.
+    size_t size = fragmenter->size & ~((size_t)7), overlap = (fragmenter->overlap + 7) & ~((size_t)7);
+    if (size == 0 || overlap >= size) {
+        return 0;
+    }
+    return size - overlap;
+}
+
+static void shuffle_fragments(pig_fragment_ctx *fragments, const size_t fragments_nr) {
+    pig_fragment_ctx temp;
+    size_t i = 0, j = 0;
+    for (i = fragments_nr - 1; i > 0; i--) {
+        j = mk_rnd_u32() % (i + 1);
+        temp = fragments[i];
+        fragments[i] = fragments[j];
+        fragments[j] = temp;
+    }
+}
+
+static size_t mk_next_fragment_hdr(const unsigned char *dgram, const size_t hdr_size, unsigned char *hdr) {
+    size_t o = 20, size = 20, option_size = 0;
+    memcpy(hdr, dgram, 20);
+    //  INFO(Santiago): as RFC 791 asks, the fragments after the first one only carry the options with the copied
+    //                  flag. The header is padded with end of options up to a multiple of 4 bytes.
+    while (o < hdr_size && dgram[o] != 0) {
+        option_size = (dgram[o] == 1) ? 1 : ((o + 1 < hdr_size) ? dgram[o + 1] : 0);
+        if (option_size == 0 || (dgram[o] != 1 && option_size < 2) || o + option_size > hdr_size) {
+            break;
+        }
+        if (dgram[o] & 0x80) {
+            memcpy(&hdr[size], &dgram[o], option_size);
+            size += option_size;
+        }
+        o += option_size;
+    }
+    while (size & 3) {
+        hdr[size++] = 0;
+    }
+    hdr[0] = (hdr[0] & 0xf0) | (size >> 2);
+    return size;
+}
+
+static unsigned long long splitmix64(unsigned long long *x) {
+    unsigned long long z = (*x += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+static void seed_rnd_state(const pig_fragmenter_ctx *fragmenter, const unsigned char *dgram, unsigned long long state[4]) {
+    //  INFO(Santiago): total length, id and header checksum, the checksum already sums up the addresses.
+    unsigned long long x = fragmenter->seed ^ (((unsigned long long)get_u16(&dgram[2]) << 32) |
+                                               ((unsigned long long)get_u16(&dgram[4]) << 16) | get_u16(&dgram[10]));
+    size_t s = 0;
+    for (s = 0; s < 4; s++) {
+        state[s] = splitmix64(&x);
+    }
+}
+
+static void swap_rnd_state(unsigned long long state[4]) {
+    unsigned long long temp[4];
+    mk_rnd_get_state(temp);
+    mk_rnd_set_state(state);
+    memcpy(state, temp, sizeof(temp));
+}
+
+int get_pig_fragment_order(const char *name, pig_fragment_order_t *order) {
+    if (name == NULL || strcmp(name, "in-order") == 0) {
+        *order = kFragmentInOrder;
+    } else if (strcmp(name, "reverse") == 0) {
+        *order = kFragmentReverse;
+    } else if (strcmp(name, "random") == 0) {
+        *order = kFragmentRandom;
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
+size_t get_pig_fragments_nr(const unsigned char *dgram, const size_t dgram_size, const pig_fragmenter_ctx *fragmenter) {
+    size_t hdr_size = 0, payload_size = 0, step = 0, size = 0;
+    if (dgram == NULL || fragmenter == NULL || dgram_size < 20 || (dgram[0] >> 4) != 4 || (get_u16(&dgram[6]) & 0x3fff) != 0) {
+        return 0;
+    }
+    hdr_size = (dgram[0] & 0x0f) * 4;
+    step = get_step(fragmenter);
+    size = fragmenter->size & ~((size_t)7);
+    if (hdr_size < 20 || hdr_size >= dgram_size || step == 0) {
+        return 0;
+    }
+    payload_size = dgram_size - hdr_size;
+    if (payload_size <= size) {
+        return 0;
+    }
+    return 1 + (payload_size - size + step - 1) / step + fragmenter->duplicates;
+}
+
+int mk_pig_fragments(const unsigned char *dgram, const size_t dgram_size, const pig_fragmenter_ctx *fragmenter, pig_fragment_ctx *fragments, const size_t fragments_max) {
+    size_t fragments_nr = get_pig_fragments_nr(dgram, dgram_size, fragmenter), hdr_size = 0, payload_size = 0;
+    size_t step = 0, size = 0, f = 0, distinct_nr = 0, start = 0;
+    unsigned long long state[4];
+    unsigned short flags_fragoff = 0;
+    pig_fragment_ctx temp;
+    if (fragments_nr == 0) {
+        return 0;
+    }
+    if (fragments_nr > fragments_max) {
+        return -1;
+    }
+    hdr_size = (dgram[0] & 0x0f) * 4;
+    payload_size = dgram_size - hdr_size;
+    step = get_step(fragmenter);
+    size = fragmenter->size & ~((size_t)7);
+    distinct_nr = fragments_nr - fragmenter->duplicates;
+    for (f = 0; f < distinct_nr; f++) {
+        start = f * step;
+        fragments[f].offset = hdr_size + start;
+        fragments[f].size = (payload_size - start > size ? size : payload_size - start);
+        if (f == 0) {
+            fragments[f].hdr_size = hdr_size;
+            memcpy(fragments[f].hdr, dgram, hdr_size);
+        } else {
+            fragments[f].hdr_size = mk_next_fragment_hdr(dgram, hdr_size, fragments[f].hdr);
+        }
+        //  INFO(Santiago): DF would forbid what is being done here, so only the reserved bit is kept.
+        flags_fragoff = (get_u16(&dgram[6]) & 0x8000) | (start >> 3);
+        if (f + 1 < distinct_nr) {
+            flags_fragoff |= 0x2000;
+        }
+        put_u16(&fragments[f].hdr[2], fragments[f].hdr_size + fragments[f].size);
+        put_u16(&fragments[f].hdr[6], flags_fragoff);
+        chsum_ip4_hdr(fragments[f].hdr, fragments[f].hdr_size);
+    }
+    seed_rnd_state(fragmenter, dgram, state);
+    swap_rnd_state(state);
+    for (f = distinct_nr; f < fragments_nr; f++) {
+        fragments[f] = fragments[mk_rnd_u32() % distinct_nr];
+    }
+    switch (fragmenter->order) {
+        case kFragmentReverse:
+            for (f = 0; f < fragments_nr / 2; f++) {
+                temp = fragments[f];
+                fragments[f] = fragments[fragments_nr - 1 - f];
+                fragments[fragments_nr - 1 - f] = temp;
+            }
+            break;
+
+        case kFragmentRandom:
+            shuffle_fragments(fragments, fragments_nr);
+            break;
+
+        default:
+            break;
+    }
+    swap_rnd_state(state);
+    return fragments_nr;
+}
@@ -0,0 +1,41 @@
+/*
+ *                                Copyright (C) 2015 by Rafael Santiago
+ *
+ * This is a free software. You can redistribute it and/or modify under
+ * the terms of the GNU General Public License version 2.
+ *
+ */
+#ifndef PIG_FRAGMENT_H
+#define PIG_FRAGMENT_H 1
+
+#include "types.h"
+
+typedef enum _pig_fragment_order {
+    kFragmentInOrder,
+    kFragmentReverse,
+    kFragmentRandom
+}pig_fragment_order_t;
+
+typedef struct _pig_fragmenter {
+    size_t size;
+    pig_fragment_order_t order;
+    size_t overlap;
+    size_t duplicates;
+    unsigned long long seed;
+}pig_fragmenter_ctx;
+
+//  INFO(Santiago): a fragment is its own IP header plus a slice of the original datagram.
+typedef struct _pig_fragment {
+    unsigned char hdr[60];
+    size_t hdr_size;
+    size_t offset;
+    size_t size;
+}pig_fragment_ctx;
+
+int get_pig_fragment_order(const char *name, pig_fragment_order_t *order);
+
+size_t get_pig_fragments_nr(const unsigned char *dgram, const size_t dgram_size, const pig_fragmenter_ctx *fragmenter);
+
+int mk_pig_fragments(const unsigned char *dgram, const size_t dgram_size, const pig_fragmenter_ctx *fragmenter, pig_fragment_ctx *fragments, const size_t fragments_max);
+
+#endif
@@ -0,0 +1,364 @@
+/*
+ *                                Copyright (C) 2015 by Rafael Santiago
+ *
+ * This is a free software. You can redistribute it and/or modify under
+ * the terms of the GNU General Public License version 2.
+ *
+ */
+#include "fuzz.h"
+#include "memory.h"
+#include "lists.h"
+#include "mkrnd.h"
+#include "chsum.h"
+#include <string.h>
+#include <stdio.h>
+#include <ctype.h>
+
+#define PIG_FUZZ_MAX_INSDEL 4
+
+#define PIG_FUZZ_MAX_CHUNK 16
+
+struct fuzz_strategy {
+    const char *label;
+    const unsigned int flag;
+};
+
+static struct fuzz_strategy FUZZ_STRATEGIES[] = {
+    { "bitflip", PIG_FUZZ_BITFLIP },
+    {  "insert",  PIG_FUZZ_INSERT },
+    {  "delete",  PIG_FUZZ_DELETE },
+    {  "splice",  PIG_FUZZ_SPLICE },
+    {    "case",    PIG_FUZZ_CASE },
+    { "chunked", PIG_FUZZ_CHUNKED }
+};
+
+static const size_t FUZZ_STRATEGIES_SIZE = sizeof(FUZZ_STRATEGIES) / sizeof(FUZZ_STRATEGIES[0]);
+
+static const char *FUZZ_DEFAULT_DICT[] = {
+    "../", "%00", "\r\n", "' OR '1'='1", "<script>", "%n%n%n%n",
+    "AAAAAAAAAAAAAAAA", "\xff\xfe", "cmd.exe", "/bin/sh", "%2e%2e%2f", "\\\\"
+};
+
+static const size_t FUZZ_DEFAULT_DICT_SIZE = sizeof(FUZZ_DEFAULT_DICT) / sizeof(FUZZ_DEFAULT_DICT[0]);
+
+static void fuzz_bitflip(unsigned char *dgram, const size_t dgram_size, const size_t l7_offset);
+
+static void fuzz_case(unsigned char *dgram, const size_t dgram_size, const size_t l7_offset);
+
+static void fuzz_splice(const pig_fuzz_ctx *fuzz, unsigned char *dgram, const size_t dgram_size, const size_t l7_offset);
+
+static void fuzz_insert(unsigned char *dgram, size_t *dgram_size, const size_t dgram_capacity, const size_t l7_offset);
+
+static void fuzz_delete(unsigned char *dgram, size_t *dgram_size, const size_t l7_offset);
+
+static void fuzz_chunked(unsigned char *dgram, size_t *dgram_size, const size_t dgram_capacity, const size_t l7_offset);
+
+static int is_http_hdr(const unsigned char *line, const size_t line_size, const char *name);
+
+static void fix_ip4_dgram(unsigned char *dgram, const size_t dgram_size);
+
+int get_fuzz_strategies(const char *data, const size_t dsize, unsigned int *strategies) {
+    char label[20];
+    size_t d = 0, l = 0, s = 0;
+    int found = 0;
+    if (data == NULL || strategies == NULL) {
+        return 0;
+    }
+    *strategies = 0;
+    memset(label, 0, sizeof(label));
+    for (d = 0; d <= dsize; d++) {
+        if (d == dsize || data[d] == ',') {
+            found = 0;
+            for (s = 0; s < FUZZ_STRATEGIES_SIZE && !found; s++) {
+                if (strcmp(label, FUZZ_STRATEGIES[s].label) == 0) {
+                    *strategies |= FUZZ_STRATEGIES[s].flag;
+                    found = 1;
+                }
+            }
+            if (!found) {
+                return 0;
+            }
+            memset(label, 0, sizeof(label));
+            l = 0;
+        } else if (data[d] != ' ') {
+            if (l == sizeof(label) - 1) {
+                return 0;
+            }
+            label[l++] = data[d];
+        }
+    }
+    return (*strategies != 0);
+}
+
+pig_fuzz_ctx *mk_pig_fuzz(pigsty_conf_set_ctx *conf) {
+    pig_fuzz_ctx *fuzz = NULL;
+    pigsty_field_ctx *field = NULL;
+    const unsigned char *dp = NULL, *dp_end = NULL, *tp = NULL;
+    size_t d = 0;
+    field = get_pigsty_conf_set_field(kFuzz_strategy, conf);
+    if (field == NULL) {
+        return NULL;
+    }
+    fuzz = (pig_fuzz_ctx *) pig_newseg(sizeof(pig_fuzz_ctx));
+    memset(fuzz, 0, sizeof(pig_fuzz_ctx));
+    get_fuzz_strategies(field->data, field->dsize, &fuzz->strategies);
+    fuzz->intensity = 1;
+    field = get_pigsty_conf_set_field(kFuzz_intensity, conf);
+    if (field != NULL && *(unsigned char *)field->data > 0) {
+        fuzz->intensity = *(unsigned char *)field->data;
+    }
+    field = get_pigsty_conf_set_field(kFuzz_dictionary, conf);
+    if (field != NULL && field->dsize > 0) {
+        //  INFO(Santiago): the dictionary entries are separated by '|'.
+        dp = (unsigned char *)field->data;
+        dp_end = dp + field->dsize;
+        fuzz->dict_nr = 1;
+        for (tp = dp; tp != dp_end; tp++) {
+            fuzz->dict_nr += (*tp == '|');
+        }
+        fuzz->dict = (unsigned char **) pig_newseg(sizeof(unsigned char *) * fuzz->dict_nr);
+        fuzz->dict_sizes = (size_t *) pig_newseg(sizeof(size_t) * fuzz->dict_nr);
+        for (d = 0, tp = dp; d < fuzz->dict_nr; d++, dp = tp + 1) {
+            for (tp = dp; tp != dp_end && *tp != '|'; tp++);
+            fuzz->dict_sizes[d] = tp - dp;
+            fuzz->dict[d] = (unsigned char *) pig_newseg(fuzz->dict_sizes[d] + 1);
+            memcpy(fuzz->dict[d], dp, fuzz->dict_sizes[d]);
+        }
+    }
+    return fuzz;
+}
+
+void del_pig_fuzz(pig_fuzz_ctx *fuzz) {
+    size_t d = 0;
+    if (fuzz == NULL) {
+        return;
+    }
+    for (d = 0; d < fuzz->dict_nr; d++) {
+        free(fuzz->dict[d]);
+    }
+    if (fuzz->dict != NULL) {
+        free(fuzz->dict);
+        free(fuzz->dict_sizes);
+    }
+    free(fuzz);
+}
+
+void fuzz_ip4_dgram(const pig_fuzz_ctx *fuzz, unsigned char *dgram, size_t *dgram_size, const size_t dgram_capacity) {
+    unsigned int enabled[8];
+    size_t enabled_nr = 0, s = 0;
+    unsigned int i = 0;
+    size_t l7_offset = 0;
+    if (fuzz == NULL || dgram == NULL || dgram_size == NULL || *dgram_size < 20) {
+        return;
+    }
+    for (s = 0; s < FUZZ_STRATEGIES_SIZE; s++) {
+        if (fuzz->strategies & FUZZ_STRATEGIES[s].flag) {
+            enabled[enabled_nr++] = FUZZ_STRATEGIES[s].flag;
+        }
+    }
+    if (enabled_nr == 0) {
+        return;
+    }
+    l7_offset = get_ip4_l7_offset(dgram, *dgram_size);
+    for (i = 0; i < fuzz->intensity; i++) {
+        switch (enabled[mk_rnd_u32() % enabled_nr]) {
+            case PIG_FUZZ_BITFLIP:
+                fuzz_bitflip(dgram, *dgram_size, l7_offset);
+                break;
+
+            case PIG_FUZZ_CASE:
+                fuzz_case(dgram, *dgram_size, l7_offset);
+                break;
+
+            case PIG_FUZZ_SPLICE:
+                fuzz_splice(fuzz, dgram, *dgram_size, l7_offset);
+                break;
+
+            case PIG_FUZZ_INSERT:
+                fuzz_insert(dgram, dgram_size, dgram_capacity, l7_offset);
+                break;
+
+            case PIG_FUZZ_DELETE:
+                fuzz_delete(dgram, dgram_size, l7_offset);
+                break;
+
+            case PIG_FUZZ_CHUNKED:
+                fuzz_chunked(dgram, dgram_size, dgram_capacity, l7_offset);
+                break;
+        }
+    }
+}
+
+static void fuzz_bitflip(unsigned char *dgram, const size_t dgram_size, const size_t l7_offset) {
+    size_t pos = 0;
+    unsigned char old = 0;
+    unsigned int rnd = 0;
+    if (l7_offset >= dgram_size) {
+        return;
+    }
+    rnd = mk_rnd_u32();
+    pos = l7_offset + ((rnd >> 3) % (dgram_size - l7_offset));
+    old = dgram[pos];
+    dgram[pos] ^= (1 << (rnd & 0x7));
+    adjust_ip4_l4_chsum(dgram, dgram_size, pos, &old, 1);
+}
+
+static void fuzz_case(unsigned char *dgram, const size_t dgram_size, const size_t l7_offset) {
+    size_t payload_size = 0, pos = 0, p = 0;
+    unsigned char old = 0;
+    if (l7_offset >= dgram_size) {
+        return;
+    }
+    payload_size = dgram_size - l7_offset;
+    pos = mk_rnd_u32() % payload_size;
+    for (p = 0; p < payload_size; p++) {
+        if (isalpha(dgram[l7_offset + pos])) {
+            old = dgram[l7_offset + pos];
+            dgram[l7_offset + pos] ^= 0x20;
+            adjust_ip4_l4_chsum(dgram, dgram_size, l7_offset + pos, &old, 1);
+            return;
+        }
+        pos = (pos + 1) % payload_size;
+    }
+}
+
+static void fuzz_splice(const pig_fuzz_ctx *fuzz, unsigned char *dgram, const size_t dgram_size, const size_t l7_offset) {
+    const unsigned char *token = NULL;
+    size_t token_size = 0, pos = 0;
+    size_t d = 0;
+    if (l7_offset >= dgram_size) {
+        return;
+    }
+    if (fuzz->dict_nr > 0) {
+        d = mk_rnd_u32() % fuzz->dict_nr;
+        token = fuzz->dict[d];
+        token_size = fuzz->dict_sizes[d];
+    } else {
+        d = mk_rnd_u32() % FUZZ_DEFAULT_DICT_SIZE;
+        token = (const unsigned char *)FUZZ_DEFAULT_DICT[d];
+        token_size = strlen(FUZZ_DEFAULT_DICT[d]);
+    }
+    pos = l7_offset + (mk_rnd_u32() % (dgram_size - l7_offset));
+    //  INFO(Santiago): the token overwrites the payload, so the checksum is only adjusted by the delta.
+    patch_ip4_dgram(dgram, dgram_size, pos, token, (token_size < dgram_size - pos) ? token_size : dgram_size - pos);
+}
+
+static void fuzz_insert(unsigned char *dgram, size_t *dgram_size, const size_t dgram_capacity, const size_t l7_offset) {
+    size_t n = 1 + (mk_rnd_u32() % PIG_FUZZ_MAX_INSDEL);
+    size_t pos = 0;
+    if (*dgram_size + n > dgram_capacity || *dgram_size + n > 0xffff) {
+        return;
+    }
+    pos = l7_offset + (mk_rnd_u32() % (*dgram_size - l7_offset + 1));
+    memmove(&dgram[pos + n], &dgram[pos], *dgram_size - pos);
+    mk_rnd_fill_bytes(&dgram[pos], n);
+    *dgram_size += n;
+    fix_ip4_dgram(dgram, *dgram_size);
+}
+
+static void fuzz_delete(unsigned char *dgram, size_t *dgram_size, const size_t l7_offset) {
+    size_t payload_size = 0, n = 0, pos = 0;
+    if (l7_offset >= *dgram_size) {
+        return;
+    }
+    payload_size = *dgram_size - l7_offset;
+    n = 1 + (mk_rnd_u32() % PIG_FUZZ_MAX_INSDEL);
+    if (n > payload_size) {
+        n = payload_size;
+    }
+    pos = l7_offset + (mk_rnd_u32() % (payload_size - n + 1));
+    memmove(&dgram[pos], &dgram[pos + n], *dgram_size - pos - n);
+    *dgram_size -= n;
+    fix_ip4_dgram(dgram, *dgram_size);
+}
+
+static void fuzz_chunked(unsigned char *dgram, size_t *dgram_size, const size_t dgram_capacity, const size_t l7_offset) {
+    //  INFO(Santiago): re-encodes the HTTP body (what follows the first "\r\n\r\n") as chunked transfer coding
+    //                  using random chunk sizes. The header block gets "Transfer-Encoding: chunked" and loses
+    //                  any Content-Length or older Transfer-Encoding, otherwise the peer would not decode it.
+    unsigned char *encoded = NULL, *ep = NULL;
+    size_t hdr_end = 0, body_offset = 0, b = 0, e = 0, chunk = 0, capacity = 0;
+    for (b = l7_offset; b + 3 < *dgram_size; b++) {
+        if (memcmp(&dgram[b], "\r\n\r\n", 4) == 0) {
+            hdr_end = b + 2;
+            body_offset = b + 4;
+            break;
+        }
+    }
+    if (body_offset == 0 || body_offset >= *dgram_size || dgram_capacity <= l7_offset) {
+        return;
+    }
+    capacity = dgram_capacity - l7_offset;
+    encoded = (unsigned char *) pig_newseg(capacity);
+    ep = encoded;
+    for (b = l7_offset; b < hdr_end; b = e + 2) {
+        for (e = b; e + 1 < hdr_end && memcmp(&dgram[e], "\r\n", 2) != 0; e++)
+            ;
+        if (b != l7_offset && (is_http_hdr(&dgram[b], e - b, "content-length") ||
+                               is_http_hdr(&dgram[b], e - b, "transfer-encoding"))) {
+            continue;
+        }
+        if ((ep - encoded) + (e + 2 - b) > capacity) {
+            free(encoded);
+            return;
+        }
+        memcpy(ep, &dgram[b], e + 2 - b);
+        ep += e + 2 - b;
+    }
+    if ((size_t)(ep - encoded) + 30 > capacity) {
+        free(encoded);
+        return;
+    }
+    memcpy(ep, "Transfer-Encoding: chunked\r\n\r\n", 30);
+    ep += 30;
+    for (b = body_offset; b < *dgram_size; b += chunk) {
+        chunk = 1 + (mk_rnd_u32() % PIG_FUZZ_MAX_CHUNK);
+        if (b + chunk > *dgram_size) {
+            chunk = *dgram_size - b;
+        }
+        if ((ep - encoded) + chunk + 8 > capacity) {
+            free(encoded);
+            return;
+        }
+        ep += sprintf((char *)ep, "%x\r\n", (unsigned int)chunk);
+        memcpy(ep, &dgram[b], chunk);
+        ep += chunk;
+        *ep = '\r';
+        *(ep + 1) = '\n';
+        ep += 2;
+    }
+    if ((size_t)(ep - encoded) + 5 > capacity || l7_offset + (size_t)(ep - encoded) + 5 > 0xffff) {
+        free(encoded);
+        return;
+    }
+    memcpy(ep, "0\r\n\r\n", 5);
+    ep += 5;
+    memcpy(&dgram[l7_offset], encoded, ep - encoded);
+    *dgram_size = l7_offset + (ep - encoded);
+    free(encoded);
+    fix_ip4_dgram(dgram, *dgram_size);
+}
+
+static int is_http_hdr(const unsigned char *line, const size_t line_size, const char *name) {
+    size_t n = 0, name_size = strlen(name);
+    if (line_size <= name_size || line[name_size] != ':') {
+        return 0;
+    }
+    for (n = 0; n < name_size; n++) {
+        if (tolower(line[n]) != name[n]) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static void fix_ip4_dgram(unsigned char *dgram, const size_t dgram_size) {
+    size_t l4_offset = get_ip4_l4_offset(dgram, dgram_size);
+    dgram[2] = (dgram_size & 0xff00) >> 8;
+    dgram[3] = dgram_size & 0x00ff;
+    if (dgram[9] == 17 && l4_offset + 8 <= dgram_size) {
+        dgram[l4_offset + 4] = ((dgram_size - l4_offset) & 0xff00) >> 8;
+        dgram[l4_offset + 5] = (dgram_size - l4_offset) & 0x00ff;
+    }
+    chsum_ip4_dgram(dgram, dgram_size);
+}
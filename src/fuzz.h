@@ -0,0 +1,28 @@
+/*
+ *                                Copyright (C) 2015 by Rafael Santiago
+ *
+ * This is a free software. You can redistribute it and/or modify under
+ * the terms of the GNU General Public License version 2.
+ *
+ */
+#ifndef PIG_FUZZ_H
+#define PIG_FUZZ_H 1
+
+#include "types.h"
+
+#define PIG_FUZZ_BITFLIP    0x01
+#define PIG_FUZZ_INSERT     0x02
+#define PIG_FUZZ_DELETE     0x04
+#define PIG_FUZZ_SPLICE     0x08
+#define PIG_FUZZ_CASE       0x10
+#define PIG_FUZZ_CHUNKED    0x20
+
+int get_fuzz_strategies(const char *data, const size_t dsize, unsigned int *strategies);
+
+pig_fuzz_ctx *mk_pig_fuzz(pigsty_conf_set_ctx *conf);
+
+void del_pig_fuzz(pig_fuzz_ctx *fuzz);
+
+void fuzz_ip4_dgram(const pig_fuzz_ctx *fuzz, unsigned char *dgram, size_t *dgram_size, const size_t dgram_capacity);
+
+#endif
@@ -28,6 +28,13 @@ void parse_icmp_dgram(struct icmp **hdr, const unsigned char *buf, size_t bsize)
     }
 }
 
+void put_icmp_hdr(const struct icmp *hdr, unsigned char *buf) {
+    buf[0] = hdr->type;
+    buf[1] = hdr->code;
+    buf[2] = (hdr->chsum >> 8);
+    buf[3] = (hdr->chsum & 0x00ff);
+}
+
 unsigned char *mk_icmp_buffer(const struct icmp *hdr, size_t *bsize) {
     unsigned char *retval = NULL;
     size_t p = 0;
@@ -35,10 +42,7 @@ unsigned char *mk_icmp_buffer(const struct icmp *hdr, size_t *bsize) {
         return NULL;
     }
     retval = (unsigned char *) pig_newseg(hdr->payload_size + 4);
-    retval[0] = hdr->type;
-    retval[1] = hdr->code;
-    retval[2] = (hdr->chsum >> 8);
-    retval[3] = (hdr->chsum & 0x00ff);
+    put_icmp_hdr(hdr, retval);
     for (p = 0; p < hdr->payload_size; p++) {
         retval[4 + p] = hdr->payload[p];
     }
@@ -22,6 +22,8 @@ void parse_icmp_dgram(struct icmp **hdr, const unsigned char *buf, size_t bsize)
 
 unsigned char *mk_icmp_buffer(const struct icmp *hdr, size_t *bsize);
 
+void put_icmp_hdr(const struct icmp *hdr, unsigned char *buf);
+
 unsigned short eval_icmp_chsum(const struct icmp hdr);
 
 #endif
@@ -51,6 +51,29 @@ void parse_ip4_dgram(struct ip4 **hdr, const unsigned char *buf, size_t bsize) {
     }
 }
 
+void put_ip4_hdr(const struct ip4 *hdr, unsigned char *buf) {
+    buf[ 0] = (hdr->version << 4) | hdr->ihl;
+    buf[ 1] = hdr->tos;
+    buf[ 2] = (hdr->tlen & 0xff00) >> 8;
+    buf[ 3] = (hdr->tlen & 0x00ff);
+    buf[ 4] = (hdr->id & 0xff00) >> 8;
+    buf[ 5] = (hdr->id & 0x00ff);
+    buf[ 6] = (hdr->flags_fragoff & 0xff00) >> 8;
+    buf[ 7] = (hdr->flags_fragoff & 0x00ff);
+    buf[ 8] = hdr->ttl;
+    buf[ 9] = hdr->protocol;
+    buf[10] = (hdr->chsum & 0xff00) >> 8;
+    buf[11] = (hdr->chsum & 0x00ff);
+    buf[12] = (hdr->src & 0xff000000) >> 24;
+    buf[13] = (hdr->src & 0x00ff0000) >> 16;
+    buf[14] = (hdr->src & 0x0000ff00) >>  8;
+    buf[15] = (hdr->src & 0x000000ff);
+    buf[16] = (hdr->dst & 0xff000000) >> 24;
+    buf[17] = (hdr->dst & 0x00ff0000) >> 16;
+    buf[18] = (hdr->dst & 0x0000ff00) >>  8;
+    buf[19] = (hdr->dst & 0x000000ff);
+}
+
 unsigned char *mk_ip4_buffer(const struct ip4 *hdr, size_t *bsize) {
     unsigned char *retval = NULL;
     size_t p = 0;
@@ -59,26 +82,7 @@ unsigned char *mk_ip4_buffer(const struct ip4 *hdr, size_t *bsize) {
     }
     *bsize = hdr->tlen;
     retval = (unsigned char *) pig_newseg(*bsize);
-    retval[ 0] = (hdr->version << 4) | hdr->ihl;
-    retval[ 1] = hdr->tos;
-    retval[ 2] = (hdr->tlen & 0xff00) >> 8;
-    retval[ 3] = (hdr->tlen & 0x00ff);
-    retval[ 4] = (hdr->id & 0xff00) >> 8;
-    retval[ 5] = (hdr->id & 0x00ff);
-    retval[ 6] = (hdr->flags_fragoff & 0xff00) >> 8;
-    retval[ 7] = (hdr->flags_fragoff & 0x00ff);
-    retval[ 8] = hdr->ttl;
-    retval[ 9] = hdr->protocol;
-    retval[10] = (hdr->chsum & 0xff00) >> 8;
-    retval[11] = (hdr->chsum & 0x00ff);
-    retval[12] = (hdr->src & 0xff000000) >> 24;
-    retval[13] = (hdr->src & 0x00ff0000) >> 16;
-    retval[14] = (hdr->src & 0x0000ff00) >>  8;
-    retval[15] = (hdr->src & 0x000000ff);
-    retval[16] = (hdr->dst & 0xff000000) >> 24;
-    retval[17] = (hdr->dst & 0x00ff0000) >> 16;
-    retval[18] = (hdr->dst & 0x0000ff00) >>  8;
-    retval[19] = (hdr->dst & 0x000000ff);
+    put_ip4_hdr(hdr, retval);
     if (*bsize > 20) {
         for (p = 0; p < hdr->payload_size; p++) {
             retval[20 + p] = hdr->payload[p];
@@ -30,6 +30,8 @@ void parse_ip4_dgram(struct ip4 **hdr, const unsigned char *buf, size_t bsize);
 
 unsigned char *mk_ip4_buffer(const struct ip4 *hdr, size_t *bsize);
 
+void put_ip4_hdr(const struct ip4 *hdr, unsigned char *buf);
+
 unsigned short eval_ip4_chsum(const struct ip4 hdr);
 
 unsigned char *addr2byte(const char *addr, size_t len);
@@ -0,0 +1,86 @@
+/*
+ *                                Copyright (C) 2015 by Rafael Santiago
+ *
+ * This is a free software. You can redistribute it and/or modify under
+ * the terms of the GNU General Public License version 2.
+ *
+ */
+#define _GNU_SOURCE 1
+#include "cpu.h"
+#include <sched.h>
+#include <stdio.h>
+#include <string.h>
+
+static int read_sysfs_line(const char *path, char *buf, const size_t buf_size);
+
+static int read_sysfs_line(const char *path, char *buf, const size_t buf_size) {
+    FILE *fp = fopen(path, "r");
+    size_t len = 0;
+    if (fp == NULL) {
+        return 0;
+    }
+    if (fgets(buf, buf_size, fp) == NULL) {
+        fclose(fp);
+        return 0;
+    }
+    fclose(fp);
+    len = strlen(buf);
+    while (len > 0 && (buf[len - 1] == '\n' || buf[len - 1] == '\r' || buf[len - 1] == ' ')) {
+        buf[--len] = 0;
+    }
+    return (len > 0);
+}
+
+int lin_cpu_setaffinity(pthread_t thread, const int *cpus, const size_t cpus_nr) {
+    cpu_set_t set;
+    size_t c = 0;
+    if (cpus == NULL || cpus_nr == 0) {
+        return 0;
+    }
+    CPU_ZERO(&set);
+    for (c = 0; c < cpus_nr; c++) {
+        if (cpus[c] >= 0 && cpus[c] < CPU_SETSIZE) {
+            CPU_SET(cpus[c], &set);
+        }
+    }
+    return (pthread_setaffinity_np(thread, sizeof(set), &set) == 0);
+}
+
+size_t lin_cpu_getaffinity(int *cpus, const size_t max_cpus) {
+    cpu_set_t set;
+    size_t cpus_nr = 0;
+    int c = 0;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) != 0) {
+        return 0;
+    }
+    for (c = 0; c < CPU_SETSIZE && cpus_nr < max_cpus; c++) {
+        if (CPU_ISSET(c, &set)) {
+            cpus[cpus_nr++] = c;
+        }
+    }
+    return cpus_nr;
+}
+
+int lin_cpu_iface_node(const char *iface) {
+    char path[255], buf[32];
+    if (iface == NULL || strchr(iface, '/') != NULL) {
+        return -1;
+    }
+    //  INFO(Santiago): virtual devices (lo, tun, veth...) have no "device" entry, the kernel also
+    //                  reports -1 there when the machine has only one node.
+    snprintf(path, sizeof(path), "/sys/class/net/%s/device/numa_node", iface);
+    if (!read_sysfs_line(path, buf, sizeof(buf))) {
+        return -1;
+    }
+    return atoi(buf);
+}
+
+int lin_cpu_node_cpulist(const int node, char *buf, const size_t buf_size) {
+    char path[255];
+    if (node < 0) {
+        return 0;
+    }
+    snprintf(path, sizeof(path), "/sys/devices/system/node/node%d/cpulist", node);
+    return read_sysfs_line(path, buf, buf_size);
+}
@@ -0,0 +1,22 @@
+/*
+ *                                Copyright (C) 2015 by Rafael Santiago
+ *
+ * This is a free software. You can redistribute it and/or modify under
+ * the terms of the GNU General Public License version 2.
+ *
+ */
+#ifndef PIG_LINUX_CPU_H
+#define PIG_LINUX_CPU_H 1
+
+#include <stdlib.h>
+#include <pthread.h>
+
+int lin_cpu_setaffinity(pthread_t thread, const int *cpus, const size_t cpus_nr);
+
+size_t lin_cpu_getaffinity(int *cpus, const size_t max_cpus);
+
+int lin_cpu_iface_node(const char *iface);
+
+int lin_cpu_node_cpulist(const int node, char *buf, const size_t buf_size);
+
+#endif
@@ -5,6 +5,7 @@
  * the terms of the GNU General Public License version 2.
  *
  */
+#define _GNU_SOURCE 1
 #include "rsk.h"
 #include <unistd.h>
 #include <sys/types.h>
@@ -15,6 +16,12 @@
 #include <string.h>
 #include <net/if.h>
 #include <sys/ioctl.h>
+#include <sys/uio.h>
+#include <linux/virtio_net.h>
+
+static __thread struct mmsghdr *thread_msgs = NULL;
+
+static __thread int thread_msgs_size = 0;
 
 static int get_iface_index(const char *iface);
 
@@ -80,6 +87,62 @@ int lin_rsk_sendto(const char *buffer, size_t buffer_size, const int sockfd) {
     return sendto(sockfd, buffer, buffer_size, 0, NULL, 0);
 }
 
+int lin_rsk_sendv(const struct iovec *iov, const int iovcnt, const int sockfd) {
+    struct msghdr msg;
+    size_t total = 0;
+    int i = 0;
+    for (i = 0; i < iovcnt; i++) {
+        total += iov[i].iov_len;
+    }
+    if (total < 34) {
+        return -1;
+    }
+    //  INFO(Santiago): gathering the frame pieces here saves the copy of the whole datagram into a new frame buffer.
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = (struct iovec *)iov;
+    msg.msg_iovlen = iovcnt;
+    return sendmsg(sockfd, &msg, 0);
+}
+
+int lin_rsk_sendmmsg(struct iovec *iov, const int iovcnt, const int msgs_nr, const int sockfd) {
+    struct mmsghdr *msgs = NULL;
+    int m = 0, sent = 0, retval = 0;
+    if (iov == NULL || msgs_nr <= 0) {
+        return 0;
+    }
+    //  INFO(Santiago): the message headers are kept by each thread from a burst to the next one.
+    if (msgs_nr > thread_msgs_size) {
+        msgs = (struct mmsghdr *) realloc(thread_msgs, sizeof(struct mmsghdr) * msgs_nr);
+        if (msgs == NULL) {
+            return -1;
+        }
+        thread_msgs = msgs;
+        thread_msgs_size = msgs_nr;
+    }
+    msgs = thread_msgs;
+    memset(msgs, 0, sizeof(struct mmsghdr) * msgs_nr);
+    for (m = 0; m < msgs_nr; m++) {
+        msgs[m].msg_hdr.msg_iov = &iov[m * iovcnt];
+        msgs[m].msg_hdr.msg_iovlen = iovcnt;
+    }
+    //  INFO(Santiago): the whole burst goes down in one system call (or a few ones, when the
+    //                  kernel takes only part of it).
+    while (sent < msgs_nr) {
+        retval = sendmmsg(sockfd, &msgs[sent], msgs_nr - sent, 0);
+        if (retval <= 0) {
+            break;
+        }
+        sent += retval;
+    }
+    return (sent == 0 && retval == -1 ? -1 : sent);
+}
+
+void lin_rsk_release_msgs(void) {
+    free(thread_msgs);
+    thread_msgs = NULL;
+    thread_msgs_size = 0;
+}
+
 int lin_rsk_lo_sendto(const char *buffer, size_t buffer_size, const int sockfd) {
     struct sockaddr_in sk_in = { 0 };
     unsigned int ipv4_addr = 0;
@@ -111,3 +174,26 @@ int lin_rsk_lo_sendto(const char *buffer, size_t buffer_size, const int sockfd)
     sk_in.sin_port = htons(dst_port);
     return sendto(sockfd, buffer, buffer_size, 0, (struct sockaddr *)&sk_in, sizeof(sk_in));
 }
+
+int lin_rsk_enable_vnet_hdr(const int sockfd) {
+    int yes = 1;
+    //  WARN(Santiago): from now on every frame written to this socket must start with a virtio_net_hdr.
+    return setsockopt(sockfd, SOL_PACKET, PACKET_VNET_HDR, &yes, sizeof(yes));
+}
+
+size_t lin_rsk_mk_vnet_hdr(unsigned char *buf, const size_t csum_start, const size_t hdr_len, const size_t gso_size) {
+    struct virtio_net_hdr vnet;
+    memset(&vnet, 0, sizeof(vnet));
+    if (gso_size > 0) {
+        //  INFO(Santiago): the kernel (or the NIC) cuts the datagram into gso_size segments and finishes
+        //                  the TCP checksum of each one, the checksum field only brings the pseudo header.
+        vnet.flags = VIRTIO_NET_HDR_F_NEEDS_CSUM;
+        vnet.gso_type = VIRTIO_NET_HDR_GSO_TCPV4;
+        vnet.hdr_len = hdr_len;
+        vnet.gso_size = gso_size;
+        vnet.csum_start = csum_start;
+        vnet.csum_offset = 16;
+    }
+    memcpy(buf, &vnet, sizeof(vnet));
+    return sizeof(vnet);
+}
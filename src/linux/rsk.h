@@ -9,6 +9,7 @@
 #define PIG_LINUX_RSK_H 1
 
 #include <stdlib.h>
+#include <sys/uio.h>
 
 int lin_rsk_create(const char *iface);
 
@@ -18,6 +19,16 @@ void lin_rsk_close(const int sockfd);
 
 int lin_rsk_sendto(const char *buffer, size_t buffer_size, const int sockfd);
 
+int lin_rsk_sendv(const struct iovec *iov, const int iovcnt, const int sockfd);
+
+int lin_rsk_sendmmsg(struct iovec *iov, const int iovcnt, const int msgs_nr, const int sockfd);
+
+void lin_rsk_release_msgs(void);
+
 int lin_rsk_lo_sendto(const char *buffer, size_t buffer_size, const int sockfd);
 
+int lin_rsk_enable_vnet_hdr(const int sockfd);
+
+size_t lin_rsk_mk_vnet_hdr(unsigned char *buf, const size_t csum_start, const size_t hdr_len, const size_t gso_size);
+
 #endif
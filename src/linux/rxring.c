@@ -0,0 +1,157 @@
+/*
+ *                                Copyright (C) 2015 by Rafael Santiago
+ *
+ * This is a free software. You can redistribute it and/or modify under
+ * the terms of the GNU General Public License version 2.
+ *
+ */
+#include "rxring.h"
+#include "../memory.h"
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <poll.h>
+#include <net/if.h>
+#include <arpa/inet.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <linux/if_packet.h>
+#include <linux/if_ether.h>
+#include <linux/filter.h>
+#include <linux/net_tstamp.h>
+
+//  INFO(Santiago): a TPACKET_V3 ring, the kernel fills whole blocks of packets in the mapped memory
+//                  and hands them over at once, so reading the replies costs no copy and (almost) no
+//                  system calls. A BPF filter keeps only IPv4 going to the host and cuts it to the
+//                  headers, pig's own packets never reach the ring. Each packet carries the kernel's
+//                  receive time stamp (wall clock, taken as the packet comes from the driver).
+
+static int attach_filter(const int fd, const int is_outgoing, const int has_l2);
+
+static int attach_filter(const int fd, const int is_outgoing, const int has_l2) {
+    struct sock_filter code[8];
+    struct sock_fprog prog;
+    unsigned char check_nr = (has_l2 ? 2 : 3);
+    unsigned short n = 0;
+    //  INFO(Santiago): on a tun/tap device things are upside down, what pig writes comes in and what
+    //                  the host answers goes out.
+    code[n++] = (struct sock_filter) BPF_STMT(BPF_LD | BPF_W | BPF_ABS, SKF_AD_OFF + SKF_AD_PKTTYPE);
+    code[n++] = (struct sock_filter) BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, PACKET_OUTGOING, (is_outgoing ? 0 : check_nr), (is_outgoing ? check_nr : 0));
+    if (has_l2) {
+        code[n++] = (struct sock_filter) BPF_STMT(BPF_LD | BPF_H | BPF_ABS, 12);
+        code[n++] = (struct sock_filter) BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, ETH_P_IP, 1, 0);
+    } else {
+        code[n++] = (struct sock_filter) BPF_STMT(BPF_LD | BPF_B | BPF_ABS, 0);
+        code[n++] = (struct sock_filter) BPF_STMT(BPF_ALU | BPF_AND | BPF_K, 0xf0);
+        code[n++] = (struct sock_filter) BPF_JUMP(BPF_JMP | BPF_JEQ | BPF_K, 0x40, 1, 0);
+    }
+    code[n++] = (struct sock_filter) BPF_STMT(BPF_RET | BPF_K, 0);
+    code[n++] = (struct sock_filter) BPF_STMT(BPF_RET | BPF_K, LIN_RXRING_SNAPLEN);
+    prog.len = n;
+    prog.filter = code;
+    return setsockopt(fd, SOL_SOCKET, SO_ATTACH_FILTER, &prog, sizeof(prog));
+}
+
+lin_rxring_ctx *lin_rxring_open(const char *iface, const int is_outgoing, const int has_l2) {
+    lin_rxring_ctx *ring = NULL;
+    struct tpacket_req3 req;
+    struct sockaddr_ll sll;
+    int version = TPACKET_V3;
+    int stamping = SOF_TIMESTAMPING_RX_SOFTWARE | SOF_TIMESTAMPING_SOFTWARE;
+    unsigned int ifindex = 0;
+    if (iface == NULL || (ifindex = if_nametoindex(iface)) == 0) {
+        return NULL;
+    }
+    ring = (lin_rxring_ctx *) pig_newseg(sizeof(lin_rxring_ctx));
+    memset(ring, 0, sizeof(lin_rxring_ctx));
+    //  INFO(Santiago): the socket starts deaf (protocol 0) and only hears after the filter is in place.
+    ring->fd = socket(AF_PACKET, SOCK_RAW, 0);
+    if (ring->fd == -1) {
+        free(ring);
+        return NULL;
+    }
+    memset(&req, 0, sizeof(req));
+    req.tp_block_size = LIN_RXRING_BLOCK_SIZE;
+    req.tp_block_nr = LIN_RXRING_BLOCK_NR;
+    req.tp_frame_size = LIN_RXRING_FRAME_SIZE;
+    req.tp_frame_nr = (LIN_RXRING_BLOCK_SIZE / LIN_RXRING_FRAME_SIZE) * LIN_RXRING_BLOCK_NR;
+    req.tp_retire_blk_tov = 10;
+    ring->map_size = (size_t)LIN_RXRING_BLOCK_SIZE * LIN_RXRING_BLOCK_NR;
+    if (attach_filter(ring->fd, is_outgoing, has_l2) != 0 ||
+        setsockopt(ring->fd, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) != 0 ||
+        setsockopt(ring->fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) != 0) {
+        close(ring->fd);
+        free(ring);
+        return NULL;
+    }
+    //  INFO(Santiago): without it the packets are stamped only when they reach the tap, a bit later. It
+    //                  is not fatal, the caller tells the user about the coarser stamps.
+    ring->has_rx_stamps = (setsockopt(ring->fd, SOL_SOCKET, SO_TIMESTAMPING, &stamping, sizeof(stamping)) == 0);
+    ring->map = (unsigned char *) mmap(NULL, ring->map_size, PROT_READ | PROT_WRITE, MAP_SHARED, ring->fd, 0);
+    if (ring->map == MAP_FAILED) {
+        close(ring->fd);
+        free(ring);
+        return NULL;
+    }
+    memset(&sll, 0, sizeof(sll));
+    sll.sll_family = AF_PACKET;
+    sll.sll_protocol = htons(ETH_P_ALL);
+    sll.sll_ifindex = ifindex;
+    if (bind(ring->fd, (struct sockaddr *)&sll, sizeof(sll)) != 0) {
+        lin_rxring_close(ring);
+        return NULL;
+    }
+    return ring;
+}
+
+int lin_rxring_read(lin_rxring_ctx *ring, const int timeout, lin_rxring_callback callback, void *arg) {
+    struct tpacket_block_desc *block = NULL;
+    struct tpacket3_hdr *hdr = NULL;
+    struct pollfd pfd;
+    unsigned int p = 0;
+    int packets = 0;
+    block = (struct tpacket_block_desc *)(ring->map + ring->block * LIN_RXRING_BLOCK_SIZE);
+    if ((__atomic_load_n(&block->hdr.bh1.block_status, __ATOMIC_ACQUIRE) & TP_STATUS_USER) == 0) {
+        pfd.fd = ring->fd;
+        pfd.events = POLLIN | POLLERR;
+        pfd.revents = 0;
+        if (poll(&pfd, 1, timeout) <= 0) {
+            return 0;
+        }
+        if ((__atomic_load_n(&block->hdr.bh1.block_status, __ATOMIC_ACQUIRE) & TP_STATUS_USER) == 0) {
+            return 0;
+        }
+    }
+    hdr = (struct tpacket3_hdr *)((unsigned char *)block + block->hdr.bh1.offset_to_first_pkt);
+    for (p = 0; p < block->hdr.bh1.num_pkts; p++) {
+        if (hdr->tp_net >= hdr->tp_mac && hdr->tp_snaplen > (unsigned int)(hdr->tp_net - hdr->tp_mac)) {
+            callback((unsigned char *)hdr + hdr->tp_net, hdr->tp_snaplen - (hdr->tp_net - hdr->tp_mac),
+                     (unsigned long long)hdr->tp_sec * 1000000000ULL + hdr->tp_nsec, arg);
+            packets++;
+        }
+        hdr = (struct tpacket3_hdr *)((unsigned char *)hdr + hdr->tp_next_offset);
+    }
+    __atomic_store_n(&block->hdr.bh1.block_status, TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+    ring->block = (ring->block + 1) % LIN_RXRING_BLOCK_NR;
+    return packets;
+}
+
+void lin_rxring_stats(lin_rxring_ctx *ring, unsigned long long *packets, unsigned long long *drops) {
+    struct tpacket_stats_v3 stats;
+    socklen_t len = sizeof(stats);
+    memset(&stats, 0, sizeof(stats));
+    //  INFO(Santiago): the kernel resets these counters on every read.
+    if (getsockopt(ring->fd, SOL_PACKET, PACKET_STATISTICS, &stats, &len) == 0) {
+        *packets += stats.tp_packets;
+        *drops += stats.tp_drops;
+    }
+}
+
+void lin_rxring_close(lin_rxring_ctx *ring) {
+    if (ring == NULL) {
+        return;
+    }
+    munmap(ring->map, ring->map_size);
+    close(ring->fd);
+    free(ring);
+}
@@ -0,0 +1,39 @@
+/*
+ *                                Copyright (C) 2015 by Rafael Santiago
+ *
+ * This is a free software. You can redistribute it and/or modify under
+ * the terms of the GNU General Public License version 2.
+ *
+ */
+#ifndef PIG_LINUX_RXRING_H
+#define PIG_LINUX_RXRING_H 1
+
+#include <stdlib.h>
+
+#define LIN_RXRING_BLOCK_SIZE (1 << 20)
+
+#define LIN_RXRING_BLOCK_NR 16
+
+#define LIN_RXRING_FRAME_SIZE 2048
+
+#define LIN_RXRING_SNAPLEN 256
+
+typedef void (*lin_rxring_callback)(const unsigned char *dgram, const size_t dgram_size, const unsigned long long timestamp, void *arg);
+
+typedef struct _lin_rxring {
+    int fd;
+    unsigned char *map;
+    size_t map_size;
+    size_t block;
+    int has_rx_stamps;
+}lin_rxring_ctx;
+
+lin_rxring_ctx *lin_rxring_open(const char *iface, const int is_outgoing, const int has_l2);
+
+int lin_rxring_read(lin_rxring_ctx *ring, const int timeout, lin_rxring_callback callback, void *arg);
+
+void lin_rxring_stats(lin_rxring_ctx *ring, unsigned long long *packets, unsigned long long *drops);
+
+void lin_rxring_close(lin_rxring_ctx *ring);
+
+#endif
@@ -0,0 +1,58 @@
+/*
+ *                                Copyright (C) 2015 by Rafael Santiago
+ *
+ * This is a free software. You can redistribute it and/or modify under
+ * the terms of the GNU General Public License version 2.
+ *
+ */
+#include "tail.h"
+#include <unistd.h>
+#include <poll.h>
+#include <sys/inotify.h>
+
+//  INFO(Santiago): the file being followed is watched with inotify, the reader sleeps until something
+//                  is appended instead of polling the file. A rotation (the file moved away or deleted)
+//                  is reported apart, the caller must then reopen the path and watch it again.
+
+int lin_tail_watch(const char *filepath) {
+    int fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (fd == -1) {
+        return -1;
+    }
+    if (inotify_add_watch(fd, filepath, IN_MODIFY | IN_MOVE_SELF | IN_DELETE_SELF | IN_ATTRIB) == -1) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int lin_tail_wait(const int fd, const int timeout) {
+    struct pollfd pfd;
+    char events[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+    const struct inotify_event *event = NULL;
+    ssize_t size = 0, e = 0;
+    int retval = 0;
+    pfd.fd = fd;
+    pfd.events = POLLIN;
+    pfd.revents = 0;
+    if (poll(&pfd, 1, timeout) <= 0) {
+        return 0;
+    }
+    while ((size = read(fd, events, sizeof(events))) > 0) {
+        for (e = 0; e < size; e += sizeof(struct inotify_event) + event->len) {
+            event = (const struct inotify_event *)&events[e];
+            if (event->mask & (IN_MOVE_SELF | IN_DELETE_SELF | IN_IGNORED)) {
+                retval |= LIN_TAIL_MOVED;
+            } else {
+                retval |= LIN_TAIL_WRITTEN;
+            }
+        }
+    }
+    return retval;
+}
+
+void lin_tail_close(const int fd) {
+    if (fd != -1) {
+        close(fd);
+    }
+}
@@ -0,0 +1,21 @@
+/*
+ *                                Copyright (C) 2015 by Rafael Santiago
+ *
+ * This is a free software. You can redistribute it and/or modify under
+ * the terms of the GNU General Public License version 2.
+ *
+ */
+#ifndef PIG_LINUX_TAIL_H
+#define PIG_LINUX_TAIL_H 1
+
+#define LIN_TAIL_WRITTEN 1
+
+#define LIN_TAIL_MOVED   2
+
+int lin_tail_watch(const char *filepath);
+
+int lin_tail_wait(const int fd, const int timeout);
+
+void lin_tail_close(const int fd);
+
+#endif
@@ -0,0 +1,86 @@
+/*
+ *                                Copyright (C) 2015 by Rafael Santiago
+ *
+ * This is a free software. You can redistribute it and/or modify under
+ * the terms of the GNU General Public License version 2.
+ *
+ */
+#include "tun.h"
+#include <unistd.h>
+#include <fcntl.h>
+#include <string.h>
+#include <sys/types.h>
+#include <sys/socket.h>
+#include <sys/ioctl.h>
+#include <net/if.h>
+#include <linux/if_tun.h>
+
+static int bring_iface_up(const char *iface);
+
+static int bring_iface_up(const char *iface) {
+    struct ifreq ifr;
+    int sockfd;
+    int retval = -1;
+    memset(&ifr, 0, sizeof(ifr));
+    memcpy(ifr.ifr_name, iface, strnlen(iface, sizeof(ifr.ifr_name) - 1));
+    sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sockfd == -1) {
+        return -1;
+    }
+    if (ioctl(sockfd, SIOCGIFFLAGS, &ifr) == 0) {
+        ifr.ifr_flags |= (IFF_UP | IFF_RUNNING);
+        retval = ioctl(sockfd, SIOCSIFFLAGS, &ifr);
+    }
+    close(sockfd);
+    return retval;
+}
+
+int lin_tun_create(const char *iface, const int is_tap) {
+    struct ifreq ifr;
+    int tunfd = -1;
+    if (iface == NULL) {
+        return -1;
+    }
+    tunfd = open("/dev/net/tun", O_RDWR);
+    if (tunfd == -1) {
+        return -1;
+    }
+    memset(&ifr, 0, sizeof(ifr));
+    //  INFO(Santiago): IFF_NO_PI because we always write the raw datagram (or frame), without the packet info prefix.
+    ifr.ifr_flags = (is_tap ? IFF_TAP : IFF_TUN) | IFF_NO_PI;
+    strncpy(ifr.ifr_name, iface, sizeof(ifr.ifr_name) - 1);
+    if (ioctl(tunfd, TUNSETIFF, &ifr) != 0 || bring_iface_up(ifr.ifr_name) != 0) {
+        lin_tun_close(tunfd);
+        return -1;
+    }
+    return tunfd;
+}
+
+void lin_tun_close(const int tunfd) {
+    close(tunfd);
+}
+
+int lin_tun_get_hwaddr(const char *iface, unsigned char hwaddr[6]) {
+    struct ifreq ifr;
+    int sockfd;
+    int retval = -1;
+    memset(&ifr, 0, sizeof(ifr));
+    strncpy(ifr.ifr_name, iface, sizeof(ifr.ifr_name) - 1);
+    sockfd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sockfd == -1) {
+        return -1;
+    }
+    if (ioctl(sockfd, SIOCGIFHWADDR, &ifr) == 0) {
+        memcpy(hwaddr, ifr.ifr_hwaddr.sa_data, 6);
+        retval = 0;
+    }
+    close(sockfd);
+    return retval;
+}
+
+int lin_tun_writev(const struct iovec *iov, const int iovcnt, const int tunfd) {
+    //  WARN(Santiago): the tun driver takes each write() as exactly one packet, so the
+    //                  iovec here gathers the pieces of a single frame (e.g. the ethernet
+    //                  header and the IP datagram) avoiding one more copy of the whole thing.
+    return writev(tunfd, iov, iovcnt);
+}
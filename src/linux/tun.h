@@ -0,0 +1,22 @@
+/*
+ *                                Copyright (C) 2015 by Rafael Santiago
+ *
+ * This is a free software. You can redistribute it and/or modify under
+ * the terms of the GNU General Public License version 2.
+ *
+ */
+#ifndef PIG_LINUX_TUN_H
+#define PIG_LINUX_TUN_H 1
+
+#include <stdlib.h>
+#include <sys/uio.h>
+
+int lin_tun_create(const char *iface, const int is_tap);
+
+void lin_tun_close(const int tunfd);
+
+int lin_tun_get_hwaddr(const char *iface, unsigned char hwaddr[6]);
+
+int lin_tun_writev(const struct iovec *iov, const int iovcnt, const int tunfd);
+
+#endif
@@ -9,6 +9,9 @@
 #include "memory.h"
 #include "netmask.h"
 #include "to_ipv4.h"
+#include "fuzz.h"
+#include "template.h"
+#include "pool.h"
 #include <string.h>
 
 static pigsty_conf_set_ctx *get_pigsty_conf_set_tail(pigsty_conf_set_ctx *conf);
@@ -44,6 +47,11 @@ void del_pigsty_entry(pigsty_entry_ctx *entries) {
     for (t = p = entries; t; p = t) {
         t = p->next;
         del_pigsty_conf_set(p->conf);
+        del_pig_fuzz(p->fuzz);
+        del_pig_template(p->tpl);
+        if (p->slots != NULL) {
+            free(p->slots);
+        }
         free(p);
     }
 }
@@ -53,7 +61,11 @@ void del_pigsty_conf_set(pigsty_conf_set_ctx *confs) {
     for (t = p = confs; t; p = t) {
         t = p->next;
         if (p->field->data != NULL) {
-            free(p->field->data);
+            if (p->field->interned) {
+                pig_pool_release(p->field->data);
+            } else {
+                free(p->field->data);
+            }
         }
         free(p->field);
     }
@@ -91,6 +103,30 @@ pigsty_entry_ctx *get_pigsty_entry_signature_name(const char *signature_name, pi
     return NULL;
 }
 
+void intern_pigsty_conf_set_payloads(pigsty_conf_set_ctx *conf) {
+    pigsty_conf_set_ctx *cp;
+    const unsigned char *blob = NULL;
+    for (cp = conf; cp != NULL; cp = cp->next) {
+        if (cp->field->interned || cp->field->data == NULL) {
+            continue;
+        }
+        switch (cp->field->index) {
+            case kIpv4_payload:
+            case kTcp_payload:
+            case kUdp_payload:
+            case kIcmp_payload:
+                blob = pig_pool_intern(cp->field->data, cp->field->dsize);
+                free(cp->field->data);
+                cp->field->data = (void *)blob;
+                cp->field->interned = 1;
+                break;
+
+            default:
+                break;
+        }
+    }
+}
+
 pigsty_field_ctx *get_pigsty_conf_set_field(const int index, pigsty_conf_set_ctx *conf) {
     pigsty_conf_set_ctx *cp;
     for (cp = conf; cp != NULL; cp = cp->next) {
@@ -142,6 +178,20 @@ pigsty_entry_ctx *get_pigsty_entry_by_index(const size_t index, pigsty_entry_ctx
     return NULL;
 }
 
+pigsty_entry_ctx **get_pigsty_entry_array(pigsty_entry_ctx *entries, size_t *count) {
+    pigsty_entry_ctx **array = NULL, *ep = NULL;
+    size_t e = 0;
+    *count = get_pigsty_entry_count(entries);
+    if (*count == 0) {
+        return NULL;
+    }
+    array = (pigsty_entry_ctx **) pig_newseg(sizeof(pigsty_entry_ctx *) * (*count));
+    for (ep = entries; ep != NULL; ep = ep->next) {
+        array[e++] = ep;
+    }
+    return array;
+}
+
 void del_pig_target_addr(pig_target_addr_ctx *addrs) {
     pig_target_addr_ctx *t, *p;
     for (t = p = addrs; t; p = t) {
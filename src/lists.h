@@ -11,10 +11,10 @@
 #include "types.h"
 
 #define new_pigsty_entry(p) ( (p) = (pigsty_entry_ctx *) pig_newseg(sizeof(pigsty_entry_ctx)),\
-                             (p)->next = NULL, (p)->conf = NULL, (p)->signature_name = NULL )
+                             (p)->next = NULL, (p)->conf = NULL, (p)->signature_name = NULL, (p)->fuzz = NULL, (p)->tpl = NULL, (p)->slots = NULL, (p)->slots_nr = 0 )
 
 #define new_pigsty_conf_set(c) ( (c) = (pigsty_conf_set_ctx *) pig_newseg(sizeof(pigsty_conf_set_ctx)),\
-                                    (c)->next = NULL, (c)->field = (pigsty_field_ctx *) pig_newseg(sizeof(pigsty_field_ctx)), (c)->field->data = NULL, (c)->field->index = kUnk )
+                                    (c)->next = NULL, (c)->field = (pigsty_field_ctx *) pig_newseg(sizeof(pigsty_field_ctx)), (c)->field->data = NULL, (c)->field->index = kUnk, (c)->field->interned = 0 )
 
 #define new_pig_target_addr(t) ( (t) = (pig_target_addr_ctx *) pig_newseg(sizeof(pig_target_addr_ctx)),\
                                  (t)->next = NULL, (t)->asize = 0, (t)->addr = NULL, (t)->type = kNone, (t)->v = 0, (t)->cidr_range = 0 )
@@ -34,6 +34,8 @@ pigsty_entry_ctx *get_pigsty_entry_tail(pigsty_entry_ctx *entries);
 
 pigsty_field_ctx *get_pigsty_conf_set_field(const int index, pigsty_conf_set_ctx *conf);
 
+void intern_pigsty_conf_set_payloads(pigsty_conf_set_ctx *conf);
+
 void del_pigsty_entry(pigsty_entry_ctx *entries);
 
 void del_pigsty_conf_set(pigsty_conf_set_ctx *confs);
@@ -46,6 +48,8 @@ size_t get_pigsty_entry_count(pigsty_entry_ctx *entries);
 
 pigsty_entry_ctx *get_pigsty_entry_by_index(const size_t index, pigsty_entry_ctx *entries);
 
+pigsty_entry_ctx **get_pigsty_entry_array(pigsty_entry_ctx *entries, size_t *count);
+
 void del_pig_target_addr(pig_target_addr_ctx *addrs);
 
 pig_target_addr_ctx *add_target_addr_to_pig_target_addr(pig_target_addr_ctx *addrs, const char *range);
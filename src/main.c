@@ -11,51 +11,93 @@
 #include "oink.h"
 #include "linux/native_arp.h"
 #include "arp.h"
+#include "options.h"
+#include "sock.h"
+#include "mkrnd.h"
+#include "mkpkt.h"
+#include "evlog.h"
+#include "profile.h"
+#include "pacer.h"
+#include "budget.h"
+#include "memory.h"
+#include "order.h"
+#include "prebuild.h"
+#include "pipeline.h"
+#include "cpus.h"
+#include "arrivals.h"
+#include "session.h"
+#include "replies.h"
+#include "manifest.h"
+#include "alerts.h"
+#include "segment.h"
+#include "fragment.h"
 #include <stdio.h>
 #include <string.h>
 #include <signal.h>
 
+#define PIG_MAX_BURST_SIZE 1024
+
+#define PIG_DEFAULT_RING_SIZE 1024
+
+#define PIG_DEFAULT_MAX_SESSIONS 1024
+
+#define PIG_MAX_FRAGMENT_DUPLICATES 64
+
 static int should_exit = 0;
 
 static int should_be_quiet = 0;
 
-static char *get_option(const char *option, char *default_value, const int argc, char **argv);
+static unsigned long long seed_value = 0;
 
 static void sigint_watchdog(int signr);
 
 static pigsty_entry_ctx *load_signatures(const char *signatures);
 
-static int run_pig_run(const char *signatures, const char *targets, const char *timeout, const char *single_test, const char *gw_addr, const char *nt_mask, const char *loiface);
+#define deinit_injection_fd(fd, tun) ( (tun) != NULL ? deinit_tun_device((fd)) : deinit_raw_socket((fd)) )
+
+static int run_pig_run(const char *signatures, const char *targets, const char *timeout, const char *single_test, const char *gw_addr, const char *nt_mask, const char *loiface, const char *tun_iface, const int is_tap);
 
 static int is_targets_option_required(const pigsty_entry_ctx *entries);
 
-static char *get_option(const char *option, char *default_value, const int argc, char **argv) {
-    static char retval[8192];
-    int a;
-    char temp[8192] = "";
-    memset(temp, 0, sizeof(temp));
-    temp[0] = '-';
-    temp[1] = '-';
-    strncpy(&temp[2], option, sizeof(temp) - 1);
-    for (a = 0; a < argc; a++) {
-        if (strcmp(argv[a], temp) == 0) {
-            return "1";
-        }
-    }
-    strncat(temp, "=", sizeof(temp) - 1);
-    for (a = 0; a < argc; a++) {
-        if (strstr(argv[a], temp) == argv[a]) {
-            return argv[a] + strlen(temp);
-        }
-    }
-    memset(retval, 0, sizeof(retval));
-    if (default_value != NULL) {
-        strncpy(retval, default_value, sizeof(retval) - 1);
-    } else {
-        return NULL;
-    }
-    return retval;
-}
+static pig_evlog_ctx *setup_evlog(pigsty_entry_ctx **signatures, const size_t signatures_count, pig_order_ctx *order, pig_target_addr_ctx *addrs, int *retval);
+
+static pig_profile_ctx *setup_profile(pigsty_entry_ctx *pigsty, int *retval);
+
+static int setup_budget(pig_budget_ctx *budget);
+
+static pig_frame_ctx *setup_burst(size_t *burst_size, unsigned long long *burst_gap, int *is_train, int *retval);
+
+static pig_order_ctx *setup_order(const size_t signatures_count, int *retval);
+
+static pig_prebuild_ctx *setup_prebuild(pigsty_entry_ctx **signatures, const size_t signatures_count, const pig_oink_args_ctx *args, int *retval);
+
+static pig_pipeline_ctx *setup_pipeline(int *retval);
+
+static int setup_placement(const char *iface, pig_pipeline_ctx *pipeline, pig_prebuild_ctx *prebuild);
+
+static int setup_realtime(pig_pipeline_ctx *pipeline, pig_pacer_ctx *pacer);
+
+static pig_arrivals_ctx *setup_arrivals(pigsty_entry_ctx **signatures, const size_t signatures_count, const unsigned long long timeout, const pig_pipeline_ctx *pipeline, int *retval);
+
+static pig_flow_table_ctx *setup_sessions(int *retval);
+
+static int setup_segmentation(const char *iface, const int fd, const int is_tun, pig_flow_table_ctx *sessions, pig_oink_args_ctx *args);
+
+static int setup_fragmentation(pig_oink_args_ctx *args);
+
+static pig_replies_ctx *setup_replies(pigsty_entry_ctx **signatures, const size_t signatures_count, const char *iface, const int is_device, const int has_l2, unsigned long long *wait, int *retval);
+
+static pig_manifest_ctx *setup_manifest(pigsty_entry_ctx **signatures, const size_t signatures_count, int *retval);
+
+static pig_alerts_ctx *setup_alerts(pigsty_entry_ctx **signatures, const size_t signatures_count, pig_manifest_ctx *manifest, unsigned long long *wait, int *retval);
+
+static int dump_manifest(const char *filepath);
+
+static int is_tcp_signature(const pigsty_entry_ctx *signature);
+
+static void mk_session_frame(pig_flow_table_ctx *sessions, pig_frame_ctx *frame, const pig_oink_args_ctx *args, const unsigned long long now);
+
+static pigsty_entry_ctx *next_signature(pigsty_entry_ctx **signatures, const size_t signatures_count, const pig_profile_point_ctx *mix, pig_order_ctx *order, pig_evlog_ctx *evlog, size_t *signature_index, int *status);
 
 static void sigint_watchdog(int signr) {
     should_exit = 1;
@@ -130,7 +172,7 @@ static pig_target_addr_ctx *parse_targets(const char *targets) {
     return addr;
 }
 
-static int run_pig_run(const char *signatures, const char *targets, const char *timeout, const char *single_test, const char *gw_addr, const char *nt_mask, const char *loiface) {
+static int run_pig_run(const char *signatures, const char *targets, const char *timeout, const char *single_test, const char *gw_addr, const char *nt_mask, const char *loiface, const char *tun_iface, const int is_tap) {
     int timeo = 10000;
     pigsty_entry_ctx *pigsty = NULL;
     size_t signatures_count = 0, addr_count = 0;
@@ -141,7 +183,28 @@ static int run_pig_run(const char *signatures, const char *targets, const char *
     int retval = 0;
     unsigned int nt_mask_addr[4] = { 0, 0, 0, 0 };
     unsigned char *gw_hwaddr = NULL, *temp = NULL;
+    unsigned char tap_hwaddr[6], *tap_hwaddr_p = NULL;
     in_addr_t gw_in_addr = 0;
+    pig_evlog_ctx *evlog = NULL;
+    pig_profile_ctx *profile = NULL;
+    const pig_profile_point_ctx *mix = NULL;
+    pig_pacer_ctx pacer;
+    pig_budget_ctx budget;
+    pig_frame_ctx *frames = NULL;
+    pigsty_entry_ctx **flat_pigsty = NULL;
+    pig_order_ctx *order = NULL;
+    pig_prebuild_ctx *prebuild = NULL;
+    pig_pipeline_ctx *pipeline = NULL;
+    pig_arrivals_ctx *arrivals = NULL;
+    pig_flow_table_ctx *sessions = NULL;
+    pig_replies_ctx *replies = NULL;
+    pig_manifest_ctx *manifest = NULL;
+    pig_alerts_ctx *alerts = NULL;
+    pig_oink_args_ctx oink_args;
+    size_t burst_size = 1, frames_nr = 0, f = 0, signature_index = 0;
+    unsigned long long packet_nr = 0, deadline = 0, elapsed = 0, burst_gap = 0, ticks = 0, replies_wait = 0, alerts_wait = 0;
+    int status = 0, sent = -1, is_train = 0;
+    long arrival_index = -1;
     if (timeout != NULL) {
         timeo = atoi(timeout);
     }
@@ -149,15 +212,31 @@ static int run_pig_run(const char *signatures, const char *targets, const char *
     if (!should_be_quiet) {
         printf("pig INFO: starting up pig engine...\n\n");
     }
-    sockfd = init_raw_socket(loiface);
-    if (sockfd == -1) {
-        printf("pig PANIC: unable to create the socket.\npig ERROR: aborted.\n");
-        return 1;
+    if (tun_iface != NULL) {
+        sockfd = init_tun_device(tun_iface, is_tap);
+        if (sockfd == -1) {
+            printf("pig PANIC: unable to create the %s device \"%s\".\npig ERROR: aborted.\n", (is_tap ? "tap" : "tun"), tun_iface);
+            return 1;
+        }
+        if (is_tap) {
+            if (get_tun_device_hwaddr(tun_iface, tap_hwaddr) == -1) {
+                printf("pig PANIC: unable to get the physical address of \"%s\".\npig ERROR: aborted.\n", tun_iface);
+                deinit_tun_device(sockfd);
+                return 1;
+            }
+            tap_hwaddr_p = &tap_hwaddr[0];
+        }
+    } else {
+        sockfd = init_raw_socket(loiface);
+        if (sockfd == -1) {
+            printf("pig PANIC: unable to create the socket.\npig ERROR: aborted.\n");
+            return 1;
+        }
     }
     pigsty = load_signatures(signatures);
     if (pigsty == NULL) {
         printf("pig ERROR: aborted.\n");
-        deinit_raw_socket(sockfd);
+        deinit_injection_fd(sockfd, tun_iface);
         return 1;
     }
     if (targets != NULL) {
@@ -169,7 +248,7 @@ static int run_pig_run(const char *signatures, const char *targets, const char *
     }
     if (is_targets_option_required(pigsty) && addr == NULL) {
         printf("pig PANIC: --targets option is required by some loaded signatures.\n");
-        deinit_raw_socket(sockfd);
+        deinit_injection_fd(sockfd, tun_iface);
         del_pigsty_entry(pigsty);
         return 1;
     }
@@ -177,65 +256,931 @@ static int run_pig_run(const char *signatures, const char *targets, const char *
     if (!should_be_quiet) {
         printf("\npig INFO: done (%d signature(s) read).\n\n", signatures_count);
     }
-    if (nt_mask == NULL) {
-        printf("\npig PANIC: --net-mask option is required.\n");
-        deinit_raw_socket(sockfd);
-        del_pigsty_entry(pigsty);
-        return 1;
-    }
-    //  WARN(Santiago): by now IPv4 only.
-    if (verify_ipv4_addr(nt_mask) == 0) {
-        printf("pig PANIC: --net-mask has an invalid ip address.\n");
-        deinit_raw_socket(sockfd);
-        del_pigsty_entry(pigsty);
-        return 1;
+    if (tun_iface == NULL) {
+        if (nt_mask == NULL) {
+            printf("\npig PANIC: --net-mask option is required.\n");
+            deinit_raw_socket(sockfd);
+            del_pigsty_entry(pigsty);
+            return 1;
+        }
+        //  WARN(Santiago): by now IPv4 only.
+        if (verify_ipv4_addr(nt_mask) == 0) {
+            printf("pig PANIC: --net-mask has an invalid ip address.\n");
+            deinit_raw_socket(sockfd);
+            del_pigsty_entry(pigsty);
+            return 1;
+        }
+        nt_mask_addr[0] = htonl(inet_addr(nt_mask));
+        if (gw_addr != NULL && loiface != NULL) {
+            gw_in_addr = inet_addr(gw_addr);
+            temp = get_mac_by_addr(gw_in_addr, loiface, 2);
+            if (!should_be_quiet && temp != NULL) {
+                gw_hwaddr = mac2byte(temp, strlen(temp));
+                printf("pig INFO: the gateway's physical address is \"%s\"...\n"
+                       "pig INFO: the local interface is \"%s\"...\n"
+                       "pig INFO: the network mask is \"%s\"...\n\n", temp, loiface, nt_mask);
+                free(temp);
+            }
+        }
+    } else if (!should_be_quiet) {
+        printf("pig INFO: injecting through the %s device \"%s\"...\n\n", (is_tap ? "tap" : "tun"), tun_iface);
     }
-    nt_mask_addr[0] = htonl(inet_addr(nt_mask));
-    if (gw_addr != NULL && loiface != NULL) {
-        gw_in_addr = inet_addr(gw_addr);
-        temp = get_mac_by_addr(gw_in_addr, loiface, 2);
-        if (!should_be_quiet && temp != NULL) {
-            gw_hwaddr = mac2byte(temp, strlen(temp));
-            printf("pig INFO: the gateway's physical address is \"%s\"...\n"
-                   "pig INFO: the local interface is \"%s\"...\n"
-                   "pig INFO: the network mask is \"%s\"...\n\n", temp, loiface, nt_mask);
-            free(temp);
-        }
-    }
-    if (gw_hwaddr != NULL) {
-        signature = get_pigsty_entry_by_index(rand() % signatures_count, pigsty);
-        if (single_test == NULL) {
-            while (!should_exit) {
-                if (signature == NULL) {
-                    continue; //  WARN(Santiago): It should never happen. However... Sometimes... The World tends to be a rather weird place.
-                }
-                if (oink(signature, &hwaddr, addr, sockfd, gw_hwaddr, nt_mask_addr, loiface) != -1) {
+    if (gw_hwaddr != NULL || tun_iface != NULL) {
+        flat_pigsty = get_pigsty_entry_array(pigsty, &signatures_count);
+        order = setup_order(signatures_count, &retval);
+        if (retval == 0) {
+            evlog = setup_evlog(flat_pigsty, signatures_count, order, addr, &retval);
+        }
+        if (retval == 0) {
+            profile = setup_profile(pigsty, &retval);
+        }
+        if (retval == 0) {
+            retval = setup_budget(&budget);
+        }
+        if (retval == 0) {
+            frames = setup_burst(&burst_size, &burst_gap, &is_train, &retval);
+        }
+        memset(&oink_args, 0, sizeof(oink_args));
+        if (retval == 0) {
+            oink_args.hwaddr = &hwaddr;
+            oink_args.addrs = addr;
+            oink_args.gw_hwaddr = gw_hwaddr;
+            oink_args.nt_mask = nt_mask_addr;
+            oink_args.loiface = loiface;
+            oink_args.tap_hwaddr = tap_hwaddr_p;
+            oink_args.is_tun = (tun_iface != NULL);
+            prebuild = setup_prebuild(flat_pigsty, signatures_count, &oink_args, &retval);
+            pig_pacer_init(&pacer);
+        }
+        if (retval == 0) {
+            pipeline = setup_pipeline(&retval);
+        }
+        //  INFO(Santiago): the helper threads are started before the main thread is pinned, so they do not
+        //                  inherit the sender's CPU.
+        if (retval == 0) {
+            replies = setup_replies(flat_pigsty, signatures_count, (tun_iface != NULL ? tun_iface : loiface), (tun_iface != NULL),
+                                    (tun_iface == NULL || is_tap), &replies_wait, &retval);
+            oink_args.replies = replies;
+        }
+        if (retval == 0) {
+            manifest = setup_manifest(flat_pigsty, signatures_count, &retval);
+            oink_args.manifest = manifest;
+        }
+        if (retval == 0) {
+            alerts = setup_alerts(flat_pigsty, signatures_count, manifest, &alerts_wait, &retval);
+        }
+        if (retval == 0) {
+            retval = setup_placement((tun_iface != NULL ? tun_iface : loiface), pipeline, prebuild);
+        }
+        if (retval == 0) {
+            retval = setup_realtime(pipeline, &pacer);
+        }
+        if (retval == 0) {
+            arrivals = setup_arrivals(flat_pigsty, signatures_count, (unsigned long long)timeo * 1000ULL, pipeline, &retval);
+        }
+        if (retval == 0) {
+            sessions = setup_sessions(&retval);
+        }
+        if (retval == 0) {
+            retval = setup_segmentation((tun_iface != NULL ? tun_iface : loiface), sockfd, (tun_iface != NULL), sessions, &oink_args);
+        }
+        if (retval == 0) {
+            retval = setup_fragmentation(&oink_args);
+        }
+        if (retval == 0 && pipeline != NULL) {
+            pipeline->signatures = flat_pigsty;
+            pipeline->signatures_count = signatures_count;
+            pipeline->order_mode = (order != NULL ? order->mode : kOrderRandom);
+            pipeline->profile = profile;
+            pipeline->budget = &budget;
+            pipeline->args = oink_args;
+            pipeline->fd = sockfd;
+            pipeline->burst_size = burst_size;
+            pipeline->burst_gap = burst_gap;
+            pipeline->timeout = (unsigned long long)timeo * 1000ULL;
+            pipeline->is_train = is_train;
+            pipeline->is_quiet = should_be_quiet;
+            pipeline->seed = seed_value;
+            pipeline->should_exit = &should_exit;
+            pipeline->arrivals = arrivals;
+            retval = run_pig_pipeline(pipeline);
+        }
+        while (pipeline == NULL && !should_exit && retval == 0 && !is_pig_budget_exhausted(&budget)) {
+            if (profile != NULL) {
+                if (!get_pig_profile_deadline(profile, (double)packet_nr, &deadline, &mix)) {
                     if (!should_be_quiet) {
-                        printf("pig INFO: a packet based on signature \"%s\" was sent.\n", signature->signature_name);
+                        printf("pig INFO: the traffic profile has ended.\n");
                     }
-                    usleep(timeo);
+                    break;
+                }
+                elapsed = pig_pacer_elapsed(&pacer);
+                if (deadline > elapsed && (deadline - elapsed) > get_pig_budget_time_left(&budget)) {
+                    break;
+                }
+                if (!pig_pacer_wait_until(&pacer, deadline)) {
+                    //  INFO(Santiago): we are too far behind the schedule, the packets that could not
+                    //                  be sent on time are dropped instead of being sent in a rush.
+                    packet_nr = (unsigned long long)get_pig_profile_packets(profile, pig_pacer_elapsed(&pacer));
+                    continue;
+                }
+                packet_nr += burst_size;
+            } else if (arrivals != NULL) {
+                deadline = next_pig_arrival(arrivals, &arrival_index);
+                elapsed = pig_pacer_elapsed(&pacer);
+                if (deadline > elapsed && (deadline - elapsed) > get_pig_budget_time_left(&budget)) {
+                    break;
+                }
+                if (!pig_pacer_wait_until(&pacer, deadline)) {
+                    pig_arrivals_rebase(arrivals, pig_pacer_elapsed(&pacer));
                 }
-                signature = get_pigsty_entry_by_index(rand() % signatures_count, pigsty);
             }
-        } else {
-            retval = (oink(signature, &hwaddr, addr, sockfd, gw_hwaddr, nt_mask_addr, loiface) != -1 ? 0 : 1);
-            if (retval == 0) {
-                if (!should_be_quiet) {
-                    printf("pig INFO: a packet based on signature \"%s\" was sent.\n", signature->signature_name);
+            for (f = 0; f < burst_size; f++) {
+                if (arrival_index >= 0) {
+                    //  INFO(Santiago): this arrival belongs to a signature with its own distribution.
+                    signature = flat_pigsty[arrival_index];
+                    signature_index = (size_t)arrival_index;
+                } else if (f == 0 || !is_train) {
+                    signature = next_signature(flat_pigsty, signatures_count, mix, order, evlog, &signature_index, &status);
+                    if (signature == NULL) {
+                        break;
+                    }
+                }
+                if (prebuild == NULL) {
+                    frames[f].signature = signature;
+                } else {
+                    get_pig_prebuilt_frame(prebuild, signature_index, &frames[f]);
+                }
+                if (sessions != NULL) {
+                    mk_session_frame(sessions, &frames[f], &oink_args, pig_pacer_elapsed(&pacer));
+                }
+            }
+            frames_nr = f;
+            //  INFO(Santiago): when the signatures run out in the middle of a burst, the frames already
+            //                  picked are still sent.
+            if (frames_nr > 0) {
+                if (prebuild != NULL || sessions != NULL) {
+                    sent = oink_ready_burst(frames, frames_nr, sockfd, &oink_args, &budget, burst_gap, (sessions != NULL));
+                } else {
+                    sent = (tun_iface != NULL ? oink_tun_burst(frames, frames_nr, &oink_args, sockfd, &budget, burst_gap) :
+                                                oink_burst(frames, frames_nr, &oink_args, sockfd, &budget, burst_gap));
+                }
+                for (f = 0; f < frames_nr && !should_be_quiet; f++) {
+                    if (frames[f].sent) {
+                        printf("pig INFO: a packet based on signature \"%s\" was sent.\n", frames[f].signature->signature_name);
+                    }
                 }
+                pig_prebuild_quiescent(prebuild, 0);
+            }
+            if (signature == NULL) {
+                if (status == -1) {
+                    printf("pig PANIC: the generated traffic diverged from the event log (are the same signatures and targets in use?).\n");
+                    retval = 1;
+                }
+                break;
+            }
+            if (single_test != NULL) {
+                retval = (sent > 0 ? 0 : 1);
+                break;
+            }
+            if (sent > 0 && profile == NULL && arrivals == NULL) {
+                if (pacer.is_absolute) {
+                    pig_pacer_tick(&pacer, &ticks, (unsigned long long)timeo * 1000ULL, get_pig_budget_time_left(&budget));
+                } else {
+                    pig_sleep_ns(((unsigned long long)timeo * 1000ULL < get_pig_budget_time_left(&budget)) ? (unsigned long long)timeo * 1000ULL :
+                                                                                                              get_pig_budget_time_left(&budget));
+                }
+            } else if (sent <= 0 && sessions != NULL) {
+                //  INFO(Santiago): all open sessions are waiting out their rtt (or hold time), instead of spinning
+                //                  let's wait for the next tick of the timer wheel.
+                pig_sleep_ns((PIG_SESSION_TICK < get_pig_budget_time_left(&budget)) ? PIG_SESSION_TICK : get_pig_budget_time_left(&budget));
             }
         }
-        free(gw_hwaddr);
+        oink_release_scratch();
+        pig_replies_stop(replies, (should_exit ? 0 : replies_wait));
+        pig_alerts_stop(alerts, (should_exit ? 0 : alerts_wait));
+        pig_manifest_stop(manifest);
+        if (retval == 0 && single_test == NULL) {
+            pig_budget_summary(&budget);
+            pig_pacer_summary(pipeline != NULL ? &pipeline->pacer : &pacer);
+            if (!should_be_quiet) {
+                pig_pipeline_stats(pipeline);
+                pig_session_stats(sessions);
+            }
+            pig_replies_stats(replies);
+            pig_manifest_stats(manifest);
+            pig_alerts_stats(alerts);
+        }
+        del_pig_alerts(alerts);
+        del_pig_manifest(manifest);
+        del_pig_replies(replies);
+        del_pig_flow_table(sessions);
+        del_pig_pipeline(pipeline);
+        del_pig_arrivals(arrivals);
+        del_pig_prebuild(prebuild);
+        evlog_close(evlog);
+        del_pig_profile(profile);
+        del_pig_order(order);
+        if (frames != NULL) {
+            free(frames);
+        }
+        if (flat_pigsty != NULL) {
+            free(flat_pigsty);
+        }
+        if (gw_hwaddr != NULL) {
+            free(gw_hwaddr);
+        }
     } else {
         printf("\npig PANIC: unable to get the gateway's physical address.\n");
     }
     del_pigsty_entry(pigsty);
     del_pig_target_addr(addr);
     del_pig_hwaddr(hwaddr);
-    deinit_raw_socket(sockfd);
+    deinit_injection_fd(sockfd, tun_iface);
     return retval;
 }
 
+static pig_evlog_ctx *setup_evlog(pigsty_entry_ctx **signatures, const size_t signatures_count, pig_order_ctx *order, pig_target_addr_ctx *addrs, int *retval) {
+    pig_evlog_ctx *evlog = NULL;
+    size_t signature_index = 0;
+    char *evlog_path = get_option("event-log", NULL);
+    char *replay_path = get_option("replay", NULL);
+    char *replay_from = get_option("replay-from", NULL);
+    unsigned long long packet_nr = 0;
+    pigsty_entry_ctx *signature = NULL;
+    unsigned char *packet = NULL;
+    size_t packet_size = 0;
+    int status = 0;
+    *retval = 0;
+    if (replay_path == NULL) {
+        if (evlog_path != NULL) {
+            evlog = evlog_create(evlog_path, seed_value, signatures_count);
+            if (evlog == NULL) {
+                *retval = 1;
+            }
+        }
+        return evlog;
+    }
+    evlog = evlog_open(replay_path);
+    if (evlog == NULL) {
+        *retval = 1;
+        return NULL;
+    }
+    if (evlog->signatures_count != signatures_count) {
+        printf("pig PANIC: the event log was generated from %zu signature(s) but %zu was(were) loaded.\n", evlog->signatures_count, signatures_count);
+        evlog_close(evlog);
+        *retval = 1;
+        return NULL;
+    }
+    //  INFO(Santiago): the other random streams (e.g. the fragments) follow the recorded run too.
+    seed_value = evlog->seed;
+    mk_rnd_init(seed_value, 0);
+    if (!should_be_quiet) {
+        printf("pig INFO: replaying \"%s\" (seed %llu)...\n", replay_path, evlog->seed);
+    }
+    if (replay_from != NULL) {
+        packet_nr = strtoull(replay_from, NULL, 10);
+        if (!evlog_seek(evlog, packet_nr, signatures)) {
+            evlog_close(evlog);
+            *retval = 1;
+            return NULL;
+        }
+        if (!pig_order_seek(order, evlog->packet_nr)) {
+            printf("pig PANIC: --replay-from cannot be used with --order=shuffle-each-pass.\n");
+            evlog_close(evlog);
+            *retval = 1;
+            return NULL;
+        }
+        //  INFO(Santiago): from the nearest checkpoint on the packets are rebuilt (but not sent) only
+        //                  to take the prng to the exact state that it had before the packet #packet_nr.
+        while (evlog->packet_nr < packet_nr) {
+            signature = next_signature(signatures, signatures_count, NULL, order, evlog, &signature_index, &status);
+            if (signature == NULL) {
+                printf("pig PANIC: the generated traffic diverged from the event log (are the same signatures and targets in use?).\n");
+                evlog_close(evlog);
+                *retval = 1;
+                return NULL;
+            }
+            packet = mk_pigsty_pkt(signature, addrs, &packet_size);
+            if (packet != NULL) {
+                free(packet);
+            }
+        }
+    }
+    return evlog;
+}
+
+static pig_profile_ctx *setup_profile(pigsty_entry_ctx *pigsty, int *retval) {
+    pig_profile_ctx *profile = NULL;
+    char *profile_path = get_option("profile", NULL);
+    char *time_compression = get_option("time-compression", NULL);
+    *retval = 0;
+    if (profile_path == NULL) {
+        return NULL;
+    }
+    profile = load_pig_profile(profile_path, pigsty);
+    if (profile == NULL) {
+        *retval = 1;
+        return NULL;
+    }
+    if (time_compression != NULL) {
+        profile->speed = strtod(time_compression, NULL);
+        if (profile->speed <= 0) {
+            printf("pig PANIC: --time-compression must be a positive number.\n");
+            del_pig_profile(profile);
+            *retval = 1;
+            return NULL;
+        }
+    }
+    if (!should_be_quiet) {
+        printf("pig INFO: following the traffic profile \"%s\" (%zu point(s), time compressed %.2fx)...\n", profile_path, profile->points_nr, profile->speed);
+    }
+    return profile;
+}
+
+static int setup_budget(pig_budget_ctx *budget) {
+    char *count = get_option("count", NULL);
+    char *bytes = get_option("bytes", NULL);
+    char *duration = get_option("duration", NULL);
+    unsigned long long max_packets = 0, max_bytes = 0, max_duration = 0;
+    if (count != NULL && (!parse_pig_bytes(count, &max_packets) || max_packets == 0)) {
+        printf("pig PANIC: an invalid --count value was supplied.\n");
+        return 1;
+    }
+    if (bytes != NULL && (!parse_pig_bytes(bytes, &max_bytes) || max_bytes == 0)) {
+        printf("pig PANIC: an invalid --bytes value was supplied.\n");
+        return 1;
+    }
+    if (duration != NULL && (!parse_pig_time(duration, &max_duration) || max_duration == 0)) {
+        printf("pig PANIC: an invalid --duration value was supplied.\n");
+        return 1;
+    }
+    pig_budget_init(budget, max_packets, max_bytes, max_duration);
+    return 0;
+}
+
+static pig_frame_ctx *setup_burst(size_t *burst_size, unsigned long long *burst_gap, int *is_train, int *retval) {
+    char *burst = get_option("burst", NULL);
+    char *gap = get_option("burst-gap", NULL);
+    pig_frame_ctx *frames = NULL;
+    char *end = NULL;
+    *retval = 0;
+    *burst_size = 1;
+    *burst_gap = 0;
+    *is_train = (get_option("train", NULL) != NULL);
+    if (burst != NULL) {
+        *burst_size = strtoul(burst, &end, 10);
+        if (*end != 0 || *burst_size == 0 || *burst_size > PIG_MAX_BURST_SIZE) {
+            printf("pig PANIC: --burst must be a number from 1 to %d.\n", PIG_MAX_BURST_SIZE);
+            *retval = 1;
+            return NULL;
+        }
+    }
+    if (gap != NULL) {
+        *burst_gap = strtoull(gap, &end, 10) * 1000ULL;
+        if (*end != 0 || *gap < '0' || *gap > '9') {
+            printf("pig PANIC: an invalid --burst-gap value was supplied.\n");
+            *retval = 1;
+            return NULL;
+        }
+    }
+    frames = (pig_frame_ctx *) pig_newseg(sizeof(pig_frame_ctx) * (*burst_size));
+    memset(frames, 0, sizeof(pig_frame_ctx) * (*burst_size));
+    return frames;
+}
+
+static pig_order_ctx *setup_order(const size_t signatures_count, int *retval) {
+    char *order_name = get_option("order", NULL);
+    pig_order_mode_t mode = kOrderRandom;
+    *retval = 0;
+    if (!get_pig_order_mode(order_name, &mode)) {
+        printf("pig PANIC: unknown --order \"%s\" (use random, sequential, round-robin or shuffle-each-pass).\n", order_name);
+        *retval = 1;
+        return NULL;
+    }
+    return mk_pig_order(mode, signatures_count, 0, 1);
+}
+
+static pig_prebuild_ctx *setup_prebuild(pigsty_entry_ctx **signatures, const size_t signatures_count, const pig_oink_args_ctx *args, int *retval) {
+    char *frames_nr = get_option("prebuild", NULL);
+    char *refresh = get_option("prebuild-refresh", NULL);
+    pig_prebuild_ctx *prebuild = NULL;
+    unsigned long long interval = 0;
+    size_t frames_per_pool = 0;
+    char *end = NULL;
+    *retval = 0;
+    if (frames_nr == NULL) {
+        return NULL;
+    }
+    frames_per_pool = strtoul(frames_nr, &end, 10);
+    if (*end != 0 || frames_per_pool == 0) {
+        printf("pig PANIC: an invalid --prebuild value was supplied.\n");
+        *retval = 1;
+        return NULL;
+    }
+    if (refresh != NULL && (!parse_pig_time(refresh, &interval) || interval == 0)) {
+        printf("pig PANIC: an invalid --prebuild-refresh value was supplied.\n");
+        *retval = 1;
+        return NULL;
+    }
+    if (!should_be_quiet) {
+        printf("pig INFO: prebuilding %zu frame(s) per signature...\n", frames_per_pool);
+    }
+    prebuild = mk_pig_prebuild(signatures, signatures_count, frames_per_pool, args);
+    if (prebuild == NULL) {
+        *retval = 1;
+        return NULL;
+    }
+    if (interval > 0 && !pig_prebuild_start_refresh(prebuild, interval, seed_value, 1)) {
+        del_pig_prebuild(prebuild);
+        *retval = 1;
+        return NULL;
+    }
+    return prebuild;
+}
+
+static pig_pipeline_ctx *setup_pipeline(int *retval) {
+    char *generators = get_option("generators", NULL);
+    char *senders = get_option("senders", NULL);
+    char *ring_size = get_option("ring-size", NULL);
+    size_t generators_nr = 0, senders_nr = 1, ring_slots = PIG_DEFAULT_RING_SIZE;
+    pig_pipeline_ctx *pipeline = NULL;
+    char *end = NULL;
+    *retval = 0;
+    if (generators == NULL) {
+        return NULL;
+    }
+    generators_nr = strtoul(generators, &end, 10);
+    if (*end != 0 || generators_nr == 0 || generators_nr > PIG_PIPELINE_MAX_THREADS) {
+        printf("pig PANIC: --generators must be a number from 1 to %d.\n", PIG_PIPELINE_MAX_THREADS);
+        *retval = 1;
+        return NULL;
+    }
+    if (senders != NULL) {
+        senders_nr = strtoul(senders, &end, 10);
+        if (*end != 0 || senders_nr == 0 || senders_nr > generators_nr) {
+            printf("pig PANIC: --senders must be a number from 1 to the number of generators.\n");
+            *retval = 1;
+            return NULL;
+        }
+    }
+    if (ring_size != NULL) {
+        ring_slots = strtoul(ring_size, &end, 10);
+        if (*end != 0 || ring_slots < 2) {
+            printf("pig PANIC: --ring-size must be a number greater than 1.\n");
+            *retval = 1;
+            return NULL;
+        }
+    }
+    pipeline = mk_pig_pipeline(generators_nr, senders_nr, ring_slots);
+    if (pipeline == NULL) {
+        *retval = 1;
+        return NULL;
+    }
+    if (!should_be_quiet) {
+        printf("pig INFO: running %zu generator(s) and %zu sender(s) over rings of %zu slot(s)...\n", generators_nr, senders_nr,
+               get_pig_spsc_size(pipeline->generators[0].ring));
+    }
+    return pipeline;
+}
+
+static int setup_placement(const char *iface, pig_pipeline_ctx *pipeline, pig_prebuild_ctx *prebuild) {
+    char *cpus_option = get_option("cpus", NULL);
+    pig_cpu_set_ctx usable, cpus, local, sender;
+    int node = get_pig_iface_numa_node(iface);
+    size_t c = 0;
+    if (!get_pig_usable_cpus(&usable)) {
+        if (cpus_option != NULL) {
+            printf("pig ERROR: unable to get the CPUs available to pig.\n");
+            return 1;
+        }
+        return 0;
+    }
+    if (cpus_option != NULL) {
+        if (!parse_pig_cpus(cpus_option, &cpus)) {
+            printf("pig ERROR: --cpus has an invalid CPU list.\n");
+            return 1;
+        }
+        for (c = 0; c < cpus.cpus_nr; c++) {
+            if (!is_pig_cpu_in_set(&usable, cpus.cpus[c])) {
+                printf("pig ERROR: the CPU %d is not available to pig.\n", cpus.cpus[c]);
+                return 1;
+            }
+        }
+    } else if (node >= 0) {
+        memcpy(&cpus, &usable, sizeof(pig_cpu_set_ctx));
+    } else {
+        //  INFO(Santiago): nothing is known about where the device lives, the scheduler decides.
+        return 0;
+    }
+    if (!should_be_quiet && node >= 0) {
+        printf("pig INFO: \"%s\" is attached to the NUMA node %d.\n", iface, node);
+    }
+    if (pipeline != NULL) {
+        pig_pipeline_place(pipeline, &cpus, node);
+        return 0;
+    }
+    //  INFO(Santiago): without the pipeline the main thread is the sender.
+    if (get_pig_numa_node_cpus(node, &local)) {
+        pig_cpus_local_first(&cpus, &local);
+    }
+    sender.cpus[0] = cpus.cpus[0];
+    sender.cpus_nr = 1;
+    pig_pin_thread(pthread_self(), &sender);
+    if (!should_be_quiet) {
+        printf("pig INFO: the sender runs on the CPU %d.\n", sender.cpus[0]);
+    }
+    if (prebuild != NULL && prebuild->has_regen_thread) {
+        pig_cpus_subtract(&usable, &sender);
+        pig_pin_thread(prebuild->regen_thread, &usable);
+    }
+    return 0;
+}
+
+static int setup_realtime(pig_pipeline_ctx *pipeline, pig_pacer_ctx *pacer) {
+    char *priority = get_option("rt-priority", NULL);
+    char *end = NULL;
+    long prio = PIG_DEFAULT_RT_PRIORITY;
+    if (get_option("realtime", NULL) == NULL) {
+        if (priority != NULL) {
+            printf("pig ERROR: --rt-priority requires --realtime.\n");
+            return 1;
+        }
+        return 0;
+    }
+    if (priority != NULL) {
+        prio = strtol(priority, &end, 10);
+        if (*priority == 0 || *end != 0 || prio < 1 || prio > 99) {
+            printf("pig ERROR: --rt-priority must be a number from 1 to 99.\n");
+            return 1;
+        }
+    }
+    if (!pig_lock_memory()) {
+        printf("pig ERROR: unable to lock the memory pages (are you root?).\n");
+        return 1;
+    }
+    //  INFO(Santiago): in the pipeline only the senders go real-time, the generators and the main thread
+    //                  keep the normal policy.
+    if (pipeline != NULL) {
+        pipeline->is_realtime = 1;
+        pipeline->rt_priority = (int)prio;
+    } else if (!pig_set_realtime(pthread_self(), (int)prio)) {
+        printf("pig ERROR: unable to switch to SCHED_FIFO (are you root?).\n");
+        return 1;
+    }
+    pacer->is_absolute = 1;
+    if (!should_be_quiet) {
+        printf("pig INFO: real-time mode on (SCHED_FIFO priority %d, memory locked).\n", (int)prio);
+    }
+    return 0;
+}
+
+static pig_arrivals_ctx *setup_arrivals(pigsty_entry_ctx **signatures, const size_t signatures_count, const unsigned long long timeout, const pig_pipeline_ctx *pipeline, int *retval) {
+    char *spec = get_option("arrivals", NULL);
+    pig_arrivals_ctx *arrivals = NULL;
+    *retval = 0;
+    if (spec == NULL) {
+        return NULL;
+    }
+    if (get_option("profile", NULL) != NULL) {
+        printf("pig ERROR: --arrivals cannot be used with --profile.\n");
+        *retval = 1;
+        return NULL;
+    }
+    arrivals = mk_pig_arrivals(spec, signatures, signatures_count, timeout, seed_value);
+    if (arrivals == NULL) {
+        *retval = 1;
+        return NULL;
+    }
+    //  INFO(Santiago): a per signature distribution decides which signature goes next, something that
+    //                  neither the generators nor a replay can follow.
+    if (arrivals->is_per_signature && (pipeline != NULL || get_option("event-log", NULL) != NULL || get_option("replay", NULL) != NULL)) {
+        printf("pig ERROR: per signature arrivals cannot be used with --generators, --event-log or --replay.\n");
+        del_pig_arrivals(arrivals);
+        *retval = 1;
+        return NULL;
+    }
+    if (!should_be_quiet) {
+        printf("pig INFO: the packets follow the arrivals \"%s\".\n", spec);
+    }
+    return arrivals;
+}
+
+static pig_flow_table_ctx *setup_sessions(int *retval) {
+    char *max_sessions = get_option("max-sessions", NULL);
+    char *rtt = get_option("session-rtt", NULL);
+    char *hold = get_option("session-hold", NULL);
+    char *overlap = get_option("session-overlap", NULL);
+    char *retransmits = get_option("session-retransmit", NULL);
+    int is_shuffled = (get_option("session-shuffle", NULL) != NULL);
+    int is_conflicting = (get_option("session-conflict", NULL) != NULL);
+    size_t capacity = PIG_DEFAULT_MAX_SESSIONS, overlap_value = 0, retransmits_value = 0;
+    pig_flow_table_ctx *sessions = NULL;
+    unsigned long long rtt_value = 0, hold_value = 0;
+    char *end = NULL;
+    *retval = 0;
+    if (get_option("sessions", NULL) == NULL) {
+        if (max_sessions != NULL || rtt != NULL || hold != NULL || overlap != NULL || retransmits != NULL || is_shuffled || is_conflicting) {
+            printf("pig ERROR: --max-sessions, --session-rtt, --session-hold, --session-shuffle, --session-overlap, --session-conflict and "
+                   "--session-retransmit require --sessions.\n");
+            *retval = 1;
+        }
+        return NULL;
+    }
+    if (max_sessions != NULL) {
+        capacity = strtoul(max_sessions, &end, 10);
+        if (*end != 0 || *max_sessions < '0' || *max_sessions > '9' || capacity == 0) {
+            printf("pig PANIC: an invalid --max-sessions value was supplied.\n");
+            *retval = 1;
+            return NULL;
+        }
+    }
+    if (rtt != NULL && !parse_pig_time(rtt, &rtt_value)) {
+        printf("pig PANIC: an invalid --session-rtt value was supplied.\n");
+        *retval = 1;
+        return NULL;
+    }
+    if (hold != NULL && !parse_pig_time(hold, &hold_value)) {
+        printf("pig PANIC: an invalid --session-hold value was supplied.\n");
+        *retval = 1;
+        return NULL;
+    }
+    if (rtt_value > PIG_SESSION_MAX_DELAY || hold_value > PIG_SESSION_MAX_DELAY - rtt_value) {
+        printf("pig PANIC: --session-rtt plus --session-hold cannot exceed %llu seconds.\n", PIG_SESSION_MAX_DELAY / 1000000000ULL);
+        *retval = 1;
+        return NULL;
+    }
+    if (overlap != NULL) {
+        overlap_value = strtoul(overlap, &end, 10);
+        if (*end != 0 || *overlap < '0' || *overlap > '9') {
+            printf("pig PANIC: an invalid --session-overlap value was supplied.\n");
+            *retval = 1;
+            return NULL;
+        }
+    }
+    if (is_conflicting && overlap_value == 0) {
+        printf("pig ERROR: --session-conflict requires a --session-overlap.\n");
+        *retval = 1;
+        return NULL;
+    }
+    if (retransmits != NULL) {
+        retransmits_value = strtoul(retransmits, &end, 10);
+        if (*end != 0 || *retransmits < '0' || *retransmits > '9') {
+            printf("pig PANIC: an invalid --session-retransmit value was supplied.\n");
+            *retval = 1;
+            return NULL;
+        }
+    }
+    sessions = mk_pig_flow_table(capacity);
+    if (sessions == NULL) {
+        *retval = 1;
+        return NULL;
+    }
+    sessions->rtt = rtt_value;
+    sessions->hold = hold_value;
+    sessions->is_shuffled = is_shuffled;
+    sessions->overlap = overlap_value;
+    sessions->is_conflicting = is_conflicting;
+    sessions->retransmits = retransmits_value;
+    if (!should_be_quiet) {
+        printf("pig INFO: the TCP signatures will be sent as sessions (up to %zu at once).\n", capacity);
+    }
+    return sessions;
+}
+
+static int setup_segmentation(const char *iface, const int fd, const int is_tun, pig_flow_table_ctx *sessions, pig_oink_args_ctx *args) {
+    char *mss_option = get_option("mss", NULL);
+    int is_gso = (get_option("gso", NULL) != NULL);
+    size_t mss = 0;
+    char *end = NULL;
+    //  INFO(Santiago): the segmentation is off unless asked for, the packets go out as the signatures make them.
+    if (mss_option != NULL) {
+        mss = strtoul(mss_option, &end, 10);
+        if (*end != 0 || *mss_option < '0' || *mss_option > '9' || mss > 65535) {
+            printf("pig PANIC: an invalid --mss value was supplied.\n");
+            return 1;
+        }
+    }
+    if (is_gso && (is_tun || mss == 0)) {
+        printf("pig ERROR: --gso is only available with a raw socket and a non-zero --mss.\n");
+        return 1;
+    }
+    if (is_gso && enable_raw_socket_gso(fd) == -1) {
+        printf("pig PANIC: unable to enable the segmentation offload on \"%s\".\n", iface);
+        return 1;
+    }
+    args->mss = mss;
+    args->is_gso = is_gso;
+    if (sessions != NULL && mss > 0) {
+        sessions->mss = mss;
+    }
+    if (sessions != NULL && sessions->overlap >= sessions->mss) {
+        printf("pig PANIC: the --session-overlap must be smaller than the MSS (%zu byte(s)).\n", sessions->mss);
+        return 1;
+    }
+    if (!should_be_quiet && mss > 0) {
+        printf("pig INFO: the TCP payloads larger than %zu byte(s) will be segmented%s.\n", mss, (is_gso ? " by the kernel" : ""));
+    }
+    return 0;
+}
+
+static int setup_fragmentation(pig_oink_args_ctx *args) {
+    char *size = get_option("fragment", NULL);
+    char *order = get_option("fragment-order", NULL);
+    char *overlap = get_option("fragment-overlap", NULL);
+    char *duplicates = get_option("fragment-duplicates", NULL);
+    pig_fragmenter_ctx fragmenter;
+    char *end = NULL;
+    if (size == NULL) {
+        if (order != NULL || overlap != NULL || duplicates != NULL) {
+            printf("pig ERROR: --fragment-order, --fragment-overlap and --fragment-duplicates require --fragment.\n");
+            return 1;
+        }
+        return 0;
+    }
+    if (get_option("gso", NULL) != NULL) {
+        printf("pig ERROR: --fragment and --gso are mutually exclusive.\n");
+        return 1;
+    }
+    memset(&fragmenter, 0, sizeof(fragmenter));
+    fragmenter.size = strtoul(size, &end, 10);
+    if (*end != 0 || *size < '0' || *size > '9' || fragmenter.size < 8 || fragmenter.size > 65535) {
+        printf("pig PANIC: an invalid --fragment value was supplied (from 8 to 65535 bytes).\n");
+        return 1;
+    }
+    fragmenter.size &= ~((size_t)7);
+    if (!get_pig_fragment_order(order, &fragmenter.order)) {
+        printf("pig PANIC: an unknown --fragment-order was supplied, use in-order, reverse or random.\n");
+        return 1;
+    }
+    if (overlap != NULL) {
+        fragmenter.overlap = strtoul(overlap, &end, 10);
+        if (*end != 0 || *overlap < '0' || *overlap > '9' || ((fragmenter.overlap + 7) & ~((size_t)7)) >= fragmenter.size) {
+            printf("pig PANIC: an invalid --fragment-overlap value was supplied (it must be smaller than the fragment).\n");
+            return 1;
+        }
+    }
+    if (duplicates != NULL) {
+        fragmenter.duplicates = strtoul(duplicates, &end, 10);
+        if (*end != 0 || *duplicates < '0' || *duplicates > '9' || fragmenter.duplicates > PIG_MAX_FRAGMENT_DUPLICATES) {
+            printf("pig PANIC: an invalid --fragment-duplicates value was supplied (up to %d).\n", PIG_MAX_FRAGMENT_DUPLICATES);
+            return 1;
+        }
+    }
+    fragmenter.seed = seed_value;
+    args->fragmenter = fragmenter;
+    if (!should_be_quiet) {
+        printf("pig INFO: the datagrams will be sent in fragments of %zu byte(s).\n", fragmenter.size);
+    }
+    return 0;
+}
+
+static pig_replies_ctx *setup_replies(pigsty_entry_ctx **signatures, const size_t signatures_count, const char *iface, const int is_device, const int has_l2, unsigned long long *wait, int *retval) {
+    char *replies_wait = get_option("replies-wait", NULL);
+    pig_replies_ctx *replies = NULL;
+    *retval = 0;
+    *wait = PIG_REPLIES_DEFAULT_WAIT;
+    if (get_option("replies", NULL) == NULL && get_option("rtt", NULL) == NULL) {
+        if (replies_wait != NULL) {
+            printf("pig ERROR: --replies-wait requires --replies or --rtt.\n");
+            *retval = 1;
+        }
+        return NULL;
+    }
+    if (replies_wait != NULL && !parse_pig_time(replies_wait, wait)) {
+        printf("pig PANIC: an invalid --replies-wait value was supplied.\n");
+        *retval = 1;
+        return NULL;
+    }
+    replies = mk_pig_replies(signatures, signatures_count);
+    if (replies != NULL && get_option("rtt", NULL) != NULL) {
+        pig_replies_enable_rtt(replies);
+    }
+    if (replies == NULL || !pig_replies_start(replies, iface, is_device, has_l2)) {
+        del_pig_replies(replies);
+        *retval = 1;
+        return NULL;
+    }
+    if (!should_be_quiet) {
+        printf("pig INFO: watching the replies on \"%s\".\n", iface);
+    }
+    return replies;
+}
+
+static pig_manifest_ctx *setup_manifest(pigsty_entry_ctx **signatures, const size_t signatures_count, int *retval) {
+    char *filepath = get_option("manifest", NULL);
+    pig_manifest_ctx *manifest = NULL;
+    int has_alerts = (get_option("alerts", NULL) != NULL);
+    *retval = 0;
+    if (filepath == NULL && !has_alerts) {
+        return NULL;
+    }
+    //  INFO(Santiago): the alert correlation reads the ground truth from the manifest, with it the
+    //                  draining is done by the alerts thread and the file is optional.
+    manifest = mk_pig_manifest(filepath, signatures, signatures_count);
+    if (manifest == NULL || (!has_alerts && !pig_manifest_start(manifest))) {
+        del_pig_manifest(manifest);
+        *retval = 1;
+        return NULL;
+    }
+    if (!should_be_quiet && filepath != NULL) {
+        printf("pig INFO: the packets sent will be written down to the manifest \"%s\".\n", filepath);
+    }
+    return manifest;
+}
+
+static pig_alerts_ctx *setup_alerts(pigsty_entry_ctx **signatures, const size_t signatures_count, pig_manifest_ctx *manifest, unsigned long long *wait, int *retval) {
+    char *filepath = get_option("alerts", NULL);
+    char *alerts_wait = get_option("alerts-wait", NULL);
+    char *alerts_window = get_option("alerts-window", NULL);
+    unsigned long long window = PIG_ALERTS_DEFAULT_WINDOW;
+    pig_alerts_ctx *alerts = NULL;
+    *retval = 0;
+    *wait = PIG_ALERTS_DEFAULT_WAIT;
+    if (filepath == NULL) {
+        if (alerts_wait != NULL || alerts_window != NULL) {
+            printf("pig ERROR: --alerts-wait and --alerts-window require --alerts.\n");
+            *retval = 1;
+        }
+        return NULL;
+    }
+    if (alerts_wait != NULL && !parse_pig_time(alerts_wait, wait)) {
+        printf("pig PANIC: an invalid --alerts-wait value was supplied.\n");
+        *retval = 1;
+        return NULL;
+    }
+    if (alerts_window != NULL && (!parse_pig_time(alerts_window, &window) || window == 0)) {
+        printf("pig PANIC: an invalid --alerts-window value was supplied.\n");
+        *retval = 1;
+        return NULL;
+    }
+    alerts = mk_pig_alerts(filepath, signatures, signatures_count, window);
+    if (alerts == NULL || !pig_alerts_start(alerts, manifest, !should_be_quiet)) {
+        del_pig_alerts(alerts);
+        *retval = 1;
+        return NULL;
+    }
+    if (!should_be_quiet) {
+        printf("pig INFO: following the alerts written to \"%s\".\n", filepath);
+    }
+    return alerts;
+}
+
+static int dump_manifest(const char *filepath) {
+    char *format = get_option("manifest-format", "csv");
+    if (strcmp(format, "csv") != 0 && strcmp(format, "json") != 0) {
+        printf("pig ERROR: an invalid --manifest-format value was supplied (use csv or json).\n");
+        return 1;
+    }
+    return (pig_manifest_dump(filepath, (strcmp(format, "csv") == 0 ? kManifestCsv : kManifestJson), stdout) ? 0 : 1);
+}
+
+static int is_tcp_signature(const pigsty_entry_ctx *signature) {
+    pigsty_field_ctx *protocol = get_pigsty_conf_set_field(kIpv4_protocol, signature->conf);
+    return (protocol != NULL && protocol->data != NULL && *(unsigned char *)protocol->data == 6);
+}
+
+static void mk_session_frame(pig_flow_table_ctx *sessions, pig_frame_ctx *frame, const pig_oink_args_ctx *args, const unsigned long long now) {
+    //  INFO(Santiago): while the table has room each chosen TCP signature opens a new session, once it
+    //                  is full the slot goes to the next step of the sessions already open (without even
+    //                  building the packet). The other signatures go as usual.
+    frame->packet = NULL;
+    if ((sessions->active_nr < sessions->capacity || !is_tcp_signature(frame->signature)) && oink_mk_frame(frame, args) == 1) {
+        switch (pig_session_open(sessions, frame)) {
+            case -1:
+                return;
+
+            case 0:
+                free(frame->packet);
+                frame->packet = NULL;
+                break;
+
+            default:
+                break;
+        }
+    }
+    pig_session_next_frame(sessions, frame, now);
+}
+
+static pigsty_entry_ctx *next_signature(pigsty_entry_ctx **signatures, const size_t signatures_count, const pig_profile_point_ctx *mix, pig_order_ctx *order, pig_evlog_ctx *evlog, size_t *signature_index, int *status) {
+    size_t logged_index = 0;
+    *status = 1;
+    if (evlog != NULL && evlog->is_replay) {
+        *status = evlog_replay_next(evlog, &logged_index);
+        if (*status != 1) {
+            return NULL;
+        }
+    } else {
+        evlog_checkpoint(evlog, signatures);
+    }
+    *signature_index = pick_pig_signature(order, mix, signatures_count);
+    if (evlog != NULL && evlog->is_replay && *signature_index != logged_index) {
+        *status = -1;
+        return NULL;
+    }
+    evlog_record(evlog, *signature_index);
+    return signatures[*signature_index];
+}
+
 static int is_targets_option_required(const pigsty_entry_ctx *entries) {
     const pigsty_conf_set_ctx *cp = NULL;
     const pigsty_entry_ctx *ep = NULL;
@@ -259,33 +1204,50 @@ int main(int argc, char **argv) {
     char *gw_addr = NULL;
     char *loiface = NULL;
     char *nt_mask = NULL;
+    char *tun_iface = NULL;
+    char *tap_iface = NULL;
+    char *seed = NULL;
     int exit_code = 1;
-    if (get_option("version", NULL, argc, argv) != NULL) {
+    register_options(argc, argv);
+    if (get_option("version", NULL) != NULL) {
         printf("pig v%s\n", PIG_VERSION);
         return 0;
     }
+    if (get_option("dump-manifest", NULL) != NULL) {
+        return dump_manifest(get_option("dump-manifest", NULL));
+    }
     if (argc > 1) {
-        signatures = get_option("signatures", NULL, argc, argv);
+        signatures = get_option("signatures", NULL);
         if (signatures == NULL) {
             printf("pig ERROR: --signatures option is missing.\n");
             return 1;
         }
-        gw_addr = get_option("gateway", NULL, argc, argv);
-        if (gw_addr == NULL) {
+        tun_iface = get_option("tun", NULL);
+        tap_iface = get_option("tap", NULL);
+        if (tun_iface != NULL && tap_iface != NULL) {
+            printf("pig ERROR: --tun and --tap options are mutually exclusive.\n");
+            return 1;
+        }
+        if (tap_iface != NULL) {
+            tun_iface = tap_iface;
+        }
+        //  INFO(Santiago): when injecting through a tun/tap device there is no physical network to deal with.
+        gw_addr = get_option("gateway", NULL);
+        if (gw_addr == NULL && tun_iface == NULL) {
             printf("pig ERROR: --gateway option is missing.\n");
             return 1;
         }
-        nt_mask = get_option("net-mask", NULL, argc, argv);
-        if (nt_mask == NULL) {
+        nt_mask = get_option("net-mask", NULL);
+        if (nt_mask == NULL && tun_iface == NULL) {
             printf("pig ERROR: --net-mask option is missing.\n");
             return 1;
         }
-        loiface = get_option("lo-iface", NULL, argc, argv);
-        if (loiface == NULL) {
+        loiface = get_option("lo-iface", NULL);
+        if (loiface == NULL && tun_iface == NULL) {
             printf("pig ERROR: --lo-iface option is missing.\n");
             return 1;
         }
-        timeout = get_option("timeout", NULL, argc, argv);
+        timeout = get_option("timeout", NULL);
         if (timeout != NULL) {
             for (tp = timeout; *tp != 0; tp++) {
                 if (!isdigit(*tp)) {
@@ -294,17 +1256,73 @@ int main(int argc, char **argv) {
                 }
             }
         }
-        should_be_quiet = (get_option("no-echo", NULL, argc, argv) != NULL);
-        targets = get_option("targets", NULL, argc, argv);
+        should_be_quiet = (get_option("no-echo", NULL) != NULL);
+        targets = get_option("targets", NULL);
         signal(SIGINT, sigint_watchdog);
         signal(SIGTERM, sigint_watchdog);
-        srand(time(0));
-        exit_code = run_pig_run(signatures, targets, timeout, get_option("single-test", NULL, argc, argv), gw_addr, nt_mask, loiface);
+        if (get_option("event-log", NULL) != NULL && get_option("replay", NULL) != NULL) {
+            printf("pig ERROR: --event-log and --replay options are mutually exclusive.\n");
+            return 1;
+        }
+        tp = get_option("replay-from", NULL);
+        if (tp != NULL && get_option("profile", NULL) != NULL) {
+            printf("pig ERROR: --replay-from cannot be used with --profile (the signature mix depends on the time).\n");
+            return 1;
+        }
+        if (get_option("generators", NULL) != NULL && (get_option("event-log", NULL) != NULL || get_option("replay", NULL) != NULL ||
+                                                       get_option("prebuild", NULL) != NULL || get_option("single-test", NULL) != NULL)) {
+            printf("pig ERROR: --generators cannot be used with --event-log, --replay, --prebuild or --single-test.\n");
+            return 1;
+        }
+        if (get_option("prebuild", NULL) != NULL && (get_option("event-log", NULL) != NULL || get_option("replay", NULL) != NULL)) {
+            printf("pig ERROR: --prebuild cannot be used with --event-log or --replay.\n");
+            return 1;
+        }
+        if (get_option("sessions", NULL) != NULL && (get_option("generators", NULL) != NULL || get_option("prebuild", NULL) != NULL ||
+                                                     get_option("event-log", NULL) != NULL || get_option("replay", NULL) != NULL)) {
+            printf("pig ERROR: --sessions cannot be used with --generators, --prebuild, --event-log or --replay.\n");
+            return 1;
+        }
+        if (tp != NULL && get_option("train", NULL) != NULL) {
+            printf("pig ERROR: --replay-from cannot be used with --train.\n");
+            return 1;
+        }
+        //  INFO(Santiago): a burst picks all of its signatures before building any packet, so a checkpoint
+        //                  taken in the middle of a burst cannot be fast-forwarded packet by packet.
+        if (tp != NULL && get_option("burst", NULL) != NULL && strtoul(get_option("burst", NULL), NULL, 10) > 1) {
+            printf("pig ERROR: --replay-from cannot be used with --burst greater than 1.\n");
+            return 1;
+        }
+        if (tp != NULL) {
+            for (; *tp != 0; tp++) {
+                if (!isdigit(*tp)) {
+                    printf("pig ERROR: an invalid --replay-from value was supplied.\n");
+                    return 1;
+                }
+            }
+        }
+        seed = get_option("seed", NULL);
+        if (seed != NULL) {
+            for (tp = seed; *tp != 0; tp++) {
+                if (!isdigit(*tp)) {
+                    printf("pig ERROR: an invalid seed value was supplied.\n");
+                    return 1;
+                }
+            }
+            seed_value = strtoull(seed, NULL, 10);
+        } else {
+            seed_value = mk_rnd_mk_seed();
+        }
+        if (!should_be_quiet) {
+            printf("pig INFO: using %llu as seed (re-run with --seed=%llu to get the same random choices).\n", seed_value, seed_value);
+        }
+        mk_rnd_init(seed_value, 0);
+        exit_code = run_pig_run(signatures, targets, timeout, get_option("single-test", NULL), gw_addr, nt_mask, loiface, tun_iface, (tap_iface != NULL));
         if (!should_be_quiet && exit_code == 0) {
             printf("\npig INFO: exiting... please wait...\npig INFO: pig has gone.\n");
         }
     } else {
-        printf("usage: %s --signatures=file.0,file.1,(...),file.n --gateway=<gateway address> --net-mask=<network mask> --lo-iface=<network interface> [--timeout=<in msecs> --no-echo --targets=n.n.n.n,n.*.*.*,n.n.n.n/n]\n", argv[0]);
+        printf("usage: %s --signatures=file.0,file.1,(...),file.n --gateway=<gateway address> --net-mask=<network mask> --lo-iface=<network interface> [--timeout=<in msecs> --no-echo --targets=n.n.n.n,n.*.*.*,n.n.n.n/n --tun=<tun device> | --tap=<tap device> --seed=<n> --event-log=<file> | --replay=<file> [--replay-from=<packet number>] --profile=<file> [--time-compression=<factor>] --count=<packets> --bytes=<n>[k|m|g] --duration=<time> --burst=<n> [--burst-gap=<usecs> --train] --order=random|sequential|round-robin|shuffle-each-pass --prebuild=<n> [--prebuild-refresh=<time>] --generators=<n> [--senders=<n> --ring-size=<n>] --cpus=<list> --realtime [--rt-priority=<1-99>] --arrivals=[<signature>=]<distribution>,... --sessions [--max-sessions=<n> --session-rtt=<time> --session-hold=<time> --session-shuffle --session-overlap=<bytes> [--session-conflict] --session-retransmit=<n>] --replies | --rtt [--replies-wait=<time>] --manifest=<file> --alerts=<eve.json or alert_fast file> [--alerts-wait=<time> --alerts-window=<time>] --mss=<n> --gso --fragment=<bytes> [--fragment-order=in-order|reverse|random --fragment-overlap=<bytes> --fragment-duplicates=<n>]]\n       %s --dump-manifest=<file> [--manifest-format=csv|json]\n", argv[0], argv[0]);
     }
     return exit_code;
 }
@@ -0,0 +1,449 @@
+/*
+ *                                Copyright (C) 2015 by Rafael Santiago
+ *
+ * This is a free software. You can redistribute it and/or modify under
+ * the terms of the GNU General Public License version 2.
+ *
+ */
+#include "manifest.h"
+#include "pacer.h"
+#include "memory.h"
+#include "cpus.h"
+#include <string.h>
+
+//  INFO(Santiago): the manifest layout is:
+//
+//      header:     "PIGMANIF" | version (u32) | record size (u32) | signatures count (u32) | reserved (u32)
+//                  signature name length (u16) | signature name (one per signature, in index order)
+//      records:    timestamp in ns since the epoch (u64) | signature index (u32) | src addr (u32) | dst addr (u32) |
+//                  src port (u16) | dst port (u16) | length (u32) | protocol (u8) | writer (u8) | reserved (u16)
+//
+//                  All numbers are little-endian, the addresses are in host order once read. For ICMP the
+//                  ports hold the type and the code. A signature index equal to 0xffffffff means a packet
+//                  whose signature was not in the loaded set.
+//
+//                  Each sending thread owns a single producer/single consumer ring of records. Appending is
+//                  filling a fixed size record and publishing the new head, the i/o belongs to the writer
+//                  thread only. When a ring is full the record is dropped and counted, the sender never waits.
+//
+//                  A reader (e.g. the alert correlation) sees every record as it is drained. Without a file
+//                  path the manifest is only this stream, the reader's thread must then do the draining.
+
+#define PIG_MANIFEST_NO_SIGNATURE 0xffffffff
+
+#define PIG_MANIFEST_CHUNK 256
+
+#define get_u16(b) ( ((unsigned short)(b)[0] << 8) | (b)[1] )
+
+#define get_u32(b) ( ((unsigned int)(b)[0] << 24) | ((unsigned int)(b)[1] << 16) | ((unsigned int)(b)[2] << 8) | (b)[3] )
+
+static __thread pig_manifest_buffer_ctx *local_buffer = NULL;
+
+static __thread unsigned long long local_manifest_id = 0;
+
+static unsigned long long manifest_ids = 0;
+
+static void put_le(unsigned char *buf, const unsigned long long value, const size_t size);
+
+static unsigned long long get_le(const unsigned char *buf, const size_t size);
+
+static size_t get_signature_index(const pig_manifest_ctx *manifest, const pigsty_entry_ctx *signature);
+
+static pig_manifest_buffer_ctx *get_local_buffer(pig_manifest_ctx *manifest);
+
+static void fill_record(pig_manifest_ctx *manifest, pig_manifest_record_ctx *record, const pig_frame_ctx *frame, const unsigned long long timestamp);
+
+static void serialize_record(const pig_manifest_record_ctx *record, unsigned char *buf);
+
+static void write_header(FILE *fp, pigsty_entry_ctx **signatures, const size_t signatures_count);
+
+static void *write_manifest(void *arg);
+
+static void dump_string(FILE *out, const char *str, const pig_manifest_format_t format);
+
+static void put_le(unsigned char *buf, const unsigned long long value, const size_t size) {
+    size_t b = 0;
+    for (b = 0; b < size; b++) {
+        buf[b] = (value >> (b * 8)) & 0xff;
+    }
+}
+
+static unsigned long long get_le(const unsigned char *buf, const size_t size) {
+    unsigned long long value = 0;
+    size_t b = size;
+    while (b-- > 0) {
+        value = (value << 8) | buf[b];
+    }
+    return value;
+}
+
+static size_t get_signature_index(const pig_manifest_ctx *manifest, const pigsty_entry_ctx *signature) {
+    size_t i = ((size_t)signature >> 4) & manifest->index_mask;
+    while (manifest->index[i].signature != NULL && manifest->index[i].signature != signature) {
+        i = (i + 1) & manifest->index_mask;
+    }
+    return (manifest->index[i].signature != NULL ? manifest->index[i].index : PIG_MANIFEST_NO_SIGNATURE);
+}
+
+static pig_manifest_buffer_ctx *get_local_buffer(pig_manifest_ctx *manifest) {
+    pig_manifest_buffer_ctx *buffer = NULL;
+    //  INFO(Santiago): a thread registers its ring on its first append, the id tells apart a new
+    //                  manifest that happens to live at the address of an old one.
+    if (local_manifest_id == manifest->id) {
+        return local_buffer;
+    }
+    pthread_mutex_lock(&manifest->lock);
+    if (manifest->buffers_nr < PIG_MANIFEST_MAX_WRITERS) {
+        buffer = (pig_manifest_buffer_ctx *) pig_newseg(sizeof(pig_manifest_buffer_ctx));
+        memset(buffer, 0, sizeof(pig_manifest_buffer_ctx));
+        buffer->records = (pig_manifest_record_ctx *) pig_newseg(sizeof(pig_manifest_record_ctx) * PIG_MANIFEST_BUFFER_SIZE);
+        buffer->writer = manifest->buffers_nr;
+        manifest->buffers[manifest->buffers_nr] = buffer;
+        __atomic_store_n(&manifest->buffers_nr, manifest->buffers_nr + 1, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&manifest->lock);
+    local_manifest_id = manifest->id;
+    local_buffer = buffer;
+    return buffer;
+}
+
+static void fill_record(pig_manifest_ctx *manifest, pig_manifest_record_ctx *record, const pig_frame_ctx *frame, const unsigned long long timestamp) {
+    const unsigned char *dgram = frame->packet;
+    size_t l4 = 0;
+    record->timestamp = timestamp;
+    record->signature = get_signature_index(manifest, frame->signature);
+    record->src_addr = record->dst_addr = 0;
+    record->src_port = record->dst_port = 0;
+    record->length = frame->packet_size;
+    record->proto = 0;
+    if (frame->packet_size < 20 || (dgram[0] >> 4) != 4) {
+        return;
+    }
+    record->src_addr = get_u32(&dgram[12]);
+    record->dst_addr = get_u32(&dgram[16]);
+    record->proto = dgram[9];
+    l4 = (dgram[0] & 0x0f) * 4;
+    switch (record->proto) {
+        case 6:
+        case 17:
+            if (l4 + 4 <= frame->packet_size) {
+                record->src_port = get_u16(&dgram[l4]);
+                record->dst_port = get_u16(&dgram[l4 + 2]);
+            }
+            break;
+
+        case 1:
+            if (l4 + 2 <= frame->packet_size) {
+                record->src_port = dgram[l4];
+                record->dst_port = dgram[l4 + 1];
+            }
+            break;
+    }
+}
+
+static void serialize_record(const pig_manifest_record_ctx *record, unsigned char *buf) {
+    put_le(&buf[0], record->timestamp, 8);
+    put_le(&buf[8], record->signature, 4);
+    put_le(&buf[12], record->src_addr, 4);
+    put_le(&buf[16], record->dst_addr, 4);
+    put_le(&buf[20], record->src_port, 2);
+    put_le(&buf[22], record->dst_port, 2);
+    put_le(&buf[24], record->length, 4);
+    buf[28] = record->proto;
+    buf[29] = record->writer;
+    put_le(&buf[30], 0, 2);
+}
+
+static void write_header(FILE *fp, pigsty_entry_ctx **signatures, const size_t signatures_count) {
+    unsigned char buf[24];
+    size_t s = 0, name_size = 0;
+    memcpy(buf, PIG_MANIFEST_MAGIC, 8);
+    put_le(&buf[8], PIG_MANIFEST_VERSION, 4);
+    put_le(&buf[12], PIG_MANIFEST_RECORD_SIZE, 4);
+    put_le(&buf[16], signatures_count, 4);
+    put_le(&buf[20], 0, 4);
+    fwrite(buf, 1, sizeof(buf), fp);
+    for (s = 0; s < signatures_count; s++) {
+        name_size = (signatures[s]->signature_name != NULL ? strlen(signatures[s]->signature_name) : 0);
+        name_size = (name_size > 0xffff ? 0xffff : name_size);
+        put_le(buf, name_size, 2);
+        fwrite(buf, 1, 2, fp);
+        fwrite(signatures[s]->signature_name, 1, name_size, fp);
+    }
+}
+
+pig_manifest_ctx *mk_pig_manifest(const char *filepath, pigsty_entry_ctx **signatures, const size_t signatures_count) {
+    pig_manifest_ctx *manifest = NULL;
+    FILE *fp = NULL;
+    size_t s = 0, i = 0, index_size = 2;
+    if (signatures == NULL || signatures_count == 0) {
+        return NULL;
+    }
+    if (filepath != NULL) {
+        fp = fopen(filepath, "wb");
+        if (fp == NULL) {
+            printf("pig i/o PANIC: unable to create the manifest \"%s\".\n", filepath);
+            return NULL;
+        }
+        write_header(fp, signatures, signatures_count);
+    }
+    while (index_size < signatures_count * 2) {
+        index_size <<= 1;
+    }
+    manifest = (pig_manifest_ctx *) pig_newseg(sizeof(pig_manifest_ctx));
+    memset(manifest, 0, sizeof(pig_manifest_ctx));
+    manifest->fp = fp;
+    manifest->id = __atomic_add_fetch(&manifest_ids, 1, __ATOMIC_RELAXED);
+    manifest->signatures = signatures;
+    manifest->signatures_count = signatures_count;
+    manifest->index = (pig_signature_index_ctx *) pig_newseg(sizeof(pig_signature_index_ctx) * index_size);
+    memset(manifest->index, 0, sizeof(pig_signature_index_ctx) * index_size);
+    manifest->index_mask = index_size - 1;
+    for (s = 0; s < signatures_count; s++) {
+        for (i = ((size_t)signatures[s] >> 4) & manifest->index_mask; manifest->index[i].signature != NULL; i = (i + 1) & manifest->index_mask)
+            ;
+        manifest->index[i].signature = signatures[s];
+        manifest->index[i].index = s;
+    }
+    pthread_mutex_init(&manifest->lock, NULL);
+    return manifest;
+}
+
+void del_pig_manifest(pig_manifest_ctx *manifest) {
+    size_t b = 0;
+    if (manifest == NULL) {
+        return;
+    }
+    pig_manifest_stop(manifest);
+    for (b = 0; b < manifest->buffers_nr; b++) {
+        free(manifest->buffers[b]->records);
+        free(manifest->buffers[b]);
+    }
+    pthread_mutex_destroy(&manifest->lock);
+    if (manifest->fp != NULL) {
+        fclose(manifest->fp);
+    }
+    free(manifest->index);
+    free(manifest);
+}
+
+void pig_manifest_append(pig_manifest_ctx *manifest, const pig_frame_ctx *frames, const size_t frames_nr, const unsigned long long timestamp) {
+    pig_manifest_buffer_ctx *buffer = NULL;
+    size_t f = 0, head = 0, tail = 0;
+    if (manifest == NULL) {
+        return;
+    }
+    buffer = get_local_buffer(manifest);
+    if (buffer == NULL) {
+        for (f = 0; f < frames_nr; f++) {
+            if (frames[f].packet != NULL && frames[f].sent) {
+                __atomic_add_fetch(&manifest->orphans, 1, __ATOMIC_RELAXED);
+            }
+        }
+        return;
+    }
+    head = buffer->head;
+    tail = __atomic_load_n(&buffer->tail, __ATOMIC_ACQUIRE);
+    for (f = 0; f < frames_nr; f++) {
+        if (frames[f].packet == NULL || !frames[f].sent) {
+            continue;
+        }
+        if (head - tail == PIG_MANIFEST_BUFFER_SIZE) {
+            tail = __atomic_load_n(&buffer->tail, __ATOMIC_ACQUIRE);
+            if (head - tail == PIG_MANIFEST_BUFFER_SIZE) {
+                __atomic_store_n(&buffer->dropped, buffer->dropped + 1, __ATOMIC_RELAXED);
+                continue;
+            }
+        }
+        fill_record(manifest, &buffer->records[head & (PIG_MANIFEST_BUFFER_SIZE - 1)], &frames[f], timestamp);
+        buffer->records[head & (PIG_MANIFEST_BUFFER_SIZE - 1)].writer = buffer->writer;
+        head++;
+    }
+    __atomic_store_n(&buffer->head, head, __ATOMIC_RELEASE);
+}
+
+size_t pig_manifest_drain(pig_manifest_ctx *manifest) {
+    unsigned char chunk[PIG_MANIFEST_RECORD_SIZE * PIG_MANIFEST_CHUNK];
+    pig_manifest_buffer_ctx *buffer = NULL;
+    const pig_manifest_record_ctx *record = NULL;
+    size_t b = 0, buffers_nr = 0, head = 0, tail = 0, n = 0, total = 0;
+    if (manifest == NULL) {
+        return 0;
+    }
+    buffers_nr = __atomic_load_n(&manifest->buffers_nr, __ATOMIC_ACQUIRE);
+    for (b = 0; b < buffers_nr; b++) {
+        buffer = manifest->buffers[b];
+        head = __atomic_load_n(&buffer->head, __ATOMIC_ACQUIRE);
+        tail = buffer->tail;
+        while (tail != head) {
+            for (n = 0; tail != head && n < PIG_MANIFEST_CHUNK; n++, tail++) {
+                record = &buffer->records[tail & (PIG_MANIFEST_BUFFER_SIZE - 1)];
+                if (manifest->reader != NULL) {
+                    manifest->reader(record, manifest->reader_arg);
+                }
+                serialize_record(record, &chunk[n * PIG_MANIFEST_RECORD_SIZE]);
+            }
+            __atomic_store_n(&buffer->tail, tail, __ATOMIC_RELEASE);
+            if (manifest->fp != NULL && fwrite(chunk, PIG_MANIFEST_RECORD_SIZE, n, manifest->fp) != n && !manifest->has_failed) {
+                printf("pig i/o PANIC: unable to write to the manifest.\n");
+                manifest->has_failed = 1;
+            }
+            total += n;
+        }
+    }
+    manifest->written += total;
+    return total;
+}
+
+static void *write_manifest(void *arg) {
+    pig_manifest_ctx *manifest = (pig_manifest_ctx *)arg;
+    while (!__atomic_load_n(&manifest->should_stop, __ATOMIC_ACQUIRE)) {
+        if (pig_manifest_drain(manifest) == 0) {
+            pig_sleep_ns(PIG_MANIFEST_IDLE);
+        }
+    }
+    return NULL;
+}
+
+int pig_manifest_start(pig_manifest_ctx *manifest) {
+    if (manifest == NULL) {
+        return 0;
+    }
+    manifest->should_stop = 0;
+    if (!pig_mk_helper_thread(&manifest->thread, write_manifest, manifest)) {
+        printf("pig PANIC: unable to start the manifest writer.\n");
+        return 0;
+    }
+    manifest->has_thread = 1;
+    return 1;
+}
+
+void pig_manifest_stop(pig_manifest_ctx *manifest) {
+    if (manifest == NULL) {
+        return;
+    }
+    if (manifest->has_thread) {
+        __atomic_store_n(&manifest->should_stop, 1, __ATOMIC_RELEASE);
+        pthread_join(manifest->thread, NULL);
+        manifest->has_thread = 0;
+    }
+    //  INFO(Santiago): the senders are gone at this point, whatever is left in the rings goes now.
+    pig_manifest_drain(manifest);
+    if (manifest->fp != NULL) {
+        fflush(manifest->fp);
+    }
+}
+
+void pig_manifest_set_reader(pig_manifest_ctx *manifest, pig_manifest_reader reader, void *arg) {
+    if (manifest == NULL) {
+        return;
+    }
+    manifest->reader = reader;
+    manifest->reader_arg = arg;
+}
+
+void pig_manifest_stats(const pig_manifest_ctx *manifest) {
+    unsigned long long dropped = 0;
+    size_t b = 0;
+    if (manifest == NULL) {
+        return;
+    }
+    for (b = 0; b < manifest->buffers_nr; b++) {
+        dropped += manifest->buffers[b]->dropped;
+    }
+    printf("pig INFO: %llu packet(s) %s by %d thread(s)", manifest->written,
+           (manifest->fp != NULL ? "written to the manifest" : "went through the ground truth stream"), (int)manifest->buffers_nr);
+    if (dropped > 0 || manifest->orphans > 0) {
+        printf(", %llu left out (%llu from full buffers, %llu from threads over the limit of %d)", dropped + manifest->orphans,
+               dropped, manifest->orphans, PIG_MANIFEST_MAX_WRITERS);
+    }
+    printf(".\n");
+}
+
+static void dump_string(FILE *out, const char *str, const pig_manifest_format_t format) {
+    const char *s = NULL;
+    fputc('"', out);
+    for (s = str; *s != 0; s++) {
+        if (format == kManifestCsv && *s == '"') {
+            fputs("\"\"", out);
+        } else if (format == kManifestJson && (*s == '"' || *s == '\\')) {
+            fprintf(out, "\\%c", *s);
+        } else if (format == kManifestJson && (unsigned char)*s < 0x20) {
+            fprintf(out, "\\u%04x", (unsigned char)*s);
+        } else {
+            fputc(*s, out);
+        }
+    }
+    fputc('"', out);
+}
+
+int pig_manifest_dump(const char *filepath, const pig_manifest_format_t format, FILE *out) {
+    FILE *fp = NULL;
+    unsigned char header[24], record[PIG_MANIFEST_RECORD_SIZE];
+    char **names = NULL;
+    size_t s = 0, signatures_count = 0, name_size = 0, record_size = 0;
+    unsigned long long timestamp = 0;
+    unsigned int signature = 0, src_addr = 0, dst_addr = 0;
+    const char *name = NULL;
+    int is_ok = 1;
+    fp = fopen(filepath, "rb");
+    if (fp == NULL) {
+        printf("pig i/o PANIC: unable to open the manifest \"%s\".\n", filepath);
+        return 0;
+    }
+    if (fread(header, 1, sizeof(header), fp) != sizeof(header) || memcmp(header, PIG_MANIFEST_MAGIC, 8) != 0 ||
+        get_le(&header[8], 4) != PIG_MANIFEST_VERSION || get_le(&header[12], 4) < PIG_MANIFEST_RECORD_SIZE) {
+        printf("pig PANIC: \"%s\" is not a manifest written by this version.\n", filepath);
+        fclose(fp);
+        return 0;
+    }
+    record_size = get_le(&header[12], 4);
+    signatures_count = get_le(&header[16], 4);
+    names = (char **) pig_newseg(sizeof(char *) * (signatures_count + 1));
+    memset(names, 0, sizeof(char *) * (signatures_count + 1));
+    for (s = 0; s < signatures_count && is_ok; s++) {
+        is_ok = (fread(header, 1, 2, fp) == 2);
+        name_size = (is_ok ? get_le(header, 2) : 0);
+        names[s] = (char *) pig_newseg(name_size + 1);
+        is_ok = (is_ok && fread(names[s], 1, name_size, fp) == name_size);
+        names[s][name_size] = 0;
+    }
+    if (!is_ok) {
+        printf("pig PANIC: the manifest \"%s\" is truncated.\n", filepath);
+    }
+    if (is_ok && format == kManifestCsv) {
+        fprintf(out, "timestamp,signature,src_addr,src_port,dst_addr,dst_port,protocol,length\n");
+    }
+    while (is_ok && fread(record, 1, PIG_MANIFEST_RECORD_SIZE, fp) == PIG_MANIFEST_RECORD_SIZE) {
+        //  INFO(Santiago): a newer writer may append fields to the records, they are skipped here.
+        if (record_size > PIG_MANIFEST_RECORD_SIZE) {
+            fseek(fp, record_size - PIG_MANIFEST_RECORD_SIZE, SEEK_CUR);
+        }
+        timestamp = get_le(&record[0], 8);
+        signature = get_le(&record[8], 4);
+        src_addr = get_le(&record[12], 4);
+        dst_addr = get_le(&record[16], 4);
+        name = (signature < signatures_count ? names[signature] : "");
+        if (format == kManifestCsv) {
+            fprintf(out, "%llu.%09llu,", timestamp / 1000000000ULL, timestamp % 1000000000ULL);
+            dump_string(out, name, format);
+            fprintf(out, ",%d.%d.%d.%d,%d,%d.%d.%d.%d,%d,%d,%u\n",
+                    src_addr >> 24, (src_addr >> 16) & 0xff, (src_addr >> 8) & 0xff, src_addr & 0xff, (int)get_le(&record[20], 2),
+                    dst_addr >> 24, (dst_addr >> 16) & 0xff, (dst_addr >> 8) & 0xff, dst_addr & 0xff, (int)get_le(&record[22], 2),
+                    record[28], (unsigned int)get_le(&record[24], 4));
+        } else {
+            fprintf(out, "{\"timestamp\":%llu.%09llu,\"signature\":", timestamp / 1000000000ULL, timestamp % 1000000000ULL);
+            dump_string(out, name, format);
+            fprintf(out, ",\"src_addr\":\"%d.%d.%d.%d\",\"src_port\":%d,\"dst_addr\":\"%d.%d.%d.%d\",\"dst_port\":%d,\"protocol\":%d,\"length\":%u}\n",
+                    src_addr >> 24, (src_addr >> 16) & 0xff, (src_addr >> 8) & 0xff, src_addr & 0xff, (int)get_le(&record[20], 2),
+                    dst_addr >> 24, (dst_addr >> 16) & 0xff, (dst_addr >> 8) & 0xff, dst_addr & 0xff, (int)get_le(&record[22], 2),
+                    record[28], (unsigned int)get_le(&record[24], 4));
+        }
+    }
+    for (s = 0; s < signatures_count; s++) {
+        free(names[s]);
+    }
+    free(names);
+    fclose(fp);
+    return is_ok;
+}
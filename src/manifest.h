@@ -0,0 +1,93 @@
+/*
+ *                                Copyright (C) 2015 by Rafael Santiago
+ *
+ * This is a free software. You can redistribute it and/or modify under
+ * the terms of the GNU General Public License version 2.
+ *
+ */
+#ifndef PIG_MANIFEST_H
+#define PIG_MANIFEST_H 1
+
+#include "types.h"
+#include <stdio.h>
+#include <pthread.h>
+
+#define PIG_MANIFEST_MAGIC "PIGMANIF"
+
+#define PIG_MANIFEST_VERSION 1
+
+#define PIG_MANIFEST_RECORD_SIZE 32
+
+#define PIG_MANIFEST_BUFFER_SIZE 65536
+
+#define PIG_MANIFEST_MAX_WRITERS 128
+
+#define PIG_MANIFEST_IDLE 1000000ULL
+
+typedef enum _pig_manifest_format {
+    kManifestCsv,
+    kManifestJson
+}pig_manifest_format_t;
+
+typedef struct _pig_manifest_record {
+    unsigned long long timestamp;
+    unsigned int signature;
+    unsigned int src_addr;
+    unsigned int dst_addr;
+    unsigned short src_port;
+    unsigned short dst_port;
+    unsigned int length;
+    unsigned char proto;
+    unsigned char writer;
+    unsigned short reserved;
+}pig_manifest_record_ctx;
+
+typedef struct _pig_manifest_buffer {
+    pig_manifest_record_ctx *records;
+    size_t head __attribute__((aligned(64)));
+    unsigned long long dropped;
+    size_t tail __attribute__((aligned(64)));
+    unsigned char writer;
+}pig_manifest_buffer_ctx;
+
+typedef void (*pig_manifest_reader)(const pig_manifest_record_ctx *record, void *arg);
+
+typedef struct _pig_manifest {
+    FILE *fp;
+    unsigned long long id;
+    pigsty_entry_ctx **signatures;
+    size_t signatures_count;
+    pig_signature_index_ctx *index;
+    size_t index_mask;
+    pig_manifest_buffer_ctx *buffers[PIG_MANIFEST_MAX_WRITERS];
+    size_t buffers_nr;
+    pthread_mutex_t lock;
+    unsigned long long orphans;
+    unsigned long long written;
+    pig_manifest_reader reader;
+    void *reader_arg;
+    int has_failed;
+    pthread_t thread;
+    int has_thread;
+    int should_stop;
+}pig_manifest_ctx;
+
+pig_manifest_ctx *mk_pig_manifest(const char *filepath, pigsty_entry_ctx **signatures, const size_t signatures_count);
+
+void del_pig_manifest(pig_manifest_ctx *manifest);
+
+int pig_manifest_start(pig_manifest_ctx *manifest);
+
+void pig_manifest_set_reader(pig_manifest_ctx *manifest, pig_manifest_reader reader, void *arg);
+
+void pig_manifest_append(pig_manifest_ctx *manifest, const pig_frame_ctx *frames, const size_t frames_nr, const unsigned long long timestamp);
+
+size_t pig_manifest_drain(pig_manifest_ctx *manifest);
+
+void pig_manifest_stop(pig_manifest_ctx *manifest);
+
+void pig_manifest_stats(const pig_manifest_ctx *manifest);
+
+int pig_manifest_dump(const char *filepath, const pig_manifest_format_t format, FILE *out);
+
+#endif
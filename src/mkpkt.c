@@ -13,17 +13,25 @@
 #include "udp.h"
 #include "icmp.h"
 #include "mkrnd.h"
+#include "fuzz.h"
+#include "template.h"
+#include "chsum.h"
+#include "slots.h"
 #include <string.h>
 
+static unsigned long long g_pig_pkt_seq = 0;
+
 static void mk_ipv4_dgram(unsigned char *buf, size_t *buf_size, pigsty_conf_set_ctx *conf, pig_target_addr_ctx *addrs);
 
 //static void mk_ipv6_dgram(unsigned char *buf, size_t *buf_size, pigsty_conf_set_ctx *conf);
 
-static void mk_tcp_dgram(unsigned char **buf, size_t *buf_size, pigsty_conf_set_ctx *conf, const unsigned int src_addr[4], const unsigned int dst_addr[4], const int version);
+static size_t mk_tcp_dgram(unsigned char *buf, const size_t buf_capacity, pigsty_conf_set_ctx *conf);
+
+static size_t mk_udp_dgram(unsigned char *buf, const size_t buf_capacity, pigsty_conf_set_ctx *conf);
 
-static void mk_udp_dgram(unsigned char **buf, size_t *buf_size, pigsty_conf_set_ctx *conf, const unsigned int src_addr[4], const unsigned int dst_addr[4], const int version);
+static size_t mk_icmp_dgram(unsigned char *buf, const size_t buf_capacity, pigsty_conf_set_ctx *conf);
 
-static void mk_icmp_dgram(unsigned char **buf, size_t *buf_size, pigsty_conf_set_ctx *conf, const int version);
+static size_t put_payload(unsigned char *buf, const size_t buf_capacity, const unsigned char *payload, const size_t payload_size);
 
 static void mk_default_ipv4(struct ip4 *hdr);
 
@@ -47,12 +55,40 @@ unsigned char *mk_ip_pkt(pigsty_conf_set_ctx *conf, pig_target_addr_ctx *addrs,
     //  }
     // }
     if (version == 4) {
-        retval = (unsigned char *) pig_newseg(0xffff);
+        retval = (unsigned char *) pig_newseg(PIG_IP_PKT_CAPACITY);
         mk_ipv4_dgram(retval, pktsize, conf, addrs);
     }
     return retval;
 }
 
+unsigned char *mk_pigsty_pkt(const pigsty_entry_ctx *signature, pig_target_addr_ctx *addrs, size_t *pktsize) {
+    unsigned char *retval = NULL;
+    unsigned long long seq = 0;
+    if (signature == NULL) {
+        return NULL;
+    }
+    retval = mk_ip_pkt(signature->conf, addrs, pktsize);
+    seq = __sync_fetch_and_add(&g_pig_pkt_seq, 1);
+    if (retval != NULL && signature->slots != NULL) {
+        fill_ip4_slots(signature->slots, signature->slots_nr, retval, *pktsize);
+    }
+    if (retval != NULL && signature->tpl != NULL) {
+        fill_ip4_template(signature->tpl, retval, *pktsize, seq);
+    }
+    if (retval != NULL && signature->fuzz != NULL) {
+        fuzz_ip4_dgram(signature->fuzz, retval, pktsize, PIG_IP_PKT_CAPACITY);
+    }
+    return retval;
+}
+
+unsigned long long get_pig_pkt_seq(void) {
+    return __sync_fetch_and_add(&g_pig_pkt_seq, 0);
+}
+
+void set_pig_pkt_seq(const unsigned long long seq) {
+    __sync_lock_test_and_set(&g_pig_pkt_seq, seq);
+}
+
 static void mk_default_ipv4(struct ip4 *hdr) {
     hdr->version = 4;
     hdr->ihl = 5;
@@ -72,12 +108,8 @@ static void mk_default_ipv4(struct ip4 *hdr) {
 static void mk_ipv4_dgram(unsigned char *buf, size_t *buf_size, pigsty_conf_set_ctx *conf, pig_target_addr_ctx *addrs) {
     pigsty_conf_set_ctx *cp = NULL;
     struct ip4 iph;
-    struct tcp tcph;
-    struct udp udph;
-    char *temp = NULL;
-    unsigned int src_addr[4] = {0, 0, 0, 0};
-    unsigned int dst_addr[4] = {0, 0, 0, 0};
     size_t addrs_count = 0, addr_index = 0;
+    size_t hdr_size = 0, payload_size = 0, chsum_offset = 0;
 
     memset(&iph, 0, sizeof(struct ip4));
     mk_default_ipv4(&iph);
@@ -136,7 +168,7 @@ static void mk_ipv4_dgram(unsigned char *buf, size_t *buf_size, pigsty_conf_set_
                         iph.src = mk_rnd_north_american_ipv4();
                     } else if (strcmp(cp->field->data, "user-defined-ip") == 0) {
                         addrs_count = get_pig_target_addr_count(addrs);
-                        addr_index = rand() % addrs_count;
+                        addr_index = mk_rnd_u32() % addrs_count;
                         iph.src = get_ipv4_pig_target_by_index(addr_index, addrs);
                     }
                 } else {
@@ -156,7 +188,7 @@ static void mk_ipv4_dgram(unsigned char *buf, size_t *buf_size, pigsty_conf_set_
                         iph.dst = mk_rnd_north_american_ipv4();
                     } else if (strcmp(cp->field->data, "user-defined-ip") == 0) {
                         addrs_count = get_pig_target_addr_count(addrs);
-                        addr_index = rand() % addrs_count;
+                        addr_index = mk_rnd_u32() % addrs_count;
                         iph.dst = get_ipv4_pig_target_by_index(addr_index, addrs);
                     }
                 } else {
@@ -177,37 +209,42 @@ static void mk_ipv4_dgram(unsigned char *buf, size_t *buf_size, pigsty_conf_set_
         }
     }
 
+    //  INFO(Santiago): the headers and the payload are written straight into the final buffer.
+    //                  The payload is read from the (interned) signature data and copied only once.
+    hdr_size = (iph.ihl < 5) ? 20 : 4 * iph.ihl;
+    memset(buf, 0, hdr_size);
+
     switch (iph.protocol) {
 
         case 1:
-            mk_icmp_dgram(&iph.payload, &iph.payload_size, conf, 4);
+            payload_size = mk_icmp_dgram(&buf[hdr_size], PIG_IP_PKT_CAPACITY - hdr_size, conf);
             break;
 
         case 6:
-            src_addr[0] = iph.src;
-            dst_addr[0] = iph.dst;
-            mk_tcp_dgram(&iph.payload, &iph.payload_size, conf, src_addr, dst_addr, 4);
+            payload_size = mk_tcp_dgram(&buf[hdr_size], PIG_IP_PKT_CAPACITY - hdr_size, conf);
             break;
 
         case 17:
-            src_addr[0] = iph.src;
-            dst_addr[0] = iph.dst;
-            mk_udp_dgram(&iph.payload, &iph.payload_size, conf, src_addr, dst_addr, 4);
+            payload_size = mk_udp_dgram(&buf[hdr_size], PIG_IP_PKT_CAPACITY - hdr_size, conf);
+            break;
+
+        default:
+            payload_size = put_payload(&buf[hdr_size], PIG_IP_PKT_CAPACITY - hdr_size, iph.payload, iph.payload_size);
             break;
 
     }
 
-    iph.tlen = (4 *  iph.ihl) + iph.payload_size;
+    iph.tlen = hdr_size + payload_size;
     iph.chsum = 0;
-    iph.chsum = eval_ip4_chsum(iph);
-
-    temp = mk_ip4_buffer(&iph, buf_size);
-
-    memcpy(buf, temp, *buf_size % 0xffff);
-    if (iph.payload != NULL) {
-        free(iph.payload);
+    put_ip4_hdr(&iph, buf);
+    *buf_size = iph.tlen;
+
+    chsum_ip4_hdr(buf, *buf_size);
+    chsum_offset = get_ip4_l4_chsum_offset(buf, *buf_size);
+    if (chsum_offset != 0 && buf[chsum_offset] == 0 && buf[chsum_offset + 1] == 0) {
+        //  INFO(Santiago): a transport checksum defined by the user is kept as is.
+        chsum_ip4_l4(buf, *buf_size);
     }
-    free(temp);
 }
 
 //static void mk_ipv6_dgram(unsigned char *buf, size_t *buf_size, pigsty_conf_set_ctx *conf) {
@@ -232,9 +269,10 @@ static void mk_default_tcp(struct tcp *hdr) {
     hdr->payload = NULL;
 }
 
-static void mk_tcp_dgram(unsigned char **buf, size_t *buf_size, pigsty_conf_set_ctx *conf, const unsigned int src_addr[4], const unsigned int dst_addr[4], const int version) {
+static size_t mk_tcp_dgram(unsigned char *buf, const size_t buf_capacity, pigsty_conf_set_ctx *conf) {
     pigsty_conf_set_ctx *cp = NULL;
     struct tcp tcph;
+    size_t hdr_size = 0;
     memset(&tcph, 0, sizeof(struct tcp));
     mk_default_tcp(&tcph);
     for (cp = conf; cp != NULL; cp = cp->next) {
@@ -301,8 +339,7 @@ static void mk_tcp_dgram(unsigned char **buf, size_t *buf_size, pigsty_conf_set_
                 break;
 
             case kTcp_payload:
-                tcph.payload = (unsigned char *)pig_newseg(cp->field->dsize);
-                memcpy(tcph.payload, cp->field->data, cp->field->dsize);
+                tcph.payload = (unsigned char *)cp->field->data;
                 tcph.payload_size = cp->field->dsize;
                 break;
 
@@ -312,20 +349,11 @@ static void mk_tcp_dgram(unsigned char **buf, size_t *buf_size, pigsty_conf_set_
         }
     }
 
-    if (tcph.chsum == 0) {
-        switch (version) {
-
-            case 4:
-                tcph.chsum = eval_tcp_ip4_chsum(tcph, src_addr[0], dst_addr[0]);
-                break;
-
-        }
-    }
+    hdr_size = (tcph.len < 5) ? 20 : 4 * tcph.len;
+    memset(buf, 0, hdr_size);
+    put_tcp_hdr(&tcph, buf);
 
-    (*buf) = mk_tcp_buffer(&tcph, buf_size);
-    if (tcph.payload != NULL) {
-        free(tcph.payload);
-    }
+    return hdr_size + put_payload(&buf[hdr_size], buf_capacity - hdr_size, tcph.payload, tcph.payload_size);
 }
 
 static void mk_default_udp(struct udp *hdr) {
@@ -341,7 +369,7 @@ static void mk_default_udp(struct udp *hdr) {
     hdr->payload_size = 0;
 }
 
-static void mk_udp_dgram(unsigned char **buf, size_t *buf_size, pigsty_conf_set_ctx *conf, const unsigned int src_addr[4], const unsigned int dst_addr[4], const int version) {
+static size_t mk_udp_dgram(unsigned char *buf, const size_t buf_capacity, pigsty_conf_set_ctx *conf) {
     pigsty_conf_set_ctx *cp = NULL;
     struct udp udph;
     memset(&udph, 0, sizeof(struct udp));
@@ -366,8 +394,7 @@ static void mk_udp_dgram(unsigned char **buf, size_t *buf_size, pigsty_conf_set_
                 break;
 
             case kUdp_payload:
-                udph.payload = (unsigned char *)pig_newseg(cp->field->dsize);
-                memcpy(udph.payload, cp->field->data, cp->field->dsize);
+                udph.payload = (unsigned char *)cp->field->data;
                 udph.payload_size = cp->field->dsize;
                 udph.len += udph.payload_size;
                 break;
@@ -378,23 +405,12 @@ static void mk_udp_dgram(unsigned char **buf, size_t *buf_size, pigsty_conf_set_
         }
     }
 
-    if (udph.chsum == 0) {
-        switch (version) {
-
-            case 4:
-                udph.chsum = eval_udp_chsum(udph, src_addr[0], dst_addr[0], udph.len);
-                break;
+    put_udp_hdr(&udph, buf);
 
-        }
-    }
-
-    (*buf) = mk_udp_buffer(&udph, buf_size);
-    if (udph.payload != NULL) {
-        free(udph.payload);
-    }
+    return 8 + put_payload(&buf[8], buf_capacity - 8, udph.payload, udph.payload_size);
 }
 
-static void mk_icmp_dgram(unsigned char **buf, size_t *buf_size, pigsty_conf_set_ctx *conf, const int version) {
+static size_t mk_icmp_dgram(unsigned char *buf, const size_t buf_capacity, pigsty_conf_set_ctx *conf) {
     struct icmp icmph;
     pigsty_conf_set_ctx *cp = NULL;
     memset(&icmph, 0, sizeof(icmph));
@@ -414,8 +430,7 @@ static void mk_icmp_dgram(unsigned char **buf, size_t *buf_size, pigsty_conf_set
                 break;
 
             case kIcmp_payload:
-                icmph.payload = (unsigned char *)pig_newseg(cp->field->dsize);
-                memcpy(icmph.payload, cp->field->data, cp->field->dsize);
+                icmph.payload = (unsigned char *)cp->field->data;
                 icmph.payload_size = cp->field->dsize;
                 break;
 
@@ -425,18 +440,16 @@ static void mk_icmp_dgram(unsigned char **buf, size_t *buf_size, pigsty_conf_set
         }
     }
 
-    if (icmph.chsum == 0) {
-        switch (version) {
+    put_icmp_hdr(&icmph, buf);
 
-            case 4:
-                icmph.chsum = eval_icmp_chsum(icmph);
-                break;
-
-        }
-    }
+    return 4 + put_payload(&buf[4], buf_capacity - 4, icmph.payload, icmph.payload_size);
+}
 
-    (*buf) = mk_icmp_buffer(&icmph, buf_size);
-    if (icmph.payload != NULL) {
-        free(icmph.payload);
+static size_t put_payload(unsigned char *buf, const size_t buf_capacity, const unsigned char *payload, const size_t payload_size) {
+    size_t size = (payload_size < buf_capacity) ? payload_size : buf_capacity;
+    if (payload == NULL || size == 0) {
+        return 0;
     }
+    memcpy(buf, payload, size);
+    return size;
 }
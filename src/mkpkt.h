@@ -11,6 +11,14 @@
 #include "types.h"
 #include <stdlib.h>
 
+#define PIG_IP_PKT_CAPACITY 0xffff
+
 unsigned char *mk_ip_pkt(pigsty_conf_set_ctx *conf, pig_target_addr_ctx *addrs, size_t *pktsize);
 
+unsigned char *mk_pigsty_pkt(const pigsty_entry_ctx *signature, pig_target_addr_ctx *addrs, size_t *pktsize);
+
+unsigned long long get_pig_pkt_seq(void);
+
+void set_pig_pkt_seq(const unsigned long long seq);
+
 #endif
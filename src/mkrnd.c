@@ -7,46 +7,166 @@
  */
 #include "mkrnd.h"
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#define rotl64(x, k) ( ((x) << (k)) | ((x) >> (64 - (k))) )
+
+//  INFO(Santiago): each thread owns its xoshiro256** state, so no lock is taken
+//                  (glibc's rand() locks) and the streams are independent among them.
+static __thread unsigned long long g_rnd_state[4] = { 0, 0, 0, 0 };
 
 static unsigned int mk_rnd_ipv4(const int msb_floor);
 
+static unsigned long long splitmix64(unsigned long long *x);
+
+static unsigned long long mk_rnd_next();
+
+static unsigned long long splitmix64(unsigned long long *x) {
+    unsigned long long z = (*x += 0x9e3779b97f4a7c15ULL);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+}
+
+void mk_rnd_init(const unsigned long long seed, const unsigned int stream) {
+    unsigned long long x = seed;
+    unsigned int s;
+    g_rnd_state[0] = splitmix64(&x);
+    g_rnd_state[1] = splitmix64(&x);
+    g_rnd_state[2] = splitmix64(&x);
+    g_rnd_state[3] = splitmix64(&x);
+    for (s = 0; s < stream; s++) {
+        mk_rnd_jump();
+    }
+}
+
+unsigned long long mk_rnd_mk_seed() {
+    unsigned long long seed = (unsigned long long) time(NULL);
+    seed = (seed << 20) ^ (unsigned long long) getpid() ^ (unsigned long long) clock();
+    return seed;
+}
+
+void mk_rnd_jump() {
+    static const unsigned long long jmp[4] = { 0x180ec6d33cfd0abaULL, 0xd5a61266f0c9392cULL,
+                                               0xa9582618e03fc9aaULL, 0x39abdc4529b1661cULL };
+    unsigned long long s0 = 0, s1 = 0, s2 = 0, s3 = 0;
+    int i, b;
+    for (i = 0; i < 4; i++) {
+        for (b = 0; b < 64; b++) {
+            if (jmp[i] & (1ULL << b)) {
+                s0 ^= g_rnd_state[0];
+                s1 ^= g_rnd_state[1];
+                s2 ^= g_rnd_state[2];
+                s3 ^= g_rnd_state[3];
+            }
+            mk_rnd_next();
+        }
+    }
+    g_rnd_state[0] = s0;
+    g_rnd_state[1] = s1;
+    g_rnd_state[2] = s2;
+    g_rnd_state[3] = s3;
+}
+
+void mk_rnd_get_state(unsigned long long state[4]) {
+    memcpy(state, g_rnd_state, sizeof(g_rnd_state));
+}
+
+void mk_rnd_set_state(const unsigned long long state[4]) {
+    memcpy(g_rnd_state, state, sizeof(g_rnd_state));
+}
+
+static unsigned long long mk_rnd_next() {
+    unsigned long long result, t;
+    if ((g_rnd_state[0] | g_rnd_state[1] | g_rnd_state[2] | g_rnd_state[3]) == 0) {
+        //  WARN(Santiago): an all zero state is a fixed point, a thread that was not
+        //                  explicitly initialized gets an unpredictable seed.
+        mk_rnd_init(mk_rnd_mk_seed() ^ (unsigned long long)(size_t)&g_rnd_state[0], 0);
+    }
+    result = rotl64(g_rnd_state[1] * 5, 7) * 9;
+    t = g_rnd_state[1] << 17;
+    g_rnd_state[2] ^= g_rnd_state[0];
+    g_rnd_state[3] ^= g_rnd_state[1];
+    g_rnd_state[1] ^= g_rnd_state[2];
+    g_rnd_state[0] ^= g_rnd_state[3];
+    g_rnd_state[2] ^= t;
+    g_rnd_state[3] = rotl64(g_rnd_state[3], 45);
+    return result;
+}
+
+void mk_rnd_fill_u32(unsigned int *buf, const size_t count) {
+    size_t c = 0;
+    unsigned long long r;
+    if (buf == NULL) {
+        return;
+    }
+    while (c + 1 < count) {
+        r = mk_rnd_next();
+        buf[c++] = (unsigned int)(r >> 32);
+        buf[c++] = (unsigned int)(r & 0xffffffff);
+    }
+    if (c < count) {
+        buf[c] = (unsigned int)(mk_rnd_next() >> 32);
+    }
+}
+
+void mk_rnd_fill_bytes(unsigned char *buf, const size_t count) {
+    size_t c = 0;
+    unsigned long long r;
+    if (buf == NULL) {
+        return;
+    }
+    while (c + 8 <= count) {
+        r = mk_rnd_next();
+        memcpy(&buf[c], &r, 8);
+        c += 8;
+    }
+    if (c < count) {
+        r = mk_rnd_next();
+        memcpy(&buf[c], &r, count - c);
+    }
+}
+
 unsigned char mk_rnd_u1() {
-    return (rand() & 0x1);
+    return (mk_rnd_next() >> 63);
 }
 
 unsigned char mk_rnd_u3() {
-    return (rand() & 0x7);
+    return (mk_rnd_next() >> 61);
 }
 
 unsigned char mk_rnd_u4() {
-    return (rand() & 0xf);
+    return (mk_rnd_next() >> 60);
 }
 
 unsigned char mk_rnd_u6() {
-    return (rand() & 0x3f);
+    return (mk_rnd_next() >> 58);
 }
 
 unsigned char mk_rnd_u8() {
-    return (rand() & 0xff);
+    return (mk_rnd_next() >> 56);
 }
 
 unsigned short mk_rnd_u13() {
-    return (rand() & 0x1fff);
+    return (mk_rnd_next() >> 51);
 }
 
 unsigned short mk_rnd_u16() {
-    return (rand() & 0xffff);
+    return (mk_rnd_next() >> 48);
 }
 
 unsigned int mk_rnd_u32() {
-    return (rand() & 0xffffffff);
+    return (mk_rnd_next() >> 32);
 }
 
 static unsigned int mk_rnd_ipv4(const int msb_floor) {
-    unsigned char b0 = msb_floor + (rand() % 2);
-    unsigned char b1 = 1 + (rand() % 254);
-    unsigned char b2 = 1 + (rand() % 254);
-    unsigned char b3 = 1 + (rand() % 254);
+    unsigned long long r = mk_rnd_next();
+    unsigned char b0 = msb_floor + (r >> 63);
+    unsigned char b1 = 1 + (((r >> 40) & 0xffff) % 254);
+    unsigned char b2 = 1 + (((r >> 20) & 0xfffff) % 254);
+    unsigned char b3 = 1 + ((r & 0xfffff) % 254);
     return ((unsigned int) b0 << 24) |
            ((unsigned int) b1 << 16) |
            ((unsigned int) b2 <<  8) |
@@ -81,7 +201,7 @@ unsigned int mk_rnd_ipv4_by_mask(const pig_target_addr_ctx *mask) {
 
         case kWild:
             maskval = *(unsigned int *)mask->addr;
-            rnd = rand() % 0xffffff;
+            rnd = mk_rnd_u32();
             retval = maskval;
             if ((maskval & 0xff000000) == 0xff000000) {
                 retval = (rnd & 0xff000000) | (retval & 0x00ffffff);
@@ -104,7 +224,7 @@ unsigned int mk_rnd_ipv4_by_mask(const pig_target_addr_ctx *mask) {
         case kCidr:
             maskval = 0xffffffff;
             maskval = maskval >> mask->cidr_range;
-            retval = 0xffffffff ^ (rand() % maskval);
+            retval = 0xffffffff ^ (mk_rnd_u32() % maskval);
             maskval = *(unsigned int *)mask->addr;
             retval = maskval & retval;
             break;
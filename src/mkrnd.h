@@ -10,6 +10,20 @@
 
 #include "types.h"
 
+void mk_rnd_init(const unsigned long long seed, const unsigned int stream);
+
+unsigned long long mk_rnd_mk_seed();
+
+void mk_rnd_jump();
+
+void mk_rnd_get_state(unsigned long long state[4]);
+
+void mk_rnd_set_state(const unsigned long long state[4]);
+
+void mk_rnd_fill_u32(unsigned int *buf, const size_t count);
+
+void mk_rnd_fill_bytes(unsigned char *buf, const size_t count);
+
 unsigned char mk_rnd_u1();
 
 unsigned char mk_rnd_u3();
@@ -14,10 +14,37 @@
 #include "if.h"
 #include "lists.h"
 #include "linux/native_arp.h"
+#include "pacer.h"
+#include "rtt.h"
+#include "segment.h"
+#include "fragment.h"
 #include <string.h>
 
 #define PIG_ARP_TRIES_NR 1
 
+//  INFO(Santiago): a locally administered address used as source of the frames written to tap devices.
+static const unsigned char PIG_TAP_SRC_HWADDR[6] = { 0x02, 0x70, 0x69, 0x67, 0x00, 0x01 };
+
+typedef enum _pig_cut {
+    kCutNone,
+    kCutSegments,
+    kCutFragments
+}pig_cut_t;
+
+typedef struct _pig_oink_scratch {
+    pig_frame_ctx *segments;
+    size_t segments_size;
+    unsigned char *data;
+    size_t data_size;
+    pig_fragment_ctx *fragments;
+    size_t fragments_size;
+    size_t *ends;
+    size_t ends_size;
+}pig_oink_scratch_ctx;
+
+//  INFO(Santiago): the segments and fragments of a burst are cut into buffers kept by each sending thread.
+static __thread pig_oink_scratch_ctx scratch;
+
 #define pig_get_net_mask_from_addr(a, m) ( ( (a) & (m) ) )
 
 static void fill_up_mac_addresses(struct ethernet_frame *eth, const struct ip4 iph, pig_hwaddr_ctx **hwaddr, const unsigned char *gw_hwaddr, const unsigned int nt_mask[4], const char *loiface);
@@ -26,6 +53,36 @@ static int should_route(const unsigned int addr[4], const unsigned int nt_mask[4
 
 static int is_lopkt(const char *datagram, const size_t datagram_sz);
 
+static int mk_frame(pig_frame_ctx *frame, pig_hwaddr_ctx **hwaddr, const pig_target_addr_ctx *addrs, const unsigned char *gw_hwaddr, const unsigned int nt_mask[4], const char *loiface, pig_budget_ctx *budget);
+
+static int mk_tun_frame(pig_frame_ctx *frame, const pig_target_addr_ctx *addrs, const unsigned char *tap_hwaddr, pig_budget_ctx *budget);
+
+static int inject_lo_frame(pig_frame_ctx *frame);
+
+static int finish_burst(pig_frame_ctx *frames, const size_t frames_nr, pig_budget_ctx *budget, const int owns_packets);
+
+static void send_burst(pig_frame_ctx *frames, const size_t frames_nr, const pig_oink_args_ctx *args, const int sockfd, const unsigned long long gap);
+
+static void send_tun_burst(pig_frame_ctx *frames, const size_t frames_nr, const pig_oink_args_ctx *args, const int tunfd, const unsigned long long gap);
+
+static void watch_frames(pig_frame_ctx *frames, const size_t frames_nr, pig_replies_ctx *replies);
+
+static void settle_frames(const pig_frame_ctx *frames, const size_t frames_nr, pig_replies_ctx *replies, const unsigned long long started_at);
+
+static pig_cut_t get_cut(const pig_frame_ctx *frame, const pig_oink_args_ctx *args, const int is_tun);
+
+static int grow_buffer(void **buf, size_t *size, const size_t wanted, const size_t item_size);
+
+static int grow_scratch(const size_t segments_nr, const size_t data_size, const size_t fragments_nr, const size_t frames_nr);
+
+static int queue_one(const pig_frame_ctx *frame, const pig_oink_args_ctx *args);
+
+static int inject_tun_cut(pig_frame_ctx *frame, const pig_oink_args_ctx *args, const pig_cut_t cut, const int tunfd);
+
+static void inject_by_size(pig_frame_ctx *frames, const size_t frames_nr, const pig_oink_args_ctx *args, const int fd, const int is_tun);
+
+static void log_frames(const pig_frame_ctx *frames, const size_t frames_nr, pig_manifest_ctx *manifest);
+
 static int is_lopkt(const char *datagram, const size_t datagram_sz) {
     int retval = 0;
     unsigned int ip4_addr = 0;
@@ -128,34 +185,442 @@ static void fill_up_mac_addresses(struct ethernet_frame *eth, const struct ip4 i
     memcpy(eth->dest_hw_addr, mac, 6);
 }
 
-int oink(const pigsty_entry_ctx *signature, pig_hwaddr_ctx **hwaddr, const pig_target_addr_ctx *addrs, const int sockfd, const unsigned char *gw_hwaddr, const unsigned int nt_mask[4], const char *loiface) {
-    unsigned char *packet = NULL;
+static int mk_frame(pig_frame_ctx *frame, pig_hwaddr_ctx **hwaddr, const pig_target_addr_ctx *addrs, const unsigned char *gw_hwaddr, const unsigned int nt_mask[4], const char *loiface, pig_budget_ctx *budget) {
     struct ethernet_frame eth;
     struct ip4 iph, *iph_p = &iph;
-    size_t packet_size = 0;
+    frame->sent = 0;
+    frame->is_lo = 0;
+    frame->l2hdr_size = 0;
+    frame->packet = mk_pigsty_pkt(frame->signature, (pig_target_addr_ctx *)addrs, &frame->packet_size);
+    if (frame->packet == NULL) {
+        return -1;
+    }
+    if (!pig_budget_take(budget, frame->packet_size)) {
+        free(frame->packet);
+        frame->packet = NULL;
+        return 0;
+    }
+    if (is_lopkt(frame->packet, frame->packet_size)) {
+        frame->is_lo = 1;
+        return 1;
+    }
+    //  INFO(Santiago): only the IP header is needed to pick the MAC addresses.
+    parse_ip4_dgram(&iph_p, frame->packet, 4 * (frame->packet[0] & 0x0f));
+    eth.ether_type = ETHER_TYPE_IP;
+    fill_up_mac_addresses(&eth, iph, hwaddr, gw_hwaddr, nt_mask, loiface);
+    if (iph.payload != NULL) {
+        free(iph.payload);
+    }
+    memcpy(&frame->l2hdr[0], eth.dest_hw_addr, 6);
+    memcpy(&frame->l2hdr[6], eth.src_hw_addr, 6);
+    frame->l2hdr[12] = (eth.ether_type & 0xff00) >> 8;
+    frame->l2hdr[13] = eth.ether_type & 0x00ff;
+    frame->l2hdr_size = sizeof(frame->l2hdr);
+    return 1;
+}
+
+static int mk_tun_frame(pig_frame_ctx *frame, const pig_target_addr_ctx *addrs, const unsigned char *tap_hwaddr, pig_budget_ctx *budget) {
+    frame->sent = 0;
+    frame->is_lo = 0;
+    frame->l2hdr_size = 0;
+    frame->packet = mk_pigsty_pkt(frame->signature, (pig_target_addr_ctx *)addrs, &frame->packet_size);
+    if (frame->packet == NULL) {
+        return -1;
+    }
+    if (!pig_budget_take(budget, frame->packet_size)) {
+        free(frame->packet);
+        frame->packet = NULL;
+        return 0;
+    }
+    if (tap_hwaddr != NULL) {
+        memcpy(&frame->l2hdr[0], tap_hwaddr, 6);
+        memcpy(&frame->l2hdr[6], PIG_TAP_SRC_HWADDR, 6);
+        frame->l2hdr[12] = (ETHER_TYPE_IP & 0xff00) >> 8;
+        frame->l2hdr[13] = ETHER_TYPE_IP & 0x00ff;
+        frame->l2hdr_size = sizeof(frame->l2hdr);
+    }
+    return 1;
+}
+
+static int inject_lo_frame(pig_frame_ctx *frame) {
+    int sockfd_lo = init_loopback_raw_socket();
     int retval = -1;
-    int sockfd_lo = -1;
-    eth.payload = mk_ip_pkt(signature->conf, (pig_target_addr_ctx *)addrs, &eth.payload_size);
-    if (!is_lopkt(eth.payload, eth.payload_size)) {
-        parse_ip4_dgram(&iph_p, eth.payload, eth.payload_size);
-        eth.ether_type = ETHER_TYPE_IP;
-        fill_up_mac_addresses(&eth, iph, hwaddr, gw_hwaddr, nt_mask, loiface);
-        if (iph.payload != NULL) {
-            free(iph.payload);
-        }
-        packet = mk_ethernet_frame(&packet_size, eth);
-        free(eth.payload);
-        if (packet != NULL) {
-            retval = inject(packet, packet_size, sockfd);
-            free(packet);
+    if (sockfd_lo != -1) {
+        retval = inject_lo(frame->packet, frame->packet_size, sockfd_lo);
+        deinit_raw_socket(sockfd_lo);
+    }
+    frame->sent = (retval != -1);
+    return retval;
+}
+
+static int finish_burst(pig_frame_ctx *frames, const size_t frames_nr, pig_budget_ctx *budget, const int owns_packets) {
+    size_t f = 0;
+    int sent = 0;
+    for (f = 0; f < frames_nr; f++) {
+        if (frames[f].packet == NULL) {
+            continue;
         }
-    } else {
-        sockfd_lo = init_loopback_raw_socket();
-        if (sockfd_lo != -1) {
-            retval = inject_lo(eth.payload, eth.payload_size, sockfd_lo);
-            deinit_raw_socket(sockfd_lo);
+        if (frames[f].sent) {
+            sent++;
+        } else {
+            pig_budget_refund(budget, frames[f].packet_size);
+        }
+        if (owns_packets) {
+            free(frames[f].packet);
         }
-        free(eth.payload);
+        frames[f].packet = NULL;
     }
+    return sent;
+}
+
+int oink(const pigsty_entry_ctx *signature, const pig_oink_args_ctx *args, const int sockfd, pig_budget_ctx *budget) {
+    pig_frame_ctx frame;
+    int retval = -1;
+    frame.signature = signature;
+    retval = mk_frame(&frame, args->hwaddr, args->addrs, args->gw_hwaddr, args->nt_mask, args->loiface, budget);
+    if (retval != 1) {
+        return retval;
+    }
+    if (frame.is_lo) {
+        retval = inject_lo_frame(&frame);
+    } else {
+        frame.sent = 0;
+        inject_by_size(&frame, 1, args, sockfd, 0);
+        retval = (frame.sent ? (int)frame.packet_size : -1);
+    }
+    finish_burst(&frame, 1, budget, 1);
+    return retval;
+}
+
+int oink_tun(const pigsty_entry_ctx *signature, const pig_oink_args_ctx *args, const int tunfd, pig_budget_ctx *budget) {
+    pig_frame_ctx frame;
+    int retval = -1;
+    frame.signature = signature;
+    retval = mk_tun_frame(&frame, args->addrs, args->tap_hwaddr, budget);
+    if (retval != 1) {
+        return retval;
+    }
+    frame.sent = 0;
+    inject_by_size(&frame, 1, args, tunfd, 1);
+    retval = (frame.sent ? (int)frame.packet_size : -1);
+    finish_burst(&frame, 1, budget, 1);
     return retval;
 }
+
+static void watch_frames(pig_frame_ctx *frames, const size_t frames_nr, pig_replies_ctx *replies) {
+    size_t f = 0;
+    if (replies == NULL) {
+        return;
+    }
+    //  INFO(Santiago): written down before going out, a quick reply must find its packet. In a burst the
+    //                  time is settled once the burst is out (see settle_frames()).
+    for (f = 0; f < frames_nr; f++) {
+        if (frames[f].packet != NULL) {
+            pig_replies_stamp(replies, &frames[f]);
+            pig_replies_record(replies, &frames[f]);
+        }
+    }
+}
+
+static void settle_frames(const pig_frame_ctx *frames, const size_t frames_nr, pig_replies_ctx *replies, const unsigned long long started_at) {
+    unsigned long long ended_at = 0;
+    size_t f = 0;
+    if (replies == NULL || !replies->with_rtt) {
+        return;
+    }
+    //  INFO(Santiago): a burst leaves at a steady pace over the injection call, each frame is given the start of
+    //                  its slot instead of the time it was written down (before the whole burst went out).
+    ended_at = pig_wall_clock_ns();
+    for (f = 0; f < frames_nr; f++) {
+        if (frames[f].packet != NULL && frames[f].sent) {
+            pig_replies_sent(replies, &frames[f], started_at + (ended_at - started_at) * f / frames_nr);
+        }
+    }
+}
+
+static void log_frames(const pig_frame_ctx *frames, const size_t frames_nr, pig_manifest_ctx *manifest) {
+    if (manifest != NULL) {
+        pig_manifest_append(manifest, frames, frames_nr, pig_wall_clock_ns());
+    }
+}
+
+static pig_cut_t get_cut(const pig_frame_ctx *frame, const pig_oink_args_ctx *args, const int is_tun) {
+    if (frame->packet == NULL || frame->is_lo) {
+        return kCutNone;
+    }
+    //  INFO(Santiago): a zero fragment size means no fragmentation at all.
+    if (args->fragmenter.size > 0 && get_pig_fragments_nr(frame->packet, frame->packet_size, &args->fragmenter) > 0) {
+        return kCutFragments;
+    }
+    if (args->mss == 0 || get_pig_tcp_hdrs_size(frame->packet, frame->packet_size, args->mss) == 0) {
+        return kCutNone;
+    }
+    if (args->is_gso && !is_tun && is_pig_tcp_gso_dgram(frame->packet, frame->packet_size, args->mss)) {
+        return kCutNone;
+    }
+    return kCutSegments;
+}
+
+static int grow_buffer(void **buf, size_t *size, const size_t wanted, const size_t item_size) {
+    void *temp = NULL;
+    if (wanted <= *size) {
+        return 1;
+    }
+    temp = realloc(*buf, wanted * item_size);
+    if (temp == NULL) {
+        return 0;
+    }
+    *buf = temp;
+    *size = wanted;
+    return 1;
+}
+
+static int grow_scratch(const size_t segments_nr, const size_t data_size, const size_t fragments_nr, const size_t frames_nr) {
+    return (grow_buffer((void **)&scratch.segments, &scratch.segments_size, segments_nr, sizeof(pig_frame_ctx)) &&
+            grow_buffer((void **)&scratch.data, &scratch.data_size, data_size, sizeof(unsigned char)) &&
+            grow_buffer((void **)&scratch.fragments, &scratch.fragments_size, fragments_nr, sizeof(pig_fragment_ctx)) &&
+            grow_buffer((void **)&scratch.ends, &scratch.ends_size, frames_nr, sizeof(size_t)));
+}
+
+static int queue_one(const pig_frame_ctx *frame, const pig_oink_args_ctx *args) {
+    return (args->is_gso ? queue_gso_frame(frame, args->mss) : queue_frame(frame));
+}
+
+static int inject_tun_cut(pig_frame_ctx *frame, const pig_oink_args_ctx *args, const pig_cut_t cut, const int tunfd) {
+    size_t pieces_nr = 0;
+    int sent = 0;
+    if (cut == kCutFragments) {
+        pieces_nr = get_pig_fragments_nr(frame->packet, frame->packet_size, &args->fragmenter);
+        if (!grow_scratch(0, 0, pieces_nr, 0) ||
+            mk_pig_fragments(frame->packet, frame->packet_size, &args->fragmenter, scratch.fragments, pieces_nr) != (int)pieces_nr) {
+            return 0;
+        }
+        sent = inject_tun_fragments(frame, scratch.fragments, pieces_nr, tunfd);
+    } else {
+        pieces_nr = get_pig_tcp_segments_nr(frame->packet, frame->packet_size, args->mss);
+        if (!grow_scratch(pieces_nr, get_pig_tcp_segments_size(frame->packet, frame->packet_size, args->mss), 0, 0) ||
+            mk_pig_tcp_segments(frame, args->mss, scratch.segments, pieces_nr, scratch.data) != (int)pieces_nr) {
+            return 0;
+        }
+        sent = inject_tun_frames(scratch.segments, pieces_nr, tunfd);
+    }
+    //  WARN(Santiago): the original packet only counts as sent when all of its pieces went out.
+    frame->sent = (sent > 0 && (size_t)sent == pieces_nr);
+    return frame->sent;
+}
+
+static void inject_by_size(pig_frame_ctx *frames, const size_t frames_nr, const pig_oink_args_ctx *args, const int fd, const int is_tun) {
+    size_t f = 0, s = 0, pieces_nr = 0, segments_nr = 0, data_size = 0, fragments_nr = 0, msgs_nr = 0, queued = 0;
+    pig_cut_t cut = kCutNone;
+    int sent = 0;
+    if (args->mss == 0 && args->fragmenter.size == 0) {
+        if (is_tun) {
+            inject_tun_frames(frames, frames_nr, fd);
+        } else {
+            inject_frames(frames, frames_nr, fd);
+        }
+        return;
+    }
+    if (is_tun) {
+        //  WARN(Santiago): the tun driver is written frame by frame anyway, only the oversized ones are cut.
+        for (f = 0; f < frames_nr; f++) {
+            if ((cut = get_cut(&frames[f], args, is_tun)) == kCutNone) {
+                inject_tun_frames(&frames[f], 1, fd);
+            } else {
+                inject_tun_cut(&frames[f], args, cut, fd);
+            }
+        }
+        return;
+    }
+    //  INFO(Santiago): the oversized packets are replaced by their segments (or fragments) in the same position
+    //                  of the burst and the whole burst goes down in one batch. The queue points into the scratch,
+    //                  so the room for everything is taken before the first packet is queued.
+    for (f = 0; f < frames_nr; f++) {
+        switch (get_cut(&frames[f], args, is_tun)) {
+            case kCutSegments:
+                pieces_nr = get_pig_tcp_segments_nr(frames[f].packet, frames[f].packet_size, args->mss);
+                segments_nr += pieces_nr;
+                data_size += get_pig_tcp_segments_size(frames[f].packet, frames[f].packet_size, args->mss);
+                break;
+
+            case kCutFragments:
+                pieces_nr = get_pig_fragments_nr(frames[f].packet, frames[f].packet_size, &args->fragmenter);
+                fragments_nr += pieces_nr;
+                break;
+
+            default:
+                pieces_nr = 1;
+                break;
+        }
+        msgs_nr += pieces_nr;
+    }
+    if (!grow_scratch(segments_nr, data_size, fragments_nr, frames_nr) || !reserve_injection_queue(msgs_nr)) {
+        return;
+    }
+    segments_nr = data_size = fragments_nr = 0;
+    for (f = 0; f < frames_nr; f++) {
+        queued = get_injection_queue_size();
+        switch (get_cut(&frames[f], args, is_tun)) {
+            case kCutSegments:
+                pieces_nr = get_pig_tcp_segments_nr(frames[f].packet, frames[f].packet_size, args->mss);
+                if (mk_pig_tcp_segments(&frames[f], args->mss, &scratch.segments[segments_nr], pieces_nr, &scratch.data[data_size]) == (int)pieces_nr) {
+                    for (s = 0; s < pieces_nr; s++) {
+                        queue_one(&scratch.segments[segments_nr + s], args);
+                    }
+                }
+                segments_nr += pieces_nr;
+                data_size += get_pig_tcp_segments_size(frames[f].packet, frames[f].packet_size, args->mss);
+                break;
+
+            case kCutFragments:
+                pieces_nr = get_pig_fragments_nr(frames[f].packet, frames[f].packet_size, &args->fragmenter);
+                if (mk_pig_fragments(frames[f].packet, frames[f].packet_size, &args->fragmenter,
+                                     &scratch.fragments[fragments_nr], pieces_nr) == (int)pieces_nr) {
+                    queue_fragments(&frames[f], &scratch.fragments[fragments_nr], pieces_nr);
+                }
+                fragments_nr += pieces_nr;
+                break;
+
+            default:
+                queue_one(&frames[f], args);
+                break;
+        }
+        //  INFO(Santiago): sendmmsg() sends a prefix of the queue, a packet counts as sent once the last
+        //                  of its pieces went out.
+        scratch.ends[f] = (get_injection_queue_size() > queued ? get_injection_queue_size() : 0);
+    }
+    sent = flush_injection_queue(fd);
+    for (f = 0; f < frames_nr && sent > 0; f++) {
+        if (scratch.ends[f] > 0 && (size_t)sent >= scratch.ends[f]) {
+            frames[f].sent = 1;
+        }
+    }
+}
+
+static void send_burst(pig_frame_ctx *frames, const size_t frames_nr, const pig_oink_args_ctx *args, const int sockfd, const unsigned long long gap) {
+    size_t f = 0;
+    unsigned long long started_at = 0;
+    if (gap == 0) {
+        watch_frames(frames, frames_nr, args->replies);
+        started_at = pig_wall_clock_ns();
+    }
+    for (f = 0; f < frames_nr; f++) {
+        if (frames[f].packet == NULL) {
+            continue;
+        }
+        if (gap > 0) {
+            watch_frames(&frames[f], 1, args->replies);
+        }
+        if (frames[f].is_lo) {
+            inject_lo_frame(&frames[f]);
+        } else if (gap > 0) {
+            inject_by_size(&frames[f], 1, args, sockfd, 0);
+        }
+        if (gap > 0) {
+            log_frames(&frames[f], 1, args->manifest);
+        }
+        if (gap > 0 && f + 1 < frames_nr) {
+            pig_delay_ns(gap);
+        }
+    }
+    if (gap == 0) {
+        inject_by_size(frames, frames_nr, args, sockfd, 0);
+        settle_frames(frames, frames_nr, args->replies, started_at);
+        log_frames(frames, frames_nr, args->manifest);
+    }
+}
+
+static void send_tun_burst(pig_frame_ctx *frames, const size_t frames_nr, const pig_oink_args_ctx *args, const int tunfd, const unsigned long long gap) {
+    size_t f = 0;
+    unsigned long long started_at = 0;
+    if (gap == 0) {
+        watch_frames(frames, frames_nr, args->replies);
+        started_at = pig_wall_clock_ns();
+        inject_by_size(frames, frames_nr, args, tunfd, 1);
+        settle_frames(frames, frames_nr, args->replies, started_at);
+        log_frames(frames, frames_nr, args->manifest);
+        return;
+    }
+    for (f = 0; f < frames_nr; f++) {
+        if (frames[f].packet == NULL) {
+            continue;
+        }
+        watch_frames(&frames[f], 1, args->replies);
+        inject_by_size(&frames[f], 1, args, tunfd, 1);
+        log_frames(&frames[f], 1, args->manifest);
+        if (f + 1 < frames_nr) {
+            pig_delay_ns(gap);
+        }
+    }
+}
+
+int oink_burst(pig_frame_ctx *frames, const size_t frames_nr, const pig_oink_args_ctx *args, const int sockfd, pig_budget_ctx *budget, const unsigned long long gap) {
+    size_t f = 0;
+    for (f = 0; f < frames_nr; f++) {
+        frames[f].packet = NULL;
+        frames[f].sent = 0;
+    }
+    //  INFO(Santiago): all frames are built before the first one goes out, so nothing but the
+    //                  injection itself happens between the frames of a burst.
+    for (f = 0; f < frames_nr && mk_frame(&frames[f], args->hwaddr, args->addrs, args->gw_hwaddr, args->nt_mask, args->loiface, budget) != 0; f++)
+        ;
+    send_burst(frames, frames_nr, args, sockfd, gap);
+    return finish_burst(frames, frames_nr, budget, 1);
+}
+
+int oink_tun_burst(pig_frame_ctx *frames, const size_t frames_nr, const pig_oink_args_ctx *args, const int tunfd, pig_budget_ctx *budget, const unsigned long long gap) {
+    size_t f = 0;
+    for (f = 0; f < frames_nr; f++) {
+        frames[f].packet = NULL;
+        frames[f].sent = 0;
+    }
+    for (f = 0; f < frames_nr && mk_tun_frame(&frames[f], args->addrs, args->tap_hwaddr, budget) != 0; f++)
+        ;
+    send_tun_burst(frames, frames_nr, args, tunfd, gap);
+    return finish_burst(frames, frames_nr, budget, 1);
+}
+
+int oink_mk_frame(pig_frame_ctx *frame, const pig_oink_args_ctx *args) {
+    if (frame == NULL || args == NULL) {
+        return -1;
+    }
+    if (args->is_tun) {
+        return mk_tun_frame(frame, args->addrs, args->tap_hwaddr, NULL);
+    }
+    return mk_frame(frame, args->hwaddr, args->addrs, args->gw_hwaddr, args->nt_mask, args->loiface, NULL);
+}
+
+int oink_ready_burst(pig_frame_ctx *frames, const size_t frames_nr, const int fd, const pig_oink_args_ctx *args, pig_budget_ctx *budget, const unsigned long long gap, const int owns_packets) {
+    size_t f = 0;
+    int is_exhausted = 0;
+    //  INFO(Santiago): here the frames are ready (e.g. taken from a prebuilt pool or built by another
+    //                  thread), they only need to pass through the budget.
+    for (f = 0; f < frames_nr; f++) {
+        frames[f].sent = 0;
+        if (frames[f].packet == NULL) {
+            continue;
+        }
+        if (is_exhausted || !pig_budget_take(budget, frames[f].packet_size)) {
+            is_exhausted = 1;
+            if (owns_packets) {
+                free(frames[f].packet);
+            }
+            frames[f].packet = NULL;
+        }
+    }
+    if (args->is_tun) {
+        send_tun_burst(frames, frames_nr, args, fd, gap);
+    } else {
+        send_burst(frames, frames_nr, args, fd, gap);
+    }
+    return finish_burst(frames, frames_nr, budget, owns_packets);
+}
+
+void oink_release_scratch(void) {
+    free(scratch.segments);
+    free(scratch.data);
+    free(scratch.fragments);
+    free(scratch.ends);
+    memset(&scratch, 0, sizeof(scratch));
+    release_injection_queue();
+}
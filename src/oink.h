@@ -9,7 +9,38 @@
 #define PIG_OINK_H 1
 
 #include "types.h"
+#include "budget.h"
+#include "replies.h"
+#include "manifest.h"
+#include "fragment.h"
 
-int oink(const pigsty_entry_ctx *signature, pig_hwaddr_ctx **hwaddr, const pig_target_addr_ctx *addrs, const int sockfd, const unsigned char *gw_hwaddr, const unsigned int nt_mask[4], const char *loiface);
+typedef struct _pig_oink_args {
+    pig_hwaddr_ctx **hwaddr;
+    const pig_target_addr_ctx *addrs;
+    const unsigned char *gw_hwaddr;
+    const unsigned int *nt_mask;
+    const char *loiface;
+    const unsigned char *tap_hwaddr;
+    int is_tun;
+    pig_replies_ctx *replies;
+    pig_manifest_ctx *manifest;
+    size_t mss;
+    int is_gso;
+    pig_fragmenter_ctx fragmenter;
+}pig_oink_args_ctx;
+
+int oink(const pigsty_entry_ctx *signature, const pig_oink_args_ctx *args, const int sockfd, pig_budget_ctx *budget);
+
+int oink_tun(const pigsty_entry_ctx *signature, const pig_oink_args_ctx *args, const int tunfd, pig_budget_ctx *budget);
+
+int oink_burst(pig_frame_ctx *frames, const size_t frames_nr, const pig_oink_args_ctx *args, const int sockfd, pig_budget_ctx *budget, const unsigned long long gap);
+
+int oink_tun_burst(pig_frame_ctx *frames, const size_t frames_nr, const pig_oink_args_ctx *args, const int tunfd, pig_budget_ctx *budget, const unsigned long long gap);
+
+int oink_mk_frame(pig_frame_ctx *frame, const pig_oink_args_ctx *args);
+
+int oink_ready_burst(pig_frame_ctx *frames, const size_t frames_nr, const int fd, const pig_oink_args_ctx *args, pig_budget_ctx *budget, const unsigned long long gap, const int owns_packets);
+
+void oink_release_scratch(void);
 
 #endif
@@ -0,0 +1,123 @@
+/*
+ *                                Copyright (C) 2015 by Rafael Santiago
+ *
+ * This is a free software. You can redistribute it and/or modify under
+ * the terms of the GNU General Public License version 2.
+ *
+ */
+#include "order.h"
+#include "memory.h"
+#include "mkrnd.h"
+#include <string.h>
+
+//  INFO(Santiago): each sender walks over its own part of the flattened signature array. With
+//                  "sequential" the parts are contiguous blocks and with "round-robin" they are
+//                  interleaved (sender t takes t, t + n, t + 2n, ...). With "shuffle-each-pass"
+//                  the parts are taken as in "round-robin" but reshuffled at the beginning of each pass.
+//                  Anyway, a pass visits every signature of the part exactly once.
+
+static void shuffle_indexes(size_t *indexes, const size_t indexes_nr);
+
+static void shuffle_indexes(size_t *indexes, const size_t indexes_nr) {
+    size_t i = 0, j = 0, temp = 0;
+    for (i = indexes_nr - 1; i > 0; i--) {
+        j = mk_rnd_u32() % (i + 1);
+        temp = indexes[i];
+        indexes[i] = indexes[j];
+        indexes[j] = temp;
+    }
+}
+
+int get_pig_order_mode(const char *name, pig_order_mode_t *mode) {
+    if (name == NULL || strcmp(name, "random") == 0) {
+        *mode = kOrderRandom;
+    } else if (strcmp(name, "sequential") == 0) {
+        *mode = kOrderSequential;
+    } else if (strcmp(name, "round-robin") == 0) {
+        *mode = kOrderRoundRobin;
+    } else if (strcmp(name, "shuffle-each-pass") == 0) {
+        *mode = kOrderShuffle;
+    } else {
+        return 0;
+    }
+    return 1;
+}
+
+pig_order_ctx *mk_pig_order(const pig_order_mode_t mode, const size_t signatures_count, const size_t thread_index, const size_t threads_nr) {
+    pig_order_ctx *order = NULL;
+    size_t first = 0, last = 0, i = 0;
+    if (mode == kOrderRandom || signatures_count == 0 || threads_nr == 0 || thread_index >= threads_nr) {
+        return NULL;
+    }
+    order = (pig_order_ctx *) pig_newseg(sizeof(pig_order_ctx));
+    memset(order, 0, sizeof(pig_order_ctx));
+    order->mode = mode;
+    if (mode == kOrderSequential) {
+        first = thread_index * signatures_count / threads_nr;
+        last = (thread_index + 1) * signatures_count / threads_nr;
+        order->indexes_nr = last - first;
+    } else {
+        order->indexes_nr = signatures_count / threads_nr + (thread_index < (signatures_count % threads_nr));
+    }
+    if (order->indexes_nr == 0) {
+        //  WARN(Santiago): more senders than signatures, some signatures will be shared.
+        order->indexes_nr = 1;
+        order->indexes = (size_t *) pig_newseg(sizeof(size_t));
+        order->indexes[0] = thread_index % signatures_count;
+        return order;
+    }
+    order->indexes = (size_t *) pig_newseg(sizeof(size_t) * order->indexes_nr);
+    for (i = 0; i < order->indexes_nr; i++) {
+        if (mode == kOrderSequential) {
+            order->indexes[i] = first + i;
+        } else {
+            order->indexes[i] = thread_index + i * threads_nr;
+        }
+    }
+    return order;
+}
+
+void del_pig_order(pig_order_ctx *order) {
+    if (order == NULL) {
+        return;
+    }
+    free(order->indexes);
+    free(order);
+}
+
+size_t next_pig_order_index(pig_order_ctx *order) {
+    size_t index = 0;
+    if (order->cursor == 0 && order->mode == kOrderShuffle && order->indexes_nr > 1) {
+        shuffle_indexes(order->indexes, order->indexes_nr);
+    }
+    index = order->indexes[order->cursor];
+    order->cursor = (order->cursor + 1) % order->indexes_nr;
+    return index;
+}
+
+int pig_order_seek(pig_order_ctx *order, const unsigned long long packet_nr) {
+    if (order == NULL) {
+        return 1;
+    }
+    if (order->mode == kOrderShuffle) {
+        //  INFO(Santiago): the permutation of a pass depends on the whole prng history.
+        return 0;
+    }
+    order->cursor = packet_nr % order->indexes_nr;
+    return 1;
+}
+
+size_t pick_pig_signature(pig_order_ctx *order, const pig_profile_point_ctx *mix, const size_t signatures_count) {
+    size_t index = 0, tries = 0;
+    if (order == NULL) {
+        return pick_pig_profile_signature(mix, signatures_count);
+    }
+    //  INFO(Santiago): signatures left out of the current profile mix are skipped.
+    do {
+        index = next_pig_order_index(order);
+    } while (mix != NULL && mix->weights[index] == 0 && ++tries < order->indexes_nr);
+    if (mix != NULL && mix->weights[index] == 0) {
+        index = pick_pig_profile_signature(mix, signatures_count);
+    }
+    return index;
+}
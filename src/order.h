@@ -0,0 +1,40 @@
+/*
+ *                                Copyright (C) 2015 by Rafael Santiago
+ *
+ * This is a free software. You can redistribute it and/or modify under
+ * the terms of the GNU General Public License version 2.
+ *
+ */
+#ifndef PIG_ORDER_H
+#define PIG_ORDER_H 1
+
+#include "profile.h"
+#include <stdlib.h>
+
+typedef enum _pig_order_mode {
+    kOrderRandom,
+    kOrderSequential,
+    kOrderRoundRobin,
+    kOrderShuffle
+}pig_order_mode_t;
+
+typedef struct _pig_order {
+    pig_order_mode_t mode;
+    size_t *indexes;
+    size_t indexes_nr;
+    size_t cursor;
+}pig_order_ctx;
+
+int get_pig_order_mode(const char *name, pig_order_mode_t *mode);
+
+pig_order_ctx *mk_pig_order(const pig_order_mode_t mode, const size_t signatures_count, const size_t thread_index, const size_t threads_nr);
+
+void del_pig_order(pig_order_ctx *order);
+
+size_t next_pig_order_index(pig_order_ctx *order);
+
+int pig_order_seek(pig_order_ctx *order, const unsigned long long packet_nr);
+
+size_t pick_pig_signature(pig_order_ctx *order, const pig_profile_point_ctx *mix, const size_t signatures_count);
+
+#endif
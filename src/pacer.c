@@ -0,0 +1,178 @@
+/*
+ *                                Copyright (C) 2015 by Rafael Santiago
+ *
+ * This is a free software. You can redistribute it and/or modify under
+ * the terms of the GNU General Public License version 2.
+ *
+ */
+#include "pacer.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+static void account_deadline(pig_pacer_ctx *pacer, const unsigned long long lateness);
+
+static void account_deadline(pig_pacer_ctx *pacer, const unsigned long long lateness) {
+    unsigned long long max = 0;
+    //  INFO(Santiago): several senders may share the same pacer.
+    __sync_fetch_and_add(&pacer->deadlines, 1);
+    __sync_fetch_and_add(&pacer->lateness_sum, lateness);
+    if (lateness > PIG_PACER_MISS_TOLERANCE) {
+        __sync_fetch_and_add(&pacer->missed, 1);
+    }
+    do {
+        max = __atomic_load_n(&pacer->lateness_max, __ATOMIC_RELAXED);
+    } while (lateness > max && !__sync_bool_compare_and_swap(&pacer->lateness_max, max, lateness));
+}
+
+unsigned long long pig_clock_ns() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((unsigned long long)ts.tv_sec * 1000000000ULL + (unsigned long long)ts.tv_nsec);
+}
+
+void pig_sleep_ns(const unsigned long long ns) {
+    struct timespec ts;
+    if (ns == 0) {
+        return;
+    }
+    ts.tv_sec = ns / 1000000000ULL;
+    ts.tv_nsec = ns % 1000000000ULL;
+    //  INFO(Santiago): a signal (e.g. SIGINT or SIGTERM) cuts the sleep short on purpose, the caller
+    //                  checks whether it should exit before sleeping again.
+    nanosleep(&ts, NULL);
+}
+
+void pig_sleep_until_ns(const unsigned long long t) {
+    struct timespec ts;
+    ts.tv_sec = t / 1000000000ULL;
+    ts.tv_nsec = t % 1000000000ULL;
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+}
+
+void pig_delay_ns(const unsigned long long ns) {
+    unsigned long long deadline = 0;
+    //  INFO(Santiago): a sleep rarely wakes up sooner than some tens of microseconds, so short delays
+    //                  (e.g. the spacing inside a burst) are done by spinning on the clock.
+    if (ns > PIG_PACER_SPIN_LIMIT) {
+        pig_sleep_ns(ns);
+        return;
+    }
+    deadline = pig_clock_ns() + ns;
+    while (pig_clock_ns() < deadline)
+        ;
+}
+
+void pig_pacer_init(pig_pacer_ctx *pacer) {
+    if (pacer == NULL) {
+        return;
+    }
+    memset(pacer, 0, sizeof(pig_pacer_ctx));
+    pacer->start = pig_clock_ns();
+    pacer->next = pacer->start;
+}
+
+unsigned long long pig_pacer_elapsed(const pig_pacer_ctx *pacer) {
+    if (pacer == NULL) {
+        return 0;
+    }
+    return (pig_clock_ns() - pacer->start);
+}
+
+void pig_pacer_wait(pig_pacer_ctx *pacer, const double rate) {
+    unsigned long long now = 0;
+    if (pacer == NULL || rate <= 0.0) {
+        return;
+    }
+    now = pig_clock_ns();
+    if (pacer->next > now) {
+        pig_sleep_ns(pacer->next - now);
+    } else if (now - pacer->next > PIG_PACER_MAX_LAG) {
+        //  INFO(Santiago): we are too late (the process was stopped or the rate is beyond what
+        //                  we can deliver). Instead of bursting to catch up, let's restart the schedule.
+        pacer->next = now;
+    }
+    //  INFO(Santiago): the deadlines are absolute, so the sleeping jitter does not accumulate.
+    pacer->next += (unsigned long long)(1000000000.0 / rate);
+}
+
+int pig_pacer_wait_until(pig_pacer_ctx *pacer, const unsigned long long deadline) {
+    unsigned long long elapsed = 0;
+    if (pacer == NULL) {
+        return 0;
+    }
+    elapsed = pig_pacer_elapsed(pacer);
+    if (deadline > elapsed) {
+        //  INFO(Santiago): an absolute wake-up does not stretch when the thread is preempted between
+        //                  reading the clock and going to sleep.
+        if (pacer->is_absolute) {
+            pig_sleep_until_ns(pacer->start + deadline);
+        } else {
+            pig_sleep_ns(deadline - elapsed);
+        }
+        elapsed = pig_pacer_elapsed(pacer);
+    }
+    account_deadline(pacer, (elapsed > deadline ? elapsed - deadline : 0));
+    return (elapsed <= deadline || (elapsed - deadline) <= PIG_PACER_MAX_LAG);
+}
+
+void pig_pacer_tick(pig_pacer_ctx *pacer, unsigned long long *ticks, const unsigned long long period, const unsigned long long time_left) {
+    unsigned long long deadline = 0, elapsed = 0;
+    if (pacer == NULL || ticks == NULL || period == 0) {
+        return;
+    }
+    //  INFO(Santiago): the k-th tick is due at k * period from the start, so neither the time spent
+    //                  sending nor the wake-up jitter make the schedule drift.
+    (*ticks)++;
+    deadline = (*ticks) * period;
+    elapsed = pig_pacer_elapsed(pacer);
+    if (deadline > elapsed && (deadline - elapsed) > time_left) {
+        pig_sleep_ns(time_left);
+        return;
+    }
+    if (!pig_pacer_wait_until(pacer, deadline)) {
+        *ticks = pig_pacer_elapsed(pacer) / period;
+    }
+}
+
+void pig_pacer_summary(const pig_pacer_ctx *pacer) {
+    if (pacer == NULL || pacer->deadlines == 0) {
+        return;
+    }
+    printf("pig INFO: %llu deadline(s), %llu missed by more than %lluus (%.2f%%), %.1fus late on average, %.1fus at worst.\n",
+           pacer->deadlines, pacer->missed, PIG_PACER_MISS_TOLERANCE / 1000ULL, 100.0 * (double)pacer->missed / (double)pacer->deadlines,
+           (double)pacer->lateness_sum / (double)pacer->deadlines / 1000.0, (double)pacer->lateness_max / 1000.0);
+}
+
+int parse_pig_time(const char *token, unsigned long long *t) {
+    double value = 0, hh = 0, mm = 0, ss = 0;
+    char *end = NULL;
+    const char *colon = strchr(token, ':');
+    if (colon != NULL) {
+        if (sscanf(token, "%lf:%lf:%lf", &hh, &mm, &ss) < 2 || hh < 0 || mm < 0 || ss < 0) {
+            return 0;
+        }
+        *t = (unsigned long long)((hh * 3600.0 + mm * 60.0 + ss) * 1000000000.0);
+        return 1;
+    }
+    value = strtod(token, &end);
+    if (end == token || value < 0) {
+        return 0;
+    }
+    if (*end == 0 || strcmp(end, "s") == 0) {
+        value *= 1000000000.0;
+    } else if (strcmp(end, "ms") == 0) {
+        value *= 1000000.0;
+    } else if (strcmp(end, "us") == 0) {
+        value *= 1000.0;
+    } else if (strcmp(end, "m") == 0) {
+        value *= 60000000000.0;
+    } else if (strcmp(end, "h") == 0) {
+        value *= 3600000000000.0;
+    } else if (strcmp(end, "ns") != 0) {
+        return 0;
+    }
+    *t = (unsigned long long)value;
+    return 1;
+}
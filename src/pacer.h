@@ -0,0 +1,49 @@
+/*
+ *                                Copyright (C) 2015 by Rafael Santiago
+ *
+ * This is a free software. You can redistribute it and/or modify under
+ * the terms of the GNU General Public License version 2.
+ *
+ */
+#ifndef PIG_PACER_H
+#define PIG_PACER_H 1
+
+#define PIG_PACER_MAX_LAG 1000000000ULL
+
+#define PIG_PACER_SPIN_LIMIT 200000ULL
+
+#define PIG_PACER_MISS_TOLERANCE 100000ULL
+
+typedef struct _pig_pacer {
+    unsigned long long start;
+    unsigned long long next;
+    int is_absolute;
+    unsigned long long deadlines;
+    unsigned long long missed;
+    unsigned long long lateness_sum;
+    unsigned long long lateness_max;
+}pig_pacer_ctx;
+
+int parse_pig_time(const char *token, unsigned long long *t);
+
+unsigned long long pig_clock_ns();
+
+void pig_sleep_ns(const unsigned long long ns);
+
+void pig_sleep_until_ns(const unsigned long long t);
+
+void pig_delay_ns(const unsigned long long ns);
+
+void pig_pacer_init(pig_pacer_ctx *pacer);
+
+unsigned long long pig_pacer_elapsed(const pig_pacer_ctx *pacer);
+
+void pig_pacer_wait(pig_pacer_ctx *pacer, const double rate);
+
+int pig_pacer_wait_until(pig_pacer_ctx *pacer, const unsigned long long deadline);
+
+void pig_pacer_tick(pig_pacer_ctx *pacer, unsigned long long *ticks, const unsigned long long period, const unsigned long long time_left);
+
+void pig_pacer_summary(const pig_pacer_ctx *pacer);
+
+#endif
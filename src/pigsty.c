@@ -11,6 +11,9 @@
 #include "to_int.h"
 #include "to_voidp.h"
 #include "to_str.h"
+#include "fuzz.h"
+#include "template.h"
+#include "slots.h"
 #include <stdio.h>
 #include <string.h>
 
@@ -56,6 +59,8 @@ static int verify_u16(const char *buffer);
 
 static int verify_u32(const char *buffer);
 
+static int verify_fuzz_strategy(const char *buffer);
+
 static int get_pigsty_field_index(const char *field);
 
 static int verify_int(const char *buffer);
@@ -117,13 +122,17 @@ static struct signature_fields SIGNATURE_FIELDS[] = {
     {    "icmp.code",     kIcmp_code,         verify_u8},
     {"icmp.checksum", kIcmp_checksum,        verify_u16},
     { "icmp.payload",  kIcmp_payload,     verify_string},
-    {    "signature",     kSignature,     verify_string}
+    {    "signature",     kSignature,     verify_string},
+    {"fuzz.strategy", kFuzz_strategy, verify_fuzz_strategy},
+    {"fuzz.dictionary", kFuzz_dictionary, verify_string},
+    {"fuzz.intensity", kFuzz_intensity,     verify_u8}
 };
 
 static const size_t SIGNATURE_FIELDS_SIZE = sizeof(SIGNATURE_FIELDS) / sizeof(SIGNATURE_FIELDS[0]);
 
 pigsty_entry_ctx *load_pigsty_data_from_file(pigsty_entry_ctx *entry, const char *filepath) {
     char *data = get_pigsty_file_data(filepath);
+    pigsty_entry_ctx *e = NULL;
     if (data != NULL) {
         if (!compile_pigsty_buffer(data)) {
             printf("pig PANIC: invalid signature detected, fix it and try again.\n");
@@ -133,6 +142,15 @@ pigsty_entry_ctx *load_pigsty_data_from_file(pigsty_entry_ctx *entry, const char
         }
         entry = make_pigsty_data_from_loaded_data(entry, data);
         free(data);
+        for (e = entry; e != NULL; e = e->next) {
+            if (e->tpl == NULL) {
+                e->tpl = mk_pig_template(e->conf);
+            }
+            if (e->fuzz == NULL) {
+                e->fuzz = mk_pig_fuzz(e->conf);
+            }
+            intern_pigsty_conf_set_payloads(e->conf);
+        }
     } else {
         printf("pig PANIC: some i/o error happened.\n");
         del_pigsty_entry(entry);
@@ -244,6 +262,8 @@ static pigsty_entry_ctx *mk_pigsty_entry_from_compiled_buffer(pigsty_entry_ctx *
     pigsty_entry_ctx *entry_p = NULL;
     int field_index = 0;
     size_t sz = 0;
+    pig_field_t modifier = kUnk;
+    unsigned int param = 0;
     token = get_next_pigsty_word(tmp_buffer, next);
     while (**next != 0 && signature_name == NULL) {
         if (strcmp(token, "signature") == 0) {
@@ -283,7 +303,11 @@ static pigsty_entry_ctx *mk_pigsty_entry_from_compiled_buffer(pigsty_entry_ctx *
                 tmp_buffer = *next;
                 data = get_next_pigsty_word(tmp_buffer, next);
                 if (data != NULL) {
-                    if (verify_int(data) || verify_hex(data)) {
+                    if (get_pig_slot_modifier(data, &modifier, &param)) {
+                        //  INFO(Santiago): the field is built as zero and rewritten by its dynamic slot.
+                        add_pig_slot_to_pigsty_entry(entry_p, field_index, modifier, param);
+                        fmt_data = int_to_voidp("0", &fmt_dsize);
+                    } else if (verify_int(data) || verify_hex(data)) {
                         fmt_data = int_to_voidp(data, &fmt_dsize);
                     } else if (verify_ipv4_addr(data)) {
                         fmt_data = ipv4_to_voidp(data, &fmt_dsize);
@@ -317,6 +341,8 @@ static int compile_next_buffered_pigsty_entry(char *buffer, char **next) {
     int state = 0;
     unsigned char field_map[SIGNATURE_FIELDS_SIZE];
     int field_index = 0;
+    pig_field_t modifier = kUnk;
+    unsigned int param = 0;
     memset(field_map, 0, sizeof(field_map));
     if (*token == 0) {
         return 1;
@@ -357,7 +383,13 @@ static int compile_next_buffered_pigsty_entry(char *buffer, char **next) {
                 break;
 
             case 2:  //  field data verifying
-                if (SIGNATURE_FIELDS[field_index].verifier != NULL) {
+                if (get_pig_slot_modifier(token, &modifier, &param)) {
+                    if (!is_pig_slot_field(field_index)) {
+                        printf("pig PANIC: field \"%s\" does not accept \"%s\".\n", SIGNATURE_FIELDS[field_index].label, token);
+                        free(token);
+                        return 0;
+                    }
+                } else if (SIGNATURE_FIELDS[field_index].verifier != NULL) {
                     all_ok = SIGNATURE_FIELDS[field_index].verifier(token);
                     if (!all_ok) {
                         printf("pig PANIC: field \"%s\" has invalid data (\"%s\").\n", SIGNATURE_FIELDS[field_index].label, token);
@@ -491,6 +523,14 @@ static int verify_u32(const char *buffer) {
     return (retval >= 0x0 && retval <= 0xffffffff);
 }
 
+static int verify_fuzz_strategy(const char *buffer) {
+    unsigned int strategies = 0;
+    if (!verify_string(buffer)) {
+        return 0;
+    }
+    return get_fuzz_strategies(buffer + 1, strlen(buffer) - 2, &strategies);
+}
+
 int verify_ipv4_addr(const char *buffer) {
     int retval = 1;
     const char *b = buffer;
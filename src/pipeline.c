@@ -0,0 +1,372 @@
+/*
+ *                                Copyright (C) 2015 by Rafael Santiago
+ *
+ * This is a free software. You can redistribute it and/or modify under
+ * the terms of the GNU General Public License version 2.
+ *
+ */
+#include "pipeline.h"
+#include "lists.h"
+#include "memory.h"
+#include "mkrnd.h"
+#include <stdio.h>
+#include <string.h>
+#include <sched.h>
+
+//  INFO(Santiago): the generators build frames and push them into their own rings, the senders
+//                  pop them and inject. The generator i feeds the sender (i % senders), so each
+//                  ring has exactly one producer and one consumer. When a ring is full the generator
+//                  waits (backpressure), when the rings are empty the sender waits.
+
+static int should_pipeline_stop(pig_pipeline_ctx *pipeline);
+
+static void stop_pipeline(pig_pipeline_ctx *pipeline);
+
+static void *generate_frames(void *arg);
+
+static size_t gather_burst(pig_sender_ctx *sender, pig_frame_ctx *frames, size_t *ring_index);
+
+static int wait_burst_deadline(pig_sender_ctx *sender);
+
+static void *send_frames(void *arg);
+
+static void print_placement(const pig_pipeline_ctx *pipeline);
+
+static int should_pipeline_stop(pig_pipeline_ctx *pipeline) {
+    return (__atomic_load_n(&pipeline->should_stop, __ATOMIC_ACQUIRE) ||
+            (pipeline->should_exit != NULL && *(volatile int *)pipeline->should_exit));
+}
+
+static void stop_pipeline(pig_pipeline_ctx *pipeline) {
+    __atomic_store_n(&pipeline->should_stop, 1, __ATOMIC_RELEASE);
+}
+
+pig_pipeline_ctx *mk_pig_pipeline(const size_t generators_nr, const size_t senders_nr, const size_t ring_size) {
+    pig_pipeline_ctx *pipeline = NULL;
+    size_t t = 0;
+    if (generators_nr == 0 || generators_nr > PIG_PIPELINE_MAX_THREADS ||
+        senders_nr == 0 || senders_nr > generators_nr || ring_size < 2) {
+        return NULL;
+    }
+    pipeline = (pig_pipeline_ctx *) pig_newseg(sizeof(pig_pipeline_ctx));
+    memset(pipeline, 0, sizeof(pig_pipeline_ctx));
+    pipeline->generators_nr = generators_nr;
+    pipeline->senders_nr = senders_nr;
+    pipeline->ring_size = ring_size;
+    pipeline->burst_size = 1;
+    pipeline->generators = (pig_generator_ctx *) pig_newseg(sizeof(pig_generator_ctx) * generators_nr);
+    memset(pipeline->generators, 0, sizeof(pig_generator_ctx) * generators_nr);
+    pipeline->senders = (pig_sender_ctx *) pig_newseg(sizeof(pig_sender_ctx) * senders_nr);
+    memset(pipeline->senders, 0, sizeof(pig_sender_ctx) * senders_nr);
+    for (t = 0; t < generators_nr; t++) {
+        pipeline->generators[t].index = t;
+        pipeline->generators[t].pipeline = pipeline;
+        pipeline->generators[t].ring = mk_pig_spsc_ring(ring_size);
+        pipeline->generators[t].cpu = -1;
+    }
+    for (t = 0; t < senders_nr; t++) {
+        pipeline->senders[t].index = t;
+        pipeline->senders[t].pipeline = pipeline;
+        pipeline->senders[t].cpu = -1;
+    }
+    return pipeline;
+}
+
+void del_pig_pipeline(pig_pipeline_ctx *pipeline) {
+    pig_frame_ctx frame;
+    size_t t = 0;
+    if (pipeline == NULL) {
+        return;
+    }
+    for (t = 0; t < pipeline->generators_nr; t++) {
+        //  INFO(Santiago): the frames built but not sent are still in the rings.
+        while (pig_spsc_pop(pipeline->generators[t].ring, &frame, 1) == 1) {
+            free(frame.packet);
+        }
+        del_pig_spsc_ring(pipeline->generators[t].ring);
+        del_pig_hwaddr(pipeline->generators[t].hwaddr);
+    }
+    free(pipeline->generators);
+    free(pipeline->senders);
+    free(pipeline);
+}
+
+static void *generate_frames(void *arg) {
+    pig_generator_ctx *generator = (pig_generator_ctx *)arg;
+    pig_pipeline_ctx *pipeline = generator->pipeline;
+    pig_order_ctx *order = NULL;
+    const pig_profile_point_ctx *mix = NULL;
+    pig_frame_ctx frame;
+    unsigned long long deadline = 0;
+    size_t signature_index = 0, train_left = 0;
+    if (generator->cpu >= 0) {
+        pig_pin_thread_to(pthread_self(), generator->cpu);
+    }
+    mk_rnd_init(pipeline->seed, 1 + generator->index);
+    order = mk_pig_order(pipeline->order_mode, pipeline->signatures_count, generator->index, pipeline->generators_nr);
+    generator->args = pipeline->args;
+    generator->args.hwaddr = &generator->hwaddr;
+    while (!should_pipeline_stop(pipeline)) {
+        if (train_left > 0) {
+            train_left--;
+        } else {
+            if (pipeline->profile != NULL) {
+                get_pig_profile_deadline(pipeline->profile, get_pig_profile_packets(pipeline->profile, pig_pacer_elapsed(&pipeline->pacer)), &deadline, &mix);
+            }
+            signature_index = pick_pig_signature(order, mix, pipeline->signatures_count);
+            train_left = (pipeline->is_train ? pipeline->burst_size - 1 : 0);
+        }
+        frame.signature = pipeline->signatures[signature_index];
+        if (oink_mk_frame(&frame, &generator->args) != 1) {
+            continue;
+        }
+        while (!pig_spsc_push(generator->ring, &frame)) {
+            if (should_pipeline_stop(pipeline)) {
+                free(frame.packet);
+                del_pig_order(order);
+                return NULL;
+            }
+            sched_yield();
+        }
+        generator->generated++;
+    }
+    del_pig_order(order);
+    return NULL;
+}
+
+static size_t gather_burst(pig_sender_ctx *sender, pig_frame_ctx *frames, size_t *ring_index) {
+    pig_pipeline_ctx *pipeline = sender->pipeline;
+    size_t got = 0, r = 0, polled = 0;
+    //  INFO(Santiago): in train mode the whole burst comes from one ring, so the train is not broken.
+    r = *ring_index;
+    while (got < pipeline->burst_size && !should_pipeline_stop(pipeline)) {
+        got += pig_spsc_pop(pipeline->generators[r].ring, &frames[got], pipeline->burst_size - got);
+        if (got == pipeline->burst_size) {
+            break;
+        }
+        if (!pipeline->is_train || got == 0) {
+            r += pipeline->senders_nr;
+            if (r >= pipeline->generators_nr) {
+                r = sender->index;
+            }
+        }
+        if (++polled % (pipeline->generators_nr / pipeline->senders_nr + 1) == 0) {
+            //  INFO(Santiago): a SCHED_FIFO sender only yields to other real-time threads, so
+            //                  it must really sleep to let the generators run.
+            if (pipeline->is_realtime) {
+                pig_sleep_ns(PIG_PIPELINE_RT_IDLE);
+            } else {
+                sched_yield();
+            }
+        }
+    }
+    r += pipeline->senders_nr;
+    *ring_index = (r >= pipeline->generators_nr ? sender->index : r);
+    return got;
+}
+
+static int wait_burst_deadline(pig_sender_ctx *sender) {
+    pig_pipeline_ctx *pipeline = sender->pipeline;
+    unsigned long long packet_nr = 0, deadline = 0, elapsed = 0, tick = 0;
+    if (pipeline->arrivals != NULL) {
+        deadline = pig_arrival_stream_advance(&sender->arrival);
+        elapsed = pig_pacer_elapsed(&pipeline->pacer);
+        if (deadline > elapsed && (deadline - elapsed) > get_pig_budget_time_left(pipeline->budget)) {
+            return 0;
+        }
+        if (!pig_pacer_wait_until(&pipeline->pacer, deadline) && sender->arrival.next < pig_pacer_elapsed(&pipeline->pacer)) {
+            sender->arrival.next = pig_pacer_elapsed(&pipeline->pacer);
+        }
+        return 1;
+    }
+    if (pipeline->profile == NULL && pipeline->timeout > 0) {
+        //  INFO(Santiago): the senders share one schedule, the k-th burst of the whole pipeline is due at
+        //                  k * timeout, so adding senders does not multiply the rate.
+        tick = __sync_fetch_and_add(&pipeline->ticks, 1);
+        deadline = tick * pipeline->timeout;
+        elapsed = pig_pacer_elapsed(&pipeline->pacer);
+        if (deadline > elapsed && (deadline - elapsed) > get_pig_budget_time_left(pipeline->budget)) {
+            return 0;
+        }
+        if (!pig_pacer_wait_until(&pipeline->pacer, deadline)) {
+            __atomic_store_n(&pipeline->ticks, pig_pacer_elapsed(&pipeline->pacer) / pipeline->timeout + 1, __ATOMIC_RELEASE);
+        }
+        return 1;
+    }
+    if (pipeline->profile == NULL) {
+        return 1;
+    }
+    do {
+        packet_nr = __sync_fetch_and_add(&pipeline->packet_nr, pipeline->burst_size);
+        if (!get_pig_profile_deadline(pipeline->profile, (double)packet_nr, &deadline, NULL)) {
+            return 0;
+        }
+        elapsed = pig_pacer_elapsed(&pipeline->pacer);
+        if (deadline > elapsed && (deadline - elapsed) > get_pig_budget_time_left(pipeline->budget)) {
+            return 0;
+        }
+        if (!pig_pacer_wait_until(&pipeline->pacer, deadline)) {
+            //  INFO(Santiago): too far behind the schedule, the late packets are dropped.
+            __atomic_store_n(&pipeline->packet_nr, (unsigned long long)get_pig_profile_packets(pipeline->profile, pig_pacer_elapsed(&pipeline->pacer)), __ATOMIC_RELEASE);
+            continue;
+        }
+        return 1;
+    } while (!should_pipeline_stop(pipeline));
+    return 0;
+}
+
+static void *send_frames(void *arg) {
+    pig_sender_ctx *sender = (pig_sender_ctx *)arg;
+    pig_pipeline_ctx *pipeline = sender->pipeline;
+    pig_frame_ctx *frames = NULL;
+    size_t ring_index = sender->index, got = 0, f = 0;
+    if (sender->cpu >= 0) {
+        pig_pin_thread_to(pthread_self(), sender->cpu);
+    }
+    if (pipeline->is_realtime && !pig_set_realtime(pthread_self(), pipeline->rt_priority)) {
+        printf("pig PANIC: unable to switch the sender #%zu to SCHED_FIFO.\n", sender->index);
+        pipeline->has_failed = 1;
+        stop_pipeline(pipeline);
+        return NULL;
+    }
+    frames = (pig_frame_ctx *) pig_newseg(sizeof(pig_frame_ctx) * pipeline->burst_size);
+    //  INFO(Santiago): each sender follows its own arrival process, like it would keep its own timeout.
+    mk_rnd_init(pipeline->seed, 1 + 2 * PIG_PIPELINE_MAX_THREADS + sender->index);
+    if (pipeline->arrivals != NULL) {
+        pig_arrival_stream_init(&sender->arrival, pipeline->arrivals->streams[0].dist, -1, 0);
+    }
+    while (!should_pipeline_stop(pipeline) && !is_pig_budget_exhausted(pipeline->budget)) {
+        if (!wait_burst_deadline(sender)) {
+            break;
+        }
+        got = gather_burst(sender, frames, &ring_index);
+        if (got == 0) {
+            continue;
+        }
+        oink_ready_burst(frames, got, pipeline->fd, &pipeline->args, pipeline->budget, pipeline->burst_gap, 1);
+        sender->bursts++;
+        for (f = 0; f < got && !pipeline->is_quiet; f++) {
+            if (frames[f].sent) {
+                printf("pig INFO: a packet based on signature \"%s\" was sent.\n", frames[f].signature->signature_name);
+            }
+        }
+    }
+    stop_pipeline(pipeline);
+    free(frames);
+    oink_release_scratch();
+    return NULL;
+}
+
+int pig_pipeline_place(pig_pipeline_ctx *pipeline, const pig_cpu_set_ctx *cpus, const int numa_node) {
+    pig_cpu_set_ctx order, local, used;
+    size_t t = 0, first = 0;
+    if (pipeline == NULL || cpus == NULL || cpus->cpus_nr == 0) {
+        return 0;
+    }
+    //  INFO(Santiago): the senders touch the NIC, so they take the CPUs of its NUMA node first. The generators
+    //                  take the next CPUs, staying as near as possible of their senders. When there are fewer
+    //                  CPUs than threads the CPUs are shared in round-robin.
+    memcpy(&order, cpus, sizeof(pig_cpu_set_ctx));
+    if (get_pig_numa_node_cpus(numa_node, &local)) {
+        pig_cpus_local_first(&order, &local);
+    }
+    used.cpus_nr = 0;
+    for (t = 0; t < pipeline->senders_nr; t++) {
+        pipeline->senders[t].cpu = order.cpus[t % order.cpus_nr];
+        used.cpus[used.cpus_nr++] = pipeline->senders[t].cpu;
+    }
+    first = (pipeline->senders_nr < order.cpus_nr ? pipeline->senders_nr : 0);
+    for (t = 0; t < pipeline->generators_nr; t++) {
+        pipeline->generators[t].cpu = order.cpus[first + t % (order.cpus_nr - first)];
+        used.cpus[used.cpus_nr++] = pipeline->generators[t].cpu;
+    }
+    //  INFO(Santiago): everything else (the main thread, signal handling, the summary) stays away from them.
+    if (get_pig_usable_cpus(&pipeline->housekeeping)) {
+        pig_cpus_subtract(&pipeline->housekeeping, &used);
+    }
+    return 1;
+}
+
+static void print_placement(const pig_pipeline_ctx *pipeline) {
+    size_t t = 0;
+    for (t = 0; t < pipeline->senders_nr; t++) {
+        if (pipeline->senders[t].cpu >= 0) {
+            printf("pig INFO: the sender #%zu runs on the CPU %d.\n", t, pipeline->senders[t].cpu);
+        }
+    }
+    for (t = 0; t < pipeline->generators_nr; t++) {
+        if (pipeline->generators[t].cpu >= 0) {
+            printf("pig INFO: the generator #%zu runs on the CPU %d.\n", t, pipeline->generators[t].cpu);
+        }
+    }
+}
+
+int run_pig_pipeline(pig_pipeline_ctx *pipeline) {
+    size_t t = 0;
+    int retval = 0;
+    if (pipeline == NULL || pipeline->signatures == NULL || pipeline->budget == NULL) {
+        return 1;
+    }
+    for (t = 0; t < pipeline->generators_nr; t++) {
+        if (pipeline->generators[t].ring == NULL) {
+            printf("pig PANIC: unable to create the ring of the generator #%zu.\n", t);
+            return 1;
+        }
+    }
+    if (!pipeline->is_quiet) {
+        print_placement(pipeline);
+    }
+    pipeline->should_stop = 0;
+    pipeline->has_failed = 0;
+    pig_pacer_init(&pipeline->pacer);
+    pipeline->pacer.is_absolute = pipeline->is_realtime;
+    for (t = 0; t < pipeline->generators_nr && retval == 0; t++) {
+        if (pthread_create(&pipeline->generators[t].thread, NULL, generate_frames, &pipeline->generators[t]) != 0) {
+            printf("pig PANIC: unable to start the generator #%zu.\n", t);
+            retval = 1;
+        } else {
+            pipeline->generators[t].is_running = 1;
+        }
+    }
+    for (t = 0; t < pipeline->senders_nr && retval == 0; t++) {
+        if (pthread_create(&pipeline->senders[t].thread, NULL, send_frames, &pipeline->senders[t]) != 0) {
+            printf("pig PANIC: unable to start the sender #%zu.\n", t);
+            retval = 1;
+        } else {
+            pipeline->senders[t].is_running = 1;
+        }
+    }
+    if (retval != 0) {
+        stop_pipeline(pipeline);
+    } else if (pipeline->housekeeping.cpus_nr > 0) {
+        pig_pin_thread(pthread_self(), &pipeline->housekeeping);
+    }
+    for (t = 0; t < pipeline->senders_nr; t++) {
+        if (pipeline->senders[t].is_running) {
+            pthread_join(pipeline->senders[t].thread, NULL);
+            pipeline->senders[t].is_running = 0;
+        }
+    }
+    stop_pipeline(pipeline);
+    for (t = 0; t < pipeline->generators_nr; t++) {
+        if (pipeline->generators[t].is_running) {
+            pthread_join(pipeline->generators[t].thread, NULL);
+            pipeline->generators[t].is_running = 0;
+        }
+    }
+    return (retval != 0 || pipeline->has_failed);
+}
+
+void pig_pipeline_stats(const pig_pipeline_ctx *pipeline) {
+    const pig_generator_ctx *generator = NULL;
+    size_t t = 0;
+    if (pipeline == NULL) {
+        return;
+    }
+    for (t = 0; t < pipeline->generators_nr; t++) {
+        generator = &pipeline->generators[t];
+        printf("pig INFO: ring #%zu (%zu slot(s)): %llu frame(s) generated, %llu consumed, %.1f%% average use, "
+               "%llu full ring stall(s), %llu empty poll(s).\n", t, get_pig_spsc_size(generator->ring), generator->generated,
+               generator->ring->popped, get_pig_spsc_usage(generator->ring), generator->ring->full_stalls, generator->ring->empty_polls);
+    }
+}
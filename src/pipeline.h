@@ -0,0 +1,91 @@
+/*
+ *                                Copyright (C) 2015 by Rafael Santiago
+ *
+ * This is a free software. You can redistribute it and/or modify under
+ * the terms of the GNU General Public License version 2.
+ *
+ */
+#ifndef PIG_PIPELINE_H
+#define PIG_PIPELINE_H 1
+
+#include "types.h"
+#include "oink.h"
+#include "order.h"
+#include "profile.h"
+#include "budget.h"
+#include "pacer.h"
+#include "spsc.h"
+#include "cpus.h"
+#include "arrivals.h"
+#include <pthread.h>
+
+#define PIG_PIPELINE_MAX_THREADS 64
+
+#define PIG_PIPELINE_RT_IDLE 20000ULL
+
+struct _pig_pipeline;
+
+typedef struct _pig_generator {
+    pthread_t thread;
+    size_t index;
+    int is_running;
+    pig_spsc_ring_ctx *ring;
+    pig_hwaddr_ctx *hwaddr;
+    pig_oink_args_ctx args;
+    int cpu;
+    unsigned long long generated;
+    struct _pig_pipeline *pipeline;
+}pig_generator_ctx;
+
+typedef struct _pig_sender {
+    pthread_t thread;
+    size_t index;
+    int is_running;
+    int cpu;
+    pig_arrival_stream_ctx arrival;
+    unsigned long long bursts;
+    struct _pig_pipeline *pipeline;
+}pig_sender_ctx;
+
+typedef struct _pig_pipeline {
+    pig_generator_ctx *generators;
+    size_t generators_nr;
+    pig_sender_ctx *senders;
+    size_t senders_nr;
+    size_t ring_size;
+    pigsty_entry_ctx **signatures;
+    size_t signatures_count;
+    pig_order_mode_t order_mode;
+    const pig_profile_ctx *profile;
+    pig_budget_ctx *budget;
+    pig_oink_args_ctx args;
+    int fd;
+    size_t burst_size;
+    unsigned long long burst_gap;
+    unsigned long long timeout;
+    int is_train;
+    int is_quiet;
+    unsigned long long seed;
+    pig_pacer_ctx pacer;
+    unsigned long long packet_nr;
+    unsigned long long ticks;
+    int should_stop;
+    int *should_exit;
+    pig_cpu_set_ctx housekeeping;
+    pig_arrivals_ctx *arrivals;
+    int is_realtime;
+    int rt_priority;
+    int has_failed;
+}pig_pipeline_ctx;
+
+pig_pipeline_ctx *mk_pig_pipeline(const size_t generators_nr, const size_t senders_nr, const size_t ring_size);
+
+void del_pig_pipeline(pig_pipeline_ctx *pipeline);
+
+int pig_pipeline_place(pig_pipeline_ctx *pipeline, const pig_cpu_set_ctx *cpus, const int numa_node);
+
+int run_pig_pipeline(pig_pipeline_ctx *pipeline);
+
+void pig_pipeline_stats(const pig_pipeline_ctx *pipeline);
+
+#endif
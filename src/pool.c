@@ -0,0 +1,92 @@
+/*
+ *                                Copyright (C) 2015 by Rafael Santiago
+ *
+ * This is a free software. You can redistribute it and/or modify under
+ * the terms of the GNU General Public License version 2.
+ *
+ */
+#include "pool.h"
+#include "memory.h"
+#include <string.h>
+#include <stddef.h>
+
+//  INFO(Santiago): a content-addressed store for the read-only signature blobs (mostly payloads).
+//                  Equal blobs are stored once, no matter how many signatures or files bring them.
+
+#define PIG_POOL_BUCKETS 256
+
+struct pool_blob {
+    unsigned long long hash;
+    size_t size;
+    unsigned int refs;
+    struct pool_blob *next;
+    unsigned char data[1];
+};
+
+static struct pool_blob *g_pool[PIG_POOL_BUCKETS];
+
+static size_t g_pool_count = 0;
+
+static unsigned long long pool_hash(const unsigned char *data, const size_t dsize);
+
+const unsigned char *pig_pool_intern(const unsigned char *data, const size_t dsize) {
+    unsigned long long hash = 0;
+    struct pool_blob *bp = NULL;
+    if (data == NULL) {
+        return NULL;
+    }
+    hash = pool_hash(data, dsize);
+    for (bp = g_pool[hash % PIG_POOL_BUCKETS]; bp != NULL; bp = bp->next) {
+        if (bp->hash == hash && bp->size == dsize && memcmp(bp->data, data, dsize) == 0) {
+            bp->refs++;
+            return bp->data;
+        }
+    }
+    bp = (struct pool_blob *) pig_newseg(sizeof(struct pool_blob) + dsize);
+    bp->hash = hash;
+    bp->size = dsize;
+    bp->refs = 1;
+    memcpy(bp->data, data, dsize);
+    bp->data[dsize] = 0;
+    bp->next = g_pool[hash % PIG_POOL_BUCKETS];
+    g_pool[hash % PIG_POOL_BUCKETS] = bp;
+    g_pool_count++;
+    return bp->data;
+}
+
+void pig_pool_release(const unsigned char *data) {
+    struct pool_blob *blob = NULL, *bp = NULL, *last = NULL;
+    if (data == NULL) {
+        return;
+    }
+    blob = (struct pool_blob *)(data - offsetof(struct pool_blob, data));
+    if (--blob->refs > 0) {
+        return;
+    }
+    for (bp = g_pool[blob->hash % PIG_POOL_BUCKETS]; bp != NULL && bp != blob; last = bp, bp = bp->next);
+    if (bp == NULL) {
+        return;
+    }
+    if (last == NULL) {
+        g_pool[blob->hash % PIG_POOL_BUCKETS] = bp->next;
+    } else {
+        last->next = bp->next;
+    }
+    g_pool_count--;
+    free(bp);
+}
+
+size_t pig_pool_count() {
+    return g_pool_count;
+}
+
+static unsigned long long pool_hash(const unsigned char *data, const size_t dsize) {
+    //  INFO(Santiago): FNV-1a.
+    unsigned long long hash = 0xcbf29ce484222325ULL;
+    size_t d = 0;
+    for (d = 0; d < dsize; d++) {
+        hash ^= data[d];
+        hash *= 0x100000001b3ULL;
+    }
+    return hash;
+}
@@ -0,0 +1,19 @@
+/*
+ *                                Copyright (C) 2015 by Rafael Santiago
+ *
+ * This is a free software. You can redistribute it and/or modify under
+ * the terms of the GNU General Public License version 2.
+ *
+ */
+#ifndef PIG_POOL_H
+#define PIG_POOL_H 1
+
+#include <stdlib.h>
+
+const unsigned char *pig_pool_intern(const unsigned char *data, const size_t dsize);
+
+void pig_pool_release(const unsigned char *data);
+
+size_t pig_pool_count();
+
+#endif
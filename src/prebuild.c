@@ -0,0 +1,203 @@
+/*
+ *                                Copyright (C) 2015 by Rafael Santiago
+ *
+ * This is a free software. You can redistribute it and/or modify under
+ * the terms of the GNU General Public License version 2.
+ *
+ */
+#include "prebuild.h"
+#include "memory.h"
+#include "mkrnd.h"
+#include "pacer.h"
+#include <stdio.h>
+#include <string.h>
+
+//  INFO(Santiago): a prebuilt pool keeps N ready frames of one signature, the packets stay side by side
+//                  in a single buffer. The senders only copy frame descriptors out of the pools.
+//
+//                  When the refresh is on, a background thread rebuilds one pool at a time and swaps it
+//                  for the old one. The old pool is freed only after every sender has passed through a
+//                  quiescent point (the end of a burst), since a sender may still be pointing to it.
+
+#define PIG_PREBUILD_RNG_STREAM PIG_PREBUILD_MAX_SENDERS
+
+#define PIG_PREBUILD_POLL_INTERVAL 1000000ULL
+
+static pig_frame_pool_ctx *mk_frame_pool(pig_prebuild_ctx *prebuild, const size_t signature_index);
+
+static void del_frame_pool(pig_frame_pool_ctx *pool);
+
+static int wait_senders(pig_prebuild_ctx *prebuild);
+
+static void *refresh_pools(void *arg);
+
+static pig_frame_pool_ctx *mk_frame_pool(pig_prebuild_ctx *prebuild, const size_t signature_index) {
+    pig_frame_pool_ctx *pool = NULL;
+    size_t f = 0, valid = 0, total = 0, offset = 0;
+    pool = (pig_frame_pool_ctx *) pig_newseg(sizeof(pig_frame_pool_ctx));
+    memset(pool, 0, sizeof(pig_frame_pool_ctx));
+    pool->frames = (pig_frame_ctx *) pig_newseg(sizeof(pig_frame_ctx) * prebuild->frames_per_pool);
+    memset(pool->frames, 0, sizeof(pig_frame_ctx) * prebuild->frames_per_pool);
+    for (f = 0; f < prebuild->frames_per_pool; f++) {
+        pool->frames[valid].signature = prebuild->signatures[signature_index];
+        if (oink_mk_frame(&pool->frames[valid], &prebuild->args) == 1) {
+            total += pool->frames[valid].packet_size;
+            valid++;
+        }
+    }
+    if (valid == 0) {
+        del_frame_pool(pool);
+        return NULL;
+    }
+    pool->frames_nr = valid;
+    pool->data = (unsigned char *) pig_newseg(total);
+    for (f = 0; f < valid; f++) {
+        memcpy(&pool->data[offset], pool->frames[f].packet, pool->frames[f].packet_size);
+        free(pool->frames[f].packet);
+        pool->frames[f].packet = &pool->data[offset];
+        offset += pool->frames[f].packet_size;
+    }
+    return pool;
+}
+
+static void del_frame_pool(pig_frame_pool_ctx *pool) {
+    size_t f = 0;
+    if (pool == NULL) {
+        return;
+    }
+    if (pool->data == NULL) {
+        for (f = 0; f < pool->frames_nr; f++) {
+            free(pool->frames[f].packet);
+        }
+    }
+    free(pool->data);
+    free(pool->frames);
+    free(pool);
+}
+
+pig_prebuild_ctx *mk_pig_prebuild(pigsty_entry_ctx **signatures, const size_t signatures_count, const size_t frames_per_pool, const pig_oink_args_ctx *args) {
+    pig_prebuild_ctx *prebuild = NULL;
+    size_t s = 0;
+    if (signatures == NULL || signatures_count == 0 || frames_per_pool == 0 || args == NULL) {
+        return NULL;
+    }
+    prebuild = (pig_prebuild_ctx *) pig_newseg(sizeof(pig_prebuild_ctx));
+    memset(prebuild, 0, sizeof(pig_prebuild_ctx));
+    prebuild->signatures = signatures;
+    prebuild->frames_per_pool = frames_per_pool;
+    prebuild->args = *args;
+    prebuild->pools_nr = signatures_count;
+    prebuild->pools = (pig_frame_pool_ctx **) pig_newseg(sizeof(pig_frame_pool_ctx *) * signatures_count);
+    memset(prebuild->pools, 0, sizeof(pig_frame_pool_ctx *) * signatures_count);
+    for (s = 0; s < signatures_count; s++) {
+        prebuild->pools[s] = mk_frame_pool(prebuild, s);
+        if (prebuild->pools[s] == NULL) {
+            printf("pig PANIC: unable to prebuild frames for the signature \"%s\".\n", signatures[s]->signature_name);
+            del_pig_prebuild(prebuild);
+            return NULL;
+        }
+    }
+    return prebuild;
+}
+
+static int wait_senders(pig_prebuild_ctx *prebuild) {
+    unsigned long long epochs[PIG_PREBUILD_MAX_SENDERS];
+    size_t s = 0;
+    for (s = 0; s < prebuild->senders_nr; s++) {
+        epochs[s] = __atomic_load_n(&prebuild->epochs[s], __ATOMIC_ACQUIRE);
+    }
+    while (!__atomic_load_n(&prebuild->should_stop, __ATOMIC_ACQUIRE)) {
+        for (s = 0; s < prebuild->senders_nr && __atomic_load_n(&prebuild->epochs[s], __ATOMIC_ACQUIRE) != epochs[s]; s++)
+            ;
+        if (s == prebuild->senders_nr) {
+            return 1;
+        }
+        pig_sleep_ns(PIG_PREBUILD_POLL_INTERVAL);
+    }
+    return 0;
+}
+
+static void *refresh_pools(void *arg) {
+    pig_prebuild_ctx *prebuild = (pig_prebuild_ctx *)arg;
+    pig_frame_pool_ctx *pool = NULL;
+    unsigned long long slept = 0;
+    size_t s = 0;
+    mk_rnd_init(prebuild->seed, PIG_PREBUILD_RNG_STREAM);
+    while (!__atomic_load_n(&prebuild->should_stop, __ATOMIC_ACQUIRE)) {
+        for (slept = 0; slept < prebuild->refresh_interval && !__atomic_load_n(&prebuild->should_stop, __ATOMIC_ACQUIRE); slept += PIG_PREBUILD_POLL_INTERVAL) {
+            pig_sleep_ns(PIG_PREBUILD_POLL_INTERVAL);
+        }
+        if (__atomic_load_n(&prebuild->should_stop, __ATOMIC_ACQUIRE)) {
+            break;
+        }
+        pool = mk_frame_pool(prebuild, s);
+        if (pool != NULL) {
+            pool = __atomic_exchange_n(&prebuild->pools[s], pool, __ATOMIC_ACQ_REL);
+            if (wait_senders(prebuild)) {
+                del_frame_pool(pool);
+            } else {
+                pool->next = prebuild->retired;
+                prebuild->retired = pool;
+            }
+            __sync_fetch_and_add(&prebuild->refreshes, 1);
+        }
+        s = (s + 1) % prebuild->pools_nr;
+    }
+    return NULL;
+}
+
+int pig_prebuild_start_refresh(pig_prebuild_ctx *prebuild, const unsigned long long interval, const unsigned long long seed, const size_t senders_nr) {
+    if (prebuild == NULL || interval == 0 || senders_nr == 0 || senders_nr > PIG_PREBUILD_MAX_SENDERS || prebuild->has_regen_thread) {
+        return 0;
+    }
+    prebuild->refresh_interval = interval;
+    prebuild->seed = seed;
+    prebuild->senders_nr = senders_nr;
+    prebuild->should_stop = 0;
+    if (pthread_create(&prebuild->regen_thread, NULL, refresh_pools, prebuild) != 0) {
+        printf("pig PANIC: unable to start the prebuilt pools refresher.\n");
+        return 0;
+    }
+    prebuild->has_regen_thread = 1;
+    return 1;
+}
+
+void del_pig_prebuild(pig_prebuild_ctx *prebuild) {
+    pig_frame_pool_ctx *pool = NULL, *next = NULL;
+    size_t s = 0;
+    if (prebuild == NULL) {
+        return;
+    }
+    if (prebuild->has_regen_thread) {
+        __atomic_store_n(&prebuild->should_stop, 1, __ATOMIC_RELEASE);
+        pthread_join(prebuild->regen_thread, NULL);
+    }
+    for (s = 0; s < prebuild->pools_nr; s++) {
+        del_frame_pool(prebuild->pools[s]);
+    }
+    for (pool = prebuild->retired; pool != NULL; pool = next) {
+        next = pool->next;
+        del_frame_pool(pool);
+    }
+    free(prebuild->pools);
+    free(prebuild);
+}
+
+int get_pig_prebuilt_frame(pig_prebuild_ctx *prebuild, const size_t signature_index, pig_frame_ctx *frame) {
+    pig_frame_pool_ctx *pool = NULL;
+    size_t f = 0;
+    if (prebuild == NULL || signature_index >= prebuild->pools_nr || frame == NULL) {
+        return 0;
+    }
+    pool = __atomic_load_n(&prebuild->pools[signature_index], __ATOMIC_ACQUIRE);
+    f = __sync_fetch_and_add(&pool->cursor, 1) % pool->frames_nr;
+    memcpy(frame, &pool->frames[f], sizeof(pig_frame_ctx));
+    return 1;
+}
+
+void pig_prebuild_quiescent(pig_prebuild_ctx *prebuild, const size_t sender) {
+    if (prebuild == NULL || !prebuild->has_regen_thread || sender >= prebuild->senders_nr) {
+        return;
+    }
+    __atomic_fetch_add(&prebuild->epochs[sender], 1, __ATOMIC_RELEASE);
+}
@@ -0,0 +1,52 @@
+/*
+ *                                Copyright (C) 2015 by Rafael Santiago
+ *
+ * This is a free software. You can redistribute it and/or modify under
+ * the terms of the GNU General Public License version 2.
+ *
+ */
+#ifndef PIG_PREBUILD_H
+#define PIG_PREBUILD_H 1
+
+#include "types.h"
+#include "oink.h"
+#include <pthread.h>
+
+#define PIG_PREBUILD_MAX_SENDERS 64
+
+typedef struct _pig_frame_pool {
+    unsigned char *data;
+    pig_frame_ctx *frames;
+    size_t frames_nr;
+    size_t cursor;
+    struct _pig_frame_pool *next;
+}pig_frame_pool_ctx;
+
+typedef struct _pig_prebuild {
+    pig_frame_pool_ctx **pools;
+    size_t pools_nr;
+    size_t frames_per_pool;
+    pigsty_entry_ctx **signatures;
+    pig_oink_args_ctx args;
+    unsigned long long seed;
+    unsigned long long refresh_interval;
+    unsigned long long refreshes;
+    unsigned long long epochs[PIG_PREBUILD_MAX_SENDERS];
+    size_t senders_nr;
+    pig_frame_pool_ctx *retired;
+    pthread_t regen_thread;
+    int has_regen_thread;
+    int should_stop;
+}pig_prebuild_ctx;
+
+pig_prebuild_ctx *mk_pig_prebuild(pigsty_entry_ctx **signatures, const size_t signatures_count, const size_t frames_per_pool, const pig_oink_args_ctx *args);
+
+int pig_prebuild_start_refresh(pig_prebuild_ctx *prebuild, const unsigned long long interval, const unsigned long long seed, const size_t senders_nr);
+
+void del_pig_prebuild(pig_prebuild_ctx *prebuild);
+
+int get_pig_prebuilt_frame(pig_prebuild_ctx *prebuild, const size_t signature_index, pig_frame_ctx *frame);
+
+void pig_prebuild_quiescent(pig_prebuild_ctx *prebuild, const size_t sender);
+
+#endif
@@ -0,0 +1,329 @@
+/*
+ *                                Copyright (C) 2015 by Rafael Santiago
+ *
+ * This is a free software. You can redistribute it and/or modify under
+ * the terms of the GNU General Public License version 2.
+ *
+ */
+#include "profile.h"
+#include "lists.h"
+#include "memory.h"
+#include "mkrnd.h"
+#include "pacer.h"
+#include <stdio.h>
+#include <string.h>
+#include <math.h>
+
+//  INFO(Santiago): a traffic profile is a list of points, one per line:
+//
+//      <time> <rate> [linear | step] [<signature name>=<weight> ...]
+//
+//                  The time is absolute (from the beginning of the run) and it can be expressed as
+//                  "<n>[ns|us|ms|s|m|h]" or "hh:mm[:ss]". The rate is given in packets per second and
+//                  it goes from one point to the next one linearly (default) or in steps. The signature
+//                  mix is optional, when omitted the mix of the previous point is kept (the first point
+//                  without a mix picks all signatures with the same chance). The run ends at the last point.
+
+#define PIG_PROFILE_MAX_TOKEN 1024
+
+static char *get_profile_file_data(const char *filepath);
+
+static const char *get_next_profile_token(const char *data, char *token, const size_t token_size, int *is_eol);
+
+static int parse_profile_mix(const char *token, pig_profile_point_ctx *point, pigsty_entry_ctx *pigsty);
+
+static pig_profile_point_ctx *add_profile_point(pig_profile_ctx *profile);
+
+static double get_segment_packets(const pig_profile_ctx *profile, const size_t p, const double x);
+
+static char *get_profile_file_data(const char *filepath) {
+    FILE *fp = NULL;
+    char *data = NULL;
+    long file_size = 0;
+    if (filepath == NULL || (fp = fopen(filepath, "rb")) == NULL) {
+        return NULL;
+    }
+    if (fseek(fp, 0L, SEEK_END) != -1) {
+        file_size = ftell(fp);
+        fseek(fp, 0L, SEEK_SET);
+    }
+    if (file_size >= 0) {
+        data = (char *) pig_newseg(file_size + 1);
+        memset(data, 0, file_size + 1);
+        if (fread(data, 1, file_size, fp) != (size_t)file_size) {
+            free(data);
+            data = NULL;
+        }
+    }
+    fclose(fp);
+    return data;
+}
+
+static const char *get_next_profile_token(const char *data, char *token, const size_t token_size, int *is_eol) {
+    const char *dp = data;
+    char *tp = token;
+    char *tp_end = token + token_size - 1;
+    int in_quotes = 0;
+    *is_eol = 0;
+    memset(token, 0, token_size);
+    while (*dp == ' ' || *dp == '\t' || *dp == '\r' || *dp == '#') {
+        if (*dp == '#') {
+            while (*dp != '\n' && *dp != 0) {
+                dp++;
+            }
+        } else {
+            dp++;
+        }
+    }
+    if (*dp == '\n' || *dp == 0) {
+        *is_eol = 1;
+        return (*dp == 0 ? dp : dp + 1);
+    }
+    while (*dp != 0 && *dp != '\n' && (in_quotes || (*dp != ' ' && *dp != '\t' && *dp != '\r' && *dp != '#'))) {
+        if (*dp == '"') {
+            in_quotes = !in_quotes;
+        } else if (tp != tp_end) {
+            *tp = *dp;
+            tp++;
+        }
+        dp++;
+    }
+    return dp;
+}
+
+static int parse_profile_mix(const char *token, pig_profile_point_ctx *point, pigsty_entry_ctx *pigsty) {
+    const char *eq = strrchr(token, '=');
+    char name[PIG_PROFILE_MAX_TOKEN];
+    pigsty_entry_ctx *ep = NULL;
+    size_t index = 0;
+    char *end = NULL;
+    long weight = 0;
+    if (eq == NULL || eq == token) {
+        printf("pig PANIC: profile: invalid signature mix \"%s\".\n", token);
+        return 0;
+    }
+    memset(name, 0, sizeof(name));
+    memcpy(name, token, eq - token);
+    weight = strtol(eq + 1, &end, 10);
+    if (end == eq + 1 || *end != 0 || weight < 0) {
+        printf("pig PANIC: profile: invalid weight for the signature \"%s\".\n", name);
+        return 0;
+    }
+    for (ep = pigsty; ep != NULL && strcmp(ep->signature_name, name) != 0; ep = ep->next) {
+        index++;
+    }
+    if (ep == NULL) {
+        printf("pig PANIC: profile: unknown signature \"%s\".\n", name);
+        return 0;
+    }
+    point->weights_total -= point->weights[index];
+    point->weights[index] = (unsigned int)weight;
+    point->weights_total += point->weights[index];
+    return 1;
+}
+
+static pig_profile_point_ctx *add_profile_point(pig_profile_ctx *profile) {
+    pig_profile_point_ctx *points = (pig_profile_point_ctx *) pig_newseg(sizeof(pig_profile_point_ctx) * (profile->points_nr + 1));
+    if (profile->points != NULL) {
+        memcpy(points, profile->points, sizeof(pig_profile_point_ctx) * profile->points_nr);
+        free(profile->points);
+    }
+    profile->points = points;
+    points = &profile->points[profile->points_nr++];
+    memset(points, 0, sizeof(pig_profile_point_ctx));
+    points->weights = (unsigned int *) pig_newseg(sizeof(unsigned int) * profile->signatures_count);
+    return points;
+}
+
+pig_profile_ctx *load_pig_profile(const char *filepath, pigsty_entry_ctx *pigsty) {
+    pig_profile_ctx *profile = NULL;
+    char *data = get_profile_file_data(filepath);
+    if (data == NULL) {
+        printf("pig PANIC: unable to read the profile \"%s\".\n", filepath);
+        return NULL;
+    }
+    profile = parse_pig_profile(data, pigsty);
+    free(data);
+    return profile;
+}
+
+pig_profile_ctx *parse_pig_profile(const char *data, pigsty_entry_ctx *pigsty) {
+    pig_profile_ctx *profile = NULL;
+    pig_profile_point_ctx *point = NULL, *last = NULL;
+    const char *dp = data;
+    char token[PIG_PROFILE_MAX_TOKEN];
+    char *end = NULL;
+    int is_eol = 0, has_mix = 0;
+    size_t s = 0, line_nr = 0;
+    double dt = 0;
+    if (data == NULL || pigsty == NULL) {
+        return NULL;
+    }
+    profile = (pig_profile_ctx *) pig_newseg(sizeof(pig_profile_ctx));
+    memset(profile, 0, sizeof(pig_profile_ctx));
+    profile->signatures_count = get_pigsty_entry_count(pigsty);
+    profile->speed = 1.0;
+    while (*dp != 0) {
+        line_nr++;
+        dp = get_next_profile_token(dp, token, sizeof(token), &is_eol);
+        if (is_eol) {
+            continue;
+        }
+        point = add_profile_point(profile);
+        last = (profile->points_nr > 1 ? &profile->points[profile->points_nr - 2] : NULL);
+        if (!parse_pig_time(token, &point->t)) {
+            printf("pig PANIC: profile: invalid time \"%s\" at line %zu.\n", token, line_nr);
+            del_pig_profile(profile);
+            return NULL;
+        }
+        if ((last == NULL && point->t != 0) || (last != NULL && point->t <= last->t)) {
+            printf("pig PANIC: profile: the points must start at zero and be in ascending time order (line %zu).\n", line_nr);
+            del_pig_profile(profile);
+            return NULL;
+        }
+        dp = get_next_profile_token(dp, token, sizeof(token), &is_eol);
+        point->rate = (is_eol ? -1 : strtod(token, &end));
+        if (is_eol || end == token || *end != 0 || point->rate < 0) {
+            printf("pig PANIC: profile: invalid rate at line %zu.\n", line_nr);
+            del_pig_profile(profile);
+            return NULL;
+        }
+        has_mix = 0;
+        while (!is_eol) {
+            dp = get_next_profile_token(dp, token, sizeof(token), &is_eol);
+            if (is_eol) {
+                break;
+            }
+            if (strcmp(token, "step") == 0 || strcmp(token, "linear") == 0) {
+                point->is_step = (token[0] == 's');
+                continue;
+            }
+            if (!has_mix) {
+                has_mix = 1;
+                point->weights_total = 0;
+                memset(point->weights, 0, sizeof(unsigned int) * profile->signatures_count);
+            }
+            if (!parse_profile_mix(token, point, pigsty)) {
+                printf("pig PANIC: profile: error at line %zu.\n", line_nr);
+                del_pig_profile(profile);
+                return NULL;
+            }
+        }
+        if (!has_mix) {
+            if (last != NULL) {
+                memcpy(point->weights, last->weights, sizeof(unsigned int) * profile->signatures_count);
+                point->weights_total = last->weights_total;
+            } else {
+                for (s = 0; s < profile->signatures_count; s++) {
+                    point->weights[s] = 1;
+                }
+                point->weights_total = profile->signatures_count;
+            }
+        } else if (point->weights_total == 0) {
+            printf("pig PANIC: profile: the signature mix at line %zu has no positive weight.\n", line_nr);
+            del_pig_profile(profile);
+            return NULL;
+        }
+        if (last != NULL) {
+            dt = (double)(point->t - last->t) / 1000000000.0;
+            point->packets = last->packets + get_segment_packets(profile, profile->points_nr - 2, dt);
+        }
+    }
+    if (profile->points_nr < 2) {
+        printf("pig PANIC: profile: at least two points are needed.\n");
+        del_pig_profile(profile);
+        return NULL;
+    }
+    return profile;
+}
+
+void del_pig_profile(pig_profile_ctx *profile) {
+    size_t p = 0;
+    if (profile == NULL) {
+        return;
+    }
+    for (p = 0; p < profile->points_nr; p++) {
+        free(profile->points[p].weights);
+    }
+    free(profile->points);
+    free(profile);
+}
+
+static double get_segment_packets(const pig_profile_ctx *profile, const size_t p, const double x) {
+    //  INFO(Santiago): how many packets the segment p has after x seconds (profile time), in other
+    //                  words, the area below the rate curve from the point p until p + x.
+    const pig_profile_point_ctx *a = &profile->points[p], *b = &profile->points[p + 1];
+    double slope = 0;
+    if (a->is_step) {
+        return a->rate * x;
+    }
+    slope = (b->rate - a->rate) / ((double)(b->t - a->t) / 1000000000.0);
+    return a->rate * x + slope * x * x / 2.0;
+}
+
+double get_pig_profile_packets(const pig_profile_ctx *profile, const unsigned long long elapsed) {
+    double t = 0;
+    size_t p = 0;
+    if (profile == NULL || profile->points_nr < 2) {
+        return 0;
+    }
+    t = (double)elapsed * profile->speed;
+    for (p = 0; p + 2 < profile->points_nr && t >= (double)profile->points[p + 1].t; p++)
+        ;
+    if (t >= (double)profile->points[p + 1].t) {
+        return (profile->points[p + 1].packets / profile->speed);
+    }
+    return ((profile->points[p].packets + get_segment_packets(profile, p, (t - (double)profile->points[p].t) / 1000000000.0)) / profile->speed);
+}
+
+int get_pig_profile_deadline(const pig_profile_ctx *profile, const double packet_nr, unsigned long long *elapsed, const pig_profile_point_ctx **point) {
+    const pig_profile_point_ctx *a = NULL, *b = NULL;
+    size_t p = 0;
+    double n = 0, x = 0, slope = 0;
+    if (profile == NULL || profile->points_nr < 2) {
+        return 0;
+    }
+    //  INFO(Santiago): the rates are packets per second of wall clock, when the time is compressed
+    //                  only the time axis shrinks, so the area below the curve is scaled down by the speed.
+    n = packet_nr * profile->speed;
+    if (n >= profile->points[profile->points_nr - 1].packets) {
+        return 0;
+    }
+    for (p = 0; p + 2 < profile->points_nr && n >= profile->points[p + 1].packets; p++)
+        ;
+    a = &profile->points[p];
+    b = &profile->points[p + 1];
+    n -= a->packets;
+    if (a->is_step) {
+        x = n / a->rate;
+    } else {
+        slope = (b->rate - a->rate) / ((double)(b->t - a->t) / 1000000000.0);
+        if (slope == 0) {
+            x = n / a->rate;
+        } else {
+            x = a->rate * a->rate + 2.0 * slope * n;
+            x = (sqrt(x > 0 ? x : 0) - a->rate) / slope;
+        }
+    }
+    *elapsed = (unsigned long long)(((double)a->t + x * 1000000000.0) / profile->speed);
+    if (point != NULL) {
+        *point = a;
+    }
+    return 1;
+}
+
+size_t pick_pig_profile_signature(const pig_profile_point_ctx *point, const size_t signatures_count) {
+    unsigned int r = 0;
+    size_t s = 0;
+    if (point == NULL || point->weights_total == 0) {
+        return (mk_rnd_u32() % signatures_count);
+    }
+    r = mk_rnd_u32() % point->weights_total;
+    for (s = 0; s < signatures_count; s++) {
+        if (r < point->weights[s]) {
+            return s;
+        }
+        r -= point->weights[s];
+    }
+    return (signatures_count - 1);
+}
@@ -0,0 +1,41 @@
+/*
+ *                                Copyright (C) 2015 by Rafael Santiago
+ *
+ * This is a free software. You can redistribute it and/or modify under
+ * the terms of the GNU General Public License version 2.
+ *
+ */
+#ifndef PIG_PROFILE_H
+#define PIG_PROFILE_H 1
+
+#include "types.h"
+
+typedef struct _pig_profile_point {
+    unsigned long long t;
+    double rate;
+    int is_step;
+    unsigned int *weights;
+    unsigned int weights_total;
+    double packets;
+}pig_profile_point_ctx;
+
+typedef struct _pig_profile {
+    pig_profile_point_ctx *points;
+    size_t points_nr;
+    size_t signatures_count;
+    double speed;
+}pig_profile_ctx;
+
+pig_profile_ctx *load_pig_profile(const char *filepath, pigsty_entry_ctx *pigsty);
+
+pig_profile_ctx *parse_pig_profile(const char *data, pigsty_entry_ctx *pigsty);
+
+void del_pig_profile(pig_profile_ctx *profile);
+
+double get_pig_profile_packets(const pig_profile_ctx *profile, const unsigned long long elapsed);
+
+int get_pig_profile_deadline(const pig_profile_ctx *profile, const double packet_nr, unsigned long long *elapsed, const pig_profile_point_ctx **point);
+
+size_t pick_pig_profile_signature(const pig_profile_point_ctx *point, const size_t signatures_count);
+
+#endif
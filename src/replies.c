@@ -0,0 +1,539 @@
+/*
+ *                                Copyright (C) 2015 by Rafael Santiago
+ *
+ * This is a free software. You can redistribute it and/or modify under
+ * the terms of the GNU General Public License version 2.
+ *
+ */
+#include "replies.h"
+#include "chsum.h"
+#include "pacer.h"
+#include "memory.h"
+#include "cpus.h"
+#include "lists.h"
+#ifdef __linux
+#include "linux/rxring.h"
+#endif
+#include <stdio.h>
+#include <string.h>
+
+//  INFO(Santiago): the senders write the 5-tuple of each packet that leaves into a direct mapped table
+//                  (the newest transmission wins the bucket), the capture thread looks the replies up
+//                  there. Each bucket is guarded by a sequence number: a sender that finds the bucket
+//                  busy just skips the record and a torn read on the capture side is an unmatched reply.
+//                  Nobody waits for anybody, so the transmission pays one hash and a few stores per packet.
+//
+//                  For the round trip times the entry also keeps what the reply must echo back (a cookie):
+//                  the next sequence number or the acknowledgement of a TCP segment, the IP ID quoted by an
+//                  ICMP error, the sequence number of an echo. A reply to an older packet of the same
+//                  5-tuple is still counted but gives no time sample. The IP ID and the echo sequence of
+//                  every packet are rewritten with a running counter, so they are cookies too.
+
+#define get_u16(b) ( ((unsigned short)(b)[0] << 8) | (b)[1] )
+
+#define get_u32(b) ( ((unsigned int)(b)[0] << 24) | ((unsigned int)(b)[1] << 16) | ((unsigned int)(b)[2] << 8) | (b)[3] )
+
+#define PIG_REPLIES_READ_TIMEOUT 100
+
+static size_t hash_key(const pig_tx_key_ctx *key);
+
+static size_t get_signature_index(const pig_replies_ctx *replies, const pigsty_entry_ctx *signature);
+
+static pig_rtt_pair_ctx *get_rtt_pair(pig_replies_ctx *replies, const unsigned int signature, const unsigned int target);
+
+static int is_cookie_ok(const pig_tx_key_ctx *key, const unsigned int ip_id, const unsigned int next_seq, const unsigned int ack);
+
+static int is_ip_id_pinned(const pigsty_entry_ctx *signature);
+
+static void *capture_replies(void *arg);
+
+#ifdef __linux
+static void on_reply(const unsigned char *dgram, const size_t dgram_size, const unsigned long long timestamp, void *arg);
+#endif
+
+static size_t hash_key(const pig_tx_key_ctx *key) {
+    unsigned int h = key->src_addr * 0x9e3779b1;
+    h ^= key->dst_addr * 0x85ebca6b;
+    h ^= (((unsigned int)key->src_port << 16) | key->dst_port) * 0xc2b2ae35;
+    h ^= key->proto;
+    h ^= h >> 15;
+    h *= 0x2c1b3c6d;
+    h ^= h >> 13;
+    return h & (PIG_REPLIES_TABLE_SIZE - 1);
+}
+
+static size_t get_signature_index(const pig_replies_ctx *replies, const pigsty_entry_ctx *signature) {
+    size_t i = ((size_t)signature >> 4) & replies->index_mask;
+    while (replies->index[i].signature != NULL && replies->index[i].signature != signature) {
+        i = (i + 1) & replies->index_mask;
+    }
+    return (replies->index[i].signature != NULL ? replies->index[i].index : replies->signatures_count);
+}
+
+static pig_rtt_pair_ctx *get_rtt_pair(pig_replies_ctx *replies, const unsigned int signature, const unsigned int target) {
+    size_t p = ((signature * 0x9e3779b1) ^ (target * 0x85ebca6b)) & (PIG_REPLIES_MAX_PAIRS * 2 - 1);
+    while (replies->pairs[p].signature != 0) {
+        if (replies->pairs[p].signature == signature && replies->pairs[p].target == target) {
+            return &replies->pairs[p];
+        }
+        p = (p + 1) & (PIG_REPLIES_MAX_PAIRS * 2 - 1);
+    }
+    if (replies->pairs_nr == PIG_REPLIES_MAX_PAIRS) {
+        replies->pairs_overflow++;
+        return NULL;
+    }
+    replies->pairs_nr++;
+    replies->pairs[p].signature = signature;
+    replies->pairs[p].target = target;
+    return &replies->pairs[p];
+}
+
+static int is_cookie_ok(const pig_tx_key_ctx *key, const unsigned int ip_id, const unsigned int next_seq, const unsigned int ack) {
+    switch (key->cookie_kind) {
+        case kCookieAck:
+            return (key->cookie == next_seq);
+
+        case kCookieSeq:
+            return (key->cookie == ack);
+
+        case kCookieIpId:
+            return (key->cookie == ip_id);
+
+        default:
+            return 1;
+    }
+}
+
+static int is_ip_id_pinned(const pigsty_entry_ctx *signature) {
+    size_t l = 0;
+    if (get_pigsty_conf_set_field(kIpv4_id, signature->conf) == NULL) {
+        return 0;
+    }
+    //  INFO(Santiago): "ip.id = random" leaves the value to pig, refresh and increment are a pattern chosen on purpose.
+    for (l = 0; l < signature->slots_nr; l++) {
+        if (signature->slots[l].field == kIpv4_id) {
+            return (signature->slots[l].modifier != kRandom);
+        }
+    }
+    return 1;
+}
+
+pig_replies_ctx *mk_pig_replies(pigsty_entry_ctx **signatures, const size_t signatures_count) {
+    pig_replies_ctx *replies = NULL;
+    size_t s = 0, i = 0, index_size = 2;
+    if (signatures == NULL || signatures_count == 0) {
+        return NULL;
+    }
+    while (index_size < signatures_count * 2) {
+        index_size <<= 1;
+    }
+    replies = (pig_replies_ctx *) pig_newseg(sizeof(pig_replies_ctx));
+    memset(replies, 0, sizeof(pig_replies_ctx));
+    replies->signatures = signatures;
+    replies->signatures_count = signatures_count;
+    replies->index = (pig_signature_index_ctx *) pig_newseg(sizeof(pig_signature_index_ctx) * index_size);
+    memset(replies->index, 0, sizeof(pig_signature_index_ctx) * index_size);
+    replies->index_mask = index_size - 1;
+    for (s = 0; s < signatures_count; s++) {
+        for (i = ((size_t)signatures[s] >> 4) & replies->index_mask; replies->index[i].signature != NULL; i = (i + 1) & replies->index_mask)
+            ;
+        replies->index[i].signature = signatures[s];
+        replies->index[i].index = s;
+    }
+    replies->table = (pig_tx_entry_ctx *) pig_newseg(sizeof(pig_tx_entry_ctx) * PIG_REPLIES_TABLE_SIZE);
+    memset(replies->table, 0, sizeof(pig_tx_entry_ctx) * PIG_REPLIES_TABLE_SIZE);
+    replies->stats = (pig_reply_stats_ctx *) pig_newseg(sizeof(pig_reply_stats_ctx) * signatures_count);
+    memset(replies->stats, 0, sizeof(pig_reply_stats_ctx) * signatures_count);
+    return replies;
+}
+
+void del_pig_replies(pig_replies_ctx *replies) {
+    if (replies == NULL) {
+        return;
+    }
+    pig_replies_stop(replies, 0);
+    free(replies->index);
+    free(replies->table);
+    free(replies->stats);
+    free(replies->rtt);
+    free(replies->free_ip_id);
+    free(replies->pairs);
+    free(replies);
+}
+
+int pig_replies_enable_rtt(pig_replies_ctx *replies) {
+    size_t s = 0;
+    if (replies == NULL) {
+        return 0;
+    }
+    replies->rtt = (pig_rtt_hist_ctx *) pig_newseg(sizeof(pig_rtt_hist_ctx) * replies->signatures_count);
+    memset(replies->rtt, 0, sizeof(pig_rtt_hist_ctx) * replies->signatures_count);
+    replies->pairs = (pig_rtt_pair_ctx *) pig_newseg(sizeof(pig_rtt_pair_ctx) * PIG_REPLIES_MAX_PAIRS * 2);
+    memset(replies->pairs, 0, sizeof(pig_rtt_pair_ctx) * PIG_REPLIES_MAX_PAIRS * 2);
+    //  WARN(Santiago): the rules may match on the IP identification, a signature that sets it is never stamped.
+    replies->free_ip_id = (unsigned char *) pig_newseg(replies->signatures_count);
+    for (s = 0; s < replies->signatures_count; s++) {
+        replies->free_ip_id[s] = !is_ip_id_pinned(replies->signatures[s]);
+        if (!replies->free_ip_id[s]) {
+            printf("pig WARNING: the signature \"%s\" sets ip.id, --rtt leaves it as is and can not tell apart the ICMP "
+                   "errors to its older packets.\n", replies->signatures[s]->signature_name);
+        }
+    }
+    replies->with_rtt = 1;
+    return 1;
+}
+
+int get_pig_tx_key(const unsigned char *dgram, const size_t dgram_size, pig_tx_key_ctx *key) {
+    size_t l4 = 0, payload = 0;
+    if (dgram == NULL || dgram_size < 20 || (dgram[0] >> 4) != 4) {
+        return 0;
+    }
+    l4 = get_ip4_l4_offset(dgram, dgram_size);
+    memcpy(&key->src_addr, &dgram[12], 4);
+    memcpy(&key->dst_addr, &dgram[16], 4);
+    key->proto = dgram[9];
+    key->src_port = key->dst_port = 0;
+    key->ip_id = get_u16(&dgram[4]);
+    key->next_seq = key->ack = 0;
+    key->cookie_kind = kCookieNone;
+    key->cookie = 0;
+    switch (key->proto) {
+        case 6:
+        case 17:
+            if (l4 + 4 > dgram_size) {
+                return 0;
+            }
+            key->src_port = get_u16(&dgram[l4]);
+            key->dst_port = get_u16(&dgram[l4 + 2]);
+            if (key->proto == 6 && l4 + 14 <= dgram_size) {
+                //  INFO(Santiago): SYN and FIN take a sequence number, as one byte of data would.
+                payload = get_u16(&dgram[2]);
+                payload = (payload > l4 + (dgram[l4 + 12] >> 4) * 4) ? payload - l4 - (dgram[l4 + 12] >> 4) * 4 : 0;
+                key->next_seq = get_u32(&dgram[l4 + 4]) + (unsigned int)payload + ((dgram[l4 + 13] & 0x02) != 0) + ((dgram[l4 + 13] & 0x01) != 0);
+                key->ack = get_u32(&dgram[l4 + 8]);
+            }
+            break;
+
+        case 1:
+            //  INFO(Santiago): an echo is told apart by its identifier and sequence number.
+            if (l4 + 8 <= dgram_size && (dgram[l4] == 8 || dgram[l4] == 0)) {
+                key->src_port = get_u16(&dgram[l4 + 4]);
+                key->dst_port = get_u16(&dgram[l4 + 6]);
+            }
+            break;
+    }
+    return 1;
+}
+
+int get_pig_reply_key(const unsigned char *dgram, const size_t dgram_size, pig_tx_key_ctx *key, pig_reply_type_t *type) {
+    pig_tx_key_ctx reply;
+    size_t l4 = 0;
+    unsigned char flags = 0;
+    if (!get_pig_tx_key(dgram, dgram_size, &reply)) {
+        return 0;
+    }
+    l4 = get_ip4_l4_offset(dgram, dgram_size);
+    //  INFO(Santiago): a reply goes the other way around, an ICMP error quotes the offending packet.
+    key->src_addr = reply.dst_addr;
+    key->dst_addr = reply.src_addr;
+    key->src_port = reply.dst_port;
+    key->dst_port = reply.src_port;
+    key->proto = reply.proto;
+    key->ip_id = reply.ip_id;
+    key->next_seq = key->ack = 0;
+    key->cookie_kind = kCookieNone;
+    key->cookie = 0;
+    switch (reply.proto) {
+        case 6:
+            if (l4 + 14 > dgram_size) {
+                return 0;
+            }
+            flags = dgram[l4 + 13];
+            //  INFO(Santiago): an answer with ACK acknowledges the probe, a RST without it takes the
+            //                  probe's acknowledgement as its sequence number.
+            key->cookie_kind = ((flags & 0x10) ? kCookieAck : kCookieSeq);
+            key->cookie = get_u32(&dgram[l4 + ((flags & 0x10) ? 8 : 4)]);
+            if (flags & 0x04) {
+                *type = kReplyTcpRst;
+            } else if ((flags & 0x12) == 0x12) {
+                *type = kReplyTcpSynAck;
+            } else {
+                *type = kReplyTcpOther;
+            }
+            break;
+
+        case 17:
+            *type = kReplyUdp;
+            break;
+
+        case 1:
+            if (l4 + 8 > dgram_size) {
+                return 0;
+            }
+            switch (dgram[l4]) {
+                case 0:
+                    key->src_port = reply.src_port;
+                    key->dst_port = reply.dst_port;
+                    *type = kReplyIcmpEcho;
+                    break;
+
+                case 3:
+                case 4:
+                case 5:
+                case 11:
+                case 12:
+                    if (!get_pig_tx_key(&dgram[l4 + 8], dgram_size - l4 - 8, key)) {
+                        return 0;
+                    }
+                    key->cookie_kind = kCookieIpId;
+                    key->cookie = key->ip_id;
+                    if (dgram[l4] == 3) {
+                        //  INFO(Santiago): codes 9, 10 and 13 mean "administratively prohibited", the usual
+                        //                  answer of a firewall or an IPS.
+                        *type = ((dgram[l4 + 1] == 9 || dgram[l4 + 1] == 10 || dgram[l4 + 1] == 13) ? kReplyIcmpProhibited : kReplyIcmpUnreach);
+                    } else {
+                        *type = kReplyIcmpOther;
+                    }
+                    break;
+
+                default:
+                    return 0;
+            }
+            break;
+
+        default:
+            return 0;
+    }
+    return 1;
+}
+
+void pig_replies_stamp(pig_replies_ctx *replies, pig_frame_ctx *frame) {
+    unsigned int cookie = 0;
+    unsigned char bytes[2];
+    size_t signature = 0;
+    if (replies == NULL || !replies->with_rtt || frame->packet == NULL || frame->packet_size < 20 || (frame->packet[0] >> 4) != 4) {
+        return;
+    }
+    signature = get_signature_index(replies, frame->signature);
+    if (signature == replies->signatures_count || !replies->free_ip_id[signature]) {
+        return;
+    }
+    //  INFO(Santiago): the ICMP echo sequence number comes from the signature's icmp.payload, it is never touched.
+    cookie = __atomic_fetch_add(&replies->cookie, 1, __ATOMIC_RELAXED);
+    bytes[0] = (cookie >> 8) & 0xff;
+    bytes[1] = cookie & 0xff;
+    patch_ip4_hdr(frame->packet, frame->packet_size, 4, bytes, 2);
+}
+
+void pig_replies_record(pig_replies_ctx *replies, const pig_frame_ctx *frame) {
+    pig_tx_key_ctx key;
+    pig_tx_entry_ctx *entry = NULL;
+    unsigned int seq = 0;
+    size_t signature = 0;
+    if (replies == NULL || frame->packet == NULL || !get_pig_tx_key(frame->packet, frame->packet_size, &key)) {
+        return;
+    }
+    signature = get_signature_index(replies, frame->signature);
+    if (signature == replies->signatures_count) {
+        return;
+    }
+    __atomic_fetch_add(&replies->stats[signature].sent, 1, __ATOMIC_RELAXED);
+    entry = &replies->table[hash_key(&key)];
+    seq = __atomic_load_n(&entry->seq, __ATOMIC_RELAXED);
+    if ((seq & 1) || !__atomic_compare_exchange_n(&entry->seq, &seq, seq + 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        return;
+    }
+    __atomic_store_n(&entry->src_addr, key.src_addr, __ATOMIC_RELAXED);
+    __atomic_store_n(&entry->dst_addr, key.dst_addr, __ATOMIC_RELAXED);
+    __atomic_store_n(&entry->ports, ((unsigned int)key.src_port << 16) | key.dst_port, __ATOMIC_RELAXED);
+    __atomic_store_n(&entry->proto, key.proto, __ATOMIC_RELAXED);
+    __atomic_store_n(&entry->signature, (unsigned int)signature + 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&entry->ip_id, key.ip_id, __ATOMIC_RELAXED);
+    __atomic_store_n(&entry->next_seq, key.next_seq, __ATOMIC_RELAXED);
+    __atomic_store_n(&entry->ack, key.ack, __ATOMIC_RELAXED);
+    __atomic_store_n(&entry->sent_at, (replies->with_rtt ? pig_wall_clock_ns() : 0), __ATOMIC_RELAXED);
+    __atomic_store_n(&entry->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+void pig_replies_sent(pig_replies_ctx *replies, const pig_frame_ctx *frame, const unsigned long long sent_at) {
+    pig_tx_key_ctx key;
+    pig_tx_entry_ctx *entry = NULL;
+    unsigned int seq = 0;
+    if (replies == NULL || !replies->with_rtt || frame->packet == NULL || !get_pig_tx_key(frame->packet, frame->packet_size, &key)) {
+        return;
+    }
+    //  INFO(Santiago): the record is written before the packet goes out (with a provisional time), here it gets
+    //                  the time the packet really left, unless the entry was taken by another packet meanwhile.
+    entry = &replies->table[hash_key(&key)];
+    seq = __atomic_load_n(&entry->seq, __ATOMIC_RELAXED);
+    if ((seq & 1) || !__atomic_compare_exchange_n(&entry->seq, &seq, seq + 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+        return;
+    }
+    if (__atomic_load_n(&entry->src_addr, __ATOMIC_RELAXED) == key.src_addr &&
+        __atomic_load_n(&entry->dst_addr, __ATOMIC_RELAXED) == key.dst_addr &&
+        __atomic_load_n(&entry->ports, __ATOMIC_RELAXED) == (((unsigned int)key.src_port << 16) | key.dst_port) &&
+        __atomic_load_n(&entry->proto, __ATOMIC_RELAXED) == key.proto &&
+        __atomic_load_n(&entry->ip_id, __ATOMIC_RELAXED) == key.ip_id &&
+        __atomic_load_n(&entry->sent_at, __ATOMIC_RELAXED) < sent_at) {
+        __atomic_store_n(&entry->sent_at, sent_at, __ATOMIC_RELAXED);
+    }
+    __atomic_store_n(&entry->seq, seq + 2, __ATOMIC_RELEASE);
+}
+
+int pig_replies_match(pig_replies_ctx *replies, const unsigned char *dgram, const size_t dgram_size, const unsigned long long received_at) {
+    pig_tx_key_ctx key;
+    pig_reply_type_t type = kReplyTcpOther;
+    pig_tx_entry_ctx *entry = NULL;
+    pig_rtt_pair_ctx *pair = NULL;
+    unsigned int seq = 0, signature = 0, ip_id = 0, next_seq = 0, ack = 0;
+    unsigned long long sent_at = 0, rtt = 0;
+    int is_match = 0;
+    replies->captured++;
+    if (!get_pig_reply_key(dgram, dgram_size, &key, &type)) {
+        replies->unmatched++;
+        return 0;
+    }
+    entry = &replies->table[hash_key(&key)];
+    seq = __atomic_load_n(&entry->seq, __ATOMIC_ACQUIRE);
+    if ((seq & 1) == 0) {
+        is_match = (__atomic_load_n(&entry->src_addr, __ATOMIC_RELAXED) == key.src_addr &&
+                    __atomic_load_n(&entry->dst_addr, __ATOMIC_RELAXED) == key.dst_addr &&
+                    __atomic_load_n(&entry->ports, __ATOMIC_RELAXED) == (((unsigned int)key.src_port << 16) | key.dst_port) &&
+                    __atomic_load_n(&entry->proto, __ATOMIC_RELAXED) == key.proto);
+        signature = __atomic_load_n(&entry->signature, __ATOMIC_RELAXED);
+        ip_id = __atomic_load_n(&entry->ip_id, __ATOMIC_RELAXED);
+        next_seq = __atomic_load_n(&entry->next_seq, __ATOMIC_RELAXED);
+        ack = __atomic_load_n(&entry->ack, __ATOMIC_RELAXED);
+        sent_at = __atomic_load_n(&entry->sent_at, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_ACQUIRE);
+        is_match = (is_match && signature > 0 && __atomic_load_n(&entry->seq, __ATOMIC_RELAXED) == seq);
+    }
+    if (!is_match) {
+        replies->unmatched++;
+        return 0;
+    }
+    replies->stats[signature - 1].replies[type]++;
+    if (replies->with_rtt) {
+        if (!is_cookie_ok(&key, ip_id, next_seq, ack)) {
+            replies->stale++;
+        } else {
+            //  INFO(Santiago): the departure of a packet sent in a burst is an estimate (see pig_replies_sent()),
+            //                  a reply arriving before it was quicker than the estimate can tell.
+            rtt = (received_at > sent_at ? received_at - sent_at : 0);
+            pig_rtt_hist_add(&replies->rtt[signature - 1], rtt);
+            pair = get_rtt_pair(replies, signature, key.dst_addr);
+            if (pair != NULL) {
+                pig_rtt_hist_add(&pair->hist, rtt);
+            }
+        }
+    }
+    return 1;
+}
+
+#ifdef __linux
+static void on_reply(const unsigned char *dgram, const size_t dgram_size, const unsigned long long timestamp, void *arg) {
+    pig_replies_match((pig_replies_ctx *)arg, dgram, dgram_size, timestamp);
+}
+#endif
+
+static void *capture_replies(void *arg) {
+    pig_replies_ctx *replies = (pig_replies_ctx *)arg;
+#ifdef __linux
+    while (!__atomic_load_n(&replies->should_stop, __ATOMIC_ACQUIRE)) {
+        lin_rxring_read((lin_rxring_ctx *)replies->ring, PIG_REPLIES_READ_TIMEOUT, on_reply, replies);
+    }
+    //  INFO(Santiago): whatever is still in the ring was received before the stop.
+    while (lin_rxring_read((lin_rxring_ctx *)replies->ring, 0, on_reply, replies) > 0)
+        ;
+#endif
+    return NULL;
+}
+
+int pig_replies_start(pig_replies_ctx *replies, const char *iface, const int is_device, const int has_l2) {
+    if (replies == NULL) {
+        return 0;
+    }
+#ifdef __linux
+    replies->ring = lin_rxring_open(iface, is_device, has_l2);
+    if (replies->ring == NULL) {
+        printf("pig PANIC: unable to capture the replies on \"%s\".\n", iface);
+        return 0;
+    }
+    if (!((lin_rxring_ctx *)replies->ring)->has_rx_stamps) {
+        printf("pig WARNING: no receive time stamps on \"%s\", the replies are stamped by the capture (the RTTs get a bit longer).\n", iface);
+    }
+    replies->should_stop = 0;
+    if (!pig_mk_helper_thread(&replies->thread, capture_replies, replies)) {
+        printf("pig PANIC: unable to start the replies capture.\n");
+        lin_rxring_close((lin_rxring_ctx *)replies->ring);
+        replies->ring = NULL;
+        return 0;
+    }
+    replies->has_thread = 1;
+    return 1;
+#else
+    printf("pig PANIC: the replies capture is not supported on this platform.\n");
+    return 0;
+#endif
+}
+
+void pig_replies_stop(pig_replies_ctx *replies, const unsigned long long wait) {
+    if (replies == NULL || !replies->has_thread) {
+        return;
+    }
+    if (wait > 0) {
+        pig_sleep_ns(wait);
+    }
+    __atomic_store_n(&replies->should_stop, 1, __ATOMIC_RELEASE);
+    pthread_join(replies->thread, NULL);
+    replies->has_thread = 0;
+#ifdef __linux
+    lin_rxring_stats((lin_rxring_ctx *)replies->ring, &replies->ring_packets, &replies->ring_drops);
+    lin_rxring_close((lin_rxring_ctx *)replies->ring);
+#endif
+    replies->ring = NULL;
+}
+
+void pig_replies_stats(const pig_replies_ctx *replies) {
+    const pig_reply_stats_ctx *stats = NULL;
+    size_t s = 0, p = 0, pairs_nr = 0;
+    char summary[256];
+    unsigned char *target = NULL;
+    if (replies == NULL) {
+        return;
+    }
+    printf("pig INFO: %llu repl%s captured, %llu not matching any recent packet, %llu dropped by the capture ring.\n",
+           replies->captured, (replies->captured == 1 ? "y" : "ies"), replies->unmatched, replies->ring_drops);
+    if (replies->with_rtt) {
+        printf("pig INFO: %llu repl%s to older packets gave no round trip time, %llu sample(s) exceeded the %d signature/target pairs.\n",
+               replies->stale, (replies->stale == 1 ? "y" : "ies"), replies->pairs_overflow, PIG_REPLIES_MAX_PAIRS);
+    }
+    for (s = 0; s < replies->signatures_count; s++) {
+        stats = &replies->stats[s];
+        if (stats->sent == 0) {
+            continue;
+        }
+        printf("pig INFO: signature \"%s\": %llu sent, replies: %llu RST, %llu SYN-ACK, %llu other TCP, %llu UDP, %llu echo, "
+               "%llu unreachable, %llu prohibited, %llu other ICMP.\n", replies->signatures[s]->signature_name, stats->sent,
+               stats->replies[kReplyTcpRst], stats->replies[kReplyTcpSynAck], stats->replies[kReplyTcpOther], stats->replies[kReplyUdp],
+               stats->replies[kReplyIcmpEcho], stats->replies[kReplyIcmpUnreach], stats->replies[kReplyIcmpProhibited],
+               stats->replies[kReplyIcmpOther]);
+        if (!replies->with_rtt || replies->rtt[s].count == 0) {
+            continue;
+        }
+        pig_rtt_hist_summary(&replies->rtt[s], summary, sizeof(summary));
+        printf("pig INFO: signature \"%s\" round trip: %s.\n", replies->signatures[s]->signature_name, summary);
+        for (p = 0, pairs_nr = 0; p < PIG_REPLIES_MAX_PAIRS * 2; p++) {
+            pairs_nr += (replies->pairs[p].signature == s + 1);
+        }
+        //  INFO(Santiago): one line per target only when there is more than one.
+        for (p = 0; pairs_nr > 1 && p < PIG_REPLIES_MAX_PAIRS * 2; p++) {
+            if (replies->pairs[p].signature != s + 1) {
+                continue;
+            }
+            target = (unsigned char *)&replies->pairs[p].target;
+            pig_rtt_hist_summary(&replies->pairs[p].hist, summary, sizeof(summary));
+            printf("pig INFO:     to %d.%d.%d.%d: %s.\n", target[0], target[1], target[2], target[3], summary);
+        }
+    }
+}
@@ -0,0 +1,128 @@
+/*
+ *                                Copyright (C) 2015 by Rafael Santiago
+ *
+ * This is a free software. You can redistribute it and/or modify under
+ * the terms of the GNU General Public License version 2.
+ *
+ */
+#ifndef PIG_REPLIES_H
+#define PIG_REPLIES_H 1
+
+#include "types.h"
+#include "rtt.h"
+#include <pthread.h>
+
+#define PIG_REPLIES_TABLE_BITS 16
+
+#define PIG_REPLIES_TABLE_SIZE (1 << PIG_REPLIES_TABLE_BITS)
+
+#define PIG_REPLIES_DEFAULT_WAIT 1000000000ULL
+
+#define PIG_REPLIES_MAX_PAIRS 256
+
+typedef enum _pig_reply_type {
+    kReplyTcpRst,
+    kReplyTcpSynAck,
+    kReplyTcpOther,
+    kReplyUdp,
+    kReplyIcmpEcho,
+    kReplyIcmpUnreach,
+    kReplyIcmpProhibited,
+    kReplyIcmpOther,
+    kReplyTypesNr
+}pig_reply_type_t;
+
+typedef enum _pig_cookie_kind {
+    kCookieNone,
+    kCookieAck,
+    kCookieSeq,
+    kCookieIpId
+}pig_cookie_kind_t;
+
+typedef struct _pig_tx_key {
+    unsigned int src_addr;
+    unsigned int dst_addr;
+    unsigned short src_port;
+    unsigned short dst_port;
+    unsigned char proto;
+    unsigned short ip_id;
+    unsigned int next_seq;
+    unsigned int ack;
+    pig_cookie_kind_t cookie_kind;
+    unsigned int cookie;
+}pig_tx_key_ctx;
+
+typedef struct _pig_tx_entry {
+    unsigned int seq;
+    unsigned int src_addr;
+    unsigned int dst_addr;
+    unsigned int ports;
+    unsigned int proto;
+    unsigned int signature;
+    unsigned int ip_id;
+    unsigned int next_seq;
+    unsigned int ack;
+    unsigned long long sent_at;
+}pig_tx_entry_ctx;
+
+typedef struct _pig_reply_stats {
+    unsigned long long sent;
+    unsigned long long replies[kReplyTypesNr];
+}pig_reply_stats_ctx;
+
+typedef struct _pig_rtt_pair {
+    unsigned int signature;
+    unsigned int target;
+    pig_rtt_hist_ctx hist;
+}pig_rtt_pair_ctx;
+
+typedef struct _pig_replies {
+    pigsty_entry_ctx **signatures;
+    size_t signatures_count;
+    pig_signature_index_ctx *index;
+    size_t index_mask;
+    pig_tx_entry_ctx *table;
+    pig_reply_stats_ctx *stats;
+    int with_rtt;
+    unsigned char *free_ip_id;
+    unsigned int cookie;
+    pig_rtt_hist_ctx *rtt;
+    pig_rtt_pair_ctx *pairs;
+    size_t pairs_nr;
+    unsigned long long pairs_overflow;
+    unsigned long long stale;
+    unsigned long long captured;
+    unsigned long long unmatched;
+    unsigned long long ring_packets;
+    unsigned long long ring_drops;
+    void *ring;
+    pthread_t thread;
+    int has_thread;
+    int should_stop;
+}pig_replies_ctx;
+
+pig_replies_ctx *mk_pig_replies(pigsty_entry_ctx **signatures, const size_t signatures_count);
+
+void del_pig_replies(pig_replies_ctx *replies);
+
+int get_pig_tx_key(const unsigned char *dgram, const size_t dgram_size, pig_tx_key_ctx *key);
+
+int get_pig_reply_key(const unsigned char *dgram, const size_t dgram_size, pig_tx_key_ctx *key, pig_reply_type_t *type);
+
+int pig_replies_enable_rtt(pig_replies_ctx *replies);
+
+void pig_replies_stamp(pig_replies_ctx *replies, pig_frame_ctx *frame);
+
+void pig_replies_record(pig_replies_ctx *replies, const pig_frame_ctx *frame);
+
+void pig_replies_sent(pig_replies_ctx *replies, const pig_frame_ctx *frame, const unsigned long long sent_at);
+
+int pig_replies_match(pig_replies_ctx *replies, const unsigned char *dgram, const size_t dgram_size, const unsigned long long received_at);
+
+int pig_replies_start(pig_replies_ctx *replies, const char *iface, const int is_device, const int has_l2);
+
+void pig_replies_stop(pig_replies_ctx *replies, const unsigned long long wait);
+
+void pig_replies_stats(const pig_replies_ctx *replies);
+
+#endif
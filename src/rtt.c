@@ -0,0 +1,90 @@
+/*
+ *                                Copyright (C) 2015 by Rafael Santiago
+ *
+ * This is a free software. You can redistribute it and/or modify under
+ * the terms of the GNU General Public License version 2.
+ *
+ */
+#include "rtt.h"
+#include <stdio.h>
+#include <time.h>
+
+//  INFO(Santiago): log-linear histogram, every power of two is split in 2^PIG_RTT_SUB_BITS buckets, so
+//                  a percentile is off by 6% at most from 1 ns to centuries in 4 KB.
+
+static size_t get_bucket(const unsigned long long ns);
+
+static unsigned long long get_bucket_floor(const size_t bucket, unsigned long long *width);
+
+static size_t get_bucket(const unsigned long long ns) {
+    int msb = 0;
+    if (ns < (1 << PIG_RTT_SUB_BITS)) {
+        return (size_t)ns;
+    }
+    msb = 63 - __builtin_clzll(ns);
+    return ((size_t)(msb - PIG_RTT_SUB_BITS + 1) << PIG_RTT_SUB_BITS) + ((ns >> (msb - PIG_RTT_SUB_BITS)) & ((1 << PIG_RTT_SUB_BITS) - 1));
+}
+
+static unsigned long long get_bucket_floor(const size_t bucket, unsigned long long *width) {
+    int msb = 0;
+    if (bucket < (1 << PIG_RTT_SUB_BITS)) {
+        *width = 1;
+        return bucket;
+    }
+    msb = (int)(bucket >> PIG_RTT_SUB_BITS) - 1 + PIG_RTT_SUB_BITS;
+    *width = 1ULL << (msb - PIG_RTT_SUB_BITS);
+    return ((1ULL << PIG_RTT_SUB_BITS) + (bucket & ((1 << PIG_RTT_SUB_BITS) - 1))) << (msb - PIG_RTT_SUB_BITS);
+}
+
+unsigned long long pig_wall_clock_ns() {
+    struct timespec ts;
+    //  INFO(Santiago): the kernel stamps the received packets with the wall clock.
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void pig_rtt_hist_add(pig_rtt_hist_ctx *hist, const unsigned long long ns) {
+    hist->buckets[get_bucket(ns)]++;
+    if (hist->count == 0 || ns < hist->min) {
+        hist->min = ns;
+    }
+    if (ns > hist->max) {
+        hist->max = ns;
+    }
+    hist->count++;
+    hist->sum += ns;
+}
+
+unsigned long long get_pig_rtt_percentile(const pig_rtt_hist_ctx *hist, const double q) {
+    unsigned long long rank = 0, seen = 0, floor = 0, width = 0, value = 0;
+    size_t b = 0;
+    if (hist == NULL || hist->count == 0) {
+        return 0;
+    }
+    rank = (unsigned long long)(q * (double)hist->count);
+    if (rank >= hist->count) {
+        rank = hist->count - 1;
+    }
+    for (b = 0; b < PIG_RTT_BUCKETS; b++) {
+        seen += hist->buckets[b];
+        if (seen > rank) {
+            break;
+        }
+    }
+    floor = get_bucket_floor(b, &width);
+    value = floor + width / 2;
+    if (value < hist->min) {
+        value = hist->min;
+    }
+    if (value > hist->max) {
+        value = hist->max;
+    }
+    return value;
+}
+
+void pig_rtt_hist_summary(const pig_rtt_hist_ctx *hist, char *buf, const size_t buf_size) {
+    snprintf(buf, buf_size, "%llu sample(s), min %.1f us, p50 %.1f us, p90 %.1f us, p99 %.1f us, max %.1f us",
+             hist->count, (double)hist->min / 1000.0, (double)get_pig_rtt_percentile(hist, 0.5) / 1000.0,
+             (double)get_pig_rtt_percentile(hist, 0.9) / 1000.0, (double)get_pig_rtt_percentile(hist, 0.99) / 1000.0,
+             (double)hist->max / 1000.0);
+}
@@ -0,0 +1,33 @@
+/*
+ *                                Copyright (C) 2015 by Rafael Santiago
+ *
+ * This is a free software. You can redistribute it and/or modify under
+ * the terms of the GNU General Public License version 2.
+ *
+ */
+#ifndef PIG_RTT_H
+#define PIG_RTT_H 1
+
+#include <stdlib.h>
+
+#define PIG_RTT_SUB_BITS 3
+
+#define PIG_RTT_BUCKETS (64 << PIG_RTT_SUB_BITS)
+
+typedef struct _pig_rtt_hist {
+    unsigned long long buckets[PIG_RTT_BUCKETS];
+    unsigned long long count;
+    unsigned long long sum;
+    unsigned long long min;
+    unsigned long long max;
+}pig_rtt_hist_ctx;
+
+unsigned long long pig_wall_clock_ns();
+
+void pig_rtt_hist_add(pig_rtt_hist_ctx *hist, const unsigned long long ns);
+
+unsigned long long get_pig_rtt_percentile(const pig_rtt_hist_ctx *hist, const double q);
+
+void pig_rtt_hist_summary(const pig_rtt_hist_ctx *hist, char *buf, const size_t buf_size);
+
+#endif
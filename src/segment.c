@@ -0,0 +1,120 @@
+/*
+ *                                Copyright (C) 2015 by Rafael Santiago
+ *
+ * This is a free software. You can redistribute it and/or modify under
+ * the terms of the GNU General Public License version 2.
+ *
+ */
+#include "segment.h"
+#include "chsum.h"
+#include <string.h>
+
+//  INFO(Santiago): a TCP datagram carrying more than one MSS of payload is cut into segments that a
+//                  real stack would have sent: the headers (options included) are repeated, the
+//                  sequence numbers follow the payload, the IP ID goes up by one per segment, SYN stays
+//                  in the first segment and FIN/PSH in the last one. IP fragments are never cut. The
+//                  segments are written back to back into a buffer given by the caller.
+
+#define get_u16(b) ( ((unsigned short)(b)[0] << 8) | (b)[1] )
+
+#define get_u32(b) ( ((unsigned int)(b)[0] << 24) | ((unsigned int)(b)[1] << 16) | ((unsigned int)(b)[2] << 8) | (b)[3] )
+
+#define put_u16(b, w) ( (b)[0] = ((w) & 0xff00) >> 8, (b)[1] = (w) & 0x00ff )
+
+#define put_u32(b, d) ( (b)[0] = ((d) >> 24) & 0xff, (b)[1] = ((d) >> 16) & 0xff, (b)[2] = ((d) >> 8) & 0xff, (b)[3] = (d) & 0xff )
+
+#define PIG_TCP_FIN 0x01
+
+#define PIG_TCP_SYN 0x02
+
+#define PIG_TCP_PSH 0x08
+
+size_t get_pig_tcp_hdrs_size(const unsigned char *dgram, const size_t dgram_size, const size_t mss) {
+    size_t l4 = 0, hdrs_size = 0;
+    if (dgram == NULL || mss == 0 || dgram_size < 40 || (dgram[0] >> 4) != 4 || dgram[9] != 6 || (get_u16(&dgram[6]) & 0x3fff) != 0) {
+        return 0;
+    }
+    l4 = (dgram[0] & 0x0f) * 4;
+    if (l4 < 20 || l4 + 20 > dgram_size) {
+        return 0;
+    }
+    hdrs_size = l4 + (dgram[l4 + 12] >> 4) * 4;
+    if (hdrs_size < l4 + 20 || hdrs_size >= dgram_size || dgram_size - hdrs_size <= mss) {
+        return 0;
+    }
+    return hdrs_size;
+}
+
+size_t get_pig_tcp_segments_nr(const unsigned char *dgram, const size_t dgram_size, const size_t mss) {
+    size_t hdrs_size = get_pig_tcp_hdrs_size(dgram, dgram_size, mss);
+    if (hdrs_size == 0) {
+        return 0;
+    }
+    return (dgram_size - hdrs_size + mss - 1) / mss;
+}
+
+size_t get_pig_tcp_segments_size(const unsigned char *dgram, const size_t dgram_size, const size_t mss) {
+    size_t hdrs_size = get_pig_tcp_hdrs_size(dgram, dgram_size, mss);
+    if (hdrs_size == 0) {
+        return 0;
+    }
+    return dgram_size + (get_pig_tcp_segments_nr(dgram, dgram_size, mss) - 1) * hdrs_size;
+}
+
+int is_pig_tcp_gso_dgram(const unsigned char *dgram, const size_t dgram_size, const size_t mss) {
+    size_t hdrs_size = get_pig_tcp_hdrs_size(dgram, dgram_size, mss);
+    //  WARN(Santiago): the kernel would repeat a SYN in every segment, so this one must be cut here.
+    return (hdrs_size > 0 && (dgram[(dgram[0] & 0x0f) * 4 + 13] & PIG_TCP_SYN) == 0);
+}
+
+int mk_pig_tcp_segments(const pig_frame_ctx *frame, const size_t mss, pig_frame_ctx *segments, const size_t segments_max, unsigned char *data) {
+    const unsigned char *dgram = frame->packet;
+    unsigned char *segment = NULL;
+    size_t l4 = 0, hdrs_size = 0, payload_size = 0, segments_nr = 0, s = 0, offset = 0, len = 0;
+    unsigned int seq = 0;
+    unsigned short id = 0;
+    unsigned char flags = 0;
+    hdrs_size = get_pig_tcp_hdrs_size(dgram, frame->packet_size, mss);
+    if (hdrs_size == 0) {
+        return 0;
+    }
+    payload_size = frame->packet_size - hdrs_size;
+    segments_nr = (payload_size + mss - 1) / mss;
+    if (segments_nr > segments_max) {
+        return -1;
+    }
+    l4 = (dgram[0] & 0x0f) * 4;
+    seq = get_u32(&dgram[l4 + 4]);
+    id = get_u16(&dgram[4]);
+    flags = dgram[l4 + 13];
+    for (s = 0; s < segments_nr; s++) {
+        offset = s * mss;
+        len = (payload_size - offset > mss ? mss : payload_size - offset);
+        segments[s] = *frame;
+        segments[s].sent = 0;
+        segment = data;
+        data += hdrs_size + len;
+        memcpy(segment, dgram, hdrs_size);
+        memcpy(&segment[hdrs_size], &dgram[hdrs_size + offset], len);
+        put_u16(&segment[2], hdrs_size + len);
+        put_u16(&segment[4], (unsigned short)(id + s));
+        //  INFO(Santiago): a SYN takes one sequence number before the data.
+        put_u32(&segment[l4 + 4], seq + offset + ((s > 0 && (flags & PIG_TCP_SYN)) ? 1 : 0));
+        segment[l4 + 13] = flags & ~((s > 0 ? PIG_TCP_SYN : 0) | (s + 1 < segments_nr ? (PIG_TCP_FIN | PIG_TCP_PSH) : 0));
+        chsum_ip4_hdr(segment, hdrs_size + len);
+        chsum_ip4_l4(segment, hdrs_size + len);
+        segments[s].packet = segment;
+        segments[s].packet_size = hdrs_size + len;
+    }
+    return segments_nr;
+}
+
+unsigned short get_pig_tcp_pseudo_chsum(const unsigned char *dgram, const size_t dgram_size) {
+    unsigned int sum = 0;
+    //  INFO(Santiago): what goes in the checksum field when the rest is left to the kernel (or to the NIC),
+    //                  the pseudo header folded but not complemented.
+    sum = chsum_partial(&dgram[12], 8, 0);
+    sum += dgram[9];
+    sum += dgram_size - (dgram[0] & 0x0f) * 4;
+    return chsum_fold(sum);
+}
@@ -0,0 +1,25 @@
+/*
+ *                                Copyright (C) 2015 by Rafael Santiago
+ *
+ * This is a free software. You can redistribute it and/or modify under
+ * the terms of the GNU General Public License version 2.
+ *
+ */
+#ifndef PIG_SEGMENT_H
+#define PIG_SEGMENT_H 1
+
+#include "types.h"
+
+size_t get_pig_tcp_hdrs_size(const unsigned char *dgram, const size_t dgram_size, const size_t mss);
+
+size_t get_pig_tcp_segments_nr(const unsigned char *dgram, const size_t dgram_size, const size_t mss);
+
+size_t get_pig_tcp_segments_size(const unsigned char *dgram, const size_t dgram_size, const size_t mss);
+
+int is_pig_tcp_gso_dgram(const unsigned char *dgram, const size_t dgram_size, const size_t mss);
+
+int mk_pig_tcp_segments(const pig_frame_ctx *frame, const size_t mss, pig_frame_ctx *segments, const size_t segments_max, unsigned char *data);
+
+unsigned short get_pig_tcp_pseudo_chsum(const unsigned char *dgram, const size_t dgram_size);
+
+#endif
@@ -0,0 +1,628 @@
+/*
+ *                                Copyright (C) 2015 by Rafael Santiago
+ *
+ * This is a free software. You can redistribute it and/or modify under
+ * the terms of the GNU General Public License version 2.
+ *
+ */
+#include "session.h"
+#include "chsum.h"
+#include "mkrnd.h"
+#include "memory.h"
+#include <stdio.h>
+#include <string.h>
+
+//  INFO(Santiago): a TCP signature becomes a whole session: three-way handshake, the payload in data
+//                  segments (each one acknowledged by the peer), and the four-way close. Both sides are
+//                  synthesized, the "server" packets are just the client ones with everything swapped.
+//                  The side with the lower port is taken as the server, so the signature payload goes
+//                  from the client for requests (tcp.dst = 80) and from the server for responses
+//                  (tcp.src = 80), keeping the direction written in the signature.
+//
+//                  The table is made to hold millions of flows. A flow is a fixed 48 bytes record taken
+//                  from slabs of PIG_SESSION_SLAB_SIZE records (allocated on demand, reused through a
+//                  free list) and named by its 32-bit index. The records are found by their 4-tuple
+//                  through an open addressing (linear probing) index with 2 to 4 buckets of 4 bytes per
+//                  flow. The IP header and the payload are not in the record, they come from a template
+//                  shared by up to PIG_SESSION_TEMPLATE_REUSE flows of the same signature (each flow
+//                  keeps its own addresses and ports). So a flow costs at most 64 bytes plus its share
+//                  of a template.
+//
+//                  The next segment of each flow is driven by a hierarchical timer wheel (4 levels of 64
+//                  slots, ticks of PIG_SESSION_TICK ns) chained through the records themselves: scheduling
+//                  and expiring a flow are O(1), whatever the number of flows in the table.
+
+#define get_u16(b) ( ((unsigned short)(b)[0] << 8) | (b)[1] )
+
+#define put_u16(b, w) ( (b)[0] = ((w) & 0xff00) >> 8, (b)[1] = (w) & 0x00ff )
+
+#define put_u32(b, d) ( (b)[0] = ((d) >> 24) & 0xff, (b)[1] = ((d) >> 16) & 0xff, (b)[2] = ((d) >> 8) & 0xff, (b)[3] = (d) & 0xff )
+
+#define get_flow(t, id) ( &(t)->slabs[(id) >> PIG_SESSION_SLAB_SHIFT][(id) & (PIG_SESSION_SLAB_SIZE - 1)] )
+
+#define PIG_TCP_FIN 0x01
+
+#define PIG_TCP_SYN 0x02
+
+#define PIG_TCP_PSH 0x08
+
+#define PIG_TCP_ACK 0x10
+
+#define PIG_SESSION_REMAP_TRIES 64
+
+#define is_stressed(t) ( (t)->is_shuffled || (t)->overlap > 0 || (t)->retransmits > 0 )
+
+static unsigned int hash_flow(const unsigned int client_addr, const unsigned short client_port, const unsigned int server_addr, const unsigned short server_port);
+
+static size_t find_bucket(const pig_flow_table_ctx *table, const unsigned int client_addr, const unsigned short client_port,
+                          const unsigned int server_addr, const unsigned short server_port);
+
+static void unindex_flow(pig_flow_table_ctx *table, const unsigned int id);
+
+static unsigned int alloc_flow(pig_flow_table_ctx *table);
+
+static void close_flow(pig_flow_table_ctx *table, const unsigned int id);
+
+static pig_flow_template_ctx *get_template(pig_flow_table_ctx *table, pig_frame_ctx *frame);
+
+static void release_template(pig_flow_table_ctx *table, pig_flow_template_ctx *template);
+
+static void due_flow(pig_flow_table_ctx *table, const unsigned int id);
+
+static void schedule_flow(pig_flow_table_ctx *table, const unsigned int id, unsigned long long expires);
+
+static void cascade_wheel(pig_flow_table_ctx *table, const size_t level, const size_t slot);
+
+static void advance_wheel(pig_flow_table_ctx *table, const unsigned long long tick);
+
+static unsigned char *mk_segment(pig_flow_ctx *flow, const int from_client, const unsigned char flags, const unsigned int seq, const unsigned int ack,
+                                 const unsigned char *head, const size_t head_size, const unsigned char *payload, const size_t payload_size,
+                                 size_t *segment_size);
+
+static size_t get_pieces_nr(const pig_flow_table_ctx *table, const size_t payload_total);
+
+static size_t get_piece(const pig_flow_table_ctx *table, const pig_flow_ctx *flow, const size_t pieces_nr, const size_t plan_index);
+
+static const unsigned char *get_conflict(pig_flow_template_ctx *template, const unsigned char *payload, const size_t payload_total);
+
+static unsigned int hash_flow(const unsigned int client_addr, const unsigned short client_port, const unsigned int server_addr, const unsigned short server_port) {
+    unsigned int h = client_addr * 0x9e3779b1;
+    h ^= server_addr * 0x85ebca6b;
+    h ^= (((unsigned int)client_port << 16) | server_port) * 0xc2b2ae35;
+    h ^= h >> 15;
+    h *= 0x2c1b3c6d;
+    h ^= h >> 13;
+    return h;
+}
+
+static size_t find_bucket(const pig_flow_table_ctx *table, const unsigned int client_addr, const unsigned short client_port,
+                          const unsigned int server_addr, const unsigned short server_port) {
+    size_t b = hash_flow(client_addr, client_port, server_addr, server_port) & table->buckets_mask;
+    const pig_flow_ctx *flow = NULL;
+    while (table->buckets[b] != 0) {
+        flow = get_flow(table, table->buckets[b] - 1);
+        if (flow->client_addr == client_addr && flow->client_port == client_port &&
+            flow->server_addr == server_addr && flow->server_port == server_port) {
+            break;
+        }
+        b = (b + 1) & table->buckets_mask;
+    }
+    return b;
+}
+
+static void unindex_flow(pig_flow_table_ctx *table, const unsigned int id) {
+    const pig_flow_ctx *flow = get_flow(table, id);
+    size_t hole = find_bucket(table, flow->client_addr, flow->client_port, flow->server_addr, flow->server_port);
+    size_t b = hole, home = 0;
+    table->buckets[hole] = 0;
+    //  INFO(Santiago): backward shift deletion, the entries after the hole that could live in it move
+    //                  back, so the probing sequences stay unbroken without tombstones.
+    for (b = (hole + 1) & table->buckets_mask; table->buckets[b] != 0; b = (b + 1) & table->buckets_mask) {
+        flow = get_flow(table, table->buckets[b] - 1);
+        home = hash_flow(flow->client_addr, flow->client_port, flow->server_addr, flow->server_port) & table->buckets_mask;
+        if (((b - home) & table->buckets_mask) >= ((b - hole) & table->buckets_mask)) {
+            table->buckets[hole] = table->buckets[b];
+            table->buckets[b] = 0;
+            hole = b;
+        }
+    }
+}
+
+static unsigned int alloc_flow(pig_flow_table_ctx *table) {
+    unsigned int id = table->free_head;
+    size_t slab = 0, slab_size = 0;
+    if (id != PIG_SESSION_NIL) {
+        table->free_head = get_flow(table, id)->next;
+        return id;
+    }
+    if (table->allocated >= table->capacity) {
+        return PIG_SESSION_NIL;
+    }
+    id = (unsigned int)table->allocated++;
+    slab = id >> PIG_SESSION_SLAB_SHIFT;
+    if (table->slabs[slab] == NULL) {
+        slab_size = table->capacity - id;
+        if (slab_size > PIG_SESSION_SLAB_SIZE) {
+            slab_size = PIG_SESSION_SLAB_SIZE;
+        }
+        table->slabs[slab] = (pig_flow_ctx *) pig_newseg(sizeof(pig_flow_ctx) * slab_size);
+    }
+    return id;
+}
+
+static void close_flow(pig_flow_table_ctx *table, const unsigned int id) {
+    pig_flow_ctx *flow = get_flow(table, id);
+    unindex_flow(table, id);
+    release_template(table, flow->template);
+    flow->template = NULL;
+    flow->next = table->free_head;
+    table->free_head = id;
+    table->active_nr--;
+}
+
+static pig_flow_template_ctx *get_template(pig_flow_table_ctx *table, pig_frame_ctx *frame) {
+    size_t c = (((size_t)frame->signature >> 4) ^ frame->is_lo) % PIG_SESSION_TEMPLATE_CACHE;
+    pig_flow_template_ctx *template = table->cache[c];
+    if (template != NULL && template->frame.signature == frame->signature && template->frame.is_lo == frame->is_lo &&
+        template->uses < PIG_SESSION_TEMPLATE_REUSE) {
+        template->uses++;
+        template->refs++;
+        free(frame->packet);
+        frame->packet = NULL;
+        return template;
+    }
+    if (template != NULL) {
+        table->cache[c] = NULL;
+        release_template(table, template);
+    }
+    template = (pig_flow_template_ctx *) pig_newseg(sizeof(pig_flow_template_ctx));
+    memcpy(&template->frame, frame, sizeof(pig_frame_ctx));
+    template->conflict = NULL;
+    frame->packet = NULL;
+    //  INFO(Santiago): one reference from the cache, another from the flow.
+    template->refs = 2;
+    template->uses = 1;
+    template->prev = NULL;
+    template->next = table->templates;
+    if (table->templates != NULL) {
+        table->templates->prev = template;
+    }
+    table->templates = template;
+    table->templates_nr++;
+    table->cache[c] = template;
+    return template;
+}
+
+static void release_template(pig_flow_table_ctx *table, pig_flow_template_ctx *template) {
+    if (--template->refs > 0) {
+        return;
+    }
+    if (template->prev != NULL) {
+        template->prev->next = template->next;
+    } else {
+        table->templates = template->next;
+    }
+    if (template->next != NULL) {
+        template->next->prev = template->prev;
+    }
+    free(template->frame.packet);
+    free(template->conflict);
+    free(template);
+    table->templates_nr--;
+}
+
+static void due_flow(pig_flow_table_ctx *table, const unsigned int id) {
+    get_flow(table, id)->next = PIG_SESSION_NIL;
+    if (table->due_tail == PIG_SESSION_NIL) {
+        table->due_head = id;
+    } else {
+        get_flow(table, table->due_tail)->next = id;
+    }
+    table->due_tail = id;
+}
+
+static void schedule_flow(pig_flow_table_ctx *table, const unsigned int id, unsigned long long expires) {
+    pig_flow_ctx *flow = get_flow(table, id);
+    unsigned long long delta = 0;
+    size_t level = 0, slot = 0;
+    if (expires < table->now_tick) {
+        due_flow(table, id);
+        return;
+    }
+    delta = expires - table->now_tick;
+    if (delta >= PIG_SESSION_WHEEL_SPAN) {
+        delta = PIG_SESSION_WHEEL_SPAN - 1;
+        expires = table->now_tick + delta;
+    }
+    while (delta >= (1ULL << (PIG_SESSION_WHEEL_BITS * (level + 1)))) {
+        level++;
+    }
+    slot = (expires >> (PIG_SESSION_WHEEL_BITS * level)) & (PIG_SESSION_WHEEL_SLOTS - 1);
+    //  INFO(Santiago): the wheel spans less than 2^32 ticks, the low half of the expiry time is enough.
+    flow->expires = (unsigned int)expires;
+    flow->next = table->wheel[level][slot];
+    table->wheel[level][slot] = id;
+    table->scheduled++;
+}
+
+static void cascade_wheel(pig_flow_table_ctx *table, const size_t level, const size_t slot) {
+    unsigned int id = table->wheel[level][slot], next = 0;
+    pig_flow_ctx *flow = NULL;
+    table->wheel[level][slot] = PIG_SESSION_NIL;
+    while (id != PIG_SESSION_NIL) {
+        flow = get_flow(table, id);
+        next = flow->next;
+        table->scheduled--;
+        schedule_flow(table, id, table->now_tick + (unsigned int)(flow->expires - (unsigned int)table->now_tick));
+        id = next;
+    }
+}
+
+static void advance_wheel(pig_flow_table_ctx *table, const unsigned long long tick) {
+    size_t slot = 0, level = 0;
+    unsigned int id = 0, next = 0;
+    if (table->scheduled == 0) {
+        if (tick >= table->now_tick) {
+            table->now_tick = tick + 1;
+        }
+        return;
+    }
+    //  INFO(Santiago): now_tick is the next tick to expire, a level is cascaded into the one below
+    //                  when the lower levels wrap around.
+    while (table->now_tick <= tick) {
+        slot = table->now_tick & (PIG_SESSION_WHEEL_SLOTS - 1);
+        for (level = 1; slot == 0 && level < PIG_SESSION_WHEEL_LEVELS; level++) {
+            slot = (table->now_tick >> (PIG_SESSION_WHEEL_BITS * level)) & (PIG_SESSION_WHEEL_SLOTS - 1);
+            cascade_wheel(table, level, slot);
+        }
+        slot = table->now_tick & (PIG_SESSION_WHEEL_SLOTS - 1);
+        id = table->wheel[0][slot];
+        table->wheel[0][slot] = PIG_SESSION_NIL;
+        while (id != PIG_SESSION_NIL) {
+            next = get_flow(table, id)->next;
+            table->scheduled--;
+            due_flow(table, id);
+            id = next;
+        }
+        table->now_tick++;
+    }
+}
+
+pig_flow_table_ctx *mk_pig_flow_table(const size_t capacity) {
+    pig_flow_table_ctx *table = NULL;
+    size_t buckets = 2, slabs = 0;
+    if (capacity == 0 || capacity > PIG_SESSION_MAX_FLOWS) {
+        return NULL;
+    }
+    while (buckets < capacity * 2) {
+        buckets <<= 1;
+    }
+    slabs = (capacity + PIG_SESSION_SLAB_SIZE - 1) >> PIG_SESSION_SLAB_SHIFT;
+    table = (pig_flow_table_ctx *) pig_newseg(sizeof(pig_flow_table_ctx));
+    memset(table, 0, sizeof(pig_flow_table_ctx));
+    table->capacity = capacity;
+    table->slabs = (pig_flow_ctx **) pig_newseg(sizeof(pig_flow_ctx *) * slabs);
+    memset(table->slabs, 0, sizeof(pig_flow_ctx *) * slabs);
+    table->buckets = (unsigned int *) pig_newseg(sizeof(unsigned int) * buckets);
+    memset(table->buckets, 0, sizeof(unsigned int) * buckets);
+    table->buckets_mask = buckets - 1;
+    memset(table->wheel, 0xff, sizeof(table->wheel));
+    table->free_head = PIG_SESSION_NIL;
+    table->due_head = table->due_tail = PIG_SESSION_NIL;
+    table->mss = PIG_SESSION_MSS;
+    return table;
+}
+
+void del_pig_flow_table(pig_flow_table_ctx *table) {
+    pig_flow_template_ctx *template = NULL, *next = NULL;
+    size_t s = 0;
+    if (table == NULL) {
+        return;
+    }
+    for (template = table->templates; template != NULL; template = next) {
+        next = template->next;
+        free(template->frame.packet);
+        free(template->conflict);
+        free(template);
+    }
+    for (s = 0; s < ((table->capacity + PIG_SESSION_SLAB_SIZE - 1) >> PIG_SESSION_SLAB_SHIFT); s++) {
+        free(table->slabs[s]);
+    }
+    free(table->slabs);
+    free(table->buckets);
+    free(table);
+}
+
+int is_pig_session_signature(const pig_frame_ctx *frame) {
+    size_t l4 = 0;
+    if (frame == NULL || frame->packet == NULL || frame->packet_size < 20 || (frame->packet[0] >> 4) != 4 || frame->packet[9] != 6) {
+        return 0;
+    }
+    l4 = get_ip4_l4_offset(frame->packet, frame->packet_size);
+    return (l4 + 20 <= frame->packet_size);
+}
+
+pig_flow_ctx *get_pig_flow(const pig_flow_table_ctx *table, const unsigned int client_addr, const unsigned short client_port,
+                           const unsigned int server_addr, const unsigned short server_port) {
+    size_t b = 0;
+    if (table == NULL) {
+        return NULL;
+    }
+    b = find_bucket(table, client_addr, client_port, server_addr, server_port);
+    return (table->buckets[b] != 0 ? get_flow(table, table->buckets[b] - 1) : NULL);
+}
+
+int pig_session_open(pig_flow_table_ctx *table, pig_frame_ctx *frame) {
+    pig_flow_ctx *flow = NULL;
+    const unsigned char *packet = NULL;
+    unsigned int src_addr = 0, dst_addr = 0, client_addr = 0, server_addr = 0, id = 0;
+    unsigned short src_port = 0, dst_port = 0, client_port = 0, server_port = 0;
+    size_t l4 = 0, tries = 0;
+    int data_from_client = 0;
+    if (table == NULL || !is_pig_session_signature(frame)) {
+        return -1;
+    }
+    if (table->free_head == PIG_SESSION_NIL && table->allocated >= table->capacity) {
+        return 0;
+    }
+    packet = frame->packet;
+    l4 = get_ip4_l4_offset(packet, frame->packet_size);
+    memcpy(&src_addr, &packet[12], 4);
+    memcpy(&dst_addr, &packet[16], 4);
+    src_port = get_u16(&packet[l4]);
+    dst_port = get_u16(&packet[l4 + 2]);
+    data_from_client = (src_port >= dst_port);
+    client_addr = (data_from_client ? src_addr : dst_addr);
+    client_port = (data_from_client ? src_port : dst_port);
+    server_addr = (data_from_client ? dst_addr : src_addr);
+    server_port = (data_from_client ? dst_port : src_port);
+    while (get_pig_flow(table, client_addr, client_port, server_addr, server_port) != NULL) {
+        if (++tries > PIG_SESSION_REMAP_TRIES) {
+            return 0;
+        }
+        client_port = 1024 + mk_rnd_u32() % (65536 - 1024);
+        table->remapped++;
+    }
+    id = alloc_flow(table);
+    flow = get_flow(table, id);
+    flow->client_addr = client_addr;
+    flow->client_port = client_port;
+    flow->server_addr = server_addr;
+    flow->server_port = server_port;
+    flow->data_from_client = data_from_client;
+    flow->is_lo = (frame->is_lo != 0);
+    flow->client_seq = mk_rnd_u32();
+    flow->server_seq = mk_rnd_u32();
+    flow->data_sent = 0;
+    flow->ip_id = get_u16(&packet[4]);
+    flow->step = kSessionSyn;
+    flow->template = get_template(table, frame);
+    table->buckets[find_bucket(table, client_addr, client_port, server_addr, server_port)] = id + 1;
+    due_flow(table, id);
+    table->active_nr++;
+    table->opened++;
+    return 1;
+}
+
+static unsigned char *mk_segment(pig_flow_ctx *flow, const int from_client, const unsigned char flags, const unsigned int seq, const unsigned int ack,
+                                 const unsigned char *head, const size_t head_size, const unsigned char *payload, const size_t payload_size,
+                                 size_t *segment_size) {
+    const unsigned char *tpl = flow->template->frame.packet;
+    size_t l4 = get_ip4_l4_offset(tpl, flow->template->frame.packet_size);
+    unsigned short window = get_u16(&tpl[l4 + 14]);
+    unsigned char *segment = NULL, *tcp = NULL;
+    *segment_size = l4 + 20 + head_size + payload_size;
+    segment = (unsigned char *) pig_newseg(*segment_size);
+    //  INFO(Santiago): the IP header (options included) comes from the signature, the TCP options do not.
+    memcpy(segment, tpl, l4);
+    put_u16(&segment[2], *segment_size);
+    put_u16(&segment[4], flow->ip_id);
+    flow->ip_id++;
+    memcpy(&segment[12], (from_client ? &flow->client_addr : &flow->server_addr), 4);
+    memcpy(&segment[16], (from_client ? &flow->server_addr : &flow->client_addr), 4);
+    tcp = &segment[l4];
+    put_u16(&tcp[0], (from_client ? flow->client_port : flow->server_port));
+    put_u16(&tcp[2], (from_client ? flow->server_port : flow->client_port));
+    put_u32(&tcp[4], seq);
+    put_u32(&tcp[8], ack);
+    tcp[12] = 5 << 4;
+    tcp[13] = flags;
+    put_u16(&tcp[14], (window != 0 ? window : PIG_SESSION_WINDOW));
+    memset(&tcp[16], 0, 4);
+    if (head_size > 0) {
+        memcpy(&tcp[20], head, head_size);
+    }
+    if (payload_size > 0) {
+        memcpy(&tcp[20 + head_size], payload, payload_size);
+    }
+    chsum_ip4_dgram(segment, *segment_size);
+    return segment;
+}
+
+//  INFO(Santiago): under stress the payload is cut in pieces of up to mss bytes, each one starting overlap bytes
+//                  before the end of the previous one. The pieces are planned, not stored: the plan index
+//                  (kept in data_sent) is mapped to a piece by an affine permutation taken from the flow's hash,
+//                  the plan indexes past the last piece are retransmissions of pieces picked at random.
+//                  Every piece is a slice of the template payload, the conflicting overlaps are slices of the
+//                  template's inverted payload.
+
+static size_t get_pieces_nr(const pig_flow_table_ctx *table, const size_t payload_total) {
+    size_t step = table->mss - table->overlap;
+    if (payload_total <= table->mss) {
+        return 1;
+    }
+    return 1 + (payload_total - table->mss + step - 1) / step;
+}
+
+static size_t get_piece(const pig_flow_table_ctx *table, const pig_flow_ctx *flow, const size_t pieces_nr, const size_t plan_index) {
+    unsigned int h = 0;
+    size_t a = 0, x = 0, y = 0, r = 0;
+    if (plan_index >= pieces_nr) {
+        return mk_rnd_u32() % pieces_nr;
+    }
+    if (!table->is_shuffled || pieces_nr < 2) {
+        return plan_index;
+    }
+    h = hash_flow(flow->client_addr, flow->client_port, flow->server_addr, flow->server_port);
+    //  WARN(Santiago): a must be coprime with the number of pieces, otherwise this is not a permutation.
+    for (a = 1 + (h >> 16) % pieces_nr; ; a++) {
+        for (x = a, y = pieces_nr; y != 0; r = x % y, x = y, y = r)
+            ;
+        if (x == 1) {
+            break;
+        }
+    }
+    return (a * plan_index + h) % pieces_nr;
+}
+
+static const unsigned char *get_conflict(pig_flow_template_ctx *template, const unsigned char *payload, const size_t payload_total) {
+    size_t b = 0;
+    if (template->conflict == NULL) {
+        template->conflict = (unsigned char *) pig_newseg(payload_total);
+        for (b = 0; b < payload_total; b++) {
+            template->conflict[b] = ~payload[b];
+        }
+    }
+    return template->conflict;
+}
+
+int pig_session_next_frame(pig_flow_table_ctx *table, pig_frame_ctx *frame, const unsigned long long now) {
+    pig_flow_ctx *flow = NULL;
+    const pig_frame_ctx *tpl = NULL;
+    const unsigned char *payload = NULL;
+    size_t l7 = 0, payload_total = 0, len = 0, pieces_nr = 0, piece = 0, start = 0, head_size = 0;
+    unsigned int *seq = NULL, *ack = NULL, id = 0;
+    unsigned long long delay = 0;
+    int from_client = 1;
+    if (table == NULL || frame == NULL) {
+        return 0;
+    }
+    advance_wheel(table, now / PIG_SESSION_TICK);
+    if (table->due_head == PIG_SESSION_NIL) {
+        return 0;
+    }
+    id = table->due_head;
+    flow = get_flow(table, id);
+    table->due_head = flow->next;
+    if (table->due_head == PIG_SESSION_NIL) {
+        table->due_tail = PIG_SESSION_NIL;
+    }
+    tpl = &flow->template->frame;
+    l7 = get_ip4_l7_offset(tpl->packet, tpl->packet_size);
+    payload = tpl->packet + l7;
+    payload_total = tpl->packet_size - l7;
+    switch (flow->step) {
+        case kSessionSyn:
+            frame->packet = mk_segment(flow, 1, PIG_TCP_SYN, flow->client_seq, 0, NULL, 0, NULL, 0, &frame->packet_size);
+            flow->client_seq++;
+            flow->step = kSessionSynAck;
+            break;
+
+        case kSessionSynAck:
+            from_client = 0;
+            frame->packet = mk_segment(flow, 0, PIG_TCP_SYN | PIG_TCP_ACK, flow->server_seq, flow->client_seq, NULL, 0, NULL, 0, &frame->packet_size);
+            flow->server_seq++;
+            flow->step = kSessionAck;
+            break;
+
+        case kSessionAck:
+            frame->packet = mk_segment(flow, 1, PIG_TCP_ACK, flow->client_seq, flow->server_seq, NULL, 0, NULL, 0, &frame->packet_size);
+            flow->step = (payload_total > 0 ? kSessionData : kSessionFin);
+            break;
+
+        case kSessionData:
+            from_client = flow->data_from_client;
+            seq = (from_client ? &flow->client_seq : &flow->server_seq);
+            ack = (from_client ? &flow->server_seq : &flow->client_seq);
+            if (is_stressed(table)) {
+                //  INFO(Santiago): the sequence number stays at the beginning of the stream until the plan is over.
+                pieces_nr = get_pieces_nr(table, payload_total);
+                piece = get_piece(table, flow, pieces_nr, flow->data_sent);
+                start = piece * (table->mss - table->overlap);
+                len = payload_total - start;
+                if (len > table->mss) {
+                    len = table->mss;
+                }
+                head_size = (piece > 0 && table->is_conflicting ? table->overlap : 0);
+                frame->packet = mk_segment(flow, from_client, PIG_TCP_PSH | PIG_TCP_ACK, *seq + start, *ack,
+                                           (head_size > 0 ? get_conflict(flow->template, payload, payload_total) + start : NULL), head_size,
+                                           payload + start + head_size, len - head_size, &frame->packet_size);
+                table->reordered += (piece != flow->data_sent && flow->data_sent < pieces_nr);
+                table->overlapped += (piece > 0 && table->overlap > 0);
+                table->retransmitted += (flow->data_sent >= pieces_nr);
+                flow->data_sent++;
+                if (flow->data_sent == pieces_nr + table->retransmits) {
+                    *seq += payload_total;
+                    flow->step = kSessionDataAck;
+                }
+                break;
+            }
+            len = payload_total - flow->data_sent;
+            if (len > table->mss) {
+                len = table->mss;
+            }
+            frame->packet = mk_segment(flow, from_client, PIG_TCP_PSH | PIG_TCP_ACK, *seq, *ack, NULL, 0, payload + flow->data_sent, len, &frame->packet_size);
+            *seq += len;
+            flow->data_sent += len;
+            flow->step = kSessionDataAck;
+            break;
+
+        case kSessionDataAck:
+            from_client = !flow->data_from_client;
+            seq = (from_client ? &flow->client_seq : &flow->server_seq);
+            ack = (from_client ? &flow->server_seq : &flow->client_seq);
+            frame->packet = mk_segment(flow, from_client, PIG_TCP_ACK, *seq, *ack, NULL, 0, NULL, 0, &frame->packet_size);
+            flow->step = (!is_stressed(table) && flow->data_sent < payload_total ? kSessionData : kSessionFin);
+            break;
+
+        case kSessionFin:
+            frame->packet = mk_segment(flow, 1, PIG_TCP_FIN | PIG_TCP_ACK, flow->client_seq, flow->server_seq, NULL, 0, NULL, 0, &frame->packet_size);
+            flow->client_seq++;
+            flow->step = kSessionFinAck;
+            break;
+
+        case kSessionFinAck:
+            from_client = 0;
+            frame->packet = mk_segment(flow, 0, PIG_TCP_FIN | PIG_TCP_ACK, flow->server_seq, flow->client_seq, NULL, 0, NULL, 0, &frame->packet_size);
+            flow->server_seq++;
+            flow->step = kSessionLastAck;
+            break;
+
+        default:
+            frame->packet = mk_segment(flow, 1, PIG_TCP_ACK, flow->client_seq, flow->server_seq, NULL, 0, NULL, 0, &frame->packet_size);
+            flow->step = kSessionDone;
+            break;
+    }
+    frame->signature = tpl->signature;
+    frame->is_lo = flow->is_lo;
+    frame->l2hdr_size = tpl->l2hdr_size;
+    frame->sent = 0;
+    memcpy(frame->l2hdr, tpl->l2hdr, sizeof(frame->l2hdr));
+    if (frame->l2hdr_size == sizeof(frame->l2hdr) && from_client != flow->data_from_client) {
+        //  INFO(Santiago): the signature's direction has the right MAC addresses, the other one swaps them.
+        memcpy(&frame->l2hdr[0], &tpl->l2hdr[6], 6);
+        memcpy(&frame->l2hdr[6], &tpl->l2hdr[0], 6);
+    }
+    if (flow->step == kSessionDone) {
+        table->completed++;
+        close_flow(table, id);
+    } else {
+        //  INFO(Santiago): every segment waits a round trip for its answer, an established session
+        //                  stays idle for the holding time before being closed.
+        delay = table->rtt + (flow->step == kSessionFin ? table->hold : 0);
+        schedule_flow(table, id, (now + delay) / PIG_SESSION_TICK);
+    }
+    return 1;
+}
+
+void pig_session_stats(const pig_flow_table_ctx *table) {
+    if (table == NULL) {
+        return;
+    }
+    printf("pig INFO: %llu TCP session(s) opened, %llu completed, %llu left open, %llu client port(s) remapped, %llu template(s) in use.\n",
+           table->opened, table->completed, (unsigned long long) table->active_nr, table->remapped, (unsigned long long) table->templates_nr);
+    if (is_stressed(table)) {
+        printf("pig INFO: %llu data segment(s) sent out of order, %llu overlapping, %llu retransmitted.\n",
+               table->reordered, table->overlapped, table->retransmitted);
+    }
+}
@@ -0,0 +1,125 @@
+/*
+ *                                Copyright (C) 2015 by Rafael Santiago
+ *
+ * This is a free software. You can redistribute it and/or modify under
+ * the terms of the GNU General Public License version 2.
+ *
+ */
+#ifndef PIG_SESSION_H
+#define PIG_SESSION_H 1
+
+#include "types.h"
+
+#define PIG_SESSION_MSS 1460
+
+#define PIG_SESSION_WINDOW 64240
+
+#define PIG_SESSION_NIL 0xffffffff
+
+#define PIG_SESSION_SLAB_SHIFT 16
+
+#define PIG_SESSION_SLAB_SIZE (1 << PIG_SESSION_SLAB_SHIFT)
+
+#define PIG_SESSION_MAX_FLOWS 0x7fffffff
+
+#define PIG_SESSION_TICK 100000ULL
+
+#define PIG_SESSION_WHEEL_BITS 6
+
+#define PIG_SESSION_WHEEL_SLOTS (1 << PIG_SESSION_WHEEL_BITS)
+
+#define PIG_SESSION_WHEEL_LEVELS 4
+
+#define PIG_SESSION_WHEEL_SPAN (1ULL << (PIG_SESSION_WHEEL_BITS * PIG_SESSION_WHEEL_LEVELS))
+
+//  INFO(Santiago): the longest wait the wheel can hold, less one tick for the rounding of the current time.
+#define PIG_SESSION_MAX_DELAY ((PIG_SESSION_WHEEL_SPAN - 2) * PIG_SESSION_TICK)
+
+#define PIG_SESSION_TEMPLATE_REUSE 64
+
+#define PIG_SESSION_TEMPLATE_CACHE 256
+
+typedef enum _pig_session_step {
+    kSessionSyn,
+    kSessionSynAck,
+    kSessionAck,
+    kSessionData,
+    kSessionDataAck,
+    kSessionFin,
+    kSessionFinAck,
+    kSessionLastAck,
+    kSessionDone
+}pig_session_step_t;
+
+typedef struct _pig_flow_template {
+    pig_frame_ctx frame;
+    unsigned char *conflict;
+    unsigned int refs;
+    unsigned int uses;
+    struct _pig_flow_template *prev, *next;
+}pig_flow_template_ctx;
+
+//  INFO(Santiago): keep this record small, it is what a flow costs (48 bytes on 64-bit builds).
+typedef struct _pig_flow {
+    unsigned int client_addr;
+    unsigned int server_addr;
+    unsigned short client_port;
+    unsigned short server_port;
+    unsigned int client_seq;
+    unsigned int server_seq;
+    unsigned int data_sent;
+    unsigned int expires;
+    unsigned int next;
+    unsigned short ip_id;
+    unsigned char step;
+    unsigned char data_from_client : 1;
+    unsigned char is_lo : 1;
+    pig_flow_template_ctx *template;
+}pig_flow_ctx;
+
+typedef struct _pig_flow_table {
+    pig_flow_ctx **slabs;
+    size_t capacity;
+    size_t allocated;
+    unsigned int free_head;
+    unsigned int *buckets;
+    size_t buckets_mask;
+    size_t active_nr;
+    unsigned int wheel[PIG_SESSION_WHEEL_LEVELS][PIG_SESSION_WHEEL_SLOTS];
+    unsigned int due_head, due_tail;
+    size_t scheduled;
+    unsigned long long now_tick;
+    unsigned long long rtt;
+    unsigned long long hold;
+    size_t mss;
+    int is_shuffled;
+    size_t overlap;
+    int is_conflicting;
+    size_t retransmits;
+    pig_flow_template_ctx *cache[PIG_SESSION_TEMPLATE_CACHE];
+    pig_flow_template_ctx *templates;
+    size_t templates_nr;
+    unsigned long long opened;
+    unsigned long long completed;
+    unsigned long long remapped;
+    unsigned long long reordered;
+    unsigned long long overlapped;
+    unsigned long long retransmitted;
+}pig_flow_table_ctx;
+
+pig_flow_table_ctx *mk_pig_flow_table(const size_t capacity);
+
+void del_pig_flow_table(pig_flow_table_ctx *table);
+
+int is_pig_session_signature(const pig_frame_ctx *frame);
+
+int pig_session_open(pig_flow_table_ctx *table, pig_frame_ctx *frame);
+
+int pig_session_next_frame(pig_flow_table_ctx *table, pig_frame_ctx *frame, const unsigned long long now);
+
+pig_flow_ctx *get_pig_flow(const pig_flow_table_ctx *table, const unsigned int client_addr, const unsigned short client_port,
+                           const unsigned int server_addr, const unsigned short server_port);
+
+void pig_session_stats(const pig_flow_table_ctx *table);
+
+#endif
@@ -0,0 +1,188 @@
+/*
+ *                                Copyright (C) 2015 by Rafael Santiago
+ *
+ * This is a free software. You can redistribute it and/or modify under
+ * the terms of the GNU General Public License version 2.
+ *
+ */
+#include "slots.h"
+#include "memory.h"
+#include "mkrnd.h"
+#include "chsum.h"
+#include <string.h>
+#include <ctype.h>
+
+//  INFO(Santiago): the dynamic slots are the header fields declared as "random", "refresh(n)" or
+//                  "increment(n)". The packet is built as usual (with zero on these fields) and then
+//                  only the slot bytes are rewritten, adjusting the checksums incrementally.
+
+struct slot_field {
+    const pig_field_t field;
+    const unsigned char protocol;  //  INFO(Santiago): 0 means the IP header itself.
+    const size_t offset;
+    const size_t size;
+};
+
+static struct slot_field SLOT_FIELDS[] = {
+    {  kIpv4_tos,  0,  1, 1 },
+    {   kIpv4_id,  0,  4, 2 },
+    {  kIpv4_ttl,  0,  8, 1 },
+    {  kIpv4_src,  0, 12, 4 },
+    {  kIpv4_dst,  0, 16, 4 },
+    {   kTcp_src,  6,  0, 2 },
+    {   kTcp_dst,  6,  2, 2 },
+    {   kTcp_seq,  6,  4, 4 },
+    { kTcp_ackno,  6,  8, 4 },
+    { kTcp_wsize,  6, 14, 2 },
+    {  kTcp_urgp,  6, 18, 2 },
+    {   kUdp_src, 17,  0, 2 },
+    {   kUdp_dst, 17,  2, 2 },
+    { kIcmp_type,  1,  0, 1 },
+    { kIcmp_code,  1,  1, 1 }
+};
+
+static const size_t SLOT_FIELDS_SIZE = sizeof(SLOT_FIELDS) / sizeof(SLOT_FIELDS[0]);
+
+static struct slot_field *get_slot_field(const pig_field_t field);
+
+static unsigned long long eval_slot(pig_slot_ctx *slot);
+
+static int get_modifier_param(const char *data, const char *modifier, unsigned int *param);
+
+int get_pig_slot_modifier(const char *data, pig_field_t *modifier, unsigned int *param) {
+    if (data == NULL || modifier == NULL || param == NULL) {
+        return 0;
+    }
+    if (strcmp(data, "random") == 0) {
+        *modifier = kRandom;
+        *param = 0;
+        return 1;
+    }
+    if (get_modifier_param(data, "refresh", param)) {
+        *modifier = kRefresh;
+        return 1;
+    }
+    if (get_modifier_param(data, "increment", param)) {
+        *modifier = kIncrement;
+        return 1;
+    }
+    return 0;
+}
+
+int is_pig_slot_field(const pig_field_t field) {
+    return (get_slot_field(field) != NULL);
+}
+
+void add_pig_slot_to_pigsty_entry(pigsty_entry_ctx *entry, const pig_field_t field, const pig_field_t modifier, const unsigned int param) {
+    pig_slot_ctx *slots = NULL;
+    if (entry == NULL || !is_pig_slot_field(field)) {
+        return;
+    }
+    slots = (pig_slot_ctx *) pig_newseg(sizeof(pig_slot_ctx) * (entry->slots_nr + 1));
+    if (entry->slots != NULL) {
+        memcpy(slots, entry->slots, sizeof(pig_slot_ctx) * entry->slots_nr);
+        free(entry->slots);
+    }
+    memset(&slots[entry->slots_nr], 0, sizeof(pig_slot_ctx));
+    slots[entry->slots_nr].field = field;
+    slots[entry->slots_nr].modifier = modifier;
+    slots[entry->slots_nr].param = param;
+    entry->slots = slots;
+    entry->slots_nr++;
+}
+
+void fill_ip4_slots(pig_slot_ctx *slots, const size_t slots_nr, unsigned char *dgram, const size_t dgram_size) {
+    unsigned char data[4];
+    unsigned long long value = 0;
+    struct slot_field *sf = NULL;
+    size_t s = 0, b = 0, offset = 0;
+    if (slots == NULL || dgram == NULL || dgram_size < 20) {
+        return;
+    }
+    for (s = 0; s < slots_nr; s++) {
+        sf = get_slot_field(slots[s].field);
+        if (sf == NULL || (sf->protocol != 0 && sf->protocol != dgram[9])) {
+            continue;
+        }
+        offset = sf->offset + ((sf->protocol != 0) ? get_ip4_l4_offset(dgram, dgram_size) : 0);
+        if (offset + sf->size > dgram_size) {
+            continue;
+        }
+        value = eval_slot(&slots[s]);
+        for (b = 0; b < sf->size; b++) {
+            data[sf->size - b - 1] = value & 0xff;
+            value >>= 8;
+        }
+        if (sf->protocol == 0) {
+            patch_ip4_hdr(dgram, dgram_size, offset, data, sf->size);
+        } else {
+            patch_ip4_dgram(dgram, dgram_size, offset, data, sf->size);
+        }
+    }
+}
+
+static struct slot_field *get_slot_field(const pig_field_t field) {
+    size_t f = 0;
+    for (f = 0; f < SLOT_FIELDS_SIZE; f++) {
+        if (SLOT_FIELDS[f].field == field) {
+            return &SLOT_FIELDS[f];
+        }
+    }
+    return NULL;
+}
+
+static unsigned long long eval_slot(pig_slot_ctx *slot) {
+    unsigned long long value = 0;
+    if (slot->modifier == kRandom) {
+        return mk_rnd_u32();
+    }
+    //  INFO(Santiago): refresh and increment keep state across packets that may be built by
+    //                  several generator threads at once.
+    while (__sync_lock_test_and_set(&slot->lock, 1)) {
+        while (*(volatile int *)&slot->lock)
+            ;
+    }
+    switch (slot->modifier) {
+        case kRefresh:
+            if (slot->left == 0) {
+                slot->value = mk_rnd_u32();
+                slot->left = slot->param;
+            }
+            slot->left--;
+            break;
+
+        case kIncrement:
+            //  INFO(Santiago): the first value is random, as a real stack would pick it.
+            if (!slot->ready) {
+                slot->value = mk_rnd_u32();
+                slot->ready = 1;
+            } else {
+                slot->value += slot->param;
+            }
+            break;
+
+        default:
+            break;
+    }
+    value = slot->value;
+    __sync_lock_release(&slot->lock);
+    return value;
+}
+
+static int get_modifier_param(const char *data, const char *modifier, unsigned int *param) {
+    size_t m_size = strlen(modifier);
+    const char *dp = NULL;
+    if (strncmp(data, modifier, m_size) != 0 || data[m_size] != '(') {
+        return 0;
+    }
+    dp = &data[m_size + 1];
+    if (!isdigit(*dp)) {
+        return 0;
+    }
+    *param = 0;
+    while (isdigit(*dp)) {
+        *param = (*param * 10) + (*dp - '0');
+        dp++;
+    }
+    return (*dp == ')' && *(dp + 1) == 0 && *param > 0);
+}
@@ -0,0 +1,21 @@
+/*
+ *                                Copyright (C) 2015 by Rafael Santiago
+ *
+ * This is a free software. You can redistribute it and/or modify under
+ * the terms of the GNU General Public License version 2.
+ *
+ */
+#ifndef PIG_SLOTS_H
+#define PIG_SLOTS_H 1
+
+#include "types.h"
+
+int get_pig_slot_modifier(const char *data, pig_field_t *modifier, unsigned int *param);
+
+int is_pig_slot_field(const pig_field_t field);
+
+void add_pig_slot_to_pigsty_entry(pigsty_entry_ctx *entry, const pig_field_t field, const pig_field_t modifier, const unsigned int param);
+
+void fill_ip4_slots(pig_slot_ctx *slots, const size_t slots_nr, unsigned char *dgram, const size_t dgram_size);
+
+#endif
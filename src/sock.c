@@ -6,8 +6,72 @@
  *
  */
 #include "sock.h"
+#include "segment.h"
+#include <string.h>
 #ifdef __linux
 #include "linux/rsk.h"
+#include "linux/tun.h"
+#endif
+
+//  INFO(Santiago): room for a virtio_net_hdr plus the largest IP and TCP headers.
+#define PIG_GSO_VNET_HDR_SIZE 16
+
+#define PIG_GSO_SCRATCH_SIZE (PIG_GSO_VNET_HDR_SIZE + 120)
+
+//  INFO(Santiago): the frames of a burst are queued by each thread and go down in one sendmmsg(). Every
+//                  message takes four pieces (the empty ones are skipped by the kernel): the virtio_net_hdr
+//                  when offloading, the ethernet header, the IP header (with the TCP one when offloading)
+//                  and the rest of the datagram. The queue is kept from a burst to the next one.
+#define PIG_QUEUE_PIECES_NR 4
+
+#ifdef __linux
+static __thread struct iovec *queue_iov = NULL;
+
+static __thread unsigned char *queue_scratch = NULL;
+
+static __thread size_t queue_size = 0;
+
+static __thread size_t queue_nr = 0;
+#endif
+
+static int is_injectable_frame(const pig_frame_ctx *frame);
+
+static void mark_queued_frames(pig_frame_ctx *frames, const size_t frames_nr, const int sent);
+
+#ifdef __linux
+static struct iovec *get_queue_slot(void);
+#endif
+
+static int is_injectable_frame(const pig_frame_ctx *frame) {
+    return (frame->packet != NULL && !frame->is_lo && ((frame->packet[0] & 0xf0) >> 4) == 4 &&
+            (frame->l2hdr_size + frame->packet_size) >= 34);
+}
+
+static void mark_queued_frames(pig_frame_ctx *frames, const size_t frames_nr, const int sent) {
+    size_t f = 0, m = 0;
+    //  INFO(Santiago): sendmmsg() sends a prefix of the queue, only the queued frames count.
+    for (f = 0; f < frames_nr && sent > 0 && m < (size_t)sent; f++) {
+        if (is_injectable_frame(&frames[f])) {
+            frames[f].sent = 1;
+            m++;
+        }
+    }
+}
+
+#ifdef __linux
+static struct iovec *get_queue_slot(void) {
+    struct iovec *iov = NULL;
+    size_t p = 0;
+    if (queue_nr >= queue_size) {
+        return NULL;
+    }
+    iov = &queue_iov[PIG_QUEUE_PIECES_NR * queue_nr];
+    for (p = 0; p < PIG_QUEUE_PIECES_NR; p++) {
+        iov[p].iov_base = NULL;
+        iov[p].iov_len = 0;
+    }
+    return iov;
+}
 #endif
 
 int init_raw_socket(const char *iface) {
@@ -40,6 +104,220 @@ int inject(const unsigned char *packet, const size_t packet_size, const int sock
 #endif
 }
 
+int inject_frame(const unsigned char *l2hdr, const size_t l2hdr_size, const unsigned char *packet, const size_t packet_size, const int sockfd) {
+#ifdef __linux
+    struct iovec iov[2];
+    if (packet == NULL || packet_size == 0 || ((packet[0] & 0xf0) >> 4) != 4) {
+        return -1;
+    }
+    iov[0].iov_base = (void *)l2hdr;
+    iov[0].iov_len = l2hdr_size;
+    iov[1].iov_base = (void *)packet;
+    iov[1].iov_len = packet_size;
+    return lin_rsk_sendv(iov, 2, sockfd);
+#else
+    return -1;
+#endif
+}
+
+int inject_frames(pig_frame_ctx *frames, const size_t frames_nr, const int sockfd) {
+    size_t f = 0;
+    int sent = 0;
+    if (frames == NULL || frames_nr == 0) {
+        return 0;
+    }
+    if (!reserve_injection_queue(frames_nr)) {
+        return -1;
+    }
+    for (f = 0; f < frames_nr; f++) {
+        queue_frame(&frames[f]);
+    }
+    sent = flush_injection_queue(sockfd);
+    mark_queued_frames(frames, frames_nr, sent);
+    return sent;
+}
+
+int reserve_injection_queue(const size_t msgs_nr) {
+#ifdef __linux
+    struct iovec *iov = NULL;
+    unsigned char *scratch = NULL;
+    if (queue_nr + msgs_nr <= queue_size) {
+        return 1;
+    }
+    //  WARN(Santiago): the queued pieces point into the scratch, so it can only be moved while nothing is queued.
+    if (queue_nr > 0) {
+        return 0;
+    }
+    iov = (struct iovec *) realloc(queue_iov, sizeof(struct iovec) * PIG_QUEUE_PIECES_NR * msgs_nr);
+    if (iov == NULL) {
+        return 0;
+    }
+    queue_iov = iov;
+    scratch = (unsigned char *) realloc(queue_scratch, PIG_GSO_SCRATCH_SIZE * msgs_nr);
+    if (scratch == NULL) {
+        return 0;
+    }
+    queue_scratch = scratch;
+    queue_size = msgs_nr;
+    return 1;
+#else
+    return 0;
+#endif
+}
+
+int queue_frame(const pig_frame_ctx *frame) {
+#ifdef __linux
+    struct iovec *iov = NULL;
+    if (!is_injectable_frame(frame)) {
+        return 0;
+    }
+    if ((iov = get_queue_slot()) == NULL) {
+        return -1;
+    }
+    iov[1].iov_base = (void *)frame->l2hdr;
+    iov[1].iov_len = frame->l2hdr_size;
+    iov[3].iov_base = frame->packet;
+    iov[3].iov_len = frame->packet_size;
+    queue_nr++;
+    return 1;
+#else
+    return -1;
+#endif
+}
+
+int queue_gso_frame(const pig_frame_ctx *frame, const size_t mss) {
+#ifdef __linux
+    struct iovec *iov = NULL;
+    unsigned char *vnet = NULL, *hdrs = NULL;
+    size_t l4 = 0, hdrs_size = 0, vnet_size = 0;
+    unsigned short chsum = 0;
+    if (!is_injectable_frame(frame)) {
+        return 0;
+    }
+    if ((iov = get_queue_slot()) == NULL) {
+        return -1;
+    }
+    //  INFO(Santiago): only the headers are copied (their TCP checksum must be replaced by the pseudo
+    //                  header one), the payload goes straight from the built datagram.
+    vnet = &queue_scratch[PIG_GSO_SCRATCH_SIZE * queue_nr];
+    hdrs = vnet + PIG_GSO_VNET_HDR_SIZE;
+    if (is_pig_tcp_gso_dgram(frame->packet, frame->packet_size, mss)) {
+        hdrs_size = get_pig_tcp_hdrs_size(frame->packet, frame->packet_size, mss);
+        l4 = (frame->packet[0] & 0x0f) * 4;
+        memcpy(hdrs, frame->packet, hdrs_size);
+        chsum = get_pig_tcp_pseudo_chsum(frame->packet, frame->packet_size);
+        hdrs[l4 + 16] = (chsum >> 8) & 0xff;
+        hdrs[l4 + 17] = chsum & 0xff;
+        vnet_size = lin_rsk_mk_vnet_hdr(vnet, frame->l2hdr_size + l4, frame->l2hdr_size + hdrs_size, mss);
+    } else {
+        vnet_size = lin_rsk_mk_vnet_hdr(vnet, 0, 0, 0);
+    }
+    iov[0].iov_base = vnet;
+    iov[0].iov_len = vnet_size;
+    iov[1].iov_base = (void *)frame->l2hdr;
+    iov[1].iov_len = frame->l2hdr_size;
+    iov[2].iov_base = hdrs;
+    iov[2].iov_len = hdrs_size;
+    iov[3].iov_base = frame->packet + hdrs_size;
+    iov[3].iov_len = frame->packet_size - hdrs_size;
+    queue_nr++;
+    return 1;
+#else
+    return -1;
+#endif
+}
+
+int queue_fragments(const pig_frame_ctx *frame, const pig_fragment_ctx *fragments, const size_t fragments_nr) {
+#ifdef __linux
+    struct iovec *iov = NULL;
+    size_t f = 0;
+    if (frame == NULL || frame->packet == NULL || fragments == NULL) {
+        return 0;
+    }
+    if (queue_nr + fragments_nr > queue_size) {
+        return -1;
+    }
+    for (f = 0; f < fragments_nr; f++) {
+        iov = get_queue_slot();
+        iov[1].iov_base = (void *)frame->l2hdr;
+        iov[1].iov_len = frame->l2hdr_size;
+        iov[2].iov_base = (void *)fragments[f].hdr;
+        iov[2].iov_len = fragments[f].hdr_size;
+        iov[3].iov_base = frame->packet + fragments[f].offset;
+        iov[3].iov_len = fragments[f].size;
+        queue_nr++;
+    }
+    return (int)fragments_nr;
+#else
+    return -1;
+#endif
+}
+
+size_t get_injection_queue_size(void) {
+#ifdef __linux
+    return queue_nr;
+#else
+    return 0;
+#endif
+}
+
+int flush_injection_queue(const int sockfd) {
+#ifdef __linux
+    int sent = lin_rsk_sendmmsg(queue_iov, PIG_QUEUE_PIECES_NR, (int)queue_nr, sockfd);
+    queue_nr = 0;
+    return sent;
+#else
+    return -1;
+#endif
+}
+
+void release_injection_queue(void) {
+#ifdef __linux
+    free(queue_iov);
+    free(queue_scratch);
+    queue_iov = NULL;
+    queue_scratch = NULL;
+    queue_size = 0;
+    queue_nr = 0;
+    lin_rsk_release_msgs();
+#endif
+}
+
+int enable_raw_socket_gso(const int sockfd) {
+#ifdef __linux
+    return lin_rsk_enable_vnet_hdr(sockfd);
+#else
+    return -1;
+#endif
+}
+
+int inject_gso_frames(pig_frame_ctx *frames, const size_t frames_nr, const int sockfd, const size_t mss) {
+    size_t f = 0;
+    int sent = 0;
+    if (frames == NULL || frames_nr == 0) {
+        return 0;
+    }
+    if (!reserve_injection_queue(frames_nr)) {
+        return -1;
+    }
+    for (f = 0; f < frames_nr; f++) {
+        queue_gso_frame(&frames[f], mss);
+    }
+    sent = flush_injection_queue(sockfd);
+    mark_queued_frames(frames, frames_nr, sent);
+    return sent;
+}
+
+int inject_fragments(const pig_frame_ctx *frame, const pig_fragment_ctx *fragments, const size_t fragments_nr, const int sockfd) {
+    if (frame == NULL || frame->packet == NULL || fragments == NULL || fragments_nr == 0) {
+        return 0;
+    }
+    if (!reserve_injection_queue(fragments_nr) || queue_fragments(frame, fragments, fragments_nr) <= 0) {
+        return -1;
+    }
+    return flush_injection_queue(sockfd);
+}
+
 int inject_lo(const unsigned char *packet, const size_t packet_size, const int sockfd) {
 #ifdef __linux
     return lin_rsk_lo_sendto(packet, packet_size, sockfd);
@@ -47,3 +325,90 @@ int inject_lo(const unsigned char *packet, const size_t packet_size, const int s
     return -1;
 #endif
 }
+
+int init_tun_device(const char *iface, const int is_tap) {
+#ifdef __linux
+    return lin_tun_create(iface, is_tap);
+#else
+    return -1;
+#endif
+}
+
+void deinit_tun_device(const int tunfd) {
+#ifdef __linux
+    lin_tun_close(tunfd);
+#endif
+}
+
+int get_tun_device_hwaddr(const char *iface, unsigned char hwaddr[6]) {
+#ifdef __linux
+    return lin_tun_get_hwaddr(iface, hwaddr);
+#else
+    return -1;
+#endif
+}
+
+int inject_tun(const unsigned char *l2hdr, const size_t l2hdr_size, const unsigned char *packet, const size_t packet_size, const int tunfd) {
+#ifdef __linux
+    struct iovec iov[2];
+    int iovcnt = 0;
+    if (l2hdr != NULL && l2hdr_size > 0) {
+        iov[iovcnt].iov_base = (void *)l2hdr;
+        iov[iovcnt].iov_len = l2hdr_size;
+        iovcnt++;
+    }
+    iov[iovcnt].iov_base = (void *)packet;
+    iov[iovcnt].iov_len = packet_size;
+    iovcnt++;
+    return lin_tun_writev(iov, iovcnt, tunfd);
+#else
+    return -1;
+#endif
+}
+
+int inject_tun_frames(pig_frame_ctx *frames, const size_t frames_nr, const int tunfd) {
+    size_t f = 0;
+    int sent = 0;
+    //  WARN(Santiago): the tun driver has no batched write, so here the burst is written frame by frame.
+    for (f = 0; f < frames_nr; f++) {
+        if (frames[f].packet == NULL) {
+            continue;
+        }
+        if (inject_tun(frames[f].l2hdr, frames[f].l2hdr_size, frames[f].packet, frames[f].packet_size, tunfd) != -1) {
+            frames[f].sent = 1;
+            sent++;
+        }
+    }
+    return sent;
+}
+
+int inject_tun_fragments(const pig_frame_ctx *frame, const pig_fragment_ctx *fragments, const size_t fragments_nr, const int tunfd) {
+#ifdef __linux
+    struct iovec iov[3];
+    size_t f = 0;
+    int iovcnt = 0, sent = 0;
+    if (frame == NULL || frame->packet == NULL || fragments == NULL) {
+        return 0;
+    }
+    for (f = 0; f < fragments_nr; f++) {
+        iovcnt = 0;
+        if (frame->l2hdr_size > 0) {
+            iov[iovcnt].iov_base = (void *)frame->l2hdr;
+            iov[iovcnt].iov_len = frame->l2hdr_size;
+            iovcnt++;
+        }
+        iov[iovcnt].iov_base = (void *)fragments[f].hdr;
+        iov[iovcnt].iov_len = fragments[f].hdr_size;
+        iovcnt++;
+        iov[iovcnt].iov_base = frame->packet + fragments[f].offset;
+        iov[iovcnt].iov_len = fragments[f].size;
+        iovcnt++;
+        if (lin_tun_writev(iov, iovcnt, tunfd) != -1) {
+            sent++;
+        }
+    }
+    return sent;
+#else
+    return -1;
+#endif
+}
@@ -8,6 +8,8 @@
 #ifndef PIG_SOCK_H
 #define PIG_SOCK_H 1
 
+#include "types.h"
+#include "fragment.h"
 #include <stdlib.h>
 
 int init_raw_socket(const char *iface);
@@ -16,6 +18,44 @@ int init_loopback_raw_socket();
 
 int inject(const unsigned char *packet, const size_t packet_size, const int sockfd);
 
+int inject_frame(const unsigned char *l2hdr, const size_t l2hdr_size, const unsigned char *packet, const size_t packet_size, const int sockfd);
+
+int inject_frames(pig_frame_ctx *frames, const size_t frames_nr, const int sockfd);
+
 void deinit_raw_socket(const int sockfd);
 
+int enable_raw_socket_gso(const int sockfd);
+
+int inject_gso_frames(pig_frame_ctx *frames, const size_t frames_nr, const int sockfd, const size_t mss);
+
+int inject_fragments(const pig_frame_ctx *frame, const pig_fragment_ctx *fragments, const size_t fragments_nr, const int sockfd);
+
+int inject_lo(const unsigned char *packet, const size_t packet_size, const int sockfd);
+
+int reserve_injection_queue(const size_t msgs_nr);
+
+int queue_frame(const pig_frame_ctx *frame);
+
+int queue_gso_frame(const pig_frame_ctx *frame, const size_t mss);
+
+int queue_fragments(const pig_frame_ctx *frame, const pig_fragment_ctx *fragments, const size_t fragments_nr);
+
+size_t get_injection_queue_size(void);
+
+int flush_injection_queue(const int sockfd);
+
+void release_injection_queue(void);
+
+int init_tun_device(const char *iface, const int is_tap);
+
+void deinit_tun_device(const int tunfd);
+
+int get_tun_device_hwaddr(const char *iface, unsigned char hwaddr[6]);
+
+int inject_tun(const unsigned char *l2hdr, const size_t l2hdr_size, const unsigned char *packet, const size_t packet_size, const int tunfd);
+
+int inject_tun_frames(pig_frame_ctx *frames, const size_t frames_nr, const int tunfd);
+
+int inject_tun_fragments(const pig_frame_ctx *frame, const pig_fragment_ctx *fragments, const size_t fragments_nr, const int tunfd);
+
 #endif
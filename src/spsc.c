@@ -0,0 +1,99 @@
+/*
+ *                                Copyright (C) 2015 by Rafael Santiago
+ *
+ * This is a free software. You can redistribute it and/or modify under
+ * the terms of the GNU General Public License version 2.
+ *
+ */
+#include "spsc.h"
+#include "memory.h"
+#include <string.h>
+#include <sys/mman.h>
+
+//  INFO(Santiago): a single producer single consumer ring of frames. The producer only writes
+//                  the head and the consumer only writes the tail, each one lives in its own cache
+//                  line together with the fields touched only by the same side. A side reads the
+//                  other side's index only when its cached copy says that the ring is full (or empty).
+//                  The statistics are written by one side only, so they do not need atomic operations.
+//                  The slots come from fresh pages that nobody touches before the producer, so when the
+//                  producer is pinned the kernel places them on its NUMA node (first touch).
+
+pig_spsc_ring_ctx *mk_pig_spsc_ring(const size_t size) {
+    pig_spsc_ring_ctx *ring = NULL;
+    size_t capacity = 2;
+    if (size < 2) {
+        return NULL;
+    }
+    while (capacity < size) {
+        capacity <<= 1;
+    }
+    if (posix_memalign((void **)&ring, PIG_SPSC_CACHE_LINE, sizeof(pig_spsc_ring_ctx)) != 0) {
+        return NULL;
+    }
+    memset(ring, 0, sizeof(pig_spsc_ring_ctx));
+    ring->slots = (pig_frame_ctx *) mmap(NULL, sizeof(pig_frame_ctx) * capacity, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ring->slots == MAP_FAILED) {
+        free(ring);
+        return NULL;
+    }
+    ring->mask = capacity - 1;
+    return ring;
+}
+
+void del_pig_spsc_ring(pig_spsc_ring_ctx *ring) {
+    if (ring == NULL) {
+        return;
+    }
+    munmap(ring->slots, sizeof(pig_frame_ctx) * (ring->mask + 1));
+    free(ring);
+}
+
+int pig_spsc_push(pig_spsc_ring_ctx *ring, const pig_frame_ctx *frame) {
+    size_t head = ring->head;
+    if (head - ring->tail_cache > ring->mask) {
+        ring->tail_cache = __atomic_load_n(&ring->tail, __ATOMIC_ACQUIRE);
+        if (head - ring->tail_cache > ring->mask) {
+            //  INFO(Santiago): the ring is full, this is the backpressure. The producer must wait.
+            ring->full_stalls++;
+            return 0;
+        }
+    }
+    memcpy(&ring->slots[head & ring->mask], frame, sizeof(pig_frame_ctx));
+    __atomic_store_n(&ring->head, head + 1, __ATOMIC_RELEASE);
+    return 1;
+}
+
+size_t pig_spsc_pop(pig_spsc_ring_ctx *ring, pig_frame_ctx *frames, const size_t max_frames) {
+    size_t tail = ring->tail, available = 0, f = 0;
+    available = ring->head_cache - tail;
+    if (available < max_frames) {
+        ring->head_cache = __atomic_load_n(&ring->head, __ATOMIC_ACQUIRE);
+        available = ring->head_cache - tail;
+        if (available == 0) {
+            ring->empty_polls++;
+            return 0;
+        }
+    }
+    ring->used_sum += available;
+    ring->pops++;
+    if (available > max_frames) {
+        available = max_frames;
+    }
+    for (f = 0; f < available; f++) {
+        memcpy(&frames[f], &ring->slots[(tail + f) & ring->mask], sizeof(pig_frame_ctx));
+    }
+    ring->popped += available;
+    __atomic_store_n(&ring->tail, tail + available, __ATOMIC_RELEASE);
+    return available;
+}
+
+size_t get_pig_spsc_size(const pig_spsc_ring_ctx *ring) {
+    return (ring != NULL ? ring->mask + 1 : 0);
+}
+
+double get_pig_spsc_usage(const pig_spsc_ring_ctx *ring) {
+    if (ring == NULL || ring->pops == 0) {
+        return 0;
+    }
+    return (100.0 * (double)ring->used_sum / (double)ring->pops / (double)(ring->mask + 1));
+}
@@ -0,0 +1,41 @@
+/*
+ *                                Copyright (C) 2015 by Rafael Santiago
+ *
+ * This is a free software. You can redistribute it and/or modify under
+ * the terms of the GNU General Public License version 2.
+ *
+ */
+#ifndef PIG_SPSC_H
+#define PIG_SPSC_H 1
+
+#include "types.h"
+
+#define PIG_SPSC_CACHE_LINE 64
+
+typedef struct _pig_spsc_ring {
+    pig_frame_ctx *slots;
+    size_t mask;
+    size_t head __attribute__((aligned(PIG_SPSC_CACHE_LINE)));
+    size_t tail_cache;
+    unsigned long long full_stalls;
+    size_t tail __attribute__((aligned(PIG_SPSC_CACHE_LINE)));
+    size_t head_cache;
+    unsigned long long empty_polls;
+    unsigned long long popped;
+    unsigned long long used_sum;
+    unsigned long long pops;
+}pig_spsc_ring_ctx;
+
+pig_spsc_ring_ctx *mk_pig_spsc_ring(const size_t size);
+
+void del_pig_spsc_ring(pig_spsc_ring_ctx *ring);
+
+int pig_spsc_push(pig_spsc_ring_ctx *ring, const pig_frame_ctx *frame);
+
+size_t pig_spsc_pop(pig_spsc_ring_ctx *ring, pig_frame_ctx *frames, const size_t max_frames);
+
+size_t get_pig_spsc_size(const pig_spsc_ring_ctx *ring);
+
+double get_pig_spsc_usage(const pig_spsc_ring_ctx *ring);
+
+#endif
@@ -39,6 +39,29 @@ void parse_tcp_dgram(struct tcp **hdr, const unsigned char *buf, size_t bsize) {
     }
 }
 
+void put_tcp_hdr(const struct tcp *hdr, unsigned char *buf) {
+    buf[ 0] = (hdr->src & 0xff00) >> 8;
+    buf[ 1] =  hdr->src & 0x00ff;
+    buf[ 2] = (hdr->dst & 0xff00) >> 8;
+    buf[ 3] =  hdr->dst & 0x00ff;
+    buf[ 4] = (hdr->seqno & 0xff000000) >> 24;
+    buf[ 5] = (hdr->seqno & 0x00ff0000) >> 16;
+    buf[ 6] = (hdr->seqno & 0x0000ff00) >>  8;
+    buf[ 7] =  hdr->seqno & 0x000000ff;
+    buf[ 8] = (hdr->ackno & 0xff000000) >> 24;
+    buf[ 9] = (hdr->ackno & 0x00ff0000) >> 16;
+    buf[10] = (hdr->ackno & 0x0000ff00) >>  8;
+    buf[11] =  hdr->ackno & 0x000000ff;
+    buf[12] = (hdr->len & 0x0f) << 4 | (((hdr->reserv & 0x3f) & 0x3e) >> 2);
+    buf[13] = ((hdr->reserv & 0x03) << 6) | hdr->flags;
+    buf[14] = (hdr->window & 0xff00) >> 8;
+    buf[15] =  hdr->window & 0x00ff;
+    buf[16] = (hdr->chsum & 0xff00) >> 8;
+    buf[17] =  hdr->chsum & 0x00ff;
+    buf[18] = (hdr->urgp & 0xff00) >> 8;
+    buf[19] =  hdr->urgp & 0x00ff;
+}
+
 unsigned char *mk_tcp_buffer(const struct tcp *hdr, size_t *bsize) {
     unsigned char *retval = NULL;
     size_t p = 0;
@@ -47,26 +70,7 @@ unsigned char *mk_tcp_buffer(const struct tcp *hdr, size_t *bsize) {
     }
     *bsize = (4 * hdr->len) + hdr->payload_size;
     retval = (unsigned char *) pig_newseg(*bsize);
-    retval[ 0] = (hdr->src & 0xff00) >> 8;
-    retval[ 1] =  hdr->src & 0x00ff;
-    retval[ 2] = (hdr->dst & 0xff00) >> 8;
-    retval[ 3] =  hdr->dst & 0x00ff;
-    retval[ 4] = (hdr->seqno & 0xff000000) >> 24;
-    retval[ 5] = (hdr->seqno & 0x00ff0000) >> 16;
-    retval[ 6] = (hdr->seqno & 0x0000ff00) >>  8;
-    retval[ 7] =  hdr->seqno & 0x000000ff;
-    retval[ 8] = (hdr->ackno & 0xff000000) >> 24;
-    retval[ 9] = (hdr->ackno & 0x00ff0000) >> 16;
-    retval[10] = (hdr->ackno & 0x0000ff00) >>  8;
-    retval[11] =  hdr->ackno & 0x000000ff;
-    retval[12] = (hdr->len & 0x0f) << 4 | (((hdr->reserv & 0x3f) & 0x3e) >> 2);
-    retval[13] = ((hdr->reserv & 0x03) << 6) | hdr->flags;
-    retval[14] = (hdr->window & 0xff00) >> 8;
-    retval[15] =  hdr->window & 0x00ff;
-    retval[16] = (hdr->chsum & 0xff00) >> 8;
-    retval[17] =  hdr->chsum & 0x00ff;
-    retval[18] = (hdr->urgp & 0xff00) >> 8;
-    retval[19] =  hdr->urgp & 0x00ff;
+    put_tcp_hdr(hdr, retval);
     if (hdr->payload != NULL) {
         for (p = 0; p < hdr->payload_size; p++) {
             retval[20 + p] = hdr->payload[p];
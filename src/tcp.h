@@ -29,6 +29,8 @@ void parse_tcp_dgram(struct tcp **hdr, const unsigned char *buf, size_t bsize);
 
 unsigned char *mk_tcp_buffer(const struct tcp *hdr, size_t *bsize);
 
+void put_tcp_hdr(const struct tcp *hdr, unsigned char *buf);
+
 unsigned short eval_tcp_ip4_chsum(const struct tcp hdr, const unsigned int src_addr, const unsigned int dst_addr);
 
 #endif
@@ -0,0 +1,272 @@
+/*
+ *                                Copyright (C) 2015 by Rafael Santiago
+ *
+ * This is a free software. You can redistribute it and/or modify under
+ * the terms of the GNU General Public License version 2.
+ *
+ */
+#include "template.h"
+#include "memory.h"
+#include "lists.h"
+#include "mkrnd.h"
+#include "chsum.h"
+#include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
+#include <time.h>
+
+#define PIG_TEMPLATE_MAX_PLACEHOLDER 32
+
+#define PIG_TEMPLATE_MAX_RAND 1024
+
+struct template_fmt {
+    const char *label;
+    const size_t size;
+    const int little_endian;
+};
+
+static struct template_fmt TEMPLATE_FMTS[] = {
+    {    "u8", 1, 0 },
+    { "u16be", 2, 0 },
+    { "u16le", 2, 1 },
+    { "u32be", 4, 0 },
+    { "u32le", 4, 1 },
+    { "u64be", 8, 0 },
+    { "u64le", 8, 1 }
+};
+
+static const size_t TEMPLATE_FMTS_SIZE = sizeof(TEMPLATE_FMTS) / sizeof(TEMPLATE_FMTS[0]);
+
+static int get_template_payload_index(pigsty_conf_set_ctx *conf);
+
+static int parse_placeholder(const char *data, const size_t dsize, pig_template_op_ctx *op);
+
+static int parse_placeholder_fmt(const char *fmt, pig_template_op_ctx *op);
+
+static size_t compile_template(const unsigned char *data, const size_t dsize, unsigned char *out, pig_template_op_ctx *ops, size_t *ops_nr);
+
+static void put_template_uint(unsigned char *buf, unsigned long long value, const size_t size, const int little_endian);
+
+pig_template_ctx *mk_pig_template(pigsty_conf_set_ctx *conf) {
+    pig_template_ctx *tpl = NULL;
+    pigsty_field_ctx *payload = NULL;
+    unsigned char *data = NULL;
+    size_t data_size = 0, ops_nr = 0;
+    int index = get_template_payload_index(conf);
+    payload = get_pigsty_conf_set_field(index, conf);
+    if (payload == NULL || payload->data == NULL || payload->dsize == 0 || payload->interned) {
+        return NULL;
+    }
+    data_size = compile_template(payload->data, payload->dsize, NULL, NULL, &ops_nr);
+    if (ops_nr == 0) {
+        return NULL;
+    }
+    tpl = (pig_template_ctx *) pig_newseg(sizeof(pig_template_ctx));
+    tpl->counter = 0;
+    tpl->ops_nr = ops_nr;
+    tpl->ops = (pig_template_op_ctx *) pig_newseg(sizeof(pig_template_op_ctx) * ops_nr);
+    data = (unsigned char *) pig_newseg(data_size + 1);
+    memset(data, 0, data_size + 1);
+    compile_template(payload->data, payload->dsize, data, tpl->ops, &ops_nr);
+    //  INFO(Santiago): the placeholders are replaced by zeroed room. The packet making stays
+    //                  untouched and only these bytes are patched later, packet by packet.
+    free(payload->data);
+    payload->data = data;
+    payload->dsize = data_size;
+    return tpl;
+}
+
+void del_pig_template(pig_template_ctx *tpl) {
+    if (tpl == NULL) {
+        return;
+    }
+    free(tpl->ops);
+    free(tpl);
+}
+
+void fill_ip4_template(pig_template_ctx *tpl, unsigned char *dgram, const size_t dgram_size, const unsigned long long seq) {
+    unsigned char value[64];
+    size_t l7_offset = 0, o = 0, pos = 0, step = 0, n = 0;
+    unsigned long long counter = 0, now = 0;
+    struct timespec ts;
+    int has_now = 0;
+    pig_template_op_ctx *op = NULL;
+    if (tpl == NULL || dgram == NULL) {
+        return;
+    }
+    l7_offset = get_ip4_l7_offset(dgram, dgram_size);
+    counter = __sync_fetch_and_add(&tpl->counter, 1);
+    for (o = 0; o < tpl->ops_nr; o++) {
+        op = &tpl->ops[o];
+        pos = l7_offset + op->offset;
+        if (pos + op->size > dgram_size) {
+            continue;
+        }
+        switch (op->type) {
+
+            case kTplCounter:
+                put_template_uint(value, counter, op->size, op->little_endian);
+                patch_ip4_dgram(dgram, dgram_size, pos, value, op->size);
+                break;
+
+            case kTplSeq:
+                put_template_uint(value, seq, op->size, op->little_endian);
+                patch_ip4_dgram(dgram, dgram_size, pos, value, op->size);
+                break;
+
+            case kTplTimestamp:
+                if (!has_now) {
+                    clock_gettime(CLOCK_REALTIME, &ts);
+                    now = (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+                    has_now = 1;
+                }
+                put_template_uint(value, now / op->divisor, op->size, op->little_endian);
+                patch_ip4_dgram(dgram, dgram_size, pos, value, op->size);
+                break;
+
+            case kTplTargetIp:
+                patch_ip4_dgram(dgram, dgram_size, pos, &dgram[16], 4);
+                break;
+
+            case kTplRand:
+                for (n = 0; n < op->size; n += step) {
+                    step = (op->size - n < sizeof(value)) ? op->size - n : sizeof(value);
+                    mk_rnd_fill_bytes(value, step);
+                    patch_ip4_dgram(dgram, dgram_size, pos + n, value, step);
+                }
+                break;
+
+        }
+    }
+}
+
+static int get_template_payload_index(pigsty_conf_set_ctx *conf) {
+    pigsty_field_ctx *protocol = get_pigsty_conf_set_field(kIpv4_protocol, conf);
+    int index = kIpv4_payload;
+    if (protocol != NULL) {
+        switch (*(unsigned char *)protocol->data) {
+            case 1:
+                index = kIcmp_payload;
+                break;
+
+            case 6:
+                index = kTcp_payload;
+                break;
+
+            case 17:
+                index = kUdp_payload;
+                break;
+        }
+    }
+    return index;
+}
+
+static size_t compile_template(const unsigned char *data, const size_t dsize, unsigned char *out, pig_template_op_ctx *ops, size_t *ops_nr) {
+    const unsigned char *dp = data, *dp_end = data + dsize, *cp = NULL;
+    pig_template_op_ctx op;
+    size_t out_size = 0;
+    *ops_nr = 0;
+    while (dp != dp_end) {
+        if (*dp == '{') {
+            for (cp = dp + 1; cp != dp_end && *cp != '}' && (cp - dp) <= PIG_TEMPLATE_MAX_PLACEHOLDER; cp++);
+            if (cp != dp_end && *cp == '}' && parse_placeholder((const char *)dp + 1, cp - dp - 1, &op)) {
+                op.offset = out_size;
+                if (ops != NULL) {
+                    ops[*ops_nr] = op;
+                }
+                (*ops_nr)++;
+                out_size += op.size;
+                dp = cp + 1;
+                continue;
+            }
+        }
+        //  INFO(Santiago): anything that is not a known placeholder (e.g. JSON braces) is kept as is.
+        if (out != NULL) {
+            out[out_size] = *dp;
+        }
+        out_size++;
+        dp++;
+    }
+    return out_size;
+}
+
+static int parse_placeholder(const char *data, const size_t dsize, pig_template_op_ctx *op) {
+    char placeholder[PIG_TEMPLATE_MAX_PLACEHOLDER + 1];
+    char *arg = NULL;
+    const char *ap = NULL;
+    if (dsize == 0 || dsize > PIG_TEMPLATE_MAX_PLACEHOLDER) {
+        return 0;
+    }
+    memset(placeholder, 0, sizeof(placeholder));
+    memcpy(placeholder, data, dsize);
+    memset(op, 0, sizeof(pig_template_op_ctx));
+    if ((arg = strchr(placeholder, ':')) != NULL) {
+        *arg = 0;
+        arg++;
+    }
+    op->size = 4;
+    op->divisor = 1;
+    if (strcmp(placeholder, "counter") == 0) {
+        op->type = kTplCounter;
+        return (arg == NULL || parse_placeholder_fmt(arg, op));
+    } else if (strcmp(placeholder, "seq") == 0) {
+        op->type = kTplSeq;
+        return (arg == NULL || parse_placeholder_fmt(arg, op));
+    } else if (strcmp(placeholder, "target.ip") == 0) {
+        op->type = kTplTargetIp;
+        return (arg == NULL);
+    } else if (strcmp(placeholder, "rand") == 0) {
+        op->type = kTplRand;
+        if (arg == NULL || *arg == 0) {
+            return 0;
+        }
+        for (ap = arg; *ap != 0; ap++) {
+            if (!isdigit(*ap)) {
+                return 0;
+            }
+        }
+        op->size = atoi(arg);
+        return (op->size > 0 && op->size <= PIG_TEMPLATE_MAX_RAND);
+    } else if (strcmp(placeholder, "ts") == 0) {
+        op->type = kTplTimestamp;
+        op->size = 8;
+        if (arg == NULL || strcmp(arg, "ns") == 0) {
+            op->divisor = 1;
+        } else if (strcmp(arg, "us") == 0) {
+            op->divisor = 1000ULL;
+        } else if (strcmp(arg, "ms") == 0) {
+            op->divisor = 1000000ULL;
+        } else if (strcmp(arg, "s") == 0) {
+            op->divisor = 1000000000ULL;
+            op->size = 4;
+        } else {
+            return 0;
+        }
+        return 1;
+    }
+    return 0;
+}
+
+static int parse_placeholder_fmt(const char *fmt, pig_template_op_ctx *op) {
+    size_t f = 0;
+    for (f = 0; f < TEMPLATE_FMTS_SIZE; f++) {
+        if (strcmp(fmt, TEMPLATE_FMTS[f].label) == 0) {
+            op->size = TEMPLATE_FMTS[f].size;
+            op->little_endian = TEMPLATE_FMTS[f].little_endian;
+            return 1;
+        }
+    }
+    return 0;
+}
+
+static void put_template_uint(unsigned char *buf, unsigned long long value, const size_t size, const int little_endian) {
+    size_t b = 0;
+    for (b = 0; b < size; b++) {
+        if (little_endian) {
+            buf[b] = value & 0xff;
+        } else {
+            buf[size - b - 1] = value & 0xff;
+        }
+        value >>= 8;
+    }
+}
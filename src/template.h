@@ -0,0 +1,19 @@
+/*
+ *                                Copyright (C) 2015 by Rafael Santiago
+ *
+ * This is a free software. You can redistribute it and/or modify under
+ * the terms of the GNU General Public License version 2.
+ *
+ */
+#ifndef PIG_TEMPLATE_H
+#define PIG_TEMPLATE_H 1
+
+#include "types.h"
+
+pig_template_ctx *mk_pig_template(pigsty_conf_set_ctx *conf);
+
+void del_pig_template(pig_template_ctx *tpl);
+
+void fill_ip4_template(pig_template_ctx *tpl, unsigned char *dgram, const size_t dgram_size, const unsigned long long seq);
+
+#endif
@@ -18,13 +18,15 @@ typedef enum _pig_fields {
     kTcp_src, kTcp_dst, kTcp_seq, kTcp_ackno, kTcp_size, kTcp_reserv, kTcp_urg, kTcp_ack,
     kTcp_psh, kTcp_rst, kTcp_syn, kTcp_fin, kTcp_wsize, kTcp_checksum, kTcp_urgp, kTcp_payload,
     kUdp_src, kUdp_dst, kUdp_size, kUdp_checksum, kUdp_payload, kIcmp_type, kIcmp_code, kIcmp_checksum,
-    kIcmp_payload, kSignature, kRefresh, kRandom, kUnk, kMaxPigFields
+    kIcmp_payload, kSignature, kFuzz_strategy, kFuzz_dictionary, kFuzz_intensity,
+    kRefresh, kRandom, kIncrement, kUnk, kMaxPigFields
 }pig_field_t;
 
 typedef struct _pigsty_field {
     pig_field_t index;
     void *data;
     size_t dsize;
+    int interned;
 }pigsty_field_ctx;
 
 typedef struct _pigsty_conf_set {
@@ -32,9 +34,49 @@ typedef struct _pigsty_conf_set {
     struct _pigsty_conf_set *next;
 }pigsty_conf_set_ctx;
 
+typedef struct _pig_fuzz {
+    unsigned int strategies;
+    unsigned int intensity;
+    unsigned char **dict;
+    size_t *dict_sizes;
+    size_t dict_nr;
+}pig_fuzz_ctx;
+
+typedef enum _pig_template_op_t {
+    kTplCounter, kTplSeq, kTplRand, kTplTimestamp, kTplTargetIp
+}pig_template_op_t;
+
+typedef struct _pig_template_op {
+    pig_template_op_t type;
+    size_t offset;
+    size_t size;
+    int little_endian;
+    unsigned long long divisor;
+}pig_template_op_ctx;
+
+typedef struct _pig_template {
+    pig_template_op_ctx *ops;
+    size_t ops_nr;
+    unsigned long long counter;
+}pig_template_ctx;
+
+typedef struct _pig_slot {
+    pig_field_t field;
+    pig_field_t modifier;
+    unsigned int param;
+    unsigned int left;
+    unsigned long long value;
+    int ready;
+    int lock;
+}pig_slot_ctx;
+
 typedef struct _pigsty_entry {
     char *signature_name;
     pigsty_conf_set_ctx *conf;
+    pig_fuzz_ctx *fuzz;
+    pig_template_ctx *tpl;
+    pig_slot_ctx *slots;
+    size_t slots_nr;
     struct _pigsty_entry *next;
 }pigsty_entry_ctx;
 
@@ -61,4 +103,19 @@ typedef struct _pig_hwaddr {
     struct _pig_hwaddr *next;
 }pig_hwaddr_ctx;
 
+typedef struct _pig_frame {
+    const struct _pigsty_entry *signature;
+    unsigned char l2hdr[14];
+    size_t l2hdr_size;
+    unsigned char *packet;
+    size_t packet_size;
+    int is_lo;
+    int sent;
+}pig_frame_ctx;
+
+typedef struct _pig_signature_index {
+    const struct _pigsty_entry *signature;
+    size_t index;
+}pig_signature_index_ctx;
+
 #endif
@@ -30,6 +30,17 @@ void parse_udp_dgram(struct udp **hdr, const unsigned char *buf, size_t bsize) {
     }
 }
 
+void put_udp_hdr(const struct udp *hdr, unsigned char *buf) {
+    buf[0] = (hdr->src & 0xff00) >> 8;
+    buf[1] = hdr->src & 0x00ff;
+    buf[2] = (hdr->dst & 0xff00) >> 8;
+    buf[3] = hdr->dst & 0x00ff;
+    buf[4] = (hdr->len & 0xff00) >> 8;
+    buf[5] = hdr->len & 0x00ff;
+    buf[6] = (hdr->chsum & 0xff00) >> 8;
+    buf[7] = hdr->chsum & 0x00ff;
+}
+
 unsigned char *mk_udp_buffer(const struct udp *hdr, size_t *bsize) {
     unsigned char *retval = NULL;
     size_t p = 0;
@@ -38,14 +49,7 @@ unsigned char *mk_udp_buffer(const struct udp *hdr, size_t *bsize) {
     }
     *bsize = hdr->len;
     retval = (unsigned char *)pig_newseg(*bsize);
-    retval[0] = (hdr->src & 0xff00) >> 8;
-    retval[1] = hdr->src & 0x00ff;
-    retval[2] = (hdr->dst & 0xff00) >> 8;
-    retval[3] = hdr->dst & 0x00ff;
-    retval[4] = (hdr->len & 0xff00) >> 8;
-    retval[5] = hdr->len & 0x00ff;
-    retval[6] = (hdr->chsum & 0xff00) >> 8;
-    retval[7] = hdr->chsum & 0x00ff;
+    put_udp_hdr(hdr, retval);
     for (p = 0; p < hdr->payload_size; p++) {
         retval[8 + p] = hdr->payload[p];
     }
@@ -23,6 +23,8 @@ void parse_udp_dgram(struct udp **hdr, const unsigned char *buf, size_t bsize);
 
 unsigned char *mk_udp_buffer(const struct udp *hdr, size_t *bsize);
 
+void put_udp_hdr(const struct udp *hdr, unsigned char *buf);
+
 unsigned short eval_udp_chsum(const struct udp hdr, const unsigned int src_addr,
                               const unsigned int dst_addr, unsigned short phdr_len);
 
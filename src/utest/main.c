@@ -18,10 +18,36 @@
 #include "../netmask.h"
 #include "../icmp.h"
 #include "../arp.h"
+#include "../mkrnd.h"
+#include "../evlog.h"
+#include "../chsum.h"
+#include "../fuzz.h"
+#include "../template.h"
+#include "../mkpkt.h"
+#include "../pool.h"
+#include "../slots.h"
+#include "../profile.h"
+#include "../budget.h"
+#include "../oink.h"
+#include "../order.h"
+#include "../prebuild.h"
+#include "../spsc.h"
+#include "../pipeline.h"
+#include "../cpus.h"
+#include "../pacer.h"
+#include "../arrivals.h"
+#include "../session.h"
+#include "../replies.h"
+#include "../rtt.h"
+#include "../manifest.h"
+#include "../alerts.h"
+#include "../segment.h"
+#include "../fragment.h"
 #include <cutest.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <unistd.h>
 
 int write_to_file(const char *filepath, const char *data) {
     FILE *fp = fopen(filepath, "wb");
@@ -696,6 +722,1511 @@ CUTE_TEST_CASE(arp_packet_making_tests)
 
 CUTE_TEST_CASE_END
 
+CUTE_TEST_CASE(mk_rnd_tests)
+    unsigned int seq_a[16], seq_b[16], filled[16];
+    size_t s = 0;
+    int has_msb = 0, differs = 0;
+    mk_rnd_init(1234, 0);
+    for (s = 0; s < 16; s++) {
+        seq_a[s] = mk_rnd_u32();
+        has_msb = has_msb || (seq_a[s] & 0x80000000);
+    }
+    CUTE_CHECK("mk_rnd_u32() never sets the 31th bit", has_msb);
+    mk_rnd_init(1234, 0);
+    mk_rnd_fill_u32(filled, 16);
+    mk_rnd_init(1234, 0);
+    for (s = 0; s < 16; s++) {
+        seq_b[s] = mk_rnd_u32();
+        CUTE_CHECK("seq_a[s] != seq_b[s]", seq_a[s] == seq_b[s]);
+    }
+    mk_rnd_init(1234, 1);
+    for (s = 0; s < 16; s++) {
+        seq_b[s] = mk_rnd_u32();
+        differs = differs || (seq_a[s] != seq_b[s]);
+    }
+    CUTE_CHECK("stream 1 is equal to stream 0", differs);
+    mk_rnd_init(1234, 0);
+    mk_rnd_fill_u32(seq_b, 16);
+    for (s = 0; s < 16; s++) {
+        CUTE_CHECK("filled[s] != seq_b[s]", filled[s] == seq_b[s]);
+    }
+CUTE_TEST_CASE_END
+
+CUTE_TEST_CASE(evlog_tests)
+    pig_evlog_ctx *evlog = NULL;
+    size_t indexes[1500], index = 0, i = 0;
+    unsigned long long counter = 0;
+    pigsty_entry_ctx entries[7], *signatures[7];
+    pig_slot_ctx slot;
+    pigsty_field_ctx *payload = NULL;
+    const char *data = "n={counter:u32be}";
+    unsigned char *pkt = NULL;
+    size_t pkt_size = 0, l7_offset = 0;
+    int version = 4, protocol = 17;
+    memset(entries, 0, sizeof(entries));
+    memset(&slot, 0, sizeof(slot));
+    slot.field = kIpv4_id;
+    slot.modifier = kIncrement;
+    slot.param = 5;
+    entries[3].slots = &slot;
+    entries[3].slots_nr = 1;
+    entries[5].conf = add_conf_to_pigsty_conf_set(entries[5].conf, kIpv4_version, &version, sizeof(version));
+    entries[5].conf = add_conf_to_pigsty_conf_set(entries[5].conf, kIpv4_protocol, &protocol, sizeof(protocol));
+    entries[5].conf = add_conf_to_pigsty_conf_set(entries[5].conf, kUdp_payload, (void *)data, strlen(data));
+    entries[5].tpl = mk_pig_template(entries[5].conf);
+    CUTE_CHECK("entries[5].tpl == NULL", entries[5].tpl != NULL);
+    for (i = 0; i < 7; i++) {
+        signatures[i] = &entries[i];
+    }
+    evlog = evlog_create("test.evlog", 31337, 7);
+    CUTE_CHECK("evlog == NULL", evlog != NULL);
+    mk_rnd_init(31337, 0);
+    for (i = 0; i < 1500; i++) {
+        set_pig_pkt_seq(i * 3);
+        slot.value = i * 5;
+        slot.ready = 1;
+        CUTE_CHECK("evlog_checkpoint() != 1", evlog_checkpoint(evlog, signatures) == 1);
+        indexes[i] = mk_rnd_u32() % 7;
+        if (indexes[i] == 5) {
+            pkt = mk_pigsty_pkt(&entries[5], NULL, &pkt_size);
+            CUTE_CHECK("pkt == NULL", pkt != NULL);
+            free(pkt);
+        }
+        CUTE_CHECK("evlog_record() != 1", evlog_record(evlog, indexes[i]) == 1);
+    }
+    evlog_close(evlog);
+    evlog = evlog_open("test.evlog");
+    CUTE_CHECK("evlog == NULL", evlog != NULL);
+    CUTE_CHECK("evlog->seed != 31337", evlog->seed == 31337);
+    CUTE_CHECK("evlog->signatures_count != 7", evlog->signatures_count == 7);
+    slot.value = 0;
+    slot.ready = 0;
+    entries[5].tpl->counter = 0;
+    CUTE_CHECK("evlog_seek() != 1", evlog_seek(evlog, 1100, signatures) == 1);
+    CUTE_CHECK("evlog->packet_nr != 1024", evlog->packet_nr == 1024);
+    CUTE_CHECK("get_pig_pkt_seq() != 3072", get_pig_pkt_seq() == 3072);
+    CUTE_CHECK("slot.value != 5120", slot.value == 5120 && slot.ready == 1);
+    for (i = 0, counter = 0; i < 1024; i++) {
+        counter += (indexes[i] == 5);
+    }
+    CUTE_CHECK("the {counter} was not restored", entries[5].tpl->counter == counter);
+    for (i = 1024; i < 1500; i++) {
+        CUTE_CHECK("evlog_replay_next() != 1", evlog_replay_next(evlog, &index) == 1);
+        CUTE_CHECK("index != indexes[i]", index == indexes[i] && index == mk_rnd_u32() % 7);
+        if (index == 5) {
+            //  INFO(Santiago): the replayed packet carries the same {counter} as the recorded one.
+            pkt = mk_pigsty_pkt(&entries[5], NULL, &pkt_size);
+            CUTE_CHECK("pkt == NULL", pkt != NULL);
+            l7_offset = get_ip4_l7_offset(pkt, pkt_size);
+            CUTE_CHECK("wrong {counter} in the replayed packet",
+                       ((unsigned long long)pkt[l7_offset + 4] << 8 | pkt[l7_offset + 5]) == counter);
+            free(pkt);
+            counter++;
+        }
+    }
+    CUTE_CHECK("evlog_replay_next() != 0", evlog_replay_next(evlog, &index) == 0);
+    evlog_close(evlog);
+    del_pig_template(entries[5].tpl);
+    del_pigsty_conf_set(entries[5].conf);
+    remove("test.evlog");
+    set_pig_pkt_seq(0);
+CUTE_TEST_CASE_END
+
+CUTE_TEST_CASE(fuzz_tests)
+    unsigned char dgram[0xffff], check[0xffff];
+    const char *payload = "GET / HTTP/1.1\r\nHost: pig\r\n\r\nwhy not fuzz some pigs today?";
+    size_t dgram_size = 0, i = 0;
+    pig_fuzz_ctx fuzz;
+    unsigned int strategies = 0;
+    CUTE_CHECK("get_fuzz_strategies() != 1", get_fuzz_strategies("bitflip, splice,chunked", 23, &strategies) == 1);
+    CUTE_CHECK("strategies != BITFLIP|SPLICE|CHUNKED", strategies == (PIG_FUZZ_BITFLIP | PIG_FUZZ_SPLICE | PIG_FUZZ_CHUNKED));
+    CUTE_CHECK("get_fuzz_strategies() != 0", get_fuzz_strategies("bitflip,oink", 12, &strategies) == 0);
+    memset(&fuzz, 0, sizeof(fuzz));
+    fuzz.strategies = PIG_FUZZ_BITFLIP | PIG_FUZZ_INSERT | PIG_FUZZ_DELETE | PIG_FUZZ_SPLICE | PIG_FUZZ_CASE | PIG_FUZZ_CHUNKED;
+    fuzz.intensity = 3;
+    mk_rnd_init(1, 0);
+    for (i = 0; i < 1000; i++) {
+        memset(dgram, 0, sizeof(dgram));
+        dgram[0] = 0x45;
+        dgram[8] = 64;
+        dgram[9] = (i % 2) ? 17 : 6;
+        dgram[12] = 192; dgram[13] = 30; dgram[14] = 70; dgram[15] = 3;
+        dgram[16] = 192; dgram[17] = 30; dgram[18] = 70; dgram[19] = 10;
+        dgram[20] = 0x04; dgram[21] = 0xd2;
+        dgram[22] = 0x00; dgram[23] = 0x50;
+        dgram_size = (dgram[9] == 17) ? 28 : 40;
+        if (dgram[9] == 6) {
+            dgram[32] = 0x50;
+        }
+        memcpy(&dgram[dgram_size], payload, strlen(payload));
+        dgram_size += strlen(payload);
+        dgram[2] = (dgram_size >> 8) & 0xff;
+        dgram[3] = dgram_size & 0xff;
+        if (dgram[9] == 17) {
+            dgram[24] = ((dgram_size - 20) >> 8) & 0xff;
+            dgram[25] = (dgram_size - 20) & 0xff;
+        }
+        chsum_ip4_dgram(dgram, dgram_size);
+        fuzz_ip4_dgram(&fuzz, dgram, &dgram_size, sizeof(dgram));
+        CUTE_CHECK("dgram_size < 20", dgram_size >= 20);
+        CUTE_CHECK("tlen != dgram_size", ((dgram[2] << 8) | dgram[3]) == dgram_size);
+        memcpy(check, dgram, dgram_size);
+        chsum_ip4_dgram(check, dgram_size);
+        CUTE_CHECK("fuzzed dgram has a wrong checksum", memcmp(check, dgram, dgram_size) == 0);
+    }
+    payload = "POST / HTTP/1.1\r\nHost: pig\r\ncontent-length: 5\r\n\r\noink!";
+    fuzz.strategies = PIG_FUZZ_CHUNKED;
+    fuzz.intensity = 1;
+    memset(dgram, 0, sizeof(dgram));
+    dgram[0] = 0x45;
+    dgram[8] = 64;
+    dgram[9] = 6;
+    dgram[32] = 0x50;
+    memcpy(&dgram[40], payload, strlen(payload));
+    dgram_size = 40 + strlen(payload);
+    dgram[2] = (dgram_size >> 8) & 0xff;
+    dgram[3] = dgram_size & 0xff;
+    fuzz_ip4_dgram(&fuzz, dgram, &dgram_size, sizeof(dgram));
+    CUTE_CHECK("chunked headers were not patched",
+               memcmp(&dgram[40], "POST / HTTP/1.1\r\nHost: pig\r\nTransfer-Encoding: chunked\r\n\r\n", 58) == 0);
+    CUTE_CHECK("chunked body has no last chunk", memcmp(&dgram[dgram_size - 5], "0\r\n\r\n", 5) == 0);
+CUTE_TEST_CASE_END
+
+CUTE_TEST_CASE(template_tests)
+    pigsty_entry_ctx *pigsty = NULL;
+    pigsty_field_ctx *payload = NULL;
+    const char *data = "id={counter:u16be};tgt={target.ip};rnd={rand:3};{\"json\": {seq}}";
+    unsigned char *pkt = NULL, check[0xffff];
+    size_t pkt_size = 0, i = 0, l7_offset = 0;
+    int version = 4, protocol = 17;
+    unsigned int dst = 0x0a00000a;
+    pigsty = add_signature_to_pigsty_entry(pigsty, "tpl");
+    pigsty->conf = add_conf_to_pigsty_conf_set(pigsty->conf, kIpv4_version, &version, sizeof(version));
+    pigsty->conf = add_conf_to_pigsty_conf_set(pigsty->conf, kIpv4_protocol, &protocol, sizeof(protocol));
+    pigsty->conf = add_conf_to_pigsty_conf_set(pigsty->conf, kIpv4_dst, &dst, sizeof(dst));
+    pigsty->conf = add_conf_to_pigsty_conf_set(pigsty->conf, kUdp_payload, (void *)data, strlen(data));
+    pigsty->tpl = mk_pig_template(pigsty->conf);
+    CUTE_CHECK("pigsty->tpl == NULL", pigsty->tpl != NULL);
+    CUTE_CHECK("pigsty->tpl->ops_nr != 4", pigsty->tpl->ops_nr == 4);
+    payload = get_pigsty_conf_set_field(kUdp_payload, pigsty->conf);
+    CUTE_CHECK("payload->dsize != 37", payload->dsize == 37);
+    CUTE_CHECK("payload->data has no placeholders room", memcmp(payload->data, "id=\x00\x00;tgt=", 9) == 0);
+    for (i = 0; i < 3; i++) {
+        pkt = mk_pigsty_pkt(pigsty, NULL, &pkt_size);
+        CUTE_CHECK("pkt == NULL", pkt != NULL);
+        l7_offset = get_ip4_l7_offset(pkt, pkt_size);
+        CUTE_CHECK("pkt_size != l7_offset + 37", pkt_size == l7_offset + 37);
+        CUTE_CHECK("counter != i", pkt[l7_offset + 3] == 0 && pkt[l7_offset + 4] == i);
+        CUTE_CHECK("target.ip != ip.dst", memcmp(&pkt[l7_offset + 10], &pkt[16], 4) == 0);
+        CUTE_CHECK("literal braces lost", memcmp(&pkt[l7_offset + 23], "{\"json\": ", 9) == 0 && pkt[l7_offset + 36] == '}');
+        memcpy(check, pkt, pkt_size);
+        chsum_ip4_dgram(check, pkt_size);
+        CUTE_CHECK("template patch broke the udp checksum", memcmp(&check[26], &pkt[26], 2) == 0);
+        free(pkt);
+    }
+    del_pigsty_entry(pigsty);
+CUTE_TEST_CASE_END
+
+CUTE_TEST_CASE(pool_tests)
+    const unsigned char *a = NULL, *b = NULL, *c = NULL;
+    size_t count = pig_pool_count();
+    a = pig_pool_intern((const unsigned char *)"oink!", 5);
+    b = pig_pool_intern((const unsigned char *)"oink!", 5);
+    c = pig_pool_intern((const unsigned char *)"oink?", 5);
+    CUTE_CHECK("a == NULL", a != NULL);
+    CUTE_CHECK("a != b", a == b);
+    CUTE_CHECK("a == c", a != c);
+    CUTE_CHECK("a != oink!", memcmp(a, "oink!", 5) == 0);
+    CUTE_CHECK("pig_pool_count() != count + 2", pig_pool_count() == count + 2);
+    pig_pool_release(a);
+    CUTE_CHECK("pig_pool_count() != count + 2", pig_pool_count() == count + 2);
+    pig_pool_release(b);
+    pig_pool_release(c);
+    CUTE_CHECK("pig_pool_count() != count", pig_pool_count() == count);
+CUTE_TEST_CASE_END
+
+CUTE_TEST_CASE(slots_tests)
+    pigsty_entry_ctx *pigsty = NULL;
+    unsigned char *pkt = NULL, check[0xffff];
+    size_t pkt_size = 0, i = 0;
+    unsigned int seqno = 0, last_seqno = 0;
+    unsigned short id = 0, last_id = 0;
+    pig_field_t modifier = kUnk;
+    unsigned int param = 0;
+    CUTE_CHECK("get_pig_slot_modifier(random) != 1", get_pig_slot_modifier("random", &modifier, &param) == 1 && modifier == kRandom);
+    CUTE_CHECK("get_pig_slot_modifier(increment(7)) != 1", get_pig_slot_modifier("increment(7)", &modifier, &param) == 1 && modifier == kIncrement && param == 7);
+    CUTE_CHECK("get_pig_slot_modifier(refresh(0)) != 0", get_pig_slot_modifier("refresh(0)", &modifier, &param) == 0);
+    CUTE_CHECK("get_pig_slot_modifier(increment(1) != 0", get_pig_slot_modifier("increment(1", &modifier, &param) == 0);
+    write_to_file("test.pigsty", "[ signature = \"slots\", ip.version = 4, ip.protocol = 6, ip.src = random, ip.dst = 192.30.70.3, "
+                                 "ip.id = refresh(3), tcp.src = 1024, tcp.dst = 80, tcp.seqno = increment(1000), tcp.payload = \"oink\" ]");
+    pigsty = load_pigsty_data_from_file(pigsty, "test.pigsty");
+    remove("test.pigsty");
+    CUTE_CHECK("pigsty == NULL", pigsty != NULL);
+    CUTE_CHECK("pigsty->slots_nr != 3", pigsty->slots_nr == 3);
+    write_to_file("test.pigsty", "[ signature = \"no slots\", ip.version = 4, ip.protocol = random, ip.src = 1.2.3.4, ip.dst = 1.2.3.4 ]");
+    CUTE_CHECK("load_pigsty_data_from_file() != NULL", load_pigsty_data_from_file(NULL, "test.pigsty") == NULL);
+    remove("test.pigsty");
+    mk_rnd_init(42, 0);
+    for (i = 0; i < 9; i++) {
+        pkt = mk_pigsty_pkt(pigsty, NULL, &pkt_size);
+        CUTE_CHECK("pkt == NULL", pkt != NULL);
+        id = (pkt[4] << 8) | pkt[5];
+        seqno = (pkt[24] << 24) | (pkt[25] << 16) | (pkt[26] << 8) | pkt[27];
+        if (i > 0) {
+            CUTE_CHECK("tcp.seqno was not incremented by 1000", seqno == last_seqno + 1000);
+            CUTE_CHECK("ip.id was not kept until the refresh", (i % 3) == 0 || id == last_id);
+        }
+        last_seqno = seqno;
+        last_id = id;
+        memcpy(check, pkt, pkt_size);
+        chsum_ip4_dgram(check, pkt_size);
+        CUTE_CHECK("slots broke the checksums", memcmp(check, pkt, pkt_size) == 0);
+        free(pkt);
+    }
+    del_pigsty_entry(pigsty);
+CUTE_TEST_CASE_END
+
+CUTE_TEST_CASE(profile_tests)
+    pigsty_entry_ctx *pigsty = NULL;
+    pig_profile_ctx *profile = NULL;
+    const pig_profile_point_ctx *mix = NULL;
+    unsigned long long elapsed = 0;
+    size_t i = 0;
+    write_to_file("test.pigsty", "[ signature = \"a\", ip.version = 4, ip.protocol = 17, ip.src = 192.30.70.3, ip.dst = 192.30.70.4, udp.src = 53, udp.dst = 53 ]\n"
+                                 "[ signature = \"b b\", ip.version = 4, ip.protocol = 17, ip.src = 192.30.70.3, ip.dst = 192.30.70.4, udp.src = 53, udp.dst = 53 ]");
+    pigsty = load_pigsty_data_from_file(pigsty, "test.pigsty");
+    remove("test.pigsty");
+    CUTE_CHECK("pigsty == NULL", pigsty != NULL);
+    CUTE_CHECK("parse_pig_profile() != NULL", parse_pig_profile("10s 10\n20s 10\n", pigsty) == NULL);
+    CUTE_CHECK("parse_pig_profile() != NULL", parse_pig_profile("0 10\n20s 10\n10s 10\n", pigsty) == NULL);
+    CUTE_CHECK("parse_pig_profile() != NULL", parse_pig_profile("0 10 c=1\n20s 10\n", pigsty) == NULL);
+    CUTE_CHECK("parse_pig_profile() != NULL", parse_pig_profile("0 10 a=0\n20s 10\n", pigsty) == NULL);
+    profile = parse_pig_profile("# a ramp, a plateau and the fall.\n"
+                                "0s      10  linear  a=1\n"
+                                "\n"
+                                "10000ms 30  step\n"
+                                "00:00:20 30 \"b b\"=1 # only \"b b\" from now on\n"
+                                "0.5m    0\n", pigsty);
+    CUTE_CHECK("profile == NULL", profile != NULL);
+    CUTE_CHECK("profile->points_nr != 4", profile->points_nr == 4);
+    CUTE_CHECK("profile->points[1].is_step != 1", profile->points[1].is_step == 1);
+    CUTE_CHECK("get_pig_profile_packets() != 200", (unsigned int)get_pig_profile_packets(profile, 10000000000ULL) == 200);
+    CUTE_CHECK("get_pig_profile_packets() != 650", (unsigned int)get_pig_profile_packets(profile, 60000000000ULL) == 650);
+    CUTE_CHECK("get_pig_profile_deadline(0) != 1", get_pig_profile_deadline(profile, 0, &elapsed, &mix) == 1 && elapsed == 0 && mix == &profile->points[0]);
+    CUTE_CHECK("get_pig_profile_deadline(100) != 1", get_pig_profile_deadline(profile, 100, &elapsed, &mix) == 1);
+    CUTE_CHECK("the ramp deadline is wrong", elapsed / 1000000 == 6180);
+    CUTE_CHECK("get_pig_profile_deadline(600) != 1", get_pig_profile_deadline(profile, 600, &elapsed, &mix) == 1 && mix == &profile->points[2]);
+    CUTE_CHECK("the fall deadline is wrong", elapsed / 1000000 == 24226);
+    CUTE_CHECK("get_pig_profile_deadline(650) != 0", get_pig_profile_deadline(profile, 650, &elapsed, &mix) == 0);
+    profile->speed = 2.0;
+    CUTE_CHECK("get_pig_profile_deadline(100) != 1", get_pig_profile_deadline(profile, 100, &elapsed, &mix) == 1);
+    CUTE_CHECK("the compressed deadline is wrong", elapsed == 5000000000ULL && mix == &profile->points[1]);
+    CUTE_CHECK("get_pig_profile_deadline(325) != 0", get_pig_profile_deadline(profile, 325, &elapsed, &mix) == 0);
+    for (i = 0; i < 100; i++) {
+        CUTE_CHECK("the mix was not followed", pick_pig_profile_signature(&profile->points[1], 2) == 0);
+        CUTE_CHECK("the mix was not followed", pick_pig_profile_signature(&profile->points[3], 2) == 1);
+    }
+    del_pig_profile(profile);
+    del_pigsty_entry(pigsty);
+CUTE_TEST_CASE_END
+
+CUTE_TEST_CASE(budget_tests)
+    pig_budget_ctx budget;
+    unsigned long long value = 0;
+    size_t i = 0;
+    CUTE_CHECK("parse_pig_bytes(10k) != 1", parse_pig_bytes("10k", &value) == 1 && value == 10240);
+    CUTE_CHECK("parse_pig_bytes(2M) != 1", parse_pig_bytes("2M", &value) == 1 && value == 2097152);
+    CUTE_CHECK("parse_pig_bytes(10kb) != 0", parse_pig_bytes("10kb", &value) == 0);
+    CUTE_CHECK("parse_pig_bytes(-1) != 0", parse_pig_bytes("-1", &value) == 0);
+    CUTE_CHECK("parse_pig_bytes(17179869183G) != 1", parse_pig_bytes("17179869183G", &value) == 1 && value == 18446744072635809792ULL);
+    CUTE_CHECK("parse_pig_bytes(17179869184G) != 0", parse_pig_bytes("17179869184G", &value) == 0);
+    CUTE_CHECK("parse_pig_bytes(18014398509481984k) != 0", parse_pig_bytes("18014398509481984k", &value) == 0);
+    CUTE_CHECK("parse_pig_bytes(18446744073709551616) != 0", parse_pig_bytes("18446744073709551616", &value) == 0);
+    pig_budget_init(&budget, 10, 0, 0);
+    for (i = 0; i < 10; i++) {
+        CUTE_CHECK("pig_budget_take() != 1", pig_budget_take(&budget, 100) == 1);
+    }
+    CUTE_CHECK("pig_budget_take() != 0", pig_budget_take(&budget, 100) == 0);
+    CUTE_CHECK("is_pig_budget_exhausted() != 1", is_pig_budget_exhausted(&budget) == 1);
+    CUTE_CHECK("budget.bytes != 1000", budget.packets == 10 && budget.bytes == 1000);
+    pig_budget_init(&budget, 0, 250, 0);
+    CUTE_CHECK("pig_budget_take() != 1", pig_budget_take(&budget, 100) == 1);
+    CUTE_CHECK("pig_budget_take() != 1", pig_budget_take(&budget, 100) == 1);
+    pig_budget_refund(&budget, 100);
+    CUTE_CHECK("the refund was not done", budget.packets == 1 && budget.bytes == 100 && budget.failures == 1);
+    CUTE_CHECK("pig_budget_take() != 1", pig_budget_take(&budget, 150) == 1);
+    CUTE_CHECK("pig_budget_take() != 0", pig_budget_take(&budget, 1) == 0);
+    CUTE_CHECK("the bytes budget was exceeded", budget.packets == 2 && budget.bytes == 250);
+    pig_budget_init(&budget, 0, 0, 1000000);
+    CUTE_CHECK("is_pig_budget_exhausted() != 0", is_pig_budget_exhausted(&budget) == 0);
+    usleep(2000);
+    CUTE_CHECK("is_pig_budget_exhausted() != 1", is_pig_budget_exhausted(&budget) == 1 && get_pig_budget_time_left(&budget) == 0);
+    CUTE_CHECK("pig_budget_take(NULL) != 1", pig_budget_take(NULL, 100) == 1);
+CUTE_TEST_CASE_END
+
+CUTE_TEST_CASE(burst_tests)
+    pigsty_entry_ctx *pigsty = NULL;
+    pig_frame_ctx frames[4];
+    pig_budget_ctx budget;
+    pig_oink_args_ctx args;
+    unsigned char buf[0xffff], tap_hwaddr[6] = { 0x02, 0x00, 0x00, 0x00, 0x00, 0x01 };
+    int pipefd[2];
+    size_t f = 0;
+    write_to_file("test.pigsty", "[ signature = \"burst\", ip.version = 4, ip.protocol = 17, ip.src = 192.30.70.3, ip.dst = 192.30.70.4, "
+                                 "udp.src = 53, udp.dst = 53, udp.payload = \"oink\" ]");
+    pigsty = load_pigsty_data_from_file(pigsty, "test.pigsty");
+    remove("test.pigsty");
+    CUTE_CHECK("pigsty == NULL", pigsty != NULL);
+    CUTE_CHECK("pipe() != 0", pipe(pipefd) == 0);
+    pig_budget_init(&budget, 6, 0, 0);
+    memset(&args, 0, sizeof(args));
+    args.is_tun = 1;
+    for (f = 0; f < 4; f++) {
+        frames[f].signature = pigsty;
+    }
+    CUTE_CHECK("oink_tun_burst() != 4", oink_tun_burst(frames, 4, &args, pipefd[1], &budget, 0) == 4);
+    for (f = 0; f < 4; f++) {
+        CUTE_CHECK("the frame was not sent", frames[f].sent == 1 && frames[f].packet == NULL);
+    }
+    CUTE_CHECK("read() != 128", read(pipefd[0], buf, sizeof(buf)) == 128);
+    CUTE_CHECK("the burst went out wrong", buf[0] == 0x45 && buf[96] == 0x45 && memcmp(&buf[124], "oink", 4) == 0);
+    args.tap_hwaddr = tap_hwaddr;
+    CUTE_CHECK("oink_tun_burst() != 2", oink_tun_burst(frames, 4, &args, pipefd[1], &budget, 1) == 2);
+    CUTE_CHECK("the budget was exceeded", frames[2].sent == 0 && frames[3].sent == 0 && budget.packets == 6);
+    CUTE_CHECK("read() != 92", read(pipefd[0], buf, sizeof(buf)) == 92);
+    CUTE_CHECK("the tap header is wrong", memcmp(buf, tap_hwaddr, 6) == 0 && buf[12] == 0x08 && buf[13] == 0x00 && buf[14] == 0x45);
+    close(pipefd[0]);
+    close(pipefd[1]);
+    del_pigsty_entry(pigsty);
+CUTE_TEST_CASE_END
+
+CUTE_TEST_CASE(order_tests)
+    pig_order_ctx *order[3];
+    pig_order_mode_t mode = kOrderRandom;
+    pig_order_mode_t modes[3] = { kOrderSequential, kOrderRoundRobin, kOrderShuffle };
+    size_t seen[10], m = 0, t = 0, i = 0;
+    CUTE_CHECK("get_pig_order_mode(round-robin) != 1", get_pig_order_mode("round-robin", &mode) == 1 && mode == kOrderRoundRobin);
+    CUTE_CHECK("get_pig_order_mode(NULL) != 1", get_pig_order_mode(NULL, &mode) == 1 && mode == kOrderRandom);
+    CUTE_CHECK("get_pig_order_mode(foo) != 0", get_pig_order_mode("foo", &mode) == 0);
+    CUTE_CHECK("mk_pig_order(random) != NULL", mk_pig_order(kOrderRandom, 10, 0, 1) == NULL);
+    mk_rnd_init(42, 0);
+    for (m = 0; m < 3; m++) {
+        memset(seen, 0, sizeof(seen));
+        for (t = 0; t < 3; t++) {
+            order[t] = mk_pig_order(modes[m], 10, t, 3);
+            CUTE_CHECK("order[t] == NULL", order[t] != NULL);
+            //  INFO(Santiago): two passes, every signature must go out once per pass.
+            for (i = 0; i < 2 * order[t]->indexes_nr; i++) {
+                seen[next_pig_order_index(order[t])]++;
+            }
+        }
+        for (i = 0; i < 10; i++) {
+            CUTE_CHECK("a signature was not visited exactly once per pass", seen[i] == 2);
+        }
+        CUTE_CHECK("the partition is wrong", (modes[m] == kOrderSequential && order[1]->indexes[0] == 3 && order[1]->indexes_nr == 3) ||
+                                             (modes[m] == kOrderRoundRobin && order[1]->indexes[1] == 4 && order[0]->indexes_nr == 4) ||
+                                             modes[m] == kOrderShuffle);
+        CUTE_CHECK("pig_order_seek() failed", pig_order_seek(order[0], 5) == (modes[m] != kOrderShuffle));
+        if (modes[m] != kOrderShuffle) {
+            CUTE_CHECK("the seek is wrong", next_pig_order_index(order[0]) == order[0]->indexes[5 % order[0]->indexes_nr]);
+        }
+        for (t = 0; t < 3; t++) {
+            del_pig_order(order[t]);
+        }
+    }
+    order[0] = mk_pig_order(kOrderRoundRobin, 2, 2, 3);
+    CUTE_CHECK("a sender without signatures", order[0] != NULL && order[0]->indexes_nr == 1 && order[0]->indexes[0] == 0);
+    del_pig_order(order[0]);
+CUTE_TEST_CASE_END
+
+CUTE_TEST_CASE(prebuild_tests)
+    pigsty_entry_ctx *pigsty = NULL, **signatures = NULL;
+    pig_prebuild_ctx *prebuild = NULL;
+    pig_oink_args_ctx args;
+    pig_frame_ctx frames[4], frame;
+    unsigned char buf[0xffff];
+    size_t signatures_count = 0, f = 0;
+    int pipefd[2];
+    write_to_file("test.pigsty", "[ signature = \"a\", ip.version = 4, ip.protocol = 17, ip.src = 192.30.70.3, ip.dst = 192.30.70.4, "
+                                 "ip.id = random, udp.src = 53, udp.dst = 53, udp.payload = \"oink\" ]\n"
+                                 "[ signature = \"b\", ip.version = 4, ip.protocol = 17, ip.src = 192.30.70.3, ip.dst = 192.30.70.4, "
+                                 "udp.src = 53, udp.dst = 53, udp.payload = \"oinkoink\" ]");
+    pigsty = load_pigsty_data_from_file(pigsty, "test.pigsty");
+    remove("test.pigsty");
+    CUTE_CHECK("pigsty == NULL", pigsty != NULL);
+    signatures = get_pigsty_entry_array(pigsty, &signatures_count);
+    CUTE_CHECK("signatures_count != 2", signatures != NULL && signatures_count == 2);
+    memset(&args, 0, sizeof(args));
+    args.is_tun = 1;
+    mk_rnd_init(42, 0);
+    prebuild = mk_pig_prebuild(signatures, signatures_count, 4, &args);
+    CUTE_CHECK("prebuild == NULL", prebuild != NULL);
+    CUTE_CHECK("the pools were not filled", prebuild->pools[0]->frames_nr == 4 && prebuild->pools[1]->frames_nr == 4);
+    for (f = 0; f < 4; f++) {
+        CUTE_CHECK("the pool is not contiguous", prebuild->pools[1]->frames[f].packet == prebuild->pools[1]->data + f * 36);
+    }
+    CUTE_CHECK("the frames were not randomized", memcmp(prebuild->pools[0]->frames[0].packet, prebuild->pools[0]->frames[1].packet, 32) != 0);
+    for (f = 0; f < 5; f++) {
+        CUTE_CHECK("get_pig_prebuilt_frame() != 1", get_pig_prebuilt_frame(prebuild, 0, &frame) == 1);
+        CUTE_CHECK("the pool was not cycled", frame.packet == prebuild->pools[0]->frames[f % 4].packet);
+    }
+    CUTE_CHECK("get_pig_prebuilt_frame() != 0", get_pig_prebuilt_frame(prebuild, 2, &frame) == 0);
+    CUTE_CHECK("pipe() != 0", pipe(pipefd) == 0);
+    for (f = 0; f < 4; f++) {
+        get_pig_prebuilt_frame(prebuild, f % 2, &frames[f]);
+    }
+    CUTE_CHECK("oink_ready_burst() != 4", oink_ready_burst(frames, 4, pipefd[1], &args, NULL, 0, 0) == 4);
+    CUTE_CHECK("read() != 136", read(pipefd[0], buf, sizeof(buf)) == 136);
+    CUTE_CHECK("the pool was released", memcmp(&buf[100], prebuild->pools[1]->frames[1].packet, 36) == 0);
+    close(pipefd[0]);
+    close(pipefd[1]);
+    CUTE_CHECK("pig_prebuild_start_refresh() != 1", pig_prebuild_start_refresh(prebuild, 1000000, 42, 1) == 1);
+    for (f = 0; f < 10000 && __atomic_load_n(&prebuild->refreshes, __ATOMIC_ACQUIRE) < 3; f++) {
+        pig_prebuild_quiescent(prebuild, 0);
+        usleep(1000);
+    }
+    CUTE_CHECK("the pools were not refreshed", prebuild->refreshes >= 3);
+    del_pig_prebuild(prebuild);
+    free(signatures);
+    del_pigsty_entry(pigsty);
+CUTE_TEST_CASE_END
+
+CUTE_TEST_CASE(pipeline_tests)
+    pigsty_entry_ctx *pigsty = NULL, **signatures = NULL;
+    pig_spsc_ring_ctx *ring = NULL;
+    pig_pipeline_ctx *pipeline = NULL;
+    pig_budget_ctx budget;
+    pig_frame_ctx frame, frames[8];
+    unsigned char buf[0xffff];
+    size_t signatures_count = 0, f = 0, total = 0;
+    ssize_t bytes = 0;
+    int pipefd[2];
+    ring = mk_pig_spsc_ring(5);
+    CUTE_CHECK("ring == NULL", ring != NULL);
+    CUTE_CHECK("get_pig_spsc_size() != 8", get_pig_spsc_size(ring) == 8);
+    memset(&frame, 0, sizeof(frame));
+    for (f = 0; f < 8; f++) {
+        frame.packet_size = f;
+        CUTE_CHECK("pig_spsc_push() != 1", pig_spsc_push(ring, &frame) == 1);
+    }
+    CUTE_CHECK("pig_spsc_push() != 0", pig_spsc_push(ring, &frame) == 0);
+    CUTE_CHECK("the full ring stall was not counted", ring->full_stalls == 1);
+    CUTE_CHECK("pig_spsc_pop() != 3", pig_spsc_pop(ring, frames, 3) == 3);
+    CUTE_CHECK("the ring is not FIFO", frames[0].packet_size == 0 && frames[2].packet_size == 2);
+    CUTE_CHECK("pig_spsc_pop() != 5", pig_spsc_pop(ring, frames, 8) == 5);
+    CUTE_CHECK("the ring is not FIFO", frames[0].packet_size == 3 && frames[4].packet_size == 7);
+    CUTE_CHECK("pig_spsc_pop() != 0", pig_spsc_pop(ring, frames, 8) == 0);
+    CUTE_CHECK("the empty poll was not counted", ring->empty_polls == 1);
+    CUTE_CHECK("get_pig_spsc_usage() is wrong", get_pig_spsc_usage(ring) > 0.0 && get_pig_spsc_usage(ring) <= 100.0);
+    del_pig_spsc_ring(ring);
+    CUTE_CHECK("mk_pig_pipeline() != NULL", mk_pig_pipeline(1, 2, 16) == NULL);
+    CUTE_CHECK("mk_pig_pipeline() != NULL", mk_pig_pipeline(0, 0, 16) == NULL);
+    write_to_file("test.pigsty", "[ signature = \"a\", ip.version = 4, ip.protocol = 17, ip.src = 192.30.70.3, ip.dst = 192.30.70.4, "
+                                 "ip.id = random, udp.src = 53, udp.dst = 53, udp.payload = \"oink\" ]\n"
+                                 "[ signature = \"b\", ip.version = 4, ip.protocol = 17, ip.src = 192.30.70.3, ip.dst = 192.30.70.4, "
+                                 "udp.src = 53, udp.dst = 53, udp.payload = \"oink\" ]");
+    pigsty = load_pigsty_data_from_file(pigsty, "test.pigsty");
+    remove("test.pigsty");
+    CUTE_CHECK("pigsty == NULL", pigsty != NULL);
+    signatures = get_pigsty_entry_array(pigsty, &signatures_count);
+    CUTE_CHECK("signatures_count != 2", signatures != NULL && signatures_count == 2);
+    CUTE_CHECK("pipe() != 0", pipe(pipefd) == 0);
+    pipeline = mk_pig_pipeline(4, 2, 16);
+    CUTE_CHECK("pipeline == NULL", pipeline != NULL);
+    pig_budget_init(&budget, 100, 0, 0);
+    pipeline->signatures = signatures;
+    pipeline->signatures_count = signatures_count;
+    pipeline->order_mode = kOrderRoundRobin;
+    pipeline->budget = &budget;
+    pipeline->args.is_tun = 1;
+    pipeline->fd = pipefd[1];
+    pipeline->burst_size = 4;
+    pipeline->is_quiet = 1;
+    pipeline->seed = 42;
+    CUTE_CHECK("run_pig_pipeline() != 0", run_pig_pipeline(pipeline) == 0);
+    CUTE_CHECK("the budget was not honored", budget.packets == 100);
+    for (f = 0; f < pipeline->generators_nr; f++) {
+        total += pipeline->generators[f].ring->popped;
+        CUTE_CHECK("a generator was starved", pipeline->generators[f].generated > 0);
+    }
+    CUTE_CHECK("the consumed frames do not match the budget", total >= 100);
+    del_pig_pipeline(pipeline);
+    close(pipefd[1]);
+    total = 0;
+    while ((bytes = read(pipefd[0], buf, sizeof(buf))) > 0) {
+        total += bytes;
+    }
+    close(pipefd[0]);
+    CUTE_CHECK("the frames were not written", total == 100 * 32);
+    free(signatures);
+    del_pigsty_entry(pigsty);
+CUTE_TEST_CASE_END
+
+CUTE_TEST_CASE(cpus_tests)
+    pig_cpu_set_ctx set, local;
+    pig_pipeline_ctx *pipeline = NULL;
+    CUTE_CHECK("parse_pig_cpus() != 1", parse_pig_cpus("0-3,8,10-11", &set) == 1);
+    CUTE_CHECK("set.cpus_nr != 7", set.cpus_nr == 7);
+    CUTE_CHECK("the CPU list was not expanded", set.cpus[0] == 0 && set.cpus[3] == 3 && set.cpus[4] == 8 && set.cpus[6] == 11);
+    CUTE_CHECK("parse_pig_cpus() != 1", parse_pig_cpus("2,2,1-2", &set) == 1 && set.cpus_nr == 2);
+    CUTE_CHECK("parse_pig_cpus() != 0", parse_pig_cpus("", &set) == 0);
+    CUTE_CHECK("parse_pig_cpus() != 0", parse_pig_cpus("3-1", &set) == 0);
+    CUTE_CHECK("parse_pig_cpus() != 0", parse_pig_cpus("1,", &set) == 0);
+    CUTE_CHECK("parse_pig_cpus() != 0", parse_pig_cpus("1-", &set) == 0);
+    CUTE_CHECK("parse_pig_cpus() != 0", parse_pig_cpus("a", &set) == 0);
+    CUTE_CHECK("parse_pig_cpus() != 0", parse_pig_cpus("99999", &set) == 0);
+    parse_pig_cpus("0-7", &set);
+    parse_pig_cpus("4-5,12", &local);
+    pig_cpus_local_first(&set, &local);
+    CUTE_CHECK("the local CPUs are not first", set.cpus[0] == 4 && set.cpus[1] == 5 && set.cpus[2] == 0 && set.cpus[7] == 7);
+    pig_cpus_subtract(&set, &local);
+    CUTE_CHECK("pig_cpus_subtract() has failed", set.cpus_nr == 6 && !is_pig_cpu_in_set(&set, 4) && is_pig_cpu_in_set(&set, 6));
+    CUTE_CHECK("get_pig_usable_cpus() != 1", get_pig_usable_cpus(&set) == 1 && set.cpus_nr > 0);
+    CUTE_CHECK("pig_pin_thread() != 1", pig_pin_thread(pthread_self(), &set) == 1);
+    CUTE_CHECK("get_pig_iface_numa_node(\"lo\") != -1", get_pig_iface_numa_node("lo") == -1);
+    pipeline = mk_pig_pipeline(4, 2, 16);
+    CUTE_CHECK("pipeline == NULL", pipeline != NULL);
+    CUTE_CHECK("the threads are pinned by default", pipeline->senders[0].cpu == -1 && pipeline->generators[0].cpu == -1);
+    parse_pig_cpus("900-902", &set);
+    CUTE_CHECK("pig_pipeline_place() != 1", pig_pipeline_place(pipeline, &set, -1) == 1);
+    CUTE_CHECK("the senders were not placed", pipeline->senders[0].cpu == 900 && pipeline->senders[1].cpu == 901);
+    CUTE_CHECK("the generators were not placed", pipeline->generators[0].cpu == 902 && pipeline->generators[3].cpu == 902);
+    CUTE_CHECK("the housekeeping CPUs overlap", !is_pig_cpu_in_set(&pipeline->housekeeping, 900) && pipeline->housekeeping.cpus_nr > 0);
+    parse_pig_cpus("7", &set);
+    pig_pipeline_place(pipeline, &set, -1);
+    CUTE_CHECK("the CPU was not shared", pipeline->senders[1].cpu == 7 && pipeline->generators[2].cpu == 7);
+    del_pig_pipeline(pipeline);
+CUTE_TEST_CASE_END
+
+CUTE_TEST_CASE(pacer_tests)
+    pig_pacer_ctx pacer;
+    unsigned long long ticks = 0, t = 0, start = 0;
+    int a = 0;
+    for (a = 0; a < 2; a++) {
+        pig_pacer_init(&pacer);
+        pacer.is_absolute = a;
+        ticks = 0;
+        for (t = 0; t < 20; t++) {
+            pig_pacer_tick(&pacer, &ticks, 1000000, ~0ULL);
+        }
+        CUTE_CHECK("ticks != 20", ticks == 20);
+        CUTE_CHECK("the schedule was not followed", pig_pacer_elapsed(&pacer) >= 20000000);
+        CUTE_CHECK("the deadlines were not counted", pacer.deadlines == 20);
+        CUTE_CHECK("the lateness is inconsistent", pacer.lateness_max * pacer.deadlines >= pacer.lateness_sum && pacer.missed <= pacer.deadlines);
+    }
+    pig_pacer_init(&pacer);
+    usleep(5000);
+    CUTE_CHECK("pig_pacer_wait_until() != 1", pig_pacer_wait_until(&pacer, 1000000) == 1);
+    CUTE_CHECK("the missed deadline was not counted", pacer.deadlines == 1 && pacer.missed == 1 && pacer.lateness_max >= 4000000);
+    pig_pacer_init(&pacer);
+    ticks = 0;
+    start = pig_clock_ns();
+    pig_pacer_tick(&pacer, &ticks, 1000000000ULL, 2000000);
+    CUTE_CHECK("the time left was not honored", pig_clock_ns() - start < 500000000ULL && pacer.deadlines == 0);
+    start = pig_clock_ns() + 2000000;
+    pig_sleep_until_ns(start);
+    CUTE_CHECK("pig_sleep_until_ns() woke up too soon", pig_clock_ns() >= start);
+CUTE_TEST_CASE_END
+
+CUTE_TEST_CASE(arrivals_tests)
+    pig_arrival_dist_ctx dist;
+    pig_arrival_stream_ctx stream;
+    pig_arrivals_ctx *arrivals = NULL;
+    pigsty_entry_ctx *pigsty = NULL, **signatures = NULL;
+    size_t signatures_count = 0, n = 0, below = 0, counts[3];
+    double sum = 0, gap = 0, max = 0;
+    unsigned long long last = 0, state[4], curr_state[4];
+    long signature_index = 0;
+    CUTE_CHECK("parse_pig_arrival_dist() != 0", parse_pig_arrival_dist("poisson", &dist) == 0);
+    CUTE_CHECK("parse_pig_arrival_dist() != 0", parse_pig_arrival_dist("poisson:0", &dist) == 0);
+    CUTE_CHECK("parse_pig_arrival_dist() != 0", parse_pig_arrival_dist("pareto:1:1ms", &dist) == 0);
+    CUTE_CHECK("parse_pig_arrival_dist() != 0", parse_pig_arrival_dist("onoff:1ms:1s", &dist) == 0);
+    CUTE_CHECK("parse_pig_arrival_dist() != 0", parse_pig_arrival_dist("gauss:1ms", &dist) == 0);
+    CUTE_CHECK("parse_pig_arrival_dist() != 0", parse_pig_arrival_dist("poisson:1ms:2ms", &dist) == 0);
+    CUTE_CHECK("parse_pig_arrival_dist() != 1", parse_pig_arrival_dist("constant:2ms", &dist) == 1);
+    CUTE_CHECK("the constant gap is wrong", sample_pig_arrival_gap(&dist) == 2000000.0);
+    del_pig_arrival_dist(&dist);
+    mk_rnd_init(42, 0);
+    CUTE_CHECK("parse_pig_arrival_dist() != 1", parse_pig_arrival_dist("poisson:1ms", &dist) == 1);
+    for (n = 0; n < 1000000; n++) {
+        gap = sample_pig_arrival_gap(&dist);
+        sum += gap;
+        if (gap > max) {
+            max = gap;
+        }
+    }
+    CUTE_CHECK("the exponential mean is wrong", sum / 1000000.0 > 990000.0 && sum / 1000000.0 < 1010000.0);
+    CUTE_CHECK("the exponential tail was not sampled", max > 8400000.0);
+    del_pig_arrival_dist(&dist);
+    CUTE_CHECK("parse_pig_arrival_dist() != 1", parse_pig_arrival_dist("pareto:3:1ms", &dist) == 1);
+    for (n = 0, sum = 0, max = 0, below = 0; n < 1000000; n++) {
+        gap = sample_pig_arrival_gap(&dist);
+        below += (gap < dist.scale);
+        sum += gap;
+        if (gap > max) {
+            max = gap;
+        }
+    }
+    CUTE_CHECK("a pareto gap is below its scale", below == 0);
+    CUTE_CHECK("the pareto mean is wrong", sum / 1000000.0 > 970000.0 && sum / 1000000.0 < 1030000.0);
+    CUTE_CHECK("the pareto tail was not sampled", max > dist.scale * 16.0);
+    del_pig_arrival_dist(&dist);
+    CUTE_CHECK("parse_pig_arrival_dist() != 1", parse_pig_arrival_dist("onoff:100us:10ms:30ms", &dist) == 1);
+    pig_arrival_stream_init(&stream, &dist, -1, 0);
+    for (n = 0; n < 1000000; n++) {
+        last = pig_arrival_stream_advance(&stream);
+    }
+    //  INFO(Santiago): on during a quarter of the time, so the gaps are four times longer on average.
+    CUTE_CHECK("the on/off rate is wrong", (double)last / 1000000.0 > 360000.0 && (double)last / 1000000.0 < 440000.0);
+    del_pig_arrival_dist(&dist);
+    write_to_file("test.pigsty", "[ signature = \"a\", ip.version = 4, ip.protocol = 17, ip.src = 1.1.1.1, ip.dst = 2.2.2.2, udp.src = 1, udp.dst = 2 ]\n"
+                                 "[ signature = \"b\", ip.version = 4, ip.protocol = 17, ip.src = 1.1.1.1, ip.dst = 2.2.2.2, udp.src = 1, udp.dst = 2 ]\n"
+                                 "[ signature = \"c\", ip.version = 4, ip.protocol = 17, ip.src = 1.1.1.1, ip.dst = 2.2.2.2, udp.src = 1, udp.dst = 2 ]");
+    pigsty = load_pigsty_data_from_file(pigsty, "test.pigsty");
+    remove("test.pigsty");
+    signatures = get_pigsty_entry_array(pigsty, &signatures_count);
+    CUTE_CHECK("signatures_count != 3", signatures != NULL && signatures_count == 3);
+    CUTE_CHECK("mk_pig_arrivals() != NULL", mk_pig_arrivals("d=poisson:1ms", signatures, signatures_count, 0, 31337) == NULL);
+    CUTE_CHECK("mk_pig_arrivals() != NULL", mk_pig_arrivals("a=poisson:1ms,a=poisson:2ms", signatures, signatures_count, 0, 31337) == NULL);
+    CUTE_CHECK("mk_pig_arrivals() != NULL", mk_pig_arrivals("poisson:1ms,poisson:2ms", signatures, signatures_count, 0, 31337) == NULL);
+    CUTE_CHECK("mk_pig_arrivals() != NULL", mk_pig_arrivals("poisson:1ms,", signatures, signatures_count, 0, 31337) == NULL);
+    mk_rnd_init(31337, 0);
+    mk_rnd_get_state(state);
+    arrivals = mk_pig_arrivals("poisson:1ms", signatures, signatures_count, 0, 31337);
+    CUTE_CHECK("arrivals == NULL", arrivals != NULL);
+    CUTE_CHECK("the global stream was not created", arrivals->streams_nr == 1 && !arrivals->is_per_signature);
+    next_pig_arrival(arrivals, &signature_index);
+    mk_rnd_get_state(curr_state);
+    CUTE_CHECK("the arrivals touched the prng of the thread", memcmp(state, curr_state, sizeof(state)) == 0);
+    CUTE_CHECK("the global stream chose a signature", signature_index == -1);
+    del_pig_arrivals(arrivals);
+    arrivals = mk_pig_arrivals("a=constant:1ms,b=constant:2ms", signatures, signatures_count, 4000000, 31337);
+    CUTE_CHECK("arrivals == NULL", arrivals != NULL);
+    CUTE_CHECK("the streams were not created", arrivals->streams_nr == 3 && arrivals->shared_nr == 1 && arrivals->is_per_signature);
+    memset(counts, 0, sizeof(counts));
+    for (n = 0, below = 0, last = 0; n < 700; n++) {
+        gap = (double)last;
+        last = next_pig_arrival(arrivals, &signature_index);
+        below += ((double)last < gap);
+        counts[signature_index]++;
+    }
+    CUTE_CHECK("the streams were not merged in time order", below == 0 && last < 400000000ULL);
+    CUTE_CHECK("the streams do not follow their rates", counts[0] == 400 && counts[1] == 200 && counts[2] == 100);
+    del_pig_arrivals(arrivals);
+    free(signatures);
+    del_pigsty_entry(pigsty);
+CUTE_TEST_CASE_END
+
+CUTE_TEST_CASE(session_tests)
+    pig_flow_table_ctx *table = NULL;
+    pig_frame_ctx frame, out[16];
+    unsigned char *packet = NULL, copy[2048], tpl[2040];
+    unsigned int client_isn = 0, server_isn = 0, addr = 0;
+    unsigned short client_port = 0;
+    size_t n = 0, data = 0, bad_chsums = 0;
+    unsigned long long *last = NULL, now = 0, delay = 0;
+    unsigned char expected_flags[] = { 0x02, 0x12, 0x10, 0x18, 0x10, 0x18, 0x10, 0x11, 0x11, 0x10 };
+    //  INFO(Santiago): 10.0.0.1:40000 -> 10.0.0.2:80 carrying 2000 bytes, two data segments.
+    memset(&frame, 0, sizeof(frame));
+    frame.packet_size = 40 + 2000;
+    packet = (unsigned char *) malloc(frame.packet_size);
+    memset(packet, 'A', frame.packet_size);
+    memset(packet, 0, 40);
+    packet[0] = 0x45;
+    packet[8] = 64;
+    packet[9] = 6;
+    packet[12] = 10; packet[15] = 1;
+    packet[16] = 10; packet[19] = 2;
+    packet[20] = 0x9c; packet[21] = 0x40;
+    packet[23] = 80;
+    packet[32] = 0x50;
+    packet[33] = 0x18;
+    memcpy(tpl, packet, sizeof(tpl));
+    frame.packet = packet;
+    frame.l2hdr_size = 14;
+    memset(frame.l2hdr, 0x11, 6);
+    memset(&frame.l2hdr[6], 0x22, 6);
+    CUTE_CHECK("mk_pig_flow_table() != NULL", mk_pig_flow_table(0) == NULL);
+    table = mk_pig_flow_table(2);
+    CUTE_CHECK("table == NULL", table != NULL);
+    CUTE_CHECK("is_pig_session_signature() != 1", is_pig_session_signature(&frame) == 1);
+    packet[9] = 17;
+    CUTE_CHECK("pig_session_open() != -1", pig_session_open(table, &frame) == -1);
+    packet[9] = 6;
+    CUTE_CHECK("pig_session_open() != 1", pig_session_open(table, &frame) == 1);
+    CUTE_CHECK("the flow was not indexed", get_pig_flow(table, 0x0100000a, 40000, 0x0200000a, 80) != NULL);
+    for (n = 0; n < 16 && pig_session_next_frame(table, &out[n], 0); n++)
+        ;
+    CUTE_CHECK("the session has the wrong number of segments", n == 10);
+    client_isn = ((unsigned int)out[0].packet[24] << 24) | ((unsigned int)out[0].packet[25] << 16) | ((unsigned int)out[0].packet[26] << 8) | out[0].packet[27];
+    server_isn = ((unsigned int)out[1].packet[24] << 24) | ((unsigned int)out[1].packet[25] << 16) | ((unsigned int)out[1].packet[26] << 8) | out[1].packet[27];
+    for (n = 0; n < 10; n++) {
+        CUTE_CHECK("wrong TCP flags", out[n].packet[33] == expected_flags[n]);
+        memcpy(copy, out[n].packet, out[n].packet_size);
+        chsum_ip4_dgram(copy, out[n].packet_size);
+        bad_chsums += (memcmp(copy, out[n].packet, out[n].packet_size) != 0);
+    }
+    CUTE_CHECK("wrong checksums", bad_chsums == 0);
+    CUTE_CHECK("the SYN-ACK does not acknowledge the SYN", memcmp(&out[1].packet[28], &out[2].packet[24], 4) == 0 &&
+                                                           out[1].packet[31] == (unsigned char)(client_isn + 1));
+    CUTE_CHECK("the SYN-ACK has the wrong addresses", out[1].packet[12] == 10 && out[1].packet[15] == 2 && out[1].packet[19] == 1 &&
+                                                      out[1].packet[20] == 0 && out[1].packet[21] == 80);
+    CUTE_CHECK("the server MAC addresses were not swapped", out[1].l2hdr[0] == 0x22 && out[0].l2hdr[0] == 0x11);
+    CUTE_CHECK("wrong data segment sizes", out[3].packet_size == 40 + PIG_SESSION_MSS && out[5].packet_size == 40 + 2000 - PIG_SESSION_MSS);
+    CUTE_CHECK("the second data segment has the wrong seq", out[5].packet[27] == (unsigned char)(client_isn + 1 + PIG_SESSION_MSS));
+    CUTE_CHECK("the data ACK is wrong", out[6].packet[31] == (unsigned char)(client_isn + 1 + 2000) && out[6].packet[27] == (unsigned char)(server_isn + 1));
+    CUTE_CHECK("the FIN has the wrong seq", out[7].packet[27] == (unsigned char)(client_isn + 1 + 2000));
+    CUTE_CHECK("the last ACK is wrong", out[9].packet[27] == (unsigned char)(client_isn + 2 + 2000) &&
+                                        out[9].packet[31] == (unsigned char)(server_isn + 2));
+    for (n = 0; n < 10; n++) {
+        data += out[n].packet_size - 40;
+        free(out[n].packet);
+    }
+    CUTE_CHECK("the payload was not carried", data == 2000);
+    CUTE_CHECK("the flow was not closed", table->active_nr == 0 && table->completed == 1 &&
+                                          get_pig_flow(table, 0x0100000a, 40000, 0x0200000a, 80) == NULL);
+    //  INFO(Santiago): the same signature twice, the second session needs another client port.
+    frame.packet = (unsigned char *) malloc(frame.packet_size);
+    memcpy(frame.packet, tpl, frame.packet_size);
+    CUTE_CHECK("pig_session_open() != 1", pig_session_open(table, &frame) == 1);
+    frame.packet = (unsigned char *) malloc(frame.packet_size);
+    memcpy(frame.packet, tpl, frame.packet_size);
+    CUTE_CHECK("pig_session_open() != 1", pig_session_open(table, &frame) == 1);
+    CUTE_CHECK("the client port was not remapped", table->remapped >= 1 && table->active_nr == 2 && table->allocated == 2);
+    CUTE_CHECK("the template was not shared", table->templates_nr == 1 && table->slabs[0][0].template == table->slabs[0][1].template);
+    //  INFO(Santiago): the first record was reused by the first of these sessions.
+    addr = table->slabs[0][1].client_addr;
+    client_port = table->slabs[0][1].client_port;
+    CUTE_CHECK("the remapped flow was not indexed", client_port != 40000 && client_port >= 1024 &&
+                                                    get_pig_flow(table, addr, client_port, 0x0200000a, 80) != NULL);
+    frame.packet = (unsigned char *) malloc(frame.packet_size);
+    memcpy(frame.packet, tpl, frame.packet_size);
+    CUTE_CHECK("pig_session_open() != 0", pig_session_open(table, &frame) == 0);
+    free(frame.packet);
+    for (n = 0; n < 3 && pig_session_next_frame(table, &out[n], 0); n++)
+        ;
+    CUTE_CHECK("the sessions are not interleaved", n == 3 && out[0].packet[33] == 0x02 && out[1].packet[33] == 0x02 &&
+                                                   out[0].packet[21] != out[1].packet[21] && out[2].packet[33] == 0x12);
+    for (n = 0; n < 3; n++) {
+        free(out[n].packet);
+    }
+    del_pig_flow_table(table);
+    //  INFO(Santiago): 60000 sessions driven by the timer wheel with a simulated clock, no segment
+    //                  may go out before its time nor more than a tick (plus a clock step) after it.
+    CUTE_CHECK("a flow record is too big", sizeof(pig_flow_ctx) <= 48);
+    table = mk_pig_flow_table(60000);
+    CUTE_CHECK("table == NULL", table != NULL);
+    table->rtt = 1000000;
+    table->hold = 1000000000;
+    frame.packet_size = 40 + 10;
+    for (n = 0; n < 60000; n++) {
+        frame.packet = (unsigned char *) malloc(frame.packet_size);
+        memcpy(frame.packet, tpl, frame.packet_size);
+        frame.packet[20] = (1024 + n) >> 8;
+        frame.packet[21] = (1024 + n) & 0xff;
+        frame.packet[2] = 0;
+        frame.packet[3] = frame.packet_size;
+        if (pig_session_open(table, &frame) != 1) {
+            break;
+        }
+    }
+    CUTE_CHECK("the sessions were not opened", n == 60000 && table->active_nr == 60000 && table->templates_nr == 60000 / PIG_SESSION_TEMPLATE_REUSE + 1);
+    frame.packet = (unsigned char *) malloc(frame.packet_size);
+    memcpy(frame.packet, tpl, frame.packet_size);
+    CUTE_CHECK("the table is not full", pig_session_open(table, &frame) == 0);
+    free(frame.packet);
+    last = (unsigned long long *) malloc(sizeof(unsigned long long) * 65536);
+    memset(last, 0, sizeof(unsigned long long) * 65536);
+    for (now = 0, data = 0, bad_chsums = 0; now <= 1100000000ULL && table->active_nr > 0; now += 50000) {
+        while (pig_session_next_frame(table, &out[0], now)) {
+            client_port = ((out[0].packet[20] << 8) | out[0].packet[21]);
+            if (client_port == 80) {
+                client_port = ((out[0].packet[22] << 8) | out[0].packet[23]);
+            }
+            delay = (out[0].packet[33] == 0x02 ? 0 : table->rtt + ((out[0].packet[33] == 0x11 && out[0].packet[22] == 0 && out[0].packet[23] == 80) ? table->hold : 0));
+            bad_chsums += (now + PIG_SESSION_TICK < last[client_port] + delay || now > last[client_port] + delay + PIG_SESSION_TICK + 50000);
+            last[client_port] = now;
+            data++;
+            free(out[0].packet);
+        }
+    }
+    CUTE_CHECK("the sessions were not completed", table->active_nr == 0 && table->completed == 60000 && data == 60000 * 8);
+    CUTE_CHECK("segments were sent out of time", bad_chsums == 0);
+    CUTE_CHECK("the templates were not released", table->templates_nr == 1);
+    free(last);
+    del_pig_flow_table(table);
+CUTE_TEST_CASE_END
+
+CUTE_TEST_CASE(replies_tests)
+    pigsty_entry_ctx entries[2], *signatures[2];
+    pig_replies_ctx *replies = NULL;
+    pig_frame_ctx frame;
+    pig_tx_key_ctx key;
+    pig_reply_type_t type = kReplyUdp;
+    unsigned char tcp[40], udp[28], echo[28], rst[40], unreach[56], pong[28];
+    memset(entries, 0, sizeof(entries));
+    entries[0].signature_name = "tcp";
+    entries[1].signature_name = "udp-and-echo";
+    signatures[0] = &entries[0];
+    signatures[1] = &entries[1];
+    //  INFO(Santiago): 10.0.0.1:40000 -> 10.0.0.2:80 (TCP), 10.0.0.1:5000 -> 10.0.0.2:53 (UDP) and an echo (id 7, seq 9).
+    memset(tcp, 0, sizeof(tcp));
+    tcp[0] = 0x45; tcp[9] = 6; tcp[12] = 10; tcp[15] = 1; tcp[16] = 10; tcp[19] = 2;
+    tcp[20] = 0x9c; tcp[21] = 0x40; tcp[23] = 80; tcp[32] = 0x50; tcp[33] = 0x02;
+    memset(udp, 0, sizeof(udp));
+    memcpy(udp, tcp, 20);
+    udp[9] = 17; udp[20] = 0x13; udp[21] = 0x88; udp[23] = 53;
+    memset(echo, 0, sizeof(echo));
+    memcpy(echo, tcp, 20);
+    echo[9] = 1; echo[20] = 8; echo[25] = 7; echo[27] = 9;
+    memcpy(rst, tcp, sizeof(rst));
+    memcpy(&rst[12], &tcp[16], 4);
+    memcpy(&rst[16], &tcp[12], 4);
+    memcpy(&rst[20], &tcp[22], 2);
+    memcpy(&rst[22], &tcp[20], 2);
+    rst[33] = 0x14;
+    memset(unreach, 0, sizeof(unreach));
+    memcpy(unreach, rst, 20);
+    unreach[9] = 1; unreach[20] = 3; unreach[21] = 13;
+    memcpy(&unreach[28], udp, 28);
+    memcpy(pong, echo, sizeof(pong));
+    memcpy(&pong[12], &echo[16], 4);
+    memcpy(&pong[16], &echo[12], 4);
+    pong[20] = 0;
+    CUTE_CHECK("mk_pig_replies() != NULL", mk_pig_replies(NULL, 0) == NULL);
+    replies = mk_pig_replies(signatures, 2);
+    CUTE_CHECK("replies == NULL", replies != NULL);
+    CUTE_CHECK("get_pig_reply_key() != 1", get_pig_reply_key(unreach, sizeof(unreach), &key, &type) == 1);
+    CUTE_CHECK("the quoted packet was not read", type == kReplyIcmpProhibited && key.proto == 17 && key.src_port == 5000 && key.dst_port == 53);
+    CUTE_CHECK("an unsent packet was matched", pig_replies_match(replies, rst, sizeof(rst), 0) == 0);
+    memset(&frame, 0, sizeof(frame));
+    frame.signature = signatures[0];
+    frame.packet = tcp;
+    frame.packet_size = sizeof(tcp);
+    pig_replies_record(replies, &frame);
+    frame.signature = signatures[1];
+    frame.packet = udp;
+    frame.packet_size = sizeof(udp);
+    pig_replies_record(replies, &frame);
+    frame.packet = echo;
+    frame.packet_size = sizeof(echo);
+    pig_replies_record(replies, &frame);
+    CUTE_CHECK("the RST was not matched", pig_replies_match(replies, rst, sizeof(rst), 0) == 1);
+    CUTE_CHECK("the ICMP error was not matched", pig_replies_match(replies, unreach, sizeof(unreach), 0) == 1);
+    CUTE_CHECK("the echo reply was not matched", pig_replies_match(replies, pong, sizeof(pong), 0) == 1);
+    //  INFO(Santiago): the packet itself is not its own reply.
+    CUTE_CHECK("a request was matched", pig_replies_match(replies, tcp, sizeof(tcp), 0) == 0);
+    pong[27] = 10;
+    CUTE_CHECK("another echo was matched", pig_replies_match(replies, pong, sizeof(pong), 0) == 0);
+    CUTE_CHECK("wrong TCP stats", replies->stats[0].sent == 1 && replies->stats[0].replies[kReplyTcpRst] == 1);
+    CUTE_CHECK("wrong UDP/ICMP stats", replies->stats[1].sent == 2 && replies->stats[1].replies[kReplyIcmpProhibited] == 1 &&
+                                       replies->stats[1].replies[kReplyIcmpEcho] == 1);
+    CUTE_CHECK("wrong totals", replies->captured == 6 && replies->unmatched == 3);
+    del_pig_replies(replies);
+CUTE_TEST_CASE_END
+
+CUTE_TEST_CASE(rtt_tests)
+    pig_rtt_hist_ctx *hist = NULL;
+    pigsty_entry_ctx entry, *signatures[1];
+    pig_slot_ctx slot;
+    unsigned short id = 0;
+    pig_replies_ctx *replies = NULL;
+    pig_frame_ctx frame;
+    unsigned char syn[40], rst[40], copy[40];
+    unsigned long long v = 0, p = 0;
+    hist = (pig_rtt_hist_ctx *) malloc(sizeof(pig_rtt_hist_ctx));
+    memset(hist, 0, sizeof(pig_rtt_hist_ctx));
+    for (v = 1; v <= 1000000; v++) {
+        pig_rtt_hist_add(hist, v);
+    }
+    CUTE_CHECK("wrong min/max", hist->min == 1 && hist->max == 1000000 && hist->count == 1000000);
+    p = get_pig_rtt_percentile(hist, 0.5);
+    CUTE_CHECK("the median is off", p > 500000 * 0.93 && p < 500000 * 1.07);
+    p = get_pig_rtt_percentile(hist, 0.99);
+    CUTE_CHECK("the p99 is off", p > 990000 * 0.93 && p <= 1000000);
+    memset(hist, 0, sizeof(pig_rtt_hist_ctx));
+    pig_rtt_hist_add(hist, 5);
+    CUTE_CHECK("small values are not exact", get_pig_rtt_percentile(hist, 0.5) == 5);
+    free(hist);
+    //  INFO(Santiago): a SYN from 10.0.0.1:40000 to 10.0.0.2:80 (seq 1000) answered with RST|ACK (ack 1001).
+    memset(&entry, 0, sizeof(entry));
+    entry.signature_name = "syn";
+    signatures[0] = &entry;
+    memset(syn, 0, sizeof(syn));
+    syn[0] = 0x45; syn[3] = 40; syn[8] = 64; syn[9] = 6; syn[12] = 10; syn[15] = 1; syn[16] = 10; syn[19] = 2;
+    syn[20] = 0x9c; syn[21] = 0x40; syn[23] = 80; syn[26] = 0x03; syn[27] = 0xe8; syn[32] = 0x50; syn[33] = 0x02;
+    chsum_ip4_dgram(syn, sizeof(syn));
+    memcpy(rst, syn, sizeof(rst));
+    memcpy(&rst[12], &syn[16], 4);
+    memcpy(&rst[16], &syn[12], 4);
+    memcpy(&rst[20], &syn[22], 2);
+    memcpy(&rst[22], &syn[20], 2);
+    memset(&rst[24], 0, 4);
+    rst[30] = 0x03; rst[31] = 0xe9; rst[33] = 0x14;
+    replies = mk_pig_replies(signatures, 1);
+    CUTE_CHECK("pig_replies_enable_rtt() != 1", pig_replies_enable_rtt(replies) == 1);
+    memset(&frame, 0, sizeof(frame));
+    frame.signature = signatures[0];
+    frame.packet = syn;
+    frame.packet_size = sizeof(syn);
+    replies->cookie = 0x1234;
+    pig_replies_stamp(replies, &frame);
+    memcpy(copy, syn, sizeof(copy));
+    chsum_ip4_dgram(copy, sizeof(copy));
+    CUTE_CHECK("the IP ID was not stamped", syn[4] == 0x12 && syn[5] == 0x34 && memcmp(copy, syn, sizeof(copy)) == 0);
+    pig_replies_record(replies, &frame);
+    CUTE_CHECK("the RST was not matched", pig_replies_match(replies, rst, sizeof(rst), pig_wall_clock_ns() + 5000000) == 1);
+    CUTE_CHECK("no round trip time", replies->rtt[0].count == 1 && replies->rtt[0].min >= 5000000 && replies->rtt[0].min < 1005000000);
+    CUTE_CHECK("no round trip time per target", replies->pairs_nr == 1);
+    rst[31] = 0xea;
+    CUTE_CHECK("the RST was not matched", pig_replies_match(replies, rst, sizeof(rst), pig_wall_clock_ns()) == 1);
+    CUTE_CHECK("a reply to another packet gave a round trip time", replies->stale == 1 && replies->rtt[0].count == 1);
+    rst[31] = 0xe9;
+    v = pig_wall_clock_ns() + 1000000000;
+    pig_replies_record(replies, &frame);
+    pig_replies_sent(replies, &frame, v);
+    pig_replies_sent(replies, &frame, v - 500000000);
+    CUTE_CHECK("the RST was not matched", pig_replies_match(replies, rst, sizeof(rst), v + 5000000) == 1);
+    CUTE_CHECK("the send time was not settled", replies->rtt[0].count == 2 && replies->rtt[0].min == 5000000);
+    del_pig_replies(replies);
+    //  INFO(Santiago): an ip.id set by the signature is left as is, "ip.id = random" is still stamped.
+    id = 0x0102;
+    entry.conf = add_conf_to_pigsty_conf_set(entry.conf, kIpv4_id, &id, sizeof(id));
+    replies = mk_pig_replies(signatures, 1);
+    pig_replies_enable_rtt(replies);
+    replies->cookie = 0x5678;
+    syn[4] = 0x01; syn[5] = 0x02;
+    pig_replies_stamp(replies, &frame);
+    CUTE_CHECK("a pinned IP ID was stamped", syn[4] == 0x01 && syn[5] == 0x02);
+    del_pig_replies(replies);
+    memset(&slot, 0, sizeof(slot));
+    slot.field = kIpv4_id;
+    slot.modifier = kRandom;
+    entry.slots = &slot;
+    entry.slots_nr = 1;
+    replies = mk_pig_replies(signatures, 1);
+    pig_replies_enable_rtt(replies);
+    replies->cookie = 0x5678;
+    pig_replies_stamp(replies, &frame);
+    CUTE_CHECK("a random IP ID was not stamped", syn[4] == 0x56 && syn[5] == 0x78);
+    del_pig_replies(replies);
+    del_pigsty_conf_set(entry.conf);
+CUTE_TEST_CASE_END
+
+static pig_manifest_ctx *g_test_manifest = NULL;
+
+static pig_frame_ctx *g_test_manifest_frames = NULL;
+
+static void *append_to_manifest_test(void *arg) {
+    size_t b = 0;
+    for (b = 0; b < 1250; b++) {
+        pig_manifest_append(g_test_manifest, g_test_manifest_frames, 8, 1000000000ULL * 1700000000ULL + b);
+    }
+    return NULL;
+}
+
+CUTE_TEST_CASE(manifest_tests)
+    pigsty_entry_ctx entries[2], *signatures[2];
+    pig_frame_ctx frames[8];
+    pthread_t threads[4];
+    unsigned char syn[40];
+    char line[1024];
+    FILE *out = NULL;
+    size_t f = 0, lines = 0;
+    memset(entries, 0, sizeof(entries));
+    entries[0].signature_name = "syn";
+    entries[1].signature_name = "say \"hi\"";
+    signatures[0] = &entries[0];
+    signatures[1] = &entries[1];
+    memset(syn, 0, sizeof(syn));
+    syn[0] = 0x45; syn[3] = 40; syn[8] = 64; syn[9] = 6; syn[12] = 10; syn[15] = 1; syn[16] = 10; syn[19] = 2;
+    syn[20] = 0x9c; syn[21] = 0x40; syn[23] = 80; syn[33] = 0x02;
+    memset(frames, 0, sizeof(frames));
+    for (f = 0; f < 8; f++) {
+        frames[f].signature = signatures[f & 1];
+        frames[f].packet = syn;
+        frames[f].packet_size = sizeof(syn);
+        frames[f].sent = (f != 7);
+    }
+    g_test_manifest_frames = frames;
+    //  INFO(Santiago): four senders at once, the frame that was not sent must stay out.
+    g_test_manifest = mk_pig_manifest("test.pigm", signatures, 2);
+    CUTE_CHECK("g_test_manifest == NULL", g_test_manifest != NULL);
+    CUTE_CHECK("pig_manifest_start() != 1", pig_manifest_start(g_test_manifest) == 1);
+    for (f = 0; f < 4; f++) {
+        pthread_create(&threads[f], NULL, append_to_manifest_test, NULL);
+    }
+    for (f = 0; f < 4; f++) {
+        pthread_join(threads[f], NULL);
+    }
+    pig_manifest_stop(g_test_manifest);
+    CUTE_CHECK("wrong number of writers", g_test_manifest->buffers_nr == 4);
+    CUTE_CHECK("wrong number of records", g_test_manifest->written == 4 * 1250 * 7);
+    del_pig_manifest(g_test_manifest);
+    out = tmpfile();
+    CUTE_CHECK("pig_manifest_dump() != 1", pig_manifest_dump("test.pigm", kManifestCsv, out) == 1);
+    rewind(out);
+    while (fgets(line, sizeof(line), out) != NULL) {
+        if (lines == 1) {
+            CUTE_CHECK("wrong csv record", strcmp(line, "1700000000.000000000,\"syn\",10.0.0.1,40000,10.0.0.2,80,6,40\n") == 0);
+        } else if (lines == 2) {
+            CUTE_CHECK("the csv quoting is wrong", strstr(line, ",\"say \"\"hi\"\"\",") != NULL);
+        }
+        lines++;
+    }
+    CUTE_CHECK("wrong number of csv lines", lines == 4 * 1250 * 7 + 1);
+    fclose(out);
+    out = tmpfile();
+    CUTE_CHECK("pig_manifest_dump() != 1", pig_manifest_dump("test.pigm", kManifestJson, out) == 1);
+    rewind(out);
+    fgets(line, sizeof(line), out);
+    CUTE_CHECK("wrong json record", strcmp(line, "{\"timestamp\":1700000000.000000000,\"signature\":\"syn\",\"src_addr\":\"10.0.0.1\",\"src_port\":40000,"
+                                                 "\"dst_addr\":\"10.0.0.2\",\"dst_port\":80,\"protocol\":6,\"length\":40}\n") == 0);
+    fgets(line, sizeof(line), out);
+    CUTE_CHECK("the json escaping is wrong", strstr(line, "\"signature\":\"say \\\"hi\\\"\"") != NULL);
+    fclose(out);
+    //  INFO(Santiago): without the writer thread the ring fills up and the rest is counted, not waited for.
+    g_test_manifest = mk_pig_manifest("test.pigm", signatures, 2);
+    for (f = 0; f < PIG_MANIFEST_BUFFER_SIZE / 7 + 100; f++) {
+        pig_manifest_append(g_test_manifest, frames, 8, 0);
+    }
+    CUTE_CHECK("the full ring was not noticed", g_test_manifest->buffers[0]->dropped == (PIG_MANIFEST_BUFFER_SIZE / 7 + 100) * 7 - PIG_MANIFEST_BUFFER_SIZE);
+    pig_manifest_stop(g_test_manifest);
+    CUTE_CHECK("wrong number of records", g_test_manifest->written == PIG_MANIFEST_BUFFER_SIZE);
+    del_pig_manifest(g_test_manifest);
+    g_test_manifest = NULL;
+    CUTE_CHECK("a bogus file was dumped", pig_manifest_dump("test.pigsty", kManifestCsv, stdout) == 0);
+    remove("test.pigm");
+CUTE_TEST_CASE_END
+
+static void index_alert_record_test(const pig_manifest_record_ctx *record, void *arg) {
+    pig_alerts_index((pig_alerts_ctx *)arg, record);
+}
+
+CUTE_TEST_CASE(alerts_tests)
+    pigsty_entry_ctx entries[2], *signatures[2];
+    pig_alerts_ctx *alerts = NULL;
+    pig_manifest_ctx *manifest = NULL;
+    pig_manifest_record_ctx record;
+    pig_alert_ctx alert;
+    pig_frame_ctx frame;
+    unsigned char syn[40];
+    FILE *fp = NULL;
+    const char *eve = "{\"timestamp\":\"2015-10-17T12:00:00.003000+0200\",\"flow_id\":1,\"event_type\":\"alert\",\"src_ip\":\"10.0.0.1\","
+                      "\"src_port\":40000,\"dest_ip\":\"10.0.0.2\",\"dest_port\":80,\"proto\":\"TCP\",\"alert\":{\"action\":\"allowed\","
+                      "\"signature\":\"say \\\"src_ip\\\": {x}\",\"src_ip\":\"1.1.1.1\"},\"payload\":[\"a\",\"b\"]}";
+    const char *fast = "10/17/2015-10:00:00.004000  [**] [1:1000001:1] a {weird} message [**] [Priority: 3] {TCP} 10.0.0.2:80 -> 10.0.0.1:40000";
+    const char *lines = "{\"event_type\":\"flow\",\"src_ip\":\"10.0.0.1\",\"dest_ip\":\"10.0.0.2\",\"proto\":\"TCP\"}\n"
+                        "10/17/2015-10:00:00.005000  [**] [1:2:1] ping [**] {ICMP} 10.0.0.1 -> 10.0.0.3\n"
+                        "{\"event_type\":\"alert\",\"src_ip\":\"10.0.0.9\",\"dest_ip\":\"10.0.0.2\",\"proto\":\"UDP\"}\n"
+                        "garbage\n";
+    const char *untimed = "{\"event_type\":\"alert\",\"src_ip\":\"10.0.0.1\",\"src_port\":40000,\"dest_ip\":\"10.0.0.2\","
+                          "\"dest_port\":80,\"proto\":\"TCP\"}";
+    const char *snort = "10/17-10:00:00.000000  [**] [1:2:1] ping [**] {ICMP} 10.0.0.1 -> 10.0.0.3";
+    //  INFO(Santiago): 2015-10-17T10:00:00Z, the fast alerts are in local time, here taken as UTC.
+    const unsigned long long sent_at = 1445076000000000000ULL;
+    char *tz = getenv("TZ"), old_tz[64];
+    size_t l = 0, entries_nr = 0;
+    unsigned long long evicted = 0;
+    old_tz[0] = 0;
+    if (tz != NULL) {
+        strncpy(old_tz, tz, sizeof(old_tz) - 1);
+        old_tz[sizeof(old_tz) - 1] = 0;
+    }
+    setenv("TZ", "UTC", 1);
+    tzset();
+    memset(entries, 0, sizeof(entries));
+    entries[0].signature_name = "syn";
+    entries[1].signature_name = "ping";
+    signatures[0] = &entries[0];
+    signatures[1] = &entries[1];
+    CUTE_CHECK("the eve alert was not parsed", pig_alerts_parse(eve, strlen(eve), &alert) == 1);
+    CUTE_CHECK("wrong eve alert", alert.src_addr == 0x0a000001 && alert.dst_addr == 0x0a000002 && alert.src_port == 40000 &&
+                                  alert.dst_port == 80 && alert.proto == 6);
+    CUTE_CHECK("the fast alert was not parsed", pig_alerts_parse(fast, strlen(fast), &alert) == 1);
+    CUTE_CHECK("wrong fast alert", alert.src_addr == 0x0a000002 && alert.dst_addr == 0x0a000001 && alert.src_port == 80 &&
+                                   alert.dst_port == 40000 && alert.proto == 6);
+    CUTE_CHECK("an eve flow was taken as an alert", pig_alerts_parse(lines, strchr(lines, '\n') - lines, &alert) == 0);
+    CUTE_CHECK("garbage was taken as an alert", pig_alerts_parse("garbage", 7, &alert) == -1);
+    CUTE_CHECK("an empty line was taken as an alert", pig_alerts_parse(" \r", 2, &alert) == 0);
+    pig_alerts_parse(eve, strlen(eve), &alert);
+    CUTE_CHECK("wrong eve timestamp", alert.timestamp == sent_at + 3000000);
+    pig_alerts_parse(fast, strlen(fast), &alert);
+    CUTE_CHECK("wrong fast timestamp", alert.timestamp == sent_at + 4000000);
+    pig_alerts_parse(snort, strlen(snort), &alert);
+    CUTE_CHECK("no timestamp without the year", alert.timestamp > 0 && (alert.timestamp - sent_at) % 1000000000ULL == 0);
+    pig_alerts_parse(untimed, strlen(untimed), &alert);
+    CUTE_CHECK("a timestamp out of nothing", alert.timestamp == 0);
+    //  INFO(Santiago): a SYN and a ping sent at t, alerted at t + 3ms, t + 4ms and t + 5ms and read much later.
+    alerts = mk_pig_alerts("test.alerts", signatures, 2, PIG_ALERTS_DEFAULT_WINDOW);
+    memset(&record, 0, sizeof(record));
+    record.timestamp = sent_at;
+    record.src_addr = 0x0a000001;
+    record.dst_addr = 0x0a000002;
+    record.src_port = 40000;
+    record.dst_port = 80;
+    record.proto = 6;
+    pig_alerts_index(alerts, &record);
+    record.signature = 1;
+    record.dst_addr = 0x0a000003;
+    record.src_port = 8;
+    record.dst_port = 0;
+    record.proto = 1;
+    pig_alerts_index(alerts, &record);
+    pig_alerts_parse(eve, strlen(eve), &alert);
+    CUTE_CHECK("the alert was not matched", pig_alerts_match(alerts, &alert, sent_at + 1000000000) == 1);
+    pig_alerts_parse(fast, strlen(fast), &alert);
+    CUTE_CHECK("the alert on the answer was not matched", pig_alerts_match(alerts, &alert, sent_at + 1000000000) == 1);
+    CUTE_CHECK("wrong detection", alerts->stats[0].sent == 1 && alerts->stats[0].detected == 1 && alerts->stats[0].alerts == 2);
+    CUTE_CHECK("wrong detection latency", alerts->stats[0].latency.count == 1 && alerts->stats[0].latency.min == 3000000);
+    //  INFO(Santiago): lines split across reads.
+    for (l = 0; lines[l] != 0; l += 7) {
+        pig_alerts_feed(alerts, &lines[l], (strlen(&lines[l]) < 7 ? strlen(&lines[l]) : 7), sent_at + 1000000000);
+    }
+    CUTE_CHECK("wrong line count", alerts->lines == 4 && alerts->unparsable == 1);
+    CUTE_CHECK("the ping was not detected", alerts->stats[1].detected == 1 && alerts->stats[1].latency.min == 5000000);
+    CUTE_CHECK("wrong number of alerts", alerts->alerts == 4 && alerts->unmatched == 1);
+    alert.timestamp = sent_at + PIG_ALERTS_DEFAULT_WINDOW + 1;
+    pig_alerts_match(alerts, &alert, sent_at);
+    CUTE_CHECK("a late alert was matched", alerts->late == 1);
+    //  INFO(Santiago): without a timestamp the time the alert was read is taken.
+    pig_alerts_parse(untimed, strlen(untimed), &alert);
+    record.timestamp = sent_at;
+    record.signature = 0;
+    record.src_addr = 0x0a000001;
+    record.dst_addr = 0x0a000002;
+    record.src_port = 40000;
+    record.dst_port = 80;
+    record.proto = 6;
+    pig_alerts_index(alerts, &record);
+    CUTE_CHECK("the untimed alert was not matched", pig_alerts_match(alerts, &alert, sent_at + 7000000) == 1);
+    CUTE_CHECK("wrong untimed latency", alerts->stats[0].latency.count == 2 && alerts->stats[0].latency.max >= 7000000 &&
+                                        alerts->stats[0].latency.max < 7500000);
+    del_pig_alerts(alerts);
+    //  INFO(Santiago): more packets than entries inside the window, the ones that do not fit are counted.
+    alerts = mk_pig_alerts("test.alerts", signatures, 2, PIG_ALERTS_DEFAULT_WINDOW);
+    record.signature = 0;
+    record.proto = 17;
+    for (l = 0; l < PIG_ALERTS_TABLE_SIZE; l++) {
+        record.src_addr = 0x0a000000 | (unsigned int)l;
+        pig_alerts_index(alerts, &record);
+    }
+    for (l = 0, entries_nr = 0; l < PIG_ALERTS_TABLE_SIZE; l++) {
+        entries_nr += (alerts->table[l].signature > 0);
+    }
+    CUTE_CHECK("no packet was evicted", alerts->evicted > 0);
+    CUTE_CHECK("the evicted packets were not counted", entries_nr + alerts->evicted == PIG_ALERTS_TABLE_SIZE);
+    evicted = alerts->evicted;
+    record.timestamp += PIG_ALERTS_DEFAULT_WINDOW + 1;
+    for (l = 0; l < PIG_ALERTS_BUCKET_SIZE; l++) {
+        record.src_addr = 0x0b000000 | (unsigned int)l;
+        pig_alerts_index(alerts, &record);
+    }
+    CUTE_CHECK("a packet out of the window was counted as evicted", alerts->evicted == evicted);
+    del_pig_alerts(alerts);
+    //  INFO(Santiago): the whole thing, the alert being appended to the file while pig follows it.
+    fp = fopen("test.alerts", "w");
+    fprintf(fp, "%s\n", untimed);
+    fclose(fp);
+    manifest = mk_pig_manifest(NULL, signatures, 2);
+    alerts = mk_pig_alerts("test.alerts", signatures, 2, PIG_ALERTS_DEFAULT_WINDOW);
+    CUTE_CHECK("pig_alerts_start() != 1", pig_alerts_start(alerts, manifest, 0) == 1);
+    memset(syn, 0, sizeof(syn));
+    syn[0] = 0x45; syn[3] = 40; syn[8] = 64; syn[9] = 6; syn[12] = 10; syn[15] = 1; syn[16] = 10; syn[19] = 2;
+    syn[20] = 0x9c; syn[21] = 0x40; syn[23] = 80; syn[33] = 0x02;
+    memset(&frame, 0, sizeof(frame));
+    frame.signature = signatures[0];
+    frame.packet = syn;
+    frame.packet_size = sizeof(syn);
+    frame.sent = 1;
+    pig_manifest_append(manifest, &frame, 1, pig_wall_clock_ns());
+    usleep(50000);
+    fp = fopen("test.alerts", "a");
+    fprintf(fp, "%s\n%s", untimed, untimed);
+    fclose(fp);
+    pig_alerts_stop(alerts, 100000000ULL);
+    CUTE_CHECK("the old alert was read", alerts->lines == 1);
+    CUTE_CHECK("the followed alert was not matched", alerts->stats[0].sent == 1 && alerts->stats[0].detected == 1);
+    CUTE_CHECK("the latency is off", alerts->stats[0].latency.min >= 50000000 && alerts->stats[0].latency.min < 1000000000);
+    CUTE_CHECK("the unfinished line was taken", alerts->alerts == 1);
+    del_pig_alerts(alerts);
+    del_pig_manifest(manifest);
+    //  INFO(Santiago): a packet still in the manifest when its alert is read is not taken as unmatched.
+    manifest = mk_pig_manifest(NULL, signatures, 2);
+    alerts = mk_pig_alerts("test.alerts", signatures, 2, PIG_ALERTS_DEFAULT_WINDOW);
+    alerts->manifest = manifest;
+    pig_manifest_set_reader(manifest, index_alert_record_test, alerts);
+    pig_manifest_append(manifest, &frame, 1, pig_wall_clock_ns());
+    pig_alerts_parse(untimed, strlen(untimed), &alert);
+    CUTE_CHECK("an alert to an undrained packet was not matched", pig_alerts_match(alerts, &alert, pig_wall_clock_ns()) == 1);
+    CUTE_CHECK("wrong undrained detection", alerts->unmatched == 0 && alerts->stats[0].detected == 1);
+    pig_manifest_set_reader(manifest, NULL, NULL);
+    del_pig_alerts(alerts);
+    del_pig_manifest(manifest);
+    remove("test.alerts");
+    if (old_tz[0] != 0) {
+        setenv("TZ", old_tz, 1);
+    } else {
+        unsetenv("TZ");
+    }
+    tzset();
+CUTE_TEST_CASE_END
+
+CUTE_TEST_CASE(segment_tests)
+    pig_frame_ctx frame, segments[4];
+    unsigned char *packet = NULL, copy[2048], data[4200];
+    size_t s = 0, offset = 0, bad_chsums = 0;
+    unsigned int seq = 0;
+    //  INFO(Santiago): 10.0.0.1:40000 -> 10.0.0.2:80 carrying 4000 bytes with PSH and FIN.
+    memset(&frame, 0, sizeof(frame));
+    frame.packet_size = 40 + 4000;
+    packet = (unsigned char *) malloc(frame.packet_size);
+    for (s = 40; s < frame.packet_size; s++) {
+        packet[s] = (unsigned char)(s - 40);
+    }
+    memset(packet, 0, 40);
+    packet[0] = 0x45;
+    packet[2] = (frame.packet_size >> 8) & 0xff; packet[3] = frame.packet_size & 0xff;
+    packet[4] = 0x12; packet[5] = 0x34;
+    packet[6] = 0x40;
+    packet[8] = 64;
+    packet[9] = 6;
+    packet[12] = 10; packet[15] = 1;
+    packet[16] = 10; packet[19] = 2;
+    packet[20] = 0x9c; packet[21] = 0x40;
+    packet[23] = 80;
+    packet[24] = 0xff; packet[25] = 0xff; packet[26] = 0xff; packet[27] = 0x00;
+    packet[32] = 0x50;
+    packet[33] = 0x19;
+    frame.packet = packet;
+    frame.l2hdr_size = 14;
+    CUTE_CHECK("get_pig_tcp_hdrs_size() != 40", get_pig_tcp_hdrs_size(packet, frame.packet_size, 1460) == 40);
+    CUTE_CHECK("get_pig_tcp_hdrs_size() != 0", get_pig_tcp_hdrs_size(packet, frame.packet_size, 4000) == 0);
+    CUTE_CHECK("get_pig_tcp_segments_nr() != 3", get_pig_tcp_segments_nr(packet, frame.packet_size, 1460) == 3);
+    CUTE_CHECK("get_pig_tcp_segments_size() != 4120", get_pig_tcp_segments_size(packet, frame.packet_size, 1460) == 4120);
+    CUTE_CHECK("is_pig_tcp_gso_dgram() != 1", is_pig_tcp_gso_dgram(packet, frame.packet_size, 1460) == 1);
+    CUTE_CHECK("mk_pig_tcp_segments() != -1", mk_pig_tcp_segments(&frame, 1460, segments, 2, data) == -1);
+    CUTE_CHECK("mk_pig_tcp_segments() != 0", mk_pig_tcp_segments(&frame, 4000, segments, 4, data) == 0);
+    CUTE_CHECK("mk_pig_tcp_segments() != 3", mk_pig_tcp_segments(&frame, 1460, segments, 4, data) == 3);
+    for (s = 0, offset = 0; s < 3; s++) {
+        CUTE_CHECK("wrong segment size", segments[s].packet_size == 40 + (s < 2 ? 1460 : 1080));
+        CUTE_CHECK("wrong total length", ((segments[s].packet[2] << 8) | segments[s].packet[3]) == segments[s].packet_size);
+        CUTE_CHECK("wrong ip id", ((segments[s].packet[4] << 8) | segments[s].packet[5]) == 0x1234 + s);
+        seq = ((unsigned int)segments[s].packet[24] << 24) | ((unsigned int)segments[s].packet[25] << 16) |
+              ((unsigned int)segments[s].packet[26] << 8) | segments[s].packet[27];
+        CUTE_CHECK("wrong sequence number", seq == (unsigned int)(0xffffff00 + offset));
+        CUTE_CHECK("wrong flags", segments[s].packet[33] == (s < 2 ? 0x10 : 0x19));
+        CUTE_CHECK("wrong payload", memcmp(&segments[s].packet[40], &packet[40 + offset], segments[s].packet_size - 40) == 0);
+        CUTE_CHECK("the l2 header was not kept", segments[s].l2hdr_size == 14);
+        memcpy(copy, segments[s].packet, segments[s].packet_size);
+        chsum_ip4_dgram(copy, segments[s].packet_size);
+        bad_chsums += (memcmp(copy, segments[s].packet, segments[s].packet_size) != 0);
+        CUTE_CHECK("the segments are not back to back", segments[s].packet == &data[40 * s + offset]);
+        offset += segments[s].packet_size - 40;
+    }
+    CUTE_CHECK("wrong checksums", bad_chsums == 0);
+    //  INFO(Santiago): a SYN stays in the first segment, the data after it starts one sequence number later.
+    packet[33] = 0x02;
+    CUTE_CHECK("is_pig_tcp_gso_dgram() != 0", is_pig_tcp_gso_dgram(packet, frame.packet_size, 1460) == 0);
+    CUTE_CHECK("mk_pig_tcp_segments() != 3", mk_pig_tcp_segments(&frame, 1460, segments, 4, data) == 3);
+    CUTE_CHECK("the SYN was repeated", segments[0].packet[33] == 0x02 && segments[1].packet[33] == 0x00 && segments[2].packet[33] == 0x00);
+    CUTE_CHECK("the SYN did not take a sequence number", segments[1].packet[27] == (unsigned char)(0x00 + 1460 + 1));
+    //  INFO(Santiago): fragments and other protocols are left alone.
+    packet[6] = 0x20;
+    CUTE_CHECK("a fragment was segmented", get_pig_tcp_segments_nr(packet, frame.packet_size, 1460) == 0);
+    packet[6] = 0x40;
+    packet[9] = 17;
+    CUTE_CHECK("an UDP datagram was segmented", get_pig_tcp_segments_nr(packet, frame.packet_size, 1460) == 0);
+    free(packet);
+CUTE_TEST_CASE_END
+
+CUTE_TEST_CASE(fragment_tests)
+    pig_fragmenter_ctx fragmenter;
+    pig_fragment_ctx fragments[8];
+    pig_fragment_order_t order;
+    pig_fragment_ctx shuffled[8];
+    unsigned char dgram[120], rebuilt[100], copy[60], opts[132];
+    unsigned long long state[4], state_after[4];
+    size_t f = 0, offset = 0, last = 0, bad_chsums = 0, mf_nr = 0;
+    unsigned short flags_fragoff = 0;
+    memset(dgram, 0, sizeof(dgram));
+    dgram[0] = 0x45;
+    dgram[3] = sizeof(dgram);
+    dgram[6] = 0x40;
+    dgram[8] = 64;
+    dgram[9] = 17;
+    dgram[12] = 10; dgram[15] = 1;
+    dgram[16] = 10; dgram[19] = 2;
+    for (f = 20; f < sizeof(dgram); f++) {
+        dgram[f] = (unsigned char)f;
+    }
+    CUTE_CHECK("get_pig_fragment_order() != 1", get_pig_fragment_order(NULL, &order) == 1 && order == kFragmentInOrder);
+    CUTE_CHECK("get_pig_fragment_order() != 1", get_pig_fragment_order("reverse", &order) == 1 && order == kFragmentReverse);
+    CUTE_CHECK("get_pig_fragment_order() != 1", get_pig_fragment_order("random", &order) == 1 && order == kFragmentRandom);
+    CUTE_CHECK("get_pig_fragment_order() != 0", get_pig_fragment_order("sideways", &order) == 0);
+    //  INFO(Santiago): 100 bytes in fragments of 36 (taken as 32): 32, 32, 32 and 4.
+    memset(&fragmenter, 0, sizeof(fragmenter));
+    fragmenter.size = 36;
+    CUTE_CHECK("get_pig_fragments_nr() != 4", get_pig_fragments_nr(dgram, sizeof(dgram), &fragmenter) == 4);
+    CUTE_CHECK("mk_pig_fragments() != -1", mk_pig_fragments(dgram, sizeof(dgram), &fragmenter, fragments, 3) == -1);
+    CUTE_CHECK("mk_pig_fragments() != 4", mk_pig_fragments(dgram, sizeof(dgram), &fragmenter, fragments, 8) == 4);
+    for (f = 0; f < 4; f++) {
+        flags_fragoff = (fragments[f].hdr[6] << 8) | fragments[f].hdr[7];
+        CUTE_CHECK("wrong fragment offset", (flags_fragoff & 0x1fff) * 8 == f * 32 && fragments[f].offset == 20 + f * 32);
+        CUTE_CHECK("wrong MF/DF flags", (flags_fragoff & 0xe000) == (f < 3 ? 0x2000 : 0x0000));
+        CUTE_CHECK("wrong fragment size", fragments[f].size == (f < 3 ? 32 : 4));
+        CUTE_CHECK("wrong total length", ((fragments[f].hdr[2] << 8) | fragments[f].hdr[3]) == 20 + fragments[f].size);
+        memcpy(copy, fragments[f].hdr, fragments[f].hdr_size);
+        chsum_ip4_hdr(copy, fragments[f].hdr_size);
+        bad_chsums += (memcmp(copy, fragments[f].hdr, fragments[f].hdr_size) != 0);
+    }
+    CUTE_CHECK("wrong checksums", bad_chsums == 0);
+    CUTE_CHECK("the original datagram was touched", dgram[6] == 0x40 && dgram[3] == sizeof(dgram));
+    fragmenter.order = kFragmentReverse;
+    CUTE_CHECK("mk_pig_fragments() != 4", mk_pig_fragments(dgram, sizeof(dgram), &fragmenter, fragments, 8) == 4);
+    CUTE_CHECK("the fragments were not reversed", fragments[0].offset == 20 + 96 && fragments[3].offset == 20);
+    //  INFO(Santiago): 8 bytes of overlap, the fragments start at 0, 24, 48 and 72. Two duplicates in random order.
+    fragmenter.order = kFragmentRandom;
+    fragmenter.overlap = 5;
+    fragmenter.duplicates = 2;
+    CUTE_CHECK("mk_pig_fragments() != 6", mk_pig_fragments(dgram, sizeof(dgram), &fragmenter, fragments, 8) == 6);
+    memset(rebuilt, 0, sizeof(rebuilt));
+    for (f = 0, last = 0; f < 6; f++) {
+        flags_fragoff = (fragments[f].hdr[6] << 8) | fragments[f].hdr[7];
+        offset = (flags_fragoff & 0x1fff) * 8;
+        CUTE_CHECK("the slice does not follow the offset", fragments[f].offset == 20 + offset && offset % 24 == 0);
+        memcpy(&rebuilt[offset], &dgram[fragments[f].offset], fragments[f].size);
+        mf_nr += ((flags_fragoff & 0x2000) != 0);
+        last += (offset == 72);
+    }
+    CUTE_CHECK("the fragments do not rebuild the datagram", memcmp(rebuilt, &dgram[20], sizeof(rebuilt)) == 0);
+    CUTE_CHECK("wrong number of fragments with MF", mf_nr + last == 6);
+    //  INFO(Santiago): the random choices do not touch the thread's stream and the same datagram is cut the same way.
+    mk_rnd_init(42, 0);
+    mk_rnd_get_state(state);
+    memcpy(shuffled, fragments, sizeof(shuffled));
+    mk_pig_fragments(dgram, sizeof(dgram), &fragmenter, fragments, 8);
+    mk_rnd_get_state(state_after);
+    CUTE_CHECK("the thread's prng was touched", memcmp(state, state_after, sizeof(state)) == 0);
+    for (f = 0; f < 6; f++) {
+        CUTE_CHECK("the same datagram was cut another way", shuffled[f].offset == fragments[f].offset && shuffled[f].size == fragments[f].size);
+    }
+    //  INFO(Santiago): fragments are not fragmented again, small datagrams go as they are.
+    fragmenter.overlap = 0;
+    fragmenter.duplicates = 0;
+    dgram[7] = 0x01;
+    CUTE_CHECK("a fragment was fragmented", get_pig_fragments_nr(dgram, sizeof(dgram), &fragmenter) == 0);
+    dgram[7] = 0x00;
+    fragmenter.size = 104;
+    CUTE_CHECK("a small datagram was fragmented", get_pig_fragments_nr(dgram, sizeof(dgram), &fragmenter) == 0);
+    fragmenter.size = 16;
+    fragmenter.overlap = 16;
+    CUTE_CHECK("a full overlap was accepted", get_pig_fragments_nr(dgram, sizeof(dgram), &fragmenter) == 0);
+    //  INFO(Santiago): NOP, record route (not copied) and a copied option of 4 bytes, only the last one goes along
+    //                  with the fragments after the first.
+    memset(opts, 0, sizeof(opts));
+    memcpy(opts, dgram, 20);
+    opts[0] = 0x48;
+    opts[3] = sizeof(opts);
+    memcpy(&opts[20], "\x01\x07\x07\x04\x00\x00\x00\x00\x82\x04\xaa\xbb", 12);
+    memcpy(&opts[32], &dgram[20], 100);
+    fragmenter.size = 36;
+    fragmenter.overlap = 0;
+    fragmenter.order = kFragmentInOrder;
+    CUTE_CHECK("mk_pig_fragments() != 4", mk_pig_fragments(opts, sizeof(opts), &fragmenter, fragments, 8) == 4);
+    CUTE_CHECK("the first fragment lost options", fragments[0].hdr_size == 32 && memcmp(fragments[0].hdr + 20, &opts[20], 12) == 0);
+    for (f = 1, bad_chsums = 0; f < 4; f++) {
+        CUTE_CHECK("a fragment carries options not copied", fragments[f].hdr_size == 24 && fragments[f].hdr[0] == 0x46 &&
+                   memcmp(fragments[f].hdr + 20, "\x82\x04\xaa\xbb", 4) == 0);
+        CUTE_CHECK("wrong total length", ((fragments[f].hdr[2] << 8) | fragments[f].hdr[3]) == 24 + fragments[f].size);
+        CUTE_CHECK("wrong fragment offset", fragments[f].offset == 32 + f * 32);
+        memcpy(copy, fragments[f].hdr, fragments[f].hdr_size);
+        chsum_ip4_hdr(copy, fragments[f].hdr_size);
+        bad_chsums += (memcmp(copy, fragments[f].hdr, fragments[f].hdr_size) != 0);
+    }
+    CUTE_CHECK("wrong checksums", bad_chsums == 0);
+CUTE_TEST_CASE_END
+
+CUTE_TEST_CASE(session_stress_tests)
+    pig_flow_table_ctx *table = NULL;
+    pig_frame_ctx frame, out[16];
+    unsigned char *packet = NULL, rebuilt[300], copy[200];
+    unsigned int client_isn = 0, seq = 0;
+    size_t n = 0, d = 0, len = 0, b = 0, data_nr = 0, bad_chsums = 0, bad_heads = 0;
+    size_t starts[4] = { 0, 0, 0, 0 };
+    //  INFO(Santiago): 300 bytes, MSS 100 and 20 bytes of overlap: pieces at 0, 80, 160 and 240 plus 2 retransmissions.
+    memset(&frame, 0, sizeof(frame));
+    frame.packet_size = 40 + 300;
+    packet = (unsigned char *) malloc(frame.packet_size);
+    memset(packet, 0, 40);
+    for (b = 40; b < frame.packet_size; b++) {
+        packet[b] = (unsigned char)b;
+    }
+    packet[0] = 0x45;
+    packet[8] = 64;
+    packet[9] = 6;
+    packet[12] = 10; packet[15] = 1;
+    packet[16] = 10; packet[19] = 2;
+    packet[20] = 0x9c; packet[21] = 0x40;
+    packet[23] = 80;
+    packet[32] = 0x50;
+    packet[33] = 0x18;
+    frame.packet = packet;
+    table = mk_pig_flow_table(4);
+    CUTE_CHECK("table == NULL", table != NULL);
+    table->mss = 100;
+    table->overlap = 20;
+    table->is_shuffled = 1;
+    table->is_conflicting = 1;
+    table->retransmits = 2;
+    CUTE_CHECK("pig_session_open() != 1", pig_session_open(table, &frame) == 1);
+    for (n = 0; n < 16 && pig_session_next_frame(table, &out[n], 0); n++)
+        ;
+    //  INFO(Santiago): SYN, SYN-ACK, ACK, 6 data segments, one ACK for all, FIN, FIN-ACK, last ACK.
+    CUTE_CHECK("the session has the wrong number of segments", n == 13);
+    client_isn = ((unsigned int)out[0].packet[24] << 24) | ((unsigned int)out[0].packet[25] << 16) | ((unsigned int)out[0].packet[26] << 8) | out[0].packet[27];
+    memset(rebuilt, 0, sizeof(rebuilt));
+    for (d = 3; d < n; d++) {
+        memcpy(copy, out[d].packet, out[d].packet_size);
+        chsum_ip4_dgram(copy, out[d].packet_size);
+        bad_chsums += (memcmp(copy, out[d].packet, out[d].packet_size) != 0);
+        len = out[d].packet_size - 40;
+        if (len == 0) {
+            continue;
+        }
+        CUTE_CHECK("data segment out of the plan", d < 9);
+        seq = ((unsigned int)out[d].packet[24] << 24) | ((unsigned int)out[d].packet[25] << 16) | ((unsigned int)out[d].packet[26] << 8) | out[d].packet[27];
+        seq -= client_isn + 1;
+        CUTE_CHECK("a piece does not start where it should", seq % 80 == 0 && seq / 80 < 4);
+        CUTE_CHECK("a piece has the wrong size", len == (seq == 240 ? 60 : 100));
+        if (d < 7) {
+            starts[seq / 80]++;
+        }
+        for (b = 0; b < len; b++) {
+            if (seq > 0 && b < 20) {
+                bad_heads += (out[d].packet[40 + b] != (unsigned char)~packet[40 + seq + b]);
+            } else {
+                rebuilt[seq + b] = out[d].packet[40 + b];
+            }
+        }
+        data_nr++;
+    }
+    CUTE_CHECK("wrong checksums", bad_chsums == 0);
+    CUTE_CHECK("wrong number of data segments", data_nr == 6);
+    CUTE_CHECK("a piece was missing or repeated in the plan", starts[0] == 1 && starts[1] == 1 && starts[2] == 1 && starts[3] == 1);
+    CUTE_CHECK("the overlaps do not conflict", bad_heads == 0);
+    CUTE_CHECK("the pieces do not rebuild the stream", memcmp(rebuilt, &packet[40], sizeof(rebuilt)) == 0);
+    CUTE_CHECK("the ACK does not cover the stream", out[9].packet[33] == 0x10 &&
+                                                    out[9].packet[31] == (unsigned char)(client_isn + 1 + 300));
+    CUTE_CHECK("the FIN has the wrong seq", out[10].packet[33] == 0x11 && out[10].packet[27] == (unsigned char)(client_isn + 1 + 300));
+    CUTE_CHECK("the stress was not counted", table->retransmitted == 2 && table->overlapped >= 3);
+    CUTE_CHECK("the flow was not closed", table->active_nr == 0 && table->completed == 1);
+    for (d = 0; d < n; d++) {
+        free(out[d].packet);
+    }
+    del_pig_flow_table(table);
+CUTE_TEST_CASE_END
+
 CUTE_TEST_CASE(run_tests)
     printf("running unit tests...\n\n");
     CUTE_RUN_TEST(pigsty_file_parsing_tests);
@@ -719,6 +2250,29 @@ CUTE_TEST_CASE(run_tests)
     CUTE_RUN_TEST(tcp_chsum_evaluation_tests);
     CUTE_RUN_TEST(icmp_chsum_evaluation_tests);
     CUTE_RUN_TEST(netmask_get_range_type_tests);
+    CUTE_RUN_TEST(mk_rnd_tests);
+    CUTE_RUN_TEST(evlog_tests);
+    CUTE_RUN_TEST(fuzz_tests);
+    CUTE_RUN_TEST(template_tests);
+    CUTE_RUN_TEST(pool_tests);
+    CUTE_RUN_TEST(slots_tests);
+    CUTE_RUN_TEST(profile_tests);
+    CUTE_RUN_TEST(budget_tests);
+    CUTE_RUN_TEST(burst_tests);
+    CUTE_RUN_TEST(order_tests);
+    CUTE_RUN_TEST(prebuild_tests);
+    CUTE_RUN_TEST(pipeline_tests);
+    CUTE_RUN_TEST(cpus_tests);
+    CUTE_RUN_TEST(pacer_tests);
+    CUTE_RUN_TEST(arrivals_tests);
+    CUTE_RUN_TEST(session_tests);
+    CUTE_RUN_TEST(replies_tests);
+    CUTE_RUN_TEST(rtt_tests);
+    CUTE_RUN_TEST(manifest_tests);
+    CUTE_RUN_TEST(alerts_tests);
+    CUTE_RUN_TEST(segment_tests);
+    CUTE_RUN_TEST(fragment_tests);
+    CUTE_RUN_TEST(session_stress_tests);
 CUTE_TEST_CASE_END
 
 CUTE_MAIN(run_tests)